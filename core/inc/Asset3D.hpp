@@ -16,9 +16,10 @@
  *                If a vertex belongs to 2 different polygons with different textures or surface
  *                directions, the same vertex position can appear more than once with different
  *                normal and/or different UV coordinate
- *              * List of indices for triangle rendering lists. The list of indices is always
- *                a multiple of 3 and it specifies how to group 3 vertices to form a triangle,
- *                including the face direction (counter clock-wise)
+ *              * List of indices for triangle rendering lists. Depending on the primitive type
+ *                of the asset the list is either a multiple of 3 that specifies how to group 3
+ *                vertices to form a triangle, or a set of triangle strips separated by the
+ *                primitive restart index. In both cases the face direction is counter clock-wise
  *              * The following vector define the rendering lists. Each entry of the folowing vectors
  *                define 1 display list of triangles with it's corresponding material and texture. All
  *                the following vectors must have the same length:
@@ -42,18 +43,30 @@
 
 #include <stdint.h>
 #include <glm/glm.hpp>
+#include <memory>
+#include <string>
 #include <vector>
 #include "Material.hpp"
 #include "ProceduralUtils.hpp"
 #include "Texture.hpp"
 
+class MappedFile;
+
 namespace Procedural
 {
+class ChunkedTerrain;
 class Circle;
 class Terrain;
 class Triangle;
 };
 
+class Asset3D;
+
+/**
+ * Reference counted handle to an asset, see ResourceManager
+ */
+typedef std::shared_ptr<Asset3D> Asset3DHandle;
+
 class Asset3D
 {
   public:
@@ -63,11 +76,12 @@ class Asset3D
     friend class Asset3DStorage;
     friend class Asset3DLoaders;
     friend class Asset3DTransform;
+    friend class Procedural::ChunkedTerrain;
     friend class Procedural::Circle;
     friend class Procedural::Terrain;
     friend class Procedural::Triangle;
     friend void Procedural::AppendBentPlane(Asset3D &asset, float width, float height, float angleWidth, float angleHeight,
-                                            float angleRadius, uint32_t numVertsWidth, uint32_t numVertsHeight);
+                                            float angleRadius, uint32_t numVertsWidth, uint32_t numVertsHeight, bool strips);
 
     /**
      * Vertex data of the model
@@ -85,6 +99,28 @@ class Asset3D
      */
     static const uint32_t VertexDataPackedSize = 32;
 
+    /**
+     * Primitive used to assemble the triangles from the list of indices
+     */
+    enum PrimitiveType {
+        PRIMITIVE_TRIANGLES,     /**< Every 3 indices form an independent triangle */
+        PRIMITIVE_TRIANGLE_STRIP /**< Triangle strips separated by PrimitiveRestartIndex */
+    };
+
+    /**
+     * Index used to finish a triangle strip and start a new one in the list
+     * of indices. The renderer adjusts it to the index type used in the GPU
+     */
+    static const uint32_t PrimitiveRestartIndex = 0xFFFFFFFF;
+
+    /**
+     * What happens to the CPU copy of the data once the asset is in the GPU
+     */
+    enum ResidencyPolicy {
+        RESIDENCY_KEEP_CPU_DATA,   /**< The geometry and textures are kept in memory */
+        RESIDENCY_RELEASE_CPU_DATA /**< The geometry and textures are released, see releaseCPUData() */
+    };
+
     /**
      * Allocates a new Asset3D of the specific underlaying API
      *
@@ -130,15 +166,140 @@ class Asset3D
     const std::vector<Texture> &getTextures() const { return _textures; }
     const std::vector<uint32_t> &getIndicesOffsets() const { return _indicesOffsets; }
     const std::vector<uint32_t> &getIndicesCount() const { return _indicesCount; }
+    PrimitiveType getPrimitiveType() const { return _primitiveType; }
+    /**
+     * Geometry accessors
+     *
+     * When the asset is loaded with its geometry mapped from disk (see Asset3DStorage::Load)
+     * the vertex and index vectors are empty and the data lives in the mapped file. These
+     * accessors work in both cases and must be preferred by code that only reads the geometry.
+     * Mapped indices can be 16-bit wide, in which case the restart index is 0xFFFF
+     */
+    const VertexData *getVertexDataPtr() const { return _isGeometryExternal() ? _mappedVertexData : _vertexData.data(); }
+    uint32_t getNumVertices() const { return _isGeometryExternal() ? _mappedNumVertices : (uint32_t)_vertexData.size(); }
+    const void *getIndexDataPtr() const { return _isGeometryExternal() ? _mappedIndexData : _vertexIndices.data(); }
+    uint32_t getNumIndices() const { return _isGeometryExternal() ? _mappedNumIndices : (uint32_t)_vertexIndices.size(); }
+    uint32_t getIndexDataSize() const { return _isGeometryExternal() ? _mappedIndexSize : (uint32_t)sizeof(uint32_t); }
+    bool isGeometryMapped() const { return _mappedFile != NULL; }
+    /**
+     * Bounds of the geometry in model coordinates. The bounds always contain the
+     * origin of the model, and the maximum length vertex is the vertex farthest
+     * from it. They are either precomputed in the asset file or calculated on
+     * demand with calculateBounds()
+     */
+    bool hasBounds() const { return _boundsValid; }
+    const glm::vec3 &getBoundsMin() const { return _boundsMin; }
+    const glm::vec3 &getBoundsMax() const { return _boundsMax; }
+    const glm::vec3 &getMaxLengthVertex() const { return _maxLengthVertex; }
+    /**
+     * Calculates the bounds of the geometry from the vertex data
+     */
+    void calculateBounds();
+
+    /**
+     * Whether the asset is ready to be rendered. Assets loaded with
+     * Renderer::loadAsset3DAsync() are not resident until all their data
+     * has been uploaded to the GPU, and models using them are skipped
+     * by Renderer::renderScene() in the meantime
+     */
+    bool isResident() const { return _resident; }
+    void setResident(bool flag) { _resident = flag; }
+    /**
+     * Residency policy of the asset, applied by applyResidencyPolicy(). Assets
+     * loaded by the Renderer get the policy set with Renderer::setResidencyPolicy(),
+     * the rest keep their data
+     */
+    ResidencyPolicy getResidencyPolicy() const { return _residencyPolicy; }
+    void setResidencyPolicy(ResidencyPolicy policy) { _residencyPolicy = policy; }
+    /**
+     * Called by the renderer once the asset data is in the GPU, releases the
+     * CPU copy of the data if the residency policy says so
+     */
+    void applyResidencyPolicy();
+
+    /**
+     * Frees the vertices, the indices and the texels, or unmaps them for mapped
+     * assets. The bounds, the materials, the rendering lists and the size and
+     * format of the textures are kept, so the asset can still be rendered and
+     * used by models. The data can be brought back with reloadCPUData()
+     */
+    void releaseCPUData();
+
+    /**
+     * Loads again the data released by releaseCPUData() from the asset file
+     *
+     * @return true if the data is available, false if the asset was not
+     *         loaded from a file or the file could not be loaded
+     */
+    bool reloadCPUData();
+
+    /**
+     * Whether the vertices, indices and texels are available in memory
+     */
+    bool hasCPUData() const { return _cpuDataReleased == false; }
+    /**
+     * File the asset was loaded from, empty for assets built in memory
+     */
+    const std::string &getSourceName() const { return _sourceName; }
+    /**
+     * Exchanges the geometry, materials, textures, bounds and source file of both
+     * assets. Renderer specific data and the residency state are not exchanged
+     *
+     * @param other  Asset to exchange the data with
+     */
+    void swap(Asset3D &other);
+
   protected:
     /**
      * Constructor
      */
-    Asset3D() {}
+    Asset3D()
+        : _primitiveType(PRIMITIVE_TRIANGLES)
+        , _mappedVertexData(NULL)
+        , _mappedNumVertices(0)
+        , _mappedIndexData(NULL)
+        , _mappedNumIndices(0)
+        , _mappedIndexSize(0)
+        , _boundsValid(false)
+        , _resident(true)
+        , _residencyPolicy(RESIDENCY_KEEP_CPU_DATA)
+        , _cpuDataReleased(false)
+    {
+    }
+
+    /**
+     * Whether the geometry accessors must use the _mapped* members, which also
+     * keep the sizes of the geometry once the CPU data is released
+     */
+    bool _isGeometryExternal() const { return _mappedFile || _cpuDataReleased; }
+    /**
+     * Calculates the bounds of the given vertices as described in getBoundsMin()
+     */
+    static void _calculateBounds(const VertexData *data, uint32_t numVertices, glm::vec3 &boundsMin, glm::vec3 &boundsMax,
+                                 glm::vec3 &maxLengthVertex);
+
     std::vector<Asset3D::VertexData> _vertexData; /**< Data containing the vertex position, normal and UV coordinates */
     std::vector<Material> _materials;             /**< List of materials used in the model */
     std::vector<Texture> _textures;               /**< List of textures used in the model */
     std::vector<uint32_t> _vertexIndices;         /**< List of indices containing all rendering lists together */
     std::vector<uint32_t> _indicesOffsets;        /**< Offset in _vertexIndices of the beginning of the rendering list number 'n' */
     std::vector<uint32_t> _indicesCount;          /**< Number of indices belonging to the rendering list number 'n' */
+    PrimitiveType _primitiveType;                 /**< Primitive used to interpret _vertexIndices */
+
+    std::shared_ptr<MappedFile> _mappedFile; /**< File containing the mapped geometry, if any */
+    const VertexData *_mappedVertexData;     /**< Vertex data inside of the mapped file */
+    uint32_t _mappedNumVertices;             /**< Number of vertices in the mapped file */
+    const void *_mappedIndexData;            /**< Indices inside of the mapped file */
+    uint32_t _mappedNumIndices;              /**< Number of indices in the mapped file */
+    uint32_t _mappedIndexSize;               /**< Size in bytes of each index in the mapped file */
+
+    glm::vec3 _boundsMin;       /**< Minimum of each coordinate of the geometry */
+    glm::vec3 _boundsMax;       /**< Maximum of each coordinate of the geometry */
+    glm::vec3 _maxLengthVertex; /**< Vertex farthest from the origin */
+    bool _boundsValid;          /**< Whether the bounds match the current geometry */
+
+    bool _resident;                   /**< Whether the asset is ready to be rendered */
+    ResidencyPolicy _residencyPolicy; /**< What to do with the CPU data once in the GPU */
+    bool _cpuDataReleased;            /**< Whether releaseCPUData() freed the data */
+    std::string _sourceName;          /**< File the asset was loaded from */
 };
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include "FrustumCulling.hpp"
 #include "Object3D.hpp"
 #include "Projection.hpp"
 
@@ -35,6 +36,29 @@ class Camera : public Projection, public Object3D
      */
     bool isObjectVisible(Object3D &object);
 
+    /**
+     * Checks if any part of an axis-aligned bounding box is inside the camera's frustum
+     *
+     * @param aabb  Bounding box in world coordinates
+     *
+     * @return true if the box is visible, false otherwise
+     */
+    bool isAABBVisible(const BoundingBox &aabb);
+
+    /**
+     * Checks the visibility of many objects at once, see FrustumCulling
+     *
+     * @param bounds   Bounds of the objects to check against the camera's frustum
+     * @param visible  Returns a bit set for each visible object, with
+     *                 bounds.getMaskWords() words
+     */
+    void cullObjects(CullingBounds &bounds, uint32_t *visible) { FrustumCulling::Cull(_frustumPlanes, bounds, visible); }
+
+    /**
+     * Returns the frustum planes calculated by the last recalculateFrustum()
+     * call, normalized and pointing inwards
+     */
+    const glm::vec4 *getFrustumPlanes(void) const { return _frustumPlanes; }
   private:
     /**
      * Enumeration to access the frustum planes
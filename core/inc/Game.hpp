@@ -11,6 +11,7 @@
 #include "InputManager.hpp"
 #include "RenderTarget.hpp"
 #include "Renderer.hpp"
+#include "ResourceManager.hpp"
 #include "TextConsole.hpp"
 #include "TimeManager.hpp"
 #include "WindowManager.hpp"
@@ -30,19 +31,65 @@ class GameHandler
 class Game
 {
   public:
-    Game(const std::string &name) : _name(name), _gameHandler(NULL), _minRenderFrameMs(10000000.0f), _maxRenderFrameMs(0.0f) {}
+    Game(const std::string &name)
+        : _name(name)
+        , _gameHandler(NULL)
+        , _minRenderFrameMs(10000000.0f)
+        , _maxRenderFrameMs(0.0f)
+        , _allocationOverlay(false)
+        , _failOnAllocationBudget(false)
+        , _profilerOverlay(false)
+    {
+    }
     ~Game();
     void setHandler(GameHandler *gameHandler) { _gameHandler = gameHandler; }
     void setWindowSize(uint32_t width, uint32_t height, bool fullscreen = false);
     void setFPS(uint32_t FPS, bool unbound = false);
     void resetStats();
+
+    /**
+     * Shows the allocations of the last frame per subsystem in the text console,
+     * the engine must be built with TRACK_ALLOCATIONS, see AllocationTracker
+     *
+     * @param enable  Whether to show the allocations
+     */
+    void setAllocationOverlay(bool enable) { _allocationOverlay = enable; }
+    /**
+     * Sets the allocation budget of a frame. Frames over it are logged and,
+     * for benchmark runs, can stop the loop with an error
+     *
+     * @param maxAllocations  Maximum number of allocations per frame, 0 for no limit
+     * @param maxBytes        Maximum number of bytes allocated per frame, 0 for no limit
+     * @param failOnExceed    Whether loop() must return false when a frame exceeds the budget
+     */
+    void setAllocationBudget(uint64_t maxAllocations, uint64_t maxBytes, bool failOnExceed);
+
+    /**
+     * Shows the CPU and GPU time of each pass of the frame in the text console,
+     * enabling the Profiler if needed
+     *
+     * @param enable  Whether to show the timings
+     */
+    void setProfilerOverlay(bool enable);
+
     bool init();
     bool loop();
 
     WindowManager *getWindowManager() { return _windowManager; }
     Renderer *getRenderer() { return _renderer; }
+    ResourceManager *getResourceManager() { return ResourceManager::GetInstance(); }
     TextConsole *getTextConsole() { return &_console; }
   private:
+    /**
+     * Prints the allocation statistics of the last frame in the text console
+     */
+    void _printAllocationStats();
+
+    /**
+     * Prints the timings of the last frames in the text console
+     */
+    void _printProfile();
+
     GameHandler *_gameHandler;
     WindowManager *_windowManager;
     Renderer *_renderer;
@@ -59,4 +106,7 @@ class Game
     bool _fullscreen;
     uint32_t _width;
     uint32_t _height;
+    bool _allocationOverlay;
+    bool _failOnAllocationBudget;
+    bool _profilerOverlay;
 };
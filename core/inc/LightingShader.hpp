@@ -31,5 +31,5 @@ class LightingShader : public virtual Shader
     virtual void setDirectLight(DirectLight &directLight) = 0;
     virtual void setPointLight(uint32_t numLight, PointLight &pointLight) = 0;
     virtual void setSpotLight(uint32_t numLight, SpotLight &pointLight) = 0;
-    virtual void setMaterial(Material &material) = 0;
+    virtual void setMaterial(const Material &material) = 0;
 };
@@ -62,8 +62,28 @@ class Model3D : public Object3D
     /**
      * Constructor
      */
-    Model3D() : _lightingShader(NULL), _renderNormals(false), _isShadowCaster(true), _isShadowReceiver(true) { _asset = Asset3D::New(); }
-    Model3D(Asset3D *asset) : _asset(asset), _lightingShader(NULL), _renderNormals(false), _isShadowCaster(true), _isShadowReceiver(true) {}
+    Model3D() : _lightingShader(NULL), _renderNormals(false), _isShadowCaster(true), _isShadowReceiver(true), _isResident(false)
+    {
+        _asset = Asset3D::New();
+    }
+    Model3D(Asset3D *asset)
+        : _asset(asset), _lightingShader(NULL), _renderNormals(false), _isShadowCaster(true), _isShadowReceiver(true), _isResident(false)
+    {
+    }
+    /**
+     * Constructor for shared assets, the model keeps a reference to the
+     * asset for as long as it exists, see ResourceManager
+     */
+    Model3D(const Asset3DHandle &asset)
+        : _asset(asset.get())
+        , _assetHandle(asset)
+        , _lightingShader(NULL)
+        , _renderNormals(false)
+        , _isShadowCaster(true)
+        , _isShadowReceiver(true)
+        , _isResident(false)
+    {
+    }
     /**
      * Destructor
      */
@@ -124,6 +144,19 @@ class Model3D : public Object3D
      * @return true (receives shadow) or false (does not receive shadow)
      */
     bool isShadowReceiver(void) { return _isShadowReceiver; }
+    /**
+     * Whether the asset of the model is ready to be rendered, see Asset3D::isResident().
+     * The bounding volumes are recalculated once the asset becomes resident, as
+     * the asset has no geometry before
+     */
+    bool isResident(void)
+    {
+        if (_isResident == false && _asset->isResident() == true) {
+            _isResident = true;
+            _invalidateBoundingVolumes();
+        }
+        return _isResident;
+    }
     /**
      * Debug information
      */
@@ -135,10 +168,12 @@ class Model3D : public Object3D
      */
     void _calculateBoundingVolumes();
 
-    Asset3D *_asset;        /**< Asset containing the geometry and textures */
-    bool _renderNormals;    /**< Enables normal rendering for this model */
-    bool _isShadowCaster;   /**< Indicates if this model is a shadow caster */
-    bool _isShadowReceiver; /**< Indicates if this model is a shadow receiver */
+    Asset3D *_asset;            /**< Asset containing the geometry and textures */
+    Asset3DHandle _assetHandle; /**< Reference to _asset when it is shared */
+    bool _renderNormals;        /**< Enables normal rendering for this model */
+    bool _isShadowCaster;       /**< Indicates if this model is a shadow caster */
+    bool _isShadowReceiver;     /**< Indicates if this model is a shadow receiver */
+    bool _isResident;           /**< Indicates if the asset was resident the last time it was checked */
 
     LightingShader *_lightingShader; /** Lighting shader used to render this model */
 };
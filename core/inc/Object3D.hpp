@@ -2,7 +2,18 @@
  * @class	Object3D
  * @brief	Meta-class that represents any object in the 3D world that has a
  *          position, an orientation and a scale factor. Both the model
- *          and the view matrix can be obtained from any Object3D instance
+ *          and the view matrix can be obtained from any Object3D instance.
+ *
+ *          The transform can be kept in a TransformStore instead, see
+ *          TransformStore::attach()
+ *
+ *          Objects can be attached to a parent with Scene::setParent(). Their
+ *          position, orientation and scale are then relative to the parent
+ *          and the model matrix is the world matrix, the one of the parent
+ *          times the local one. Changing an object invalidates the cached
+ *          matrices of its descendants, stopping at the ones already invalid,
+ *          and the bounds of the subtrees it belongs to, so the work done
+ *          follows the number of objects changed
  *
  * @author	Roberto Cano (http://www.robertocano.es)
  */
@@ -14,6 +25,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include "BoundingBox.hpp"
 #include "BoundingSphere.hpp"
+#include "TransformStore.hpp"
 
 class Object3D
 {
@@ -34,7 +46,36 @@ class Object3D
         , _renderAABB(false)
         , _renderOOBB(false)
         , _enabled(true)
+        , _store(NULL)
+        , _storeIndex(0)
+        , _parent(NULL)
+        , _firstChild(NULL)
+        , _nextSibling(NULL)
+        , _subtreeAABBValid(false)
+        , _culledPass(0)
+        , _rootIndex(NoRootIndex)
+    {
+    }
+
+    /**
+     * Destructor, detaches the object from its parent, its children and its
+     * transform store. The children stay where they are, as after Scene::remove().
+     * Objects added to a Scene must be removed from it before being deleted, the
+     * destructor does not update the roots of the scene
+     */
+    virtual ~Object3D()
     {
+        while (_firstChild != NULL) {
+            Object3D *child = _firstChild;
+            glm::mat4 world = child->getModelMatrix();
+
+            child->_setParent(NULL);
+            child->_setLocalTransform(world);
+        }
+        _setParent(NULL);
+        if (_store != NULL) {
+            _store->detach(*this);
+        }
     }
 
     /**
@@ -46,9 +87,8 @@ class Object3D
      */
     void move(const glm::vec3 &amount)
     {
-        _position += amount;
-        _modelValid = false;
-        _viewValid = false;
+        _getPosition() += amount;
+        _transformChanged();
     }
 
     /**
@@ -60,9 +100,8 @@ class Object3D
      */
     void rotate(const glm::mat4 &rotation)
     {
-        _orientation = rotation * _orientation;
-        _modelValid = false;
-        _viewValid = false;
+        _getOrientation() = rotation * _getOrientation();
+        _transformChanged();
     }
 
     /**
@@ -75,9 +114,8 @@ class Object3D
      */
     void scale(const glm::vec3 &factor)
     {
-        _scale *= factor;
-        _modelValid = false;
-        _viewValid = false;
+        _getScaleFactor() *= factor;
+        _transformChanged();
     }
 
     /**
@@ -94,8 +132,13 @@ class Object3D
 
         // TODO: possible problem with lights not rendering shadow map correctly
         // when view vector is aligned with up vector
-        _view = glm::lookAt(_position, at, up);
+        _view = glm::lookAt(_getPosition(), at, up);
         _model = glm::inverse(_view);
+        if (_store != NULL) {
+            _store->setModelMatrix(_storeIndex, _model);
+        }
+        _invalidateChildren();
+        _invalidateSubtreeAABB();
 
         _modelValid = true;
         _viewValid = true;
@@ -109,29 +152,39 @@ class Object3D
      */
     void setPosition(const glm::vec3 &position)
     {
-        _position = position;
-        _modelValid = false;
-        _viewValid = false;
+        _getPosition() = position;
+        _transformChanged();
     }
     void setOrientation(const glm::mat4 &orientation)
     {
-        _orientation = orientation;
-        _modelValid = false;
-        _viewValid = false;
+        _getOrientation() = orientation;
+        _transformChanged();
     }
     void setScaleFactor(const glm::vec3 &factor)
     {
-        _scale = factor;
-        _modelValid = false;
-        _viewValid = false;
+        _getScaleFactor() = factor;
+        _transformChanged();
     }
 
     /**
      * Getters
      */
-    const glm::vec3 &getPosition() const { return _position; }
-    const glm::mat4 &getOrientation() const { return _orientation; }
-    const glm::vec3 &getScaleFactor() const { return _scale; }
+    const glm::vec3 &getPosition() const { return _store != NULL ? _store->getPosition(_storeIndex) : _position; }
+    const glm::mat4 &getOrientation() const { return _store != NULL ? _store->getOrientation(_storeIndex) : _orientation; }
+    const glm::vec3 &getScaleFactor() const { return _store != NULL ? _store->getScaleFactor(_storeIndex) : _scale; }
+    /**
+     * Returns the position of the object in world coordinates, the same as
+     * getPosition() unless the object has a parent
+     *
+     * @return A vec3 with the world position
+     */
+    glm::vec3 getWorldPosition(void) { return _parent == NULL ? getPosition() : glm::vec3(getModelMatrix()[3]); }
+    /**
+     * Hierarchy of the object, see Scene::setParent()
+     */
+    Object3D *getParent(void) { return _parent; }
+    Object3D *getFirstChild(void) { return _firstChild; }
+    Object3D *getNextSibling(void) { return _nextSibling; }
     /**
      * Returns the current direction of the model, which is the forward vector
      *
@@ -148,26 +201,50 @@ class Object3D
      */
     const glm::mat4 &getModelMatrix(void)
     {
+        if (_store != NULL) {
+            return _store->getModelMatrix(_storeIndex);
+        }
         if (_modelValid == false) {
             _model = glm::scale(glm::translate(glm::mat4(), _position) * _orientation, _scale);
+            if (_parent != NULL) {
+                _model = _parent->getModelMatrix() * _model;
+            }
             _modelValid = true;
             _boundingVolumesValid = false;
         }
         return _model;
     }
 
+    /**
+     * Returns the matrix that transforms the normals of the object to world
+     * coordinates, the inverse transpose of the model matrix
+     *
+     * @return A mat3 with the current normal matrix
+     */
+    glm::mat3 getNormalMatrix(void)
+    {
+        if (_store != NULL) {
+            return _store->getNormalMatrix(_storeIndex);
+        }
+        return glm::transpose(glm::inverse(glm::mat3(getModelMatrix())));
+    }
+
     /**
      * Returns the current view matrix of the object
      *
      * The matrix is cached and only recalculated if any of the setters or model
-     * matrix modifiers are called
+     * matrix modifiers are called. The view of an object with a parent is
+     * relative to the parent
      *
      * @return A mat4 with the current model matrix
      */
     const glm::mat4 &getViewMatrix(void)
     {
         if (_viewValid == false) {
-            _view = glm::translate(glm::scale(glm::mat4(), _scale) * _orientation, -_position);
+            _view = glm::translate(glm::scale(glm::mat4(), getScaleFactor()) * getOrientation(), -getPosition());
+            if (_parent != NULL) {
+                _view = _view * glm::inverse(_parent->getModelMatrix());
+            }
             _viewValid = true;
         }
         return _view;
@@ -175,40 +252,64 @@ class Object3D
 
     const BoundingSphere &getBoundingSphere()
     {
-        if (_oobbValid == false) {
-            _calculateBoundingVolumes();
-            _oobbValid = true;
-        }
-        if (_boundingVolumesValid == false || _modelValid == false) {
-            _updateBoundingVolumes();
-            _boundingVolumesValid = true;
-        }
-        return _boundingSphere;
+        _validateBoundingVolumes();
+        return _store != NULL ? _store->getBoundingSphere(_storeIndex) : _boundingSphere;
     }
 
     const BoundingBox &getAABB()
     {
-        if (_oobbValid == false) {
-            _calculateBoundingVolumes();
-            _oobbValid = true;
-        }
-        if (_boundingVolumesValid == false || _modelValid == false) {
-            _updateBoundingVolumes();
-            _boundingVolumesValid = true;
-        }
-        return _aabb;
+        _validateBoundingVolumes();
+        return _store != NULL ? _store->getAABB(_storeIndex) : _aabb;
     }
     const BoundingBox &getOOBB()
     {
-        if (_oobbValid == false) {
-            _calculateBoundingVolumes();
-            _oobbValid = true;
+        _validateBoundingVolumes();
+        return _oobb;
+    }
+    /**
+     * Returns the axis-aligned bounding box of the object and all its
+     * descendants, recalculated only for the subtrees that changed
+     *
+     * @return The bounding box of the subtree in world coordinates
+     */
+    const BoundingBox &getSubtreeAABB(void)
+    {
+        if (_subtreeAABBValid == false) {
+            glm::vec3 min = getAABB().getMin(), max = getAABB().getMax();
+
+            for (Object3D *child = _firstChild; child != NULL; child = child->_nextSibling) {
+                const BoundingBox &bounds = child->getSubtreeAABB();
+
+                min = glm::min(min, bounds.getMin());
+                max = glm::max(max, bounds.getMax());
+            }
+            _subtreeAABB = BoundingBox(min, max);
+            _subtreeAABBValid = true;
         }
-        if (_boundingVolumesValid == false || _modelValid == false) {
-            _updateBoundingVolumes();
-            _boundingVolumesValid = true;
+        return _subtreeAABB;
+    }
+
+    /**
+     * Marks the object and its subtree as outside the frustum during a
+     * culling pass, see Renderer::renderScene()
+     *
+     * @param pass  Number of the culling pass
+     */
+    void setCulled(uint32_t pass) { _culledPass = pass; }
+    /**
+     * Returns whether the object or one of its ancestors was marked as
+     * outside the frustum during a culling pass
+     *
+     * @param pass  Number of the culling pass
+     */
+    bool isCulled(uint32_t pass)
+    {
+        for (Object3D *object = this; object != NULL; object = object->_parent) {
+            if (object->_culledPass == pass) {
+                return true;
+            }
         }
-        return _oobb;
+        return false;
     }
 
     /**
@@ -236,6 +337,11 @@ class Object3D
     bool getRenderAABB() { return _renderAABB; }
     bool getRenderOOBB() { return _renderOOBB; }
   protected:
+    /**
+     * Value of _rootIndex for objects that are not roots of a hierarchy
+     */
+    static const uint32_t NoRootIndex = 0xFFFFFFFF;
+
     /**
      * Calculates the bounding volumes for a Model3D
      *
@@ -276,7 +382,168 @@ class Object3D
         _aabb.setMin(newCenter - newExtent);
         _aabb.setMax(newCenter + newExtent);
 
-        _boundingSphere.setRadius(glm::length(_maxLengthVertex * getScaleFactor()));
+        _boundingSphere.setRadius(glm::length(_maxLengthVertex * _getWorldScaleFactor()));
+    }
+
+    /**
+     * Scale factors of the world matrix, the ones of the object unless it has
+     * a parent
+     */
+    glm::vec3 _getWorldScaleFactor(void)
+    {
+        if (_parent == NULL) {
+            return getScaleFactor();
+        }
+
+        const glm::mat4 &model = getModelMatrix();
+        return glm::vec3(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+    }
+
+    /**
+     * Forces the recalculation of the bounding volumes in object coordinates,
+     * after the geometry of the object changes
+     */
+    void _invalidateBoundingVolumes(void)
+    {
+        _oobbValid = false;
+        _invalidateSubtreeAABB();
+    }
+
+    /**
+     * Recalculates the bounding volumes that are not valid anymore. The world
+     * volumes of the objects attached to a store are updated by the store
+     */
+    void _validateBoundingVolumes(void)
+    {
+        if (_oobbValid == false) {
+            _calculateBoundingVolumes();
+            _oobbValid = true;
+            _boundingVolumesValid = false;
+        }
+        if (_store != NULL) {
+            if (_boundingVolumesValid == false) {
+                _store->setLocalBounds(_storeIndex, _oobb, _maxLengthVertex);
+                _boundingVolumesValid = true;
+            }
+        } else if (_boundingVolumesValid == false || _modelValid == false) {
+            _updateBoundingVolumes();
+            _boundingVolumesValid = true;
+        }
+    }
+
+    /**
+     * Components of the transform, in the store if the object is attached to one
+     */
+    glm::vec3 &_getPosition(void) { return _store != NULL ? _store->getPosition(_storeIndex) : _position; }
+    glm::mat4 &_getOrientation(void) { return _store != NULL ? _store->getOrientation(_storeIndex) : _orientation; }
+    glm::vec3 &_getScaleFactor(void) { return _store != NULL ? _store->getScaleFactor(_storeIndex) : _scale; }
+    /**
+     * Invalidates the matrices after a change of the position, orientation or scale
+     */
+    void _transformChanged(void)
+    {
+        _invalidateWorld();
+        _invalidateSubtreeAABB();
+    }
+
+    /**
+     * Whether the object has any matrix calculated from the transform of its
+     * parent. When it has none its descendants have none either, as they are
+     * calculated from it
+     */
+    bool _hasValidWorld(void)
+    {
+        if (_store != NULL) {
+            return _viewValid || _store->isDirty(_storeIndex, TransformStore::DIRTY_MODEL) == false;
+        }
+        return _modelValid || _viewValid;
+    }
+
+    /**
+     * Invalidates the matrices and the subtree bounds of the object and of its
+     * descendants that are still valid
+     */
+    void _invalidateWorld(void)
+    {
+        if (_store != NULL) {
+            _store->markDirty(_storeIndex, TransformStore::DIRTY_MODEL | TransformStore::DIRTY_BOUNDS);
+        }
+        _modelValid = false;
+        _viewValid = false;
+        _subtreeAABBValid = false;
+        _invalidateChildren();
+    }
+    void _invalidateChildren(void)
+    {
+        for (Object3D *child = _firstChild; child != NULL; child = child->_nextSibling) {
+            if (child->_hasValidWorld()) {
+                child->_invalidateWorld();
+            }
+        }
+    }
+
+    /**
+     * Invalidates the subtree bounds of the object and of its ancestors, up to
+     * the first one already invalid
+     */
+    void _invalidateSubtreeAABB(void)
+    {
+        _subtreeAABBValid = false;
+        for (Object3D *object = _parent; object != NULL && object->_subtreeAABBValid; object = object->_parent) {
+            object->_subtreeAABBValid = false;
+        }
+    }
+
+    /**
+     * Sets the position, orientation and scale that give a local model
+     * matrix. The orientation keeps the shear of the matrix, if any
+     *
+     * @param model  Model matrix relative to the parent
+     */
+    void _setLocalTransform(const glm::mat4 &model)
+    {
+        glm::mat4 orientation;
+        glm::vec3 scale;
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            scale[i] = glm::length(glm::vec3(model[i]));
+            if (scale[i] != 0.0f) {
+                orientation[i] = model[i] / scale[i];
+            }
+        }
+        _getPosition() = glm::vec3(model[3]);
+        _getOrientation() = orientation;
+        _getScaleFactor() = scale;
+        _transformChanged();
+    }
+
+    /**
+     * Moves the object under a new parent, keeping its local transform
+     *
+     * @param parent  New parent or NULL
+     */
+    void _setParent(Object3D *parent)
+    {
+        if (_parent != NULL) {
+            Object3D **link = &_parent->_firstChild;
+
+            while (*link != this) {
+                link = &(*link)->_nextSibling;
+            }
+            *link = _nextSibling;
+            _parent->_invalidateSubtreeAABB();
+        }
+
+        _parent = parent;
+        if (_store != NULL) {
+            _store->setParent(_storeIndex, parent);
+        }
+        _nextSibling = NULL;
+        if (_parent != NULL) {
+            _nextSibling = _parent->_firstChild;
+            _parent->_firstChild = this;
+        }
+        _transformChanged();
     }
 
     glm::vec3 _position;    /**< Position of the object in world coordinates */
@@ -299,4 +566,22 @@ class Object3D
     bool _renderOOBB;           /**< Flag to enable model OOBB rendering */
 
     bool _enabled; /**< Indicates if this object is taken into account in the pipeline */
+
+    TransformStore *_store; /**< Store keeping the transform of the object, NULL if it is kept here */
+    uint32_t _storeIndex;   /**< Slot of the object in _store */
+
+    Object3D *_parent;        /**< Object the transform is relative to, NULL for the world */
+    Object3D *_firstChild;    /**< First object attached to this one */
+    Object3D *_nextSibling;   /**< Next object attached to the same parent */
+    BoundingBox _subtreeAABB; /**< AABB of the object and all its descendants */
+    bool _subtreeAABBValid;   /**< Indicates if _subtreeAABB is still valid */
+    uint32_t _culledPass;     /**< Last culling pass that found the subtree outside the frustum */
+    uint32_t _rootIndex;      /**< Position in the roots of its Scene, NoRootIndex if it is not one */
+
+  private:
+    Object3D(const Object3D &);
+    Object3D &operator=(const Object3D &);
+
+    friend class Scene;
+    friend class TransformStore;
 };
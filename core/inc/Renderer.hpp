@@ -6,10 +6,15 @@
  */
 #pragma once
 
+#include <stddef.h>
+#include <functional>
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
 #include "Asset3D.hpp"
+#include "FrameArena.hpp"
+#include "FrustumCulling.hpp"
+#include "Profiler.hpp"
 #include "NormalShadowMapShader.hpp"
 #include "Scene.hpp"
 #include "Viewport.hpp"
@@ -51,6 +56,64 @@ class Renderer
      */
     virtual Asset3D *loadAsset3D(const std::string &assetName) = 0;
 
+    /**
+     * Callback invoked from the rendering thread once an asset requested
+     * with loadAsset3DAsync() is resident, or when it failed to load. The
+     * residency policy of the asset is applied after the callback, once the
+     * whole asset is in the GPU, so the callback still sees its CPU data. The
+     * callback can delete the asset, the uploads still pending for it and its
+     * residency policy are then cancelled
+     *
+     * @param asset   Asset returned by loadAsset3DAsync()
+     * @param loaded  true if the asset is resident, false if it could not be loaded
+     */
+    typedef std::function<void(Asset3D *asset, bool loaded)> Asset3DLoadedCallback;
+
+    /**
+     * Loads an asset3D resource without blocking the caller
+     *
+     * The file is read and decoded in the WorkerPool, and the data is uploaded
+     * to the GPU by processAsyncLoads() a piece at a time, limited by the upload
+     * budget of each frame. The returned asset is the handle for the load: it
+     * can be used right away to create models, but it is not resident (see
+     * Asset3D::isResident()) and models using it are not rendered until the upload
+     * finishes. The asset must not be deleted before the callback is invoked,
+     * from then on it can be deleted at any time
+     *
+     * @param assetName  Asset name to be loaded from the assets directory
+     * @param callback   Optional callback invoked when the load finishes
+     *
+     * @return The asset being loaded, or NULL if an error happened
+     */
+    virtual Asset3D *loadAsset3DAsync(const std::string &assetName,
+                                      const Asset3DLoadedCallback &callback = Asset3DLoadedCallback()) = 0;
+
+    /**
+     * Continues the uploads of the assets requested with loadAsset3DAsync(),
+     * in request order, until the upload budget is consumed, and invokes the
+     * callbacks of the finished ones. Must be called once per frame from the
+     * rendering thread, Game does it before rendering each frame
+     */
+    virtual void processAsyncLoads() = 0;
+
+    /**
+     * Sets the number of bytes that processAsyncLoads() can upload to the
+     * GPU in each frame. A piece of data is always uploaded even if it is
+     * bigger than the budget, so the loads progress
+     *
+     * @param bytesPerFrame  Upload budget for each frame
+     */
+    void setUploadBudget(size_t bytesPerFrame) { _uploadBudget = bytesPerFrame; }
+    size_t getUploadBudget() { return _uploadBudget; }
+    /**
+     * Sets the residency policy of the assets loaded by loadAsset3D() and
+     * loadAsset3DAsync() from now on. By default the CPU copy of their data is
+     * released once it is in the GPU, see Asset3D::releaseCPUData()
+     *
+     * @param policy  Residency policy for the loaded assets
+     */
+    void setResidencyPolicy(Asset3D::ResidencyPolicy policy) { _residencyPolicy = policy; }
+    Asset3D::ResidencyPolicy getResidencyPolicy() { return _residencyPolicy; }
     /**
      * Prepares the given Asset3D to be rendered by the underlaying
      * rendering API
@@ -115,8 +178,8 @@ class Renderer
      * @return true or false
      */
     virtual bool renderModel3D(Model3D &model, Camera &camera, LightingShader &shader, DirectLight *sun,
-                               std::vector<PointLight *> &pointLights, std::vector<SpotLight *> &spotLights, float ambientK,
-                               RenderTarget &renderTarget, bool disableDepth = false) = 0;
+                               const FrameVector<PointLight *> &pointLights, const FrameVector<SpotLight *> &spotLights,
+                               float ambientK, RenderTarget &renderTarget, bool disableDepth = false) = 0;
 
     /**
      * Renders the shadow map of the model using the given light and the given shader. The shadow
@@ -145,6 +208,26 @@ class Renderer
      */
     virtual void clear() = 0;
 
+    /**
+     * Starts measuring the GPU time of a pass of the frame. GPU timers cannot
+     * be nested, and they do nothing unless the Profiler is enabled. Without
+     * timer queries in the context only the CPU time of the passes is measured
+     *
+     * @param name  Name of the pass, it is not copied
+     */
+    virtual void beginGPUTimer(const char *name) = 0;
+
+    /**
+     * Stops measuring the GPU time of the current pass
+     */
+    virtual void endGPUTimer() = 0;
+
+    /**
+     * Hands the GPU timers finished by the GPU to the Profiler, without
+     * waiting for the ones still in flight. Called once per frame
+     */
+    virtual void resolveGPUTimers() = 0;
+
     /**---------------------------
      * Debug rendering methods
      *----------------------------*/
@@ -175,7 +258,7 @@ class Renderer
      *
      * @return true or false
      */
-    virtual bool renderLights(std::vector<Light *> &lights, Camera &camera, RenderTarget &renderTarget) = 0;
+    virtual bool renderLights(FrameVector<Light *> &lights, Camera &camera, RenderTarget &renderTarget) = 0;
 
     /**
      * Renders the bounding box with the given color
@@ -277,16 +360,45 @@ class Renderer
         , _renderOOBB(false)
         , _renderLightsMarkers(false)
         , _shaderShadow(NULL)
+        , _uploadBudget(DefaultUploadBudget)
+        , _residencyPolicy(Asset3D::RESIDENCY_RELEASE_CPU_DATA)
+        , _cullingPass(0)
     {
     }
 
+    /**
+     * Default value for the upload budget of each frame
+     */
+    static const size_t DefaultUploadBudget = 4 * 1024 * 1024;
+
+  private:
+    static Renderer *_renderer;                /**< Singleton instance */
+    WireframeMode _wireframeMode;              /**< Sets the wireframe mode rendering. @see WireframeMode */
+    bool _renderNormals;                       /**< Global flag to enable model normals rendering */
+    bool _renderBoundingSphere;                /**< Global flag to enable model bounding sphere rendering */
+    bool _renderAABB;                          /**< Global flag to enable model AABB rendering */
+    bool _renderOOBB;                          /**< Global flag to enable model OOBB rendering */
+    bool _renderLightsMarkers;                 /**< Global flag to enable lights markers rendering */
+    NormalShadowMapShader *_shaderShadow;      /**< Preloaded shader to render shadow maps */
+    size_t _uploadBudget;                      /**< Bytes that can be uploaded to the GPU in each frame */
+    Asset3D::ResidencyPolicy _residencyPolicy; /**< Residency policy of the loaded assets */
+    CullingBounds _modelBounds;                /**< Bounds of the models of the scene, culled every frame */
+    uint32_t _cullingPass;                     /**< Number of the last culling pass, see Object3D::setCulled() */
+};
+
+/**
+ * Measures the CPU and the GPU time of a pass of the renderer while the
+ * scope is alive
+ */
+class RenderPassScope
+{
+  public:
+    RenderPassScope(Renderer *renderer, const char *name) : _cpuScope(name), _renderer(renderer) { _renderer->beginGPUTimer(name); }
+    ~RenderPassScope() { _renderer->endGPUTimer(); }
   private:
-    static Renderer *_renderer;           /**< Singleton instance */
-    WireframeMode _wireframeMode;         /**< Sets the wireframe mode rendering. @see WireframeMode */
-    bool _renderNormals;                  /**< Global flag to enable model normals rendering */
-    bool _renderBoundingSphere;           /**< Global flag to enable model bounding sphere rendering */
-    bool _renderAABB;                     /**< Global flag to enable model AABB rendering */
-    bool _renderOOBB;                     /**< Global flag to enable model OOBB rendering */
-    bool _renderLightsMarkers;            /**< Global flag to enable lights markers rendering */
-    NormalShadowMapShader *_shaderShadow; /**< Preloaded shader to render shadow maps */
+    RenderPassScope(const RenderPassScope &);
+    RenderPassScope &operator=(const RenderPassScope &);
+
+    ProfileScope _cpuScope; /**< CPU time of the pass */
+    Renderer *_renderer;    /**< Renderer measuring the GPU time */
 };
@@ -0,0 +1,180 @@
+/**
+ * @class	ResourceManager
+ * @brief	Registry of the resources shared between the objects of the engine:
+ *          assets, GPU textures and shaders. Each resource is created only once
+ *          and handed out as a reference counted handle, it is released, including
+ *          its GPU objects, as soon as the last handle is dropped.
+ *
+ *          Assets are identified by the canonical path of their file and by the hash
+ *          of its contents, so the same file reached through different paths or two
+ *          copies of the same file are loaded once. GPU textures are identified by the
+ *          hash of their pixels, identical textures referenced from several materials
+ *          or assets share the same texture object.
+ *
+ *          The registry is not thread safe, handles must be acquired and released
+ *          from the rendering thread
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include "Asset3D.hpp"
+#include "Texture.hpp"
+
+class ResourceManager
+{
+  public:
+    /**
+     * Resource manager factory
+     *
+     * @return Pointer to the resource manager
+     */
+    static ResourceManager *GetInstance(void);
+
+    /**
+     * Resource manager disposal. Handles acquired before remain valid
+     */
+    static void DisposeInstance(void);
+
+    /**
+     * Hashes a block of memory, used to identify resources by their contents
+     *
+     * @param data  Data to hash
+     * @param size  Size of the data in bytes
+     *
+     * @return 64-bit hash of the data
+     */
+    static uint64_t Hash(const void *data, size_t size);
+
+    /**
+     * Hashes the data and the layout of a texture
+     *
+     * @param texture  Texture to hash
+     *
+     * @return 64-bit hash of the texture
+     */
+    static uint64_t Hash(const Texture &texture);
+
+    /**
+     * Retrieves an asset loaded through Renderer::loadAsset3D(), loading it
+     * only if it is not already in the registry
+     *
+     * @param assetName  Name of the asset file
+     *
+     * @return Handle to the asset or an empty handle if it could not be loaded
+     */
+    Asset3DHandle acquireAsset3D(const std::string &assetName);
+
+    /**
+     * Retrieves the shader of the given type, creating and initializing it
+     * only if there is no other handle to it. T must provide New(), Delete()
+     * and init()
+     *
+     * @return Handle to the shader or an empty handle if it could not be initialized
+     */
+    template <class T>
+    std::shared_ptr<T> acquireShader(void)
+    {
+        std::string key = typeid(T).name();
+        std::shared_ptr<void> shader = _shaders[key].lock();
+
+        if (shader) {
+            return std::static_pointer_cast<T>(shader);
+        }
+
+        T *newShader = T::New();
+        if (newShader == NULL || newShader->init() == false) {
+            T::Delete(newShader);
+            _shaders.erase(key);
+            return std::shared_ptr<T>();
+        }
+
+        std::shared_ptr<T> handle(newShader, [key](T *target) {
+            if (_resourceManager != NULL) {
+                _resourceManager->_shaders.erase(key);
+            }
+            T::Delete(target);
+        });
+        _shaders[key] = handle;
+        return handle;
+    }
+
+    /**
+     * Looks for a GPU texture with the same contents and takes a reference to it
+     *
+     * @param hash  Hash of the texture, see Hash()
+     * @param id    Returns the ID of the existing texture object
+     *
+     * @return true if the texture was found, false otherwise
+     */
+    bool acquireTexture(uint64_t hash, uint32_t *id);
+
+    /**
+     * Registers a newly created GPU texture, holding one reference to it
+     *
+     * @param hash  Hash of the texture, see Hash()
+     * @param id    ID of the texture object
+     */
+    void addTexture(uint64_t hash, uint32_t id);
+
+    /**
+     * Drops a reference to a GPU texture
+     *
+     * @param id  ID of the texture object
+     *
+     * @return true if that was the last reference and the texture object must be
+     *         deleted by the caller, false otherwise
+     */
+    bool releaseTexture(uint32_t id);
+
+    /**
+     * Returns the number of assets currently in the registry
+     *
+     * @return Number of assets
+     */
+    size_t getNumAssets3D(void) const { return _assets.size(); }
+    /**
+     * Returns the number of GPU textures currently in the registry
+     *
+     * @return Number of textures
+     */
+    size_t getNumTextures(void) const { return _textures.size(); }
+  private:
+    /**
+     * Asset in the registry
+     */
+    struct AssetEntry {
+        std::weak_ptr<Asset3D> asset; /**< Asset, expired once all the handles are dropped */
+        const Asset3D *pointer;       /**< Asset, to find the entry while it is being released */
+        uint64_t hash;                /**< Hash of the contents of the file */
+    };
+
+    /**
+     * GPU texture in the registry
+     */
+    struct TextureEntry {
+        uint64_t hash;       /**< Hash of the pixels */
+        uint32_t references; /**< Number of users of the texture object */
+    };
+
+    /**
+     * Removes all the entries pointing to an asset, called when its last
+     * handle is dropped
+     *
+     * @param asset  Asset being released
+     */
+    void _releaseAsset3D(const Asset3D *asset);
+
+    static ResourceManager *_resourceManager; /**< Current resource manager */
+
+    std::map<std::string, AssetEntry> _assets;            /**< Assets by canonical path */
+    std::map<uint64_t, std::string> _assetsByHash;        /**< Canonical path of the asset loaded for each file hash */
+    std::map<uint64_t, uint32_t> _texturesByHash;         /**< Texture object for each pixels hash */
+    std::map<uint32_t, TextureEntry> _textures;           /**< Texture objects in use */
+    std::map<std::string, std::weak_ptr<void> > _shaders; /**< Shaders by type */
+};
@@ -5,27 +5,42 @@
  *          render the scene. Each added element will have an associated name that can be
  *          used to access the element to modify it, or to remove it from the scene
  *
+ *          The elements of each type are kept in a HandlePool, so they can be
+ *          iterated as a packed array and added, removed and retrieved, by
+ *          handle or by name, in constant time
+ *
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #pragma once
 
 #include <glm/glm.hpp>
-#include <map>
 #include <string>
 #include "Camera.hpp"
 #include "DirectLight.hpp"
+#include "HandlePool.hpp"
 #include "Model3D.hpp"
 #include "PointLight.hpp"
 #include "RenderTarget.hpp"
 #include "SpotLight.hpp"
+#include "TransformStore.hpp"
 
 class Scene
 {
   public:
+    /**
+     * Handles to the elements of the scene
+     */
+    typedef Handle<Model3D> ModelHandle;
+    typedef Handle<PointLight> PointLightHandle;
+    typedef Handle<SpotLight> SpotLightHandle;
+    typedef Handle<DirectLight> DirectLightHandle;
+    typedef Handle<Camera> CameraHandle;
+    typedef Handle<RenderTarget> RenderTargetHandle;
+
     /**
      * Constructor
      */
-    Scene() : _activeCamera(NULL), _activeRenderTarget(NULL) {}
+    Scene() : _activeCamera(NULL), _activeRenderTarget(NULL), _useTransformStore(false) {}
     /**
      * Methods to add different elements to the scene by name
      *
@@ -40,18 +55,48 @@ class Scene
      * the active camera or render target for the scene until it is changed using
      * setActiveCamera or setActiveRenderTarget
      *
+     * The name is optional, elements added without one can only be retrieved
+     * with the handle returned
+     *
      * @param name  Name of the element in the scene
      * @param elem  Element to be added to the scene
      *
-     * @return true if the element was added or false if
-     *              the name already exists
+     * @return Handle of the element, or the null handle, which converts
+     *         to false, if the name already exists
+     */
+    ModelHandle add(const std::string &name, Model3D *elem);
+    PointLightHandle add(const std::string &name, PointLight *elem);
+    SpotLightHandle add(const std::string &name, SpotLight *elem);
+    DirectLightHandle add(const std::string &name, DirectLight *elem);
+    CameraHandle add(const std::string &name, Camera *elem);
+    RenderTargetHandle add(const std::string &name, RenderTarget *elem);
+    ModelHandle add(Model3D *elem) { return add(std::string(), elem); }
+    PointLightHandle add(PointLight *elem) { return add(std::string(), elem); }
+    SpotLightHandle add(SpotLight *elem) { return add(std::string(), elem); }
+    DirectLightHandle add(DirectLight *elem) { return add(std::string(), elem); }
+    CameraHandle add(Camera *elem) { return add(std::string(), elem); }
+    RenderTargetHandle add(RenderTarget *elem) { return add(std::string(), elem); }
+    /**
+     * Methods to remove an element from the scene. The element is not
+     * deleted, it is detached from its parent, its children and the transform
+     * store of the scene. The children stay where they are in the world, as
+     * roots. The handle becomes invalid, and the order of the elements of the
+     * same type changes. Elements must be removed before they are deleted
+     *
+     * When the active camera or render target is removed, the first one left
+     * becomes the active one
+     *
+     * @param handle  Handle of the element
+     *
+     * @return true if the element was removed or false if the handle is not
+     *         valid
      */
-    bool add(const std::string &name, Model3D *elem);
-    bool add(const std::string &name, PointLight *elem);
-    bool add(const std::string &name, SpotLight *elem);
-    bool add(const std::string &name, DirectLight *elem);
-    bool add(const std::string &name, Camera *elem);
-    bool add(const std::string &name, RenderTarget *elem);
+    bool remove(ModelHandle handle);
+    bool remove(PointLightHandle handle);
+    bool remove(SpotLightHandle handle);
+    bool remove(DirectLightHandle handle);
+    bool remove(CameraHandle handle);
+    bool remove(RenderTargetHandle handle);
 
     /**
      * Methods to retrieve an element from the scene by name
@@ -67,17 +112,31 @@ class Scene
     Camera *getCamera(const std::string &name);
     RenderTarget *getRenderTarget(const std::string &name);
 
+    /**
+     * Methods to retrieve an element from the scene by handle
+     *
+     * @param handle  Handle returned when the element was added
+     *
+     * @return The requested element, or NULL if it was removed
+     */
+    Model3D *getModel(ModelHandle handle) { return _models.get(handle); }
+    PointLight *getPointLight(PointLightHandle handle) { return _pointLights.get(handle); }
+    SpotLight *getSpotLight(SpotLightHandle handle) { return _spotLights.get(handle); }
+    DirectLight *getDirectLight(DirectLightHandle handle) { return _directLights.get(handle); }
+    Camera *getCamera(CameraHandle handle) { return _cameras.get(handle); }
+    RenderTarget *getRenderTarget(RenderTargetHandle handle) { return _renderTargets.get(handle); }
+
     /**
      * Retrieves the internal maps of elements
      *
      * @return The map of elements including the names and the elements
      */
-    std::vector<Model3D *> &getModels(void) { return _models; }
-    std::vector<PointLight *> &getPointLights(void) { return _pointLights; }
-    std::vector<SpotLight *> &getSpotLights(void) { return _spotLights; }
-    std::vector<DirectLight *> &getDirectLights(void) { return _directLights; }
-    std::vector<Camera *> &getCameras(void) { return _cameras; }
-    std::vector<RenderTarget *> &getRenderTargets(void) { return _renderTargets; }
+    std::vector<Model3D *> &getModels(void) { return _models.getElements(); }
+    std::vector<PointLight *> &getPointLights(void) { return _pointLights.getElements(); }
+    std::vector<SpotLight *> &getSpotLights(void) { return _spotLights.getElements(); }
+    std::vector<DirectLight *> &getDirectLights(void) { return _directLights.getElements(); }
+    std::vector<Camera *> &getCameras(void) { return _cameras.getElements(); }
+    std::vector<RenderTarget *> &getRenderTargets(void) { return _renderTargets.getElements(); }
     /**
      * Sets the active camera to be used for rendering
      *
@@ -119,20 +178,75 @@ class Scene
      * @return The active render target
      * */
     RenderTarget *getActiveRenderTarget(void) { return _activeRenderTarget; }
+    /**
+     * Keeps the transforms of the models and the point and spot lights in the
+     * transform store of the scene, so they are updated in one batch per frame.
+     * Disabled by default: the batch pays off when most of the elements move
+     * every frame, while in scenes where a few hierarchies move the elements
+     * updated on access are faster
+     *
+     * @param enable  true to attach the elements to the store, including the
+     *                ones added later, false to detach them
+     */
+    void useTransformStore(bool enable);
+
+    /**
+     * Retrieves the transform store of the scene
+     *
+     * @return The transform store, empty unless useTransformStore() is enabled
+     */
+    TransformStore &getTransformStore(void) { return _transformStore; }
+    /**
+     * Attaches an element of the scene to another one, its position,
+     * orientation and scale become relative to the parent. The local
+     * transform is kept, so the element moves with the parent from then on
+     *
+     * Subtrees whose bounds are outside the frustum are culled at once, see
+     * Object3D::getSubtreeAABB()
+     *
+     * @param child   Element to attach
+     * @param parent  New parent, or NULL to detach the element from its parent
+     *
+     * @return true if the element was attached or false if the parent is the
+     *         element itself or one of its descendants
+     */
+    bool setParent(Object3D *child, Object3D *parent);
+
+    /**
+     * Retrieves the elements with children and without parent, in no
+     * particular order
+     *
+     * @return The roots of the hierarchies of the scene
+     */
+    std::vector<Object3D *> &getRoots(void) { return _roots; }
   private:
-    std::map<std::string, Model3D *> _modelsNames;             /**< Contains all models in the scene associated by name */
-    std::vector<Model3D *> _models;                            /**< Contains all models in the scene */
-    std::map<std::string, PointLight *> _pointLightsNames;     /**< Contains all point lights in the scene associated by name */
-    std::vector<PointLight *> _pointLights;                    /**< Contains all point lights in the scene */
-    std::map<std::string, SpotLight *> _spotLightsNames;       /**< Contains all spot lights in the scene associated by name */
-    std::vector<SpotLight *> _spotLights;                      /**< Contains all spot lights in the scene */
-    std::map<std::string, DirectLight *> _directLightsNames;   /**< Contains all direct lights in the scene associated by name */
-    std::vector<DirectLight *> _directLights;                  /**< Contains all direct lights in the scene */
-    std::map<std::string, Camera *> _camerasNames;             /**< Contains all cameras in the scene associated by name */
-    std::vector<Camera *> _cameras;                            /**< Contains all cameras in the scene */
-    std::map<std::string, RenderTarget *> _renderTargetsNames; /**< Contains all render targets lights in the scene associated by name */
-    std::vector<RenderTarget *> _renderTargets;                /**< Contains all render targets lights */
+    Scene(const Scene &);
+    Scene &operator=(const Scene &);
+
+    /**
+     * Adds an element to _roots or removes it, depending on whether it is a
+     * root of a hierarchy. The elements know their position in _roots, so
+     * both take constant time
+     */
+    void _updateRoot(Object3D *elem);
+
+    /**
+     * Detaches an element being removed from its parent, its children and the
+     * transform store
+     */
+    void _removeObject(Object3D *elem);
+
+    HandlePool<Model3D> _models;             /**< Contains all models in the scene */
+    HandlePool<PointLight> _pointLights;     /**< Contains all point lights in the scene */
+    HandlePool<SpotLight> _spotLights;       /**< Contains all spot lights in the scene */
+    HandlePool<DirectLight> _directLights;   /**< Contains all direct lights in the scene */
+    HandlePool<Camera> _cameras;             /**< Contains all cameras in the scene */
+    HandlePool<RenderTarget> _renderTargets; /**< Contains all render targets in the scene */
 
     Camera *_activeCamera;             /**< The current active camera */
     RenderTarget *_activeRenderTarget; /**< The current active render target */
+
+    TransformStore _transformStore; /**< Transforms of the elements when _useTransformStore is set */
+    bool _useTransformStore;        /**< Attach the models and lights to _transformStore */
+    std::vector<Object3D *> _roots; /**< Elements with children and without parent */
 };
@@ -0,0 +1,32 @@
+/**
+ * @class	SteadyTimeManager
+ * @brief	Time manager based on the monotonic clock of the standard library,
+ *          used when there is no GLFW window
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <chrono>
+#include "TimeManager.hpp"
+
+class SteadyTimeManager : public TimeManager
+{
+  public:
+    /**
+     * Constructor of the class, the elapsed time starts now
+     */
+    SteadyTimeManager(void) : _start(std::chrono::steady_clock::now()) {}
+    /**
+     * Destructor of the class
+     */
+    ~SteadyTimeManager(void) {}
+    /**
+     * Retrieves the elapsed milliseconds
+     */
+    double getElapsedMs() { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count(); }
+  private:
+    /**
+     * Creation time
+     */
+    std::chrono::steady_clock::time_point _start;
+};
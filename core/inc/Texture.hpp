@@ -2,28 +2,179 @@
  * @class	Texture
  * @brief	Holds the texture data
  *
+ *          The data can contain a full mip chain, with each level
+ *          stored right after the previous one, and can be block compressed
+ *          in which case it is made of 4x4 texel blocks, see TextureCodec.
+ *
+ *          The texture owns its data, allocated with new[]: copies duplicate
+ *          it and moves transfer it
+ *
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #pragma once
 
 #include <stdint.h>
 #include <string.h>
+#include <utility>
 
 class Texture
 {
   public:
+    /**
+     * Layout of the texels in memory
+     */
+    enum Format {
+        FORMAT_RAW = 0, /**< _Bpp bytes per texel, RGB or RGBA */
+        FORMAT_BC1 = 1, /**< 8 bytes per 4x4 block, opaque RGB */
+        FORMAT_BC3 = 2  /**< 16 bytes per 4x4 block, RGB plus interpolated alpha */
+    };
+
     /* TODO: comment this class */
-    Texture() : _texture(NULL), _width(0), _height(0), _Bpp(0) {}
-    Texture(uint8_t *texture, uint32_t width, uint32_t height, uint32_t Bpp) : _width(width), _height(height), _Bpp(Bpp)
+    Texture() : _texture(NULL), _width(0), _height(0), _Bpp(0), _format(FORMAT_RAW), _levels(1) {}
+    Texture(uint8_t *texture, uint32_t width, uint32_t height, uint32_t Bpp)
+        : _texture(NULL), _width(width), _height(height), _Bpp(Bpp), _format(FORMAT_RAW), _levels(1)
     {
         if (texture != NULL) {
             _texture = new uint8_t[_width * _height * _Bpp];
             memcpy(_texture, texture, _width * _height * _Bpp);
         }
     }
+    Texture(const Texture &other)
+        : _texture(NULL)
+        , _width(other._width)
+        , _height(other._height)
+        , _Bpp(other._Bpp)
+        , _format(other._format)
+        , _levels(other._levels)
+    {
+        if (other._texture != NULL) {
+            _texture = new uint8_t[other.getBytes()];
+            memcpy(_texture, other._texture, other.getBytes());
+        }
+    }
+    Texture(Texture &&other) noexcept
+        : _texture(other._texture)
+        , _width(other._width)
+        , _height(other._height)
+        , _Bpp(other._Bpp)
+        , _format(other._format)
+        , _levels(other._levels)
+    {
+        other._texture = NULL;
+    }
+    ~Texture() { delete[] _texture; }
+    Texture &operator=(Texture other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    /**
+     * Exchanges the data and the description of both textures
+     *
+     * @param other  Texture to exchange with
+     */
+    void swap(Texture &other)
+    {
+        std::swap(_texture, other._texture);
+        std::swap(_width, other._width);
+        std::swap(_height, other._height);
+        std::swap(_Bpp, other._Bpp);
+        std::swap(_format, other._format);
+        std::swap(_levels, other._levels);
+    }
+
+    /**
+     * Frees the data of the texture, its description is kept
+     */
+    void freeData()
+    {
+        delete[] _texture;
+        _texture = NULL;
+    }
+
+    /**
+     * Size in texels of a mipmap level
+     *
+     * @param size   Size of the level 0
+     * @param level  Mipmap level
+     *
+     * @return Size of the level
+     */
+    static uint32_t GetLevelSize(uint32_t size, uint32_t level)
+    {
+        size >>= level;
+        return size > 0 ? size : 1;
+    }
+
+    /**
+     * Size in bytes of an image in the given format
+     *
+     * @param format  Format of the image
+     * @param width   Width of the image
+     * @param height  Height of the image
+     * @param Bpp     Bytes per texel, only used by FORMAT_RAW
+     *
+     * @return Size of the image in bytes
+     */
+    static size_t GetImageBytes(Format format, uint32_t width, uint32_t height, uint32_t Bpp)
+    {
+        size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+
+        switch (format) {
+            case FORMAT_BC1:
+                return blocks * 8;
+            case FORMAT_BC3:
+                return blocks * 16;
+            default:
+                return (size_t)width * height * Bpp;
+        }
+    }
+
+    /**
+     * Size in bytes of a mipmap level of this texture
+     *
+     * @param level  Mipmap level
+     *
+     * @return Size of the level in bytes
+     */
+    size_t getLevelBytes(uint32_t level) const
+    {
+        return GetImageBytes((Format)_format, GetLevelSize(_width, level), GetLevelSize(_height, level), _Bpp);
+    }
+
+    /**
+     * Offset of a mipmap level from the start of the data
+     *
+     * @param level  Mipmap level
+     *
+     * @return Offset of the level in bytes
+     */
+    size_t getLevelOffset(uint32_t level) const
+    {
+        size_t offset = 0;
+        for (uint32_t i = 0; i < level; ++i) {
+            offset += getLevelBytes(i);
+        }
+        return offset;
+    }
 
+    /**
+     * Size in bytes of the whole data, all the levels included
+     *
+     * @return Size of the data in bytes
+     */
+    size_t getBytes() const { return getLevelOffset(_levels); }
+    /**
+     * Whether the texture is block compressed
+     *
+     * @return true if the texture is compressed
+     */
+    bool isCompressed() const { return _format != FORMAT_RAW; }
     uint8_t *_texture;
     uint32_t _width;
     uint32_t _height;
-    uint32_t _Bpp;
+    uint32_t _Bpp;    /**< Bytes per texel of the uncompressed texture */
+    uint32_t _format; /**< Format, see Format */
+    uint32_t _levels; /**< Number of mipmap levels stored in _texture */
 };
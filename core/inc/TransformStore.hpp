@@ -0,0 +1,212 @@
+/**
+ * @class	TransformStore
+ * @brief	Keeps the transforms of many Object3D in contiguous arrays, one per
+ *          component (positions, orientations, scales, model and normal
+ *          matrices and world bounds), instead of inside each object.
+ *
+ *          Objects attached to a store become handles to a slot of it. Their
+ *          setters only write the component and queue the slot in a dirty
+ *          list, and update() rebuilds the model matrices, normal matrices
+ *          and world bounds of all the queued slots in one pass, with SSE
+ *          and split among the WorkerPool threads. Reading the matrices or the
+ *          bounds of a slot still queued updates just that slot, so attached
+ *          objects behave exactly like detached ones.
+ *
+ *          Objects with a parent are updated after it: update() puts the
+ *          queued slots in one bucket per depth in the hierarchy and updates
+ *          the buckets in order.
+ *
+ *          Removing a slot moves the last one into its place, so the arrays
+ *          stay packed. Attached objects cannot be copied
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "BoundingBox.hpp"
+#include "BoundingSphere.hpp"
+
+class Object3D;
+
+class TransformStore
+{
+  public:
+    /**
+     * Parts of a slot that must be recalculated
+     */
+    enum DirtyFlags {
+        DIRTY_MODEL = 1,  /**< Model matrix, from the position, orientation and scale */
+        DIRTY_BOUNDS = 2, /**< Normal matrix and world bounds, from the model matrix */
+        QUEUED = 4        /**< The slot is in the dirty list */
+    };
+
+    /**
+     * Constructor
+     */
+    TransformStore();
+
+    /**
+     * Destructor, detaches all the objects
+     */
+    ~TransformStore();
+
+    /**
+     * Moves the transform of an object into the store. The object is
+     * detached from its previous store, if any
+     *
+     * @param object  Object to attach
+     */
+    void attach(Object3D &object);
+
+    /**
+     * Moves the transform of an object back into the object
+     *
+     * @param object  Object attached to this store
+     */
+    void detach(Object3D &object);
+
+    /**
+     * Number of objects attached
+     */
+    uint32_t size(void) const { return (uint32_t)_owners.size(); }
+    /**
+     * Number of slots waiting for update()
+     */
+    uint32_t getNumDirty(void) const { return (uint32_t)_dirty.size(); }
+    /**
+     * Recalculates the matrices and bounds of all the slots modified since
+     * the last update
+     */
+    void update(void);
+
+    /**
+     * Components of a slot. Writing them must be followed by markDirty()
+     */
+    glm::vec3 &getPosition(uint32_t slot) { return _positions[slot]; }
+    glm::mat4 &getOrientation(uint32_t slot) { return _orientations[slot]; }
+    glm::vec3 &getScaleFactor(uint32_t slot) { return _scales[slot]; }
+    /**
+     * Queues a slot for the next update
+     *
+     * @param slot   Slot modified
+     * @param flags  DIRTY_MODEL and/or DIRTY_BOUNDS
+     */
+    void markDirty(uint32_t slot, uint8_t flags)
+    {
+        if ((_flags[slot] & QUEUED) == 0) {
+            _dirty.push_back(slot);
+        }
+        _flags[slot] |= flags | QUEUED;
+    }
+    /**
+     * Returns whether a slot has any of the given dirty flags set
+     */
+    bool isDirty(uint32_t slot, uint8_t flags) const { return (_flags[slot] & flags) != 0; }
+
+    /**
+     * Sets a model matrix not built from the position, orientation and
+     * scale of the slot, see Object3D::lookAt()
+     *
+     * @param slot   Slot modified
+     * @param model  Model matrix
+     */
+    void setModelMatrix(uint32_t slot, const glm::mat4 &model);
+
+    /**
+     * Sets the bounds of a slot in object coordinates
+     *
+     * @param slot             Slot modified
+     * @param oobb             Bounding box in object coordinates
+     * @param maxLengthVertex  Vertex farthest from the origin, for the bounding sphere
+     */
+    void setLocalBounds(uint32_t slot, const BoundingBox &oobb, const glm::vec3 &maxLengthVertex);
+
+    /**
+     * Sets the parent of the object of a slot, see Object3D::_setParent().
+     * Must be followed by markDirty()
+     *
+     * @param slot    Slot modified
+     * @param parent  New parent or NULL
+     */
+    void setParent(uint32_t slot, Object3D *parent) { _parents[slot] = parent; }
+
+    /**
+     * Results of a slot, updated first if the slot is dirty
+     */
+    const glm::mat4 &getModelMatrix(uint32_t slot)
+    {
+        _updateIfDirty(slot);
+        return _models[slot];
+    }
+    const glm::mat3 &getNormalMatrix(uint32_t slot)
+    {
+        _updateIfDirty(slot);
+        return _normals[slot];
+    }
+    const BoundingBox &getAABB(uint32_t slot)
+    {
+        _updateIfDirty(slot);
+        return _aabbs[slot];
+    }
+    const BoundingSphere &getBoundingSphere(uint32_t slot)
+    {
+        _updateIfDirty(slot);
+        return _spheres[slot];
+    }
+
+  private:
+    TransformStore(const TransformStore &);
+    TransformStore &operator=(const TransformStore &);
+
+    /**
+     * Minimum number of dirty slots to split the update among the workers
+     */
+    static const uint32_t ParallelThreshold = 1024;
+
+    /**
+     * Slots updated by each task of the parallel update
+     */
+    static const uint32_t SlotsPerTask = 256;
+
+    void _updateIfDirty(uint32_t slot)
+    {
+        if ((_flags[slot] & (DIRTY_MODEL | DIRTY_BOUNDS)) != 0) {
+            _updateSlot(slot);
+        }
+    }
+
+    /**
+     * Recalculates the dirty parts of a slot and clears its dirty flags
+     */
+    void _updateSlot(uint32_t slot);
+
+    /**
+     * Updates the slots of a bucket, in parallel if there are many
+     */
+    void _updateSlots(const std::vector<uint32_t> &slots);
+
+    /**
+     * Returns the number of ancestors of the object of a slot. The parent is
+     * updated first if it is not in this store, so the slot can be updated
+     * from any thread
+     */
+    uint32_t _prepareParent(uint32_t slot);
+
+    std::vector<glm::vec3> _positions;          /**< Position of each object */
+    std::vector<glm::mat4> _orientations;       /**< Orientation of each object */
+    std::vector<glm::vec3> _scales;             /**< Scale factors of each object */
+    std::vector<glm::mat4> _models;             /**< Model matrices */
+    std::vector<glm::mat3> _normals;            /**< Normal matrices, the inverse transpose of the model matrices */
+    std::vector<BoundingBox> _localBounds;      /**< Bounding boxes in object coordinates */
+    std::vector<glm::vec3> _maxLengths;         /**< Vertices farthest from the origin */
+    std::vector<BoundingBox> _aabbs;            /**< Axis-aligned bounding boxes in world coordinates */
+    std::vector<BoundingSphere> _spheres;       /**< Bounding spheres */
+    std::vector<uint8_t> _flags;                /**< DirtyFlags of each slot */
+    std::vector<Object3D *> _owners;            /**< Object of each slot */
+    std::vector<Object3D *> _parents;           /**< Parent of each object, the roots are updated without reading their object */
+    std::vector<uint32_t> _dirty;               /**< Slots queued for the next update, may be out of range after a removal */
+    std::vector<std::vector<uint32_t>> _levels; /**< Slots being updated in one bucket per depth, kept between updates */
+};
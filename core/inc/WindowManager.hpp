@@ -15,6 +15,30 @@
 class WindowManager
 {
   public:
+    /**
+     * Window manager implementations
+     */
+    enum Backend {
+        BACKEND_WINDOWED, /**< Native window through GLFW */
+        BACKEND_HEADLESS  /**< Offscreen surface without display, see EGLWindowManager */
+    };
+
+    /**
+     * Selects the window manager implementation, must be called before the
+     * first GetInstance(). By default the window is native unless the
+     * ENGINE_HEADLESS environment variable is set to a value other than 0
+     *
+     * @param backend  Implementation to use
+     */
+    static void SetBackend(Backend backend);
+
+    /**
+     * Returns the window manager implementation in use
+     *
+     * @return Implementation of the window manager
+     */
+    static Backend GetBackend(void);
+
     /**
      * Window Manager factory
      *
@@ -110,9 +134,36 @@ class WindowManager
      */
     virtual void poll(void) = 0;
 
+    /**
+     * Creates a rendering context that shares its objects with the context
+     * of the window, so another thread can upload data to the GPU. Must be
+     * called from the main thread after createWindow()
+     *
+     * @return true if the context was created, false if not supported
+     */
+    virtual bool createUploadContext(void) = 0;
+
+    /**
+     * Makes the context created by createUploadContext() current in the
+     * calling thread, or releases it from the calling thread
+     *
+     * @param current  true to make it current, false to release it
+     */
+    virtual void makeUploadContextCurrent(bool current) = 0;
+
   private:
     /**
      * Current window manager
      */
     static WindowManager *_windowManager;
+
+    /**
+     * Whether the backend was selected, by SetBackend() or the environment
+     */
+    static bool _backendSelected;
+
+    /**
+     * Selected window manager implementation
+     */
+    static Backend _backend;
 };
@@ -4,13 +4,139 @@
  */
 
 #include "Asset3D.hpp"
+#include <utility>
+#include "Asset3DStorage.hpp"
+#include "Logging.hpp"
+#include "MappedFile.hpp"
 #include "OpenGLAsset3D.hpp"
 
+using namespace Logging;
+
+const uint32_t Asset3D::PrimitiveRestartIndex;
+
 Asset3D *Asset3D::New(void) { return new OpenGLAsset3D(); }
 void Asset3D::Delete(Asset3D *asset) { delete asset; }
+void Asset3D::calculateBounds()
+{
+    _calculateBounds(getVertexDataPtr(), getNumVertices(), _boundsMin, _boundsMax, _maxLengthVertex);
+    _boundsValid = true;
+}
+
+void Asset3D::swap(Asset3D &other)
+{
+    _vertexData.swap(other._vertexData);
+    _materials.swap(other._materials);
+    _textures.swap(other._textures);
+    _vertexIndices.swap(other._vertexIndices);
+    _indicesOffsets.swap(other._indicesOffsets);
+    _indicesCount.swap(other._indicesCount);
+    std::swap(_primitiveType, other._primitiveType);
+
+    _mappedFile.swap(other._mappedFile);
+    std::swap(_mappedVertexData, other._mappedVertexData);
+    std::swap(_mappedNumVertices, other._mappedNumVertices);
+    std::swap(_mappedIndexData, other._mappedIndexData);
+    std::swap(_mappedNumIndices, other._mappedNumIndices);
+    std::swap(_mappedIndexSize, other._mappedIndexSize);
+
+    std::swap(_boundsMin, other._boundsMin);
+    std::swap(_boundsMax, other._boundsMax);
+    std::swap(_maxLengthVertex, other._maxLengthVertex);
+    std::swap(_boundsValid, other._boundsValid);
+
+    std::swap(_cpuDataReleased, other._cpuDataReleased);
+    _sourceName.swap(other._sourceName);
+}
+
+void Asset3D::applyResidencyPolicy()
+{
+    if (_residencyPolicy == RESIDENCY_RELEASE_CPU_DATA) {
+        releaseCPUData();
+    }
+}
+
+void Asset3D::releaseCPUData()
+{
+    if (_cpuDataReleased == true) {
+        return;
+    }
+
+    /* Models need the bounds, take them before the vertices are gone */
+    if (_boundsValid == false) {
+        calculateBounds();
+    }
+
+    /* The sizes are kept in the _mapped* members, see getNumVertices() */
+    _mappedNumVertices = getNumVertices();
+    _mappedNumIndices = getNumIndices();
+    _mappedIndexSize = getIndexDataSize();
+    _mappedVertexData = NULL;
+    _mappedIndexData = NULL;
+    _mappedFile.reset();
+
+    std::vector<VertexData>().swap(_vertexData);
+    std::vector<uint32_t>().swap(_vertexIndices);
+    for (std::vector<Texture>::iterator it = _textures.begin(); it != _textures.end(); ++it) {
+        it->freeData();
+    }
+
+    _cpuDataReleased = true;
+}
+
+bool Asset3D::reloadCPUData()
+{
+    if (_cpuDataReleased == false) {
+        return true;
+    }
+
+    if (_sourceName.empty() == true) {
+        log("ERROR the data of the asset was released and it has no file to reload it from\n");
+        return false;
+    }
+
+    Asset3D *staging = Asset3D::New();
+    if (Asset3DStorage::Load(_sourceName, *staging, true) == false) {
+        log("ERROR reloading asset %s\n", _sourceName.c_str());
+        Asset3D::Delete(staging);
+        return false;
+    }
+
+    /* The file also brings the same materials and bounds */
+    swap(*staging);
+    Asset3D::Delete(staging);
+    return true;
+}
+
+void Asset3D::_calculateBounds(const VertexData *data, uint32_t numVertices, glm::vec3 &boundsMin, glm::vec3 &boundsMax,
+                               glm::vec3 &maxLengthVertex)
+{
+    float maxLength = 0.0f;
+
+    boundsMin = glm::vec3(0.0f);
+    boundsMax = glm::vec3(0.0f);
+    maxLengthVertex = glm::vec3(0.0f);
+
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        const glm::vec3 &vertex = data[i].vertex;
+
+        /* Calculate maximum length */
+        float length = glm::length(vertex);
+        if (length > maxLength) {
+            maxLength = length;
+            maxLengthVertex = vertex;
+        }
+
+        /* Calculate the maximum and minimum for each axis */
+        boundsMin = glm::min(boundsMin, vertex);
+        boundsMax = glm::max(boundsMax, vertex);
+    }
+}
+
 void Asset3D::normalize()
 {
     std::vector<VertexData>::iterator it;
+
+    _boundsValid = false;
     glm::vec3 cm = glm::vec3(0.0f, 0.0f, 0.0f);
 
     for (it = _vertexData.begin(); it != _vertexData.end(); ++it) {
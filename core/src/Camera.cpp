@@ -45,7 +45,23 @@ bool Camera::isObjectVisible(Object3D &object)
 
     for (int i = 0; i < MAX_PLANES; ++i) {
         /* Check the sphere */
-        if (glm::dot(_frustumPlanes[i], glm::vec4(object.getPosition(), 1.0f)) < -radius) {
+        if (glm::dot(_frustumPlanes[i], glm::vec4(object.getWorldPosition(), 1.0f)) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Camera::isAABBVisible(const BoundingBox &aabb)
+{
+    glm::vec3 center = (aabb.getMin() + aabb.getMax()) / 2.0f;
+    glm::vec3 extent = (aabb.getMax() - aabb.getMin()) / 2.0f;
+
+    for (int i = 0; i < MAX_PLANES; ++i) {
+        /* Distance of the vertex furthest along the plane normal */
+        glm::vec3 normal = glm::vec3(_frustumPlanes[i]);
+
+        if (glm::dot(normal, center) + _frustumPlanes[i].w + glm::dot(glm::abs(normal), extent) < 0.0f) {
             return false;
         }
     }
@@ -5,7 +5,11 @@
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #include "Game.hpp"
+#include "AllocationTracker.hpp"
+#include "FrameArena.hpp"
 #include "Logging.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
 
 using namespace Logging;
 
@@ -13,7 +17,10 @@ Game::~Game()
 {
     TimeManager::DisposeInstance();
     Renderer::DisposeInstance();
+    ResourceManager::DisposeInstance();
     WindowManager::DisposeInstance();
+    FrameArena::DisposeInstance();
+    Profiler::DisposeInstance();
 }
 
 void Game::setWindowSize(uint32_t width, uint32_t height, bool fullscreen)
@@ -29,6 +36,61 @@ void Game::setFPS(uint32_t FPS, bool unbound)
     _unboundFPS = unbound;
 }
 
+void Game::setAllocationBudget(uint64_t maxAllocations, uint64_t maxBytes, bool failOnExceed)
+{
+    AllocationTracker::SetFrameBudget(maxAllocations, maxBytes);
+    _failOnAllocationBudget = failOnExceed;
+}
+
+void Game::_printAllocationStats()
+{
+    if (AllocationTracker::IsEnabled() == false) {
+        _console.gprintf("Allocations: not tracked\n");
+        return;
+    }
+
+    for (uint32_t tag = 0; tag < AllocationTracker::TAG_COUNT; ++tag) {
+        const AllocationTracker::Stats &stats = AllocationTracker::GetFrameStats((AllocationTracker::Tag)tag);
+
+        _console.gprintf("Allocs %s: %llu (%.1fKB, peak %.1fKB)\n", AllocationTracker::GetTagName((AllocationTracker::Tag)tag),
+                         (unsigned long long)stats.allocations, stats.bytes / 1024.0, stats.peakBytes / 1024.0);
+    }
+    _console.gprintf("Live: %.1fMB (peak %.1fMB)\n", AllocationTracker::GetLiveBytes() / (1024.0 * 1024.0),
+                     AllocationTracker::GetFramePeakLiveBytes() / (1024.0 * 1024.0));
+}
+
+void Game::setProfilerOverlay(bool enable)
+{
+    if (enable) {
+        Profiler::GetInstance()->setEnabled(true);
+    }
+    _profilerOverlay = enable;
+}
+
+void Game::_printProfile()
+{
+    Profiler *profiler = Profiler::GetInstance();
+    Profiler::Event events[32];
+    size_t numEvents;
+
+    if (Profiler::IsEnabled() == false) {
+        _console.gprintf("Profiler: disabled\n");
+        return;
+    }
+
+    /* CPU timings of the last frame, GPU timings arrive some frames later */
+    numEvents = profiler->getFrameEvents(profiler->getFrame() - 1, false, events, sizeof events / sizeof *events);
+    for (size_t i = 0; i < numEvents; ++i) {
+        _console.gprintf("%*sCPU %s: %.2fms\n", events[i].depth * 2, "", events[i].name, events[i].duration / 1000.0);
+    }
+    numEvents = profiler->getFrameEvents(profiler->getLastGPUFrame(), true, events, sizeof events / sizeof *events);
+    for (size_t i = 0; i < numEvents; ++i) {
+        _console.gprintf("GPU %s: %.2fms\n", events[i].name, events[i].duration / 1000.0);
+    }
+    _console.gprintf("Draws: %llu, state changes: %llu\n", (unsigned long long)RenderStats::Get(RenderStats::DRAW_CALLS),
+                     (unsigned long long)RenderStats::GetStateChanges());
+}
+
 void Game::resetStats()
 {
     _minRenderFrameMs = 1000000;
@@ -121,8 +183,21 @@ bool Game::loop()
         tickPrevious = tickNow;
         tickNow = _timer->getElapsedMs();
 
-        if (_gameHandler->handleTick(this, tickNow - tickPrevious) != true) {
-            break;
+        {
+            AllocationScope allocationScope(AllocationTracker::TAG_SCENE);
+            ProfileScope profileScope("Tick");
+
+            if (_gameHandler->handleTick(this, tickNow - tickPrevious) != true) {
+                break;
+            }
+        }
+
+        /* Continue uploading the assets being loaded */
+        {
+            AllocationScope allocationScope(AllocationTracker::TAG_LOADERS);
+            ProfileScope profileScope("Async loads");
+
+            _renderer->processAsyncLoads();
         }
 
         /* If frame is due, render it */
@@ -138,13 +213,28 @@ bool Game::loop()
             _console.clear();
             _renderer->clear();
 
-            if (_gameHandler->handleRender(this) != true) {
-                log("ERROR handling render callback");
+            {
+                ProfileScope profileScope("Render");
+
+                if (_gameHandler->handleRender(this) != true) {
+                    log("ERROR handling render callback");
+                }
+            }
+            {
+                AllocationScope allocationScope(AllocationTracker::TAG_CONSOLE);
+                RenderPassScope pass(_renderer, "Text");
+
+                _console.gprintf("FPS: %d\n", (int)FPS);
+                _console.gprintf("Upper FPS: %d\n", (int)(1000.0 / totalAvgTime));
+                _console.gprintf("Avg. Render: %.2fms (%.2fms)\n", totalAvgTime, dueTime);
+                if (_allocationOverlay) {
+                    _printAllocationStats();
+                }
+                if (_profilerOverlay) {
+                    _printProfile();
+                }
+                _console.blit();
             }
-            _console.gprintf("FPS: %d\n", (int)FPS);
-            _console.gprintf("Upper FPS: %d\n", (int)(1000.0 / totalAvgTime));
-            _console.gprintf("Avg. Render: %.2fms (%.2fms)\n", totalAvgTime, dueTime);
-            _console.blit();
 
             /* Flush all operations so we can have a good measure
              * of the time it takes to render the scene. Otherwise this
@@ -161,8 +251,32 @@ bool Game::loop()
              *
              *  Obviously not at scale. Rendering takes much longer than the rest.
              */
-            _renderer->flush();
-            _windowManager->swapBuffers();
+            {
+                ProfileScope profileScope("Flush");
+                _renderer->flush();
+            }
+            {
+                ProfileScope profileScope("Swap");
+                _windowManager->swapBuffers();
+            }
+
+            /* Collect the GPU timings available and move to the next frame */
+            _renderer->resolveGPUTimers();
+            Profiler::GetInstance()->beginFrame();
+            RenderStats::EndFrame();
+
+            /* The transient data of the frame is no longer needed */
+            FrameArena::GetInstance()->reset();
+
+            if (AllocationTracker::EndFrame() == false) {
+                AllocationTracker::Stats total = AllocationTracker::GetFrameTotal();
+
+                log("ERROR frame over the allocation budget: %llu allocations, %llu bytes\n", (unsigned long long)total.allocations,
+                    (unsigned long long)total.bytes);
+                if (_failOnAllocationBudget) {
+                    return false;
+                }
+            }
 
             /* Calculate how much did we take to render this frame */
             renderEnd = _timer->getElapsedMs();
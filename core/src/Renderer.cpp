@@ -6,11 +6,31 @@
  */
 
 #include "Renderer.hpp"
+#include "AllocationTracker.hpp"
 #include "Logging.hpp"
 #include "OpenGLRenderer.hpp"
+#include "Profiler.hpp"
 
 using namespace Logging;
 
+/**
+ * Marks the subtrees of a hierarchy that are outside the frustum, testing the
+ * children of the visible ones only. The objects without children are left to
+ * the culling of the models
+ */
+static void _cullSubtree(Camera &camera, Object3D &node, uint32_t pass)
+{
+    if (camera.isAABBVisible(node.getSubtreeAABB()) == false) {
+        node.setCulled(pass);
+        return;
+    }
+    for (Object3D *child = node.getFirstChild(); child != NULL; child = child->getNextSibling()) {
+        if (child->getFirstChild() != NULL) {
+            _cullSubtree(camera, *child, pass);
+        }
+    }
+}
+
 Renderer *Renderer::_renderer = NULL;
 
 Renderer *Renderer::GetInstance(void)
@@ -40,12 +60,13 @@ bool Renderer::init()
 
 bool Renderer::renderScene(Scene &scene, const Viewport &viewport, bool doBlit)
 {
+    AllocationScope allocationScope(AllocationTracker::TAG_RENDERER);
     float avgRadius = 0.0f;
-    std::vector<Light *> lightsMarkers;
+    FrameVector<Light *> lightsMarkers;
     DirectLight *sun = NULL;
-    std::vector<Model3D *> visibleModels;
-    std::vector<PointLight *> visiblePointLights;
-    std::vector<SpotLight *> visibleSpotLights;
+    FrameVector<Model3D *> visibleModels;
+    FrameVector<PointLight *> visiblePointLights;
+    FrameVector<SpotLight *> visibleSpotLights;
 
     if (scene.getActiveCamera() == NULL || scene.getActiveRenderTarget() == NULL) {
         return false;
@@ -53,132 +74,185 @@ bool Renderer::renderScene(Scene &scene, const Viewport &viewport, bool doBlit)
 
     scene.getActiveRenderTarget()->clear();
 
-    /* Reserve enough space for the list of visible models */
+    /* Update the transforms modified since the last frame in one batch */
+    if (scene.getTransformStore().getNumDirty() > 0) {
+        ProfileScope profileScope("Transforms");
+
+        scene.getTransformStore().update();
+    }
+
+    /* Reserve enough space for the lists of visible objects, they live in the
+     * frame arena and growing them would waste it */
     visibleModels.reserve(scene.getModels().size());
+    visiblePointLights.reserve(scene.getPointLights().size());
+    visibleSpotLights.reserve(scene.getSpotLights().size());
+    lightsMarkers.reserve(scene.getPointLights().size() + scene.getSpotLights().size());
 
     /* Force frustum planes calculation */
     scene.getActiveCamera()->recalculateFrustum();
 
-    /* Determine the models visibility */
+    /* Reject the hierarchies outside the frustum as a whole, the bounds of
+     * their objects are not even updated */
+    ++_cullingPass;
+    for (std::vector<Object3D *>::iterator root = scene.getRoots().begin(); root != scene.getRoots().end(); ++root) {
+        _cullSubtree(*scene.getActiveCamera(), **root, _cullingPass);
+    }
+
+    /* Determine the models visibility, all of them at once. They are added
+     * in the same order every frame for the plane coherency of the culling */
+    _modelBounds.clear();
     for (std::vector<Model3D *>::iterator model = scene.getModels().begin(); model != scene.getModels().end(); ++model) {
-        if ((*model)->isEnabled() && scene.getActiveCamera()->isObjectVisible(**model)) {
-            visibleModels.push_back(*model);
+        if ((*model)->isCulled(_cullingPass)) {
+            _modelBounds.addCulled();
+            continue;
+        }
+
+        const BoundingBox &aabb = (*model)->getAABB();
+
+        _modelBounds.add((*model)->getWorldPosition(), (*model)->getBoundingSphere().getRadius(), aabb.getMin(), aabb.getMax());
+    }
+
+    uint32_t *visible = FrameArena::GetInstance()->newArray<uint32_t>(_modelBounds.getMaskWords());
+    scene.getActiveCamera()->cullObjects(_modelBounds, visible);
+
+    for (uint32_t i = 0; i < scene.getModels().size(); ++i) {
+        Model3D *model = scene.getModels()[i];
+
+        if (model->isEnabled() && model->isResident() && FrustumCulling::IsVisible(visible, i)) {
+            visibleModels.push_back(model);
         }
     }
 
     /* Determine the lights visibility */
     for (std::vector<PointLight *>::iterator pointLight = scene.getPointLights().begin(); pointLight != scene.getPointLights().end();
          ++pointLight) {
-        if ((*pointLight)->isEnabled() && scene.getActiveCamera()->isObjectVisible(**pointLight)) {
+        if ((*pointLight)->isEnabled() && (*pointLight)->isCulled(_cullingPass) == false &&
+            scene.getActiveCamera()->isObjectVisible(**pointLight)) {
             visiblePointLights.push_back(*pointLight);
         }
     }
     for (std::vector<SpotLight *>::iterator spotLight = scene.getSpotLights().begin(); spotLight != scene.getSpotLights().end();
          ++spotLight) {
-        if ((*spotLight)->isEnabled() && scene.getActiveCamera()->isObjectVisible(**spotLight)) {
+        if ((*spotLight)->isEnabled() && (*spotLight)->isCulled(_cullingPass) == false &&
+            scene.getActiveCamera()->isObjectVisible(**spotLight)) {
             visibleSpotLights.push_back(*spotLight);
         }
     }
 
-    /* TODO: We only support one direct light for now */
-    if (scene.getDirectLights().size() > 0 && scene.getDirectLights()[0]->isEnabled()) {
-        sun = scene.getDirectLights()[0];
+    {
+        RenderPassScope pass(this, "Shadow maps");
+
+        /* TODO: We only support one direct light for now */
+        if (scene.getDirectLights().size() > 0 && scene.getDirectLights()[0]->isEnabled()) {
+            sun = scene.getDirectLights()[0];
 
-        /* TODO: lookAt in this case must be fixed to go along the direct light direction */
-        sun->lookAt(glm::vec3(0.0f, 0.0f, 0.0f));
-        sun->getShadowMap()->clear();
+            /* TODO: lookAt in this case must be fixed to go along the direct light direction */
+            sun->lookAt(glm::vec3(0.0f, 0.0f, 0.0f));
+            sun->getShadowMap()->clear();
 
-        /* Render the shadow maps for all models */
-        for (std::vector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
-            if ((*model)->isShadowCaster()) {
-                renderToShadowMap(**model, *sun, *_shaderShadow);
+            /* Render the shadow maps for all models */
+            for (FrameVector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
+                if ((*model)->isShadowCaster()) {
+                    renderToShadowMap(**model, *sun, *_shaderShadow);
+                }
             }
         }
-    }
 
-    /* Render the point lights shadows */
-    for (std::vector<PointLight *>::iterator pointLight = visiblePointLights.begin(); pointLight != visiblePointLights.end();
-         ++pointLight) {
-        /* TODO: lookAt the center of the calculated bounding box, but for now this is enough */
-        (*pointLight)->getShadowMap()->clear();
-        (*pointLight)->lookAt(glm::vec3(0.0f, 0.0f, 0.0f));
-
-        /* Render the shadow maps for all models */
-        for (std::vector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
-            if ((*model)->isShadowCaster()) {
-                renderToShadowMap(**model, **pointLight, *_shaderShadow);
+        /* Render the point lights shadows */
+        for (FrameVector<PointLight *>::iterator pointLight = visiblePointLights.begin(); pointLight != visiblePointLights.end();
+             ++pointLight) {
+            /* TODO: lookAt the center of the calculated bounding box, but for now this is enough */
+            (*pointLight)->getShadowMap()->clear();
+            (*pointLight)->lookAt(glm::vec3(0.0f, 0.0f, 0.0f));
+
+            /* Render the shadow maps for all models */
+            for (FrameVector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
+                if ((*model)->isShadowCaster()) {
+                    renderToShadowMap(**model, **pointLight, *_shaderShadow);
+                }
             }
-        }
 
-        /* Check if we need to render this light billboard */
-        if ((*pointLight)->getRenderMarker() == true || this->getRenderLightsMarkers()) {
-            lightsMarkers.push_back(*pointLight);
-        }
+            /* Check if we need to render this light billboard */
+            if ((*pointLight)->getRenderMarker() == true || this->getRenderLightsMarkers()) {
+                lightsMarkers.push_back(*pointLight);
+            }
 
-        /* Check if we want to render the bounding volumes */
-        renderBoundingVolumes(**pointLight, *scene.getActiveCamera(), *scene.getActiveRenderTarget(),
-                              (*pointLight)->getRenderBoundingSphere() || this->getRenderBoundingSphere(),
-                              (*pointLight)->getRenderAABB() || this->getRenderAABB(),
-                              (*pointLight)->getRenderOOBB() || this->getRenderOOBB());
-    }
+            /* Check if we want to render the bounding volumes */
+            renderBoundingVolumes(**pointLight, *scene.getActiveCamera(), *scene.getActiveRenderTarget(),
+                                  (*pointLight)->getRenderBoundingSphere() || this->getRenderBoundingSphere(),
+                                  (*pointLight)->getRenderAABB() || this->getRenderAABB(),
+                                  (*pointLight)->getRenderOOBB() || this->getRenderOOBB());
+        }
 
-    /* Render the spot lights shadows */
-    for (std::vector<SpotLight *>::iterator spotLight = visibleSpotLights.begin(); spotLight != visibleSpotLights.end(); ++spotLight) {
-        /* TODO: lookAt the center of the calculated bounding box, but for now this is enough */
-        (*spotLight)->getShadowMap()->clear();
+        /* Render the spot lights shadows */
+        for (FrameVector<SpotLight *>::iterator spotLight = visibleSpotLights.begin(); spotLight != visibleSpotLights.end(); ++spotLight) {
+            /* TODO: lookAt the center of the calculated bounding box, but for now this is enough */
+            (*spotLight)->getShadowMap()->clear();
 
-        /* Render the shadow maps for all models */
-        for (std::vector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
-            if ((*model)->isShadowCaster()) {
-                renderToShadowMap(**model, **spotLight, *_shaderShadow);
+            /* Render the shadow maps for all models */
+            for (FrameVector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
+                if ((*model)->isShadowCaster()) {
+                    renderToShadowMap(**model, **spotLight, *_shaderShadow);
+                }
             }
-        }
 
-        /* Check if we need to render this light billboard */
-        if ((*spotLight)->getRenderMarker() == true || this->getRenderLightsMarkers()) {
-            lightsMarkers.push_back(*spotLight);
+            /* Check if we need to render this light billboard */
+            if ((*spotLight)->getRenderMarker() == true || this->getRenderLightsMarkers()) {
+                lightsMarkers.push_back(*spotLight);
+            }
         }
     }
 
-    /* Render all objects */
-    avgRadius = 0.0f;
-    for (std::vector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
-        if ((*model)->getLightingShader() == NULL) {
-            log("ERROR model has no lighting shader associated to it\n");
-            continue;
-        }
+    {
+        RenderPassScope pass(this, "Main pass");
 
-        renderModel3D(**model, *scene.getActiveCamera(), *(*model)->getLightingShader(), sun, visiblePointLights, visibleSpotLights,
-                      0.4f, /* TODO: calculate the global ambient light */
-                      *scene.getActiveRenderTarget());
+        /* Render all objects */
+        avgRadius = 0.0f;
+        for (FrameVector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
+            if ((*model)->getLightingShader() == NULL) {
+                log("ERROR model has no lighting shader associated to it\n");
+                continue;
+            }
 
-        /* Render overlay wireframe if requested */
-        if (getWireframeMode() == Renderer::RENDER_WIREFRAME_OVERLAY) {
-            renderModel3DWireframe(**model, glm::vec4(1.0f, 0.0f, 1.0f, 1.0f), *scene.getActiveCamera(), *scene.getActiveRenderTarget());
-        }
+            renderModel3D(**model, *scene.getActiveCamera(), *(*model)->getLightingShader(), sun, visiblePointLights, visibleSpotLights,
+                          0.4f, /* TODO: calculate the global ambient light */
+                          *scene.getActiveRenderTarget());
 
-        avgRadius += (*model)->getBoundingSphere().getRadius() / glm::length((*model)->getScaleFactor());
+            /* Render overlay wireframe if requested */
+            if (getWireframeMode() == Renderer::RENDER_WIREFRAME_OVERLAY) {
+                renderModel3DWireframe(**model, glm::vec4(1.0f, 0.0f, 1.0f, 1.0f), *scene.getActiveCamera(),
+                                       *scene.getActiveRenderTarget());
+            }
+
+            avgRadius += (*model)->getBoundingSphere().getRadius() / glm::length((*model)->getScaleFactor());
+        }
     }
 
     /* Calculate the average radius */
     avgRadius /= scene.getModels().size();
 
-    /* Render the required debug info for the models */
-    for (std::vector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
-        /* Render normals information */
-        if ((*model)->getRenderNormals() == true || this->getRenderNormals()) {
-            renderModelNormals(**model, *scene.getActiveCamera(), *scene.getActiveRenderTarget(), avgRadius * 0.02f);
+    {
+        RenderPassScope pass(this, "Debug");
+
+        /* Render the required debug info for the models */
+        for (FrameVector<Model3D *>::iterator model = visibleModels.begin(); model != visibleModels.end(); ++model) {
+            /* Render normals information */
+            if ((*model)->getRenderNormals() == true || this->getRenderNormals()) {
+                renderModelNormals(**model, *scene.getActiveCamera(), *scene.getActiveRenderTarget(), avgRadius * 0.02f);
+            }
+            /* Render bounding volumes information */
+            renderBoundingVolumes(**model, *scene.getActiveCamera(), *scene.getActiveRenderTarget(),
+                                  (*model)->getRenderBoundingSphere() || this->getRenderBoundingSphere(),
+                                  (*model)->getRenderAABB() || this->getRenderAABB(), (*model)->getRenderOOBB() || this->getRenderOOBB());
         }
-        /* Render bounding volumes information */
-        renderBoundingVolumes(**model, *scene.getActiveCamera(), *scene.getActiveRenderTarget(),
-                              (*model)->getRenderBoundingSphere() || this->getRenderBoundingSphere(),
-                              (*model)->getRenderAABB() || this->getRenderAABB(), (*model)->getRenderOOBB() || this->getRenderOOBB());
-    }
 
-    /* Render the required light markers */
-    renderLights(lightsMarkers, *scene.getActiveCamera(), *scene.getActiveRenderTarget());
+        /* Render the required light markers */
+        renderLights(lightsMarkers, *scene.getActiveCamera(), *scene.getActiveRenderTarget());
+    }
 
     if (doBlit) {
+        RenderPassScope pass(this, "Blit");
+
         scene.getActiveRenderTarget()->blit(viewport.getX(), viewport.getY(), viewport.getWidth(), viewport.getHeight());
     }
 
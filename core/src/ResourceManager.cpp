@@ -0,0 +1,184 @@
+/**
+ * @class	ResourceManager
+ * @brief	Registry of the shared resources of the engine
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "ResourceManager.hpp"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Logging.hpp"
+#include "MappedFile.hpp"
+#include "Renderer.hpp"
+
+using namespace Logging;
+
+ResourceManager *ResourceManager::_resourceManager = NULL;
+
+ResourceManager *ResourceManager::GetInstance(void)
+{
+    if (_resourceManager == NULL) {
+        _resourceManager = new ResourceManager();
+    }
+    return _resourceManager;
+}
+
+void ResourceManager::DisposeInstance(void)
+{
+    delete _resourceManager;
+    _resourceManager = NULL;
+}
+
+uint64_t ResourceManager::Hash(const void *data, size_t size)
+{
+    /* FNV-1a over 64-bit words, followed by a final avalanche so that
+     * the low bits depend on all the input */
+    const uint64_t prime = 0x100000001B3ull;
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t hash = 0xCBF29CE484222325ull ^ size;
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof word);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t ResourceManager::Hash(const Texture &texture)
+{
+    uint64_t layout[5] = {texture._width, texture._height, texture._Bpp, texture._format, texture._levels};
+
+    return Hash(texture._texture, texture.getBytes()) ^ Hash(layout, sizeof layout);
+}
+
+/**
+ * Resolves relative paths, symbolic links and redundant separators
+ */
+static std::string _canonicalPath(const std::string &name)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    char path[_MAX_PATH];
+    if (_fullpath(path, name.c_str(), sizeof path) == NULL) {
+        return name;
+    }
+#else
+    char path[PATH_MAX];
+    if (realpath(name.c_str(), path) == NULL) {
+        return name;
+    }
+#endif
+    return path;
+}
+
+Asset3DHandle ResourceManager::acquireAsset3D(const std::string &assetName)
+{
+    std::string path = _canonicalPath(assetName);
+
+    std::map<std::string, AssetEntry>::iterator it = _assets.find(path);
+    if (it != _assets.end()) {
+        return it->second.asset.lock();
+    }
+
+    /* A different path may lead to the same contents */
+    uint64_t hash;
+    {
+        MappedFile file;
+        if (file.open(path) == false) {
+            log("ERROR opening asset %s\n", assetName.c_str());
+            return Asset3DHandle();
+        }
+        hash = Hash(file.getData(), file.getSize());
+    }
+
+    std::map<uint64_t, std::string>::iterator alias = _assetsByHash.find(hash);
+    if (alias != _assetsByHash.end()) {
+        AssetEntry entry = _assets[alias->second];
+        _assets[path] = entry;
+        return entry.asset.lock();
+    }
+
+    Asset3D *asset = Renderer::GetInstance()->loadAsset3D(path);
+    if (asset == NULL) {
+        return Asset3DHandle();
+    }
+
+    /* The deleter finds the registry through the singleton, as the handle
+     * may outlive it */
+    Asset3DHandle handle(asset, [](Asset3D *target) {
+        if (_resourceManager != NULL) {
+            _resourceManager->_releaseAsset3D(target);
+        }
+        Asset3D::Delete(target);
+    });
+
+    AssetEntry entry;
+    entry.asset = handle;
+    entry.pointer = asset;
+    entry.hash = hash;
+    _assets[path] = entry;
+    _assetsByHash[hash] = path;
+
+    return handle;
+}
+
+void ResourceManager::_releaseAsset3D(const Asset3D *asset)
+{
+    std::map<std::string, AssetEntry>::iterator it = _assets.begin();
+    while (it != _assets.end()) {
+        if (it->second.pointer == asset) {
+            _assetsByHash.erase(it->second.hash);
+            _assets.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ResourceManager::acquireTexture(uint64_t hash, uint32_t *id)
+{
+    std::map<uint64_t, uint32_t>::iterator it = _texturesByHash.find(hash);
+    if (it == _texturesByHash.end()) {
+        return false;
+    }
+
+    ++_textures[it->second].references;
+    *id = it->second;
+    return true;
+}
+
+void ResourceManager::addTexture(uint64_t hash, uint32_t id)
+{
+    TextureEntry entry;
+    entry.hash = hash;
+    entry.references = 1;
+
+    _textures[id] = entry;
+    _texturesByHash[hash] = id;
+}
+
+bool ResourceManager::releaseTexture(uint32_t id)
+{
+    std::map<uint32_t, TextureEntry>::iterator it = _textures.find(id);
+    if (it == _textures.end()) {
+        /* Not shared, the caller owns it */
+        return true;
+    }
+
+    if (--it->second.references > 0) {
+        return false;
+    }
+
+    _texturesByHash.erase(it->second.hash);
+    _textures.erase(it);
+    return true;
+}
@@ -8,129 +8,235 @@
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #include "Scene.hpp"
+#include "Logging.hpp"
 
-bool Scene::add(const std::string &name, Model3D *elem)
+using namespace Logging;
+
+Scene::ModelHandle Scene::add(const std::string &name, Model3D *elem)
 {
-    if (getModel(name) != NULL) {
-        return false;
+    ModelHandle handle = _models.add(elem, name);
+
+    if (handle && _useTransformStore) {
+        _transformStore.attach(*elem);
     }
-    _modelsNames[name] = elem;
-    _models.push_back(elem);
-    return true;
+    return handle;
+}
+
+Scene::PointLightHandle Scene::add(const std::string &name, PointLight *elem)
+{
+    PointLightHandle handle = _pointLights.add(elem, name);
+
+    if (handle && _useTransformStore) {
+        _transformStore.attach(*elem);
+    }
+    return handle;
+}
+
+Scene::SpotLightHandle Scene::add(const std::string &name, SpotLight *elem)
+{
+    SpotLightHandle handle = _spotLights.add(elem, name);
+
+    if (handle && _useTransformStore) {
+        _transformStore.attach(*elem);
+    }
+    return handle;
 }
 
-bool Scene::add(const std::string &name, PointLight *elem)
+Scene::DirectLightHandle Scene::add(const std::string &name, DirectLight *elem)
 {
-    if (getPointLight(name) != NULL) {
+    return _directLights.add(elem, name);
+}
+
+Scene::CameraHandle Scene::add(const std::string &name, Camera *elem)
+{
+    CameraHandle handle = _cameras.add(elem, name);
+
+    if (handle && _activeCamera == NULL) {
+        _activeCamera = elem;
+    }
+    return handle;
+}
+
+Scene::RenderTargetHandle Scene::add(const std::string &name, RenderTarget *elem)
+{
+    RenderTargetHandle handle = _renderTargets.add(elem, name);
+
+    if (handle && _activeRenderTarget == NULL) {
+        _activeRenderTarget = elem;
+    }
+    return handle;
+}
+
+bool Scene::remove(ModelHandle handle)
+{
+    Model3D *elem = _models.get(handle);
+    if (elem == NULL) {
         return false;
     }
-    _pointLightsNames[name] = elem;
-    _pointLights.push_back(elem);
+
+    _removeObject(elem);
+    _models.remove(handle);
     return true;
 }
 
-bool Scene::add(const std::string &name, SpotLight *elem)
+bool Scene::remove(PointLightHandle handle)
 {
-    if (getSpotLight(name) != NULL) {
+    PointLight *elem = _pointLights.get(handle);
+    if (elem == NULL) {
         return false;
     }
-    _spotLightsNames[name] = elem;
-    _spotLights.push_back(elem);
+
+    _removeObject(elem);
+    _pointLights.remove(handle);
     return true;
 }
 
-bool Scene::add(const std::string &name, DirectLight *elem)
+bool Scene::remove(SpotLightHandle handle)
 {
-    if (getDirectLight(name) != NULL) {
+    SpotLight *elem = _spotLights.get(handle);
+    if (elem == NULL) {
         return false;
     }
-    _directLightsNames[name] = elem;
-    _directLights.push_back(elem);
+
+    _removeObject(elem);
+    _spotLights.remove(handle);
     return true;
 }
 
-bool Scene::add(const std::string &name, Camera *elem)
+bool Scene::remove(DirectLightHandle handle)
 {
-    if (getCamera(name) != NULL) {
+    DirectLight *elem = _directLights.get(handle);
+    if (elem == NULL) {
         return false;
     }
-    _camerasNames[name] = elem;
-    _cameras.push_back(elem);
 
-    if (_activeCamera == NULL) {
-        _activeCamera = elem;
-    }
+    _removeObject(elem);
+    _directLights.remove(handle);
     return true;
 }
 
-bool Scene::add(const std::string &name, RenderTarget *elem)
+bool Scene::remove(CameraHandle handle)
 {
-    if (getRenderTarget(name) != NULL) {
+    Camera *elem = _cameras.get(handle);
+    if (elem == NULL) {
         return false;
     }
-    _renderTargetsNames[name] = elem;
-    _renderTargets.push_back(elem);
 
-    if (_activeRenderTarget == NULL) {
-        _activeRenderTarget = elem;
+    _removeObject(elem);
+    _cameras.remove(handle);
+
+    if (_activeCamera == elem) {
+        _activeCamera = _cameras.size() > 0 ? _cameras.getElements()[0] : NULL;
     }
     return true;
 }
 
-Model3D *Scene::getModel(const std::string &name)
+bool Scene::remove(RenderTargetHandle handle)
 {
-    std::map<std::string, Model3D *>::iterator it = _modelsNames.find(name);
-    if (it == _modelsNames.end()) {
-        return NULL;
+    RenderTarget *elem = _renderTargets.get(handle);
+    if (elem == NULL) {
+        return false;
     }
-    return it->second;
-}
+    _renderTargets.remove(handle);
 
-PointLight *Scene::getPointLight(const std::string &name)
-{
-    std::map<std::string, PointLight *>::iterator it = _pointLightsNames.find(name);
-    if (it == _pointLightsNames.end()) {
-        return NULL;
+    if (_activeRenderTarget == elem) {
+        _activeRenderTarget = _renderTargets.size() > 0 ? _renderTargets.getElements()[0] : NULL;
     }
-    return it->second;
+    return true;
 }
 
-SpotLight *Scene::getSpotLight(const std::string &name)
+bool Scene::setParent(Object3D *child, Object3D *parent)
 {
-    std::map<std::string, SpotLight *>::iterator it = _spotLightsNames.find(name);
-    if (it == _spotLightsNames.end()) {
-        return NULL;
+    Object3D *oldParent = child->getParent();
+
+    for (Object3D *ancestor = parent; ancestor != NULL; ancestor = ancestor->getParent()) {
+        if (ancestor == child) {
+            log("ERROR an element cannot be attached to itself or to one of its descendants\n");
+            return false;
+        }
+    }
+    if (parent == oldParent) {
+        return true;
     }
-    return it->second;
+
+    child->_setParent(parent);
+
+    /* Only these three can have become or stopped being roots */
+    _updateRoot(child);
+    if (oldParent != NULL) {
+        _updateRoot(oldParent);
+    }
+    if (parent != NULL) {
+        _updateRoot(parent);
+    }
+    return true;
 }
 
-DirectLight *Scene::getDirectLight(const std::string &name)
+void Scene::_updateRoot(Object3D *elem)
 {
-    std::map<std::string, DirectLight *>::iterator it = _directLightsNames.find(name);
-    if (it == _directLightsNames.end()) {
-        return NULL;
+    bool isRoot = elem->getParent() == NULL && elem->getFirstChild() != NULL;
+
+    if (isRoot && elem->_rootIndex == Object3D::NoRootIndex) {
+        elem->_rootIndex = (uint32_t)_roots.size();
+        _roots.push_back(elem);
+    } else if (isRoot == false && elem->_rootIndex != Object3D::NoRootIndex) {
+        /* The last root takes its place */
+        _roots[elem->_rootIndex] = _roots.back();
+        _roots[elem->_rootIndex]->_rootIndex = elem->_rootIndex;
+        _roots.pop_back();
+        elem->_rootIndex = Object3D::NoRootIndex;
     }
-    return it->second;
 }
 
-Camera *Scene::getCamera(const std::string &name)
+void Scene::_removeObject(Object3D *elem)
 {
-    std::map<std::string, Camera *>::iterator it = _camerasNames.find(name);
-    if (it == _camerasNames.end()) {
-        return NULL;
+    /* The children become roots where they are, with the transform of the
+     * element baked into theirs */
+    while (elem->getFirstChild() != NULL) {
+        Object3D *child = elem->getFirstChild();
+        glm::mat4 world = child->getModelMatrix();
+
+        setParent(child, NULL);
+        child->_setLocalTransform(world);
     }
-    return it->second;
+    setParent(elem, NULL);
+    _transformStore.detach(*elem);
 }
 
-RenderTarget *Scene::getRenderTarget(const std::string &name)
+void Scene::useTransformStore(bool enable)
 {
-    std::map<std::string, RenderTarget *>::iterator it = _renderTargetsNames.find(name);
-    if (it == _renderTargetsNames.end()) {
-        return NULL;
+    _useTransformStore = enable;
+
+    for (std::vector<Model3D *>::iterator model = getModels().begin(); model != getModels().end(); ++model) {
+        if (enable) {
+            _transformStore.attach(**model);
+        } else {
+            _transformStore.detach(**model);
+        }
+    }
+    for (std::vector<PointLight *>::iterator light = getPointLights().begin(); light != getPointLights().end(); ++light) {
+        if (enable) {
+            _transformStore.attach(**light);
+        } else {
+            _transformStore.detach(**light);
+        }
+    }
+    for (std::vector<SpotLight *>::iterator light = getSpotLights().begin(); light != getSpotLights().end(); ++light) {
+        if (enable) {
+            _transformStore.attach(**light);
+        } else {
+            _transformStore.detach(**light);
+        }
     }
-    return it->second;
 }
 
+Model3D *Scene::getModel(const std::string &name) { return _models.get(_models.find(name)); }
+PointLight *Scene::getPointLight(const std::string &name) { return _pointLights.get(_pointLights.find(name)); }
+SpotLight *Scene::getSpotLight(const std::string &name) { return _spotLights.get(_spotLights.find(name)); }
+DirectLight *Scene::getDirectLight(const std::string &name) { return _directLights.get(_directLights.find(name)); }
+Camera *Scene::getCamera(const std::string &name) { return _cameras.get(_cameras.find(name)); }
+RenderTarget *Scene::getRenderTarget(const std::string &name) { return _renderTargets.get(_renderTargets.find(name)); }
+
 bool Scene::setActiveCamera(const std::string &name)
 {
     Camera *camera = getCamera(name);
@@ -7,13 +7,20 @@
 
 #include "TimeManager.hpp"
 #include "GLFWTimeManager.hpp"
+#include "SteadyTimeManager.hpp"
+#include "WindowManager.hpp"
 
 TimeManager *TimeManager::_timeManager = NULL;
 
 TimeManager *TimeManager::GetInstance()
 {
     if (_timeManager == NULL) {
-        _timeManager = new GLFWTimeManager();
+        /* GLFW is not initialized without a window */
+        if (WindowManager::GetBackend() == WindowManager::BACKEND_HEADLESS) {
+            _timeManager = new SteadyTimeManager();
+        } else {
+            _timeManager = new GLFWTimeManager();
+        }
     }
     return _timeManager;
 }
@@ -0,0 +1,356 @@
+/**
+ * @class	TransformStore
+ * @brief	Keeps the transforms of many Object3D in contiguous arrays
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "TransformStore.hpp"
+#include <string.h>
+#include <algorithm>
+#include "Object3D.hpp"
+#include "WorkerPool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE 1
+#endif
+
+/**
+ * Scale factors of the model matrix, see Object3D::_getWorldScaleFactor()
+ */
+static inline glm::vec3 _getWorldScale(const glm::mat4 *parent, const glm::vec3 &scale, const glm::mat4 &model)
+{
+    if (parent == NULL) {
+        return scale;
+    }
+    return glm::vec3(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+}
+
+#if defined(TRANSFORM_SSE)
+
+/**
+ * Cross product of the xyz components, w is 0
+ */
+static inline __m128 _cross(__m128 a, __m128 b)
+{
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static inline __m128 _loadVec3(const glm::vec3 &v) { return _mm_set_ps(0.0f, v.z, v.y, v.x); }
+static inline void _storeVec3(glm::vec3 &v, __m128 value)
+{
+    _mm_storel_pi((__m64 *)&v[0], value);
+    _mm_store_ss(&v[2], _mm_movehl_ps(value, value));
+}
+
+/**
+ * Model matrix, normal matrix and world bounds of a slot, see
+ * Object3D::getModelMatrix() and Object3D::_updateBoundingVolumes()
+ */
+static void _updateTransform(bool rebuildModel, const glm::vec3 &position, const glm::mat4 &orientation, const glm::vec3 &scale,
+                             const glm::mat4 *parent, const BoundingBox &localBounds, const glm::vec3 &maxLength, glm::mat4 &model,
+                             glm::mat3 &normal, BoundingBox &aabb, BoundingSphere &sphere)
+{
+    __m128 column[4];
+
+    if (rebuildModel) {
+        /* translate(position) * orientation * scale(scale) */
+        __m128 translation = _loadVec3(position);
+        const float factors[3] = {scale.x, scale.y, scale.z};
+
+        for (uint32_t i = 0; i < 4; ++i) {
+            __m128 o = _mm_loadu_ps(&orientation[i][0]);
+
+            column[i] = _mm_add_ps(o, _mm_mul_ps(translation, _mm_shuffle_ps(o, o, _MM_SHUFFLE(3, 3, 3, 3))));
+            if (i < 3) {
+                column[i] = _mm_mul_ps(column[i], _mm_set1_ps(factors[i]));
+            }
+        }
+
+        /* parent * local, each column a combination of the parent columns */
+        if (parent != NULL) {
+            __m128 p[4];
+
+            for (uint32_t i = 0; i < 4; ++i) {
+                p[i] = _mm_loadu_ps(&(*parent)[i][0]);
+            }
+            for (uint32_t i = 0; i < 4; ++i) {
+                __m128 c = column[i];
+
+                column[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0], _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                  _mm_mul_ps(p[1], _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                       _mm_add_ps(_mm_mul_ps(p[2], _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2))),
+                                                  _mm_mul_ps(p[3], _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)))));
+            }
+        }
+        for (uint32_t i = 0; i < 4; ++i) {
+            _mm_storeu_ps(&model[i][0], column[i]);
+        }
+    } else {
+        for (uint32_t i = 0; i < 4; ++i) {
+            column[i] = _mm_loadu_ps(&model[i][0]);
+        }
+    }
+
+    /* The inverse transpose of the upper 3x3 has the cross products of its
+     * columns as columns, divided by the determinant */
+    __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    __m128 c0 = _mm_and_ps(column[0], xyz), c1 = _mm_and_ps(column[1], xyz), c2 = _mm_and_ps(column[2], xyz);
+    __m128 n0 = _cross(c1, c2), n1 = _cross(c2, c0), n2 = _cross(c0, c1);
+    __m128 products = _mm_mul_ps(c0, n0);
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, products);
+    float determinant = lanes[0] + lanes[1] + lanes[2];
+    if (determinant != 0.0f) {
+        __m128 inverse = _mm_set1_ps(1.0f / determinant);
+
+        _storeVec3(normal[0], _mm_mul_ps(n0, inverse));
+        _storeVec3(normal[1], _mm_mul_ps(n1, inverse));
+        _storeVec3(normal[2], _mm_mul_ps(n2, inverse));
+    }
+
+    /* World AABB from the transformed center and the extents along the
+     * absolute values of the axes */
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    glm::vec3 center = (localBounds.getMin() + localBounds.getMax()) / 2.0f;
+    glm::vec3 extent = (localBounds.getMax() - localBounds.getMin()) / 2.0f;
+
+    __m128 newCenter = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column[0], _mm_set1_ps(center.x)), _mm_mul_ps(column[1], _mm_set1_ps(center.y))),
+                                  _mm_add_ps(_mm_mul_ps(column[2], _mm_set1_ps(center.z)), column[3]));
+    __m128 newExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(column[0], absMask), _mm_set1_ps(extent.x)),
+                                             _mm_mul_ps(_mm_and_ps(column[1], absMask), _mm_set1_ps(extent.y))),
+                                  _mm_mul_ps(_mm_and_ps(column[2], absMask), _mm_set1_ps(extent.z)));
+    glm::vec3 value;
+
+    _storeVec3(value, _mm_sub_ps(newCenter, newExtent));
+    aabb.setMin(value);
+    _storeVec3(value, _mm_add_ps(newCenter, newExtent));
+    aabb.setMax(value);
+
+    sphere.setRadius(glm::length(maxLength * _getWorldScale(parent, scale, model)));
+}
+
+#else
+
+static void _updateTransform(bool rebuildModel, const glm::vec3 &position, const glm::mat4 &orientation, const glm::vec3 &scale,
+                             const glm::mat4 *parent, const BoundingBox &localBounds, const glm::vec3 &maxLength, glm::mat4 &model,
+                             glm::mat3 &normal, BoundingBox &aabb, BoundingSphere &sphere)
+{
+    if (rebuildModel) {
+        model = glm::scale(glm::translate(glm::mat4(), position) * orientation, scale);
+        if (parent != NULL) {
+            model = *parent * model;
+        }
+    }
+
+    glm::mat3 model3(model);
+    if (glm::determinant(model3) != 0.0f) {
+        normal = glm::transpose(glm::inverse(model3));
+    }
+
+    glm::mat3 absModel(glm::abs(model3[0]), glm::abs(model3[1]), glm::abs(model3[2]));
+    glm::vec3 center = (localBounds.getMin() + localBounds.getMax()) / 2.0f;
+    glm::vec3 extent = (localBounds.getMax() - localBounds.getMin()) / 2.0f;
+    glm::vec3 newCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    glm::vec3 newExtent = absModel * extent;
+
+    aabb.setMin(newCenter - newExtent);
+    aabb.setMax(newCenter + newExtent);
+
+    sphere.setRadius(glm::length(maxLength * _getWorldScale(parent, scale, model)));
+}
+
+#endif
+
+TransformStore::TransformStore() {}
+TransformStore::~TransformStore()
+{
+    while (_owners.empty() == false) {
+        detach(*_owners.back());
+    }
+}
+
+void TransformStore::attach(Object3D &object)
+{
+    if (object._store == this) {
+        return;
+    }
+    if (object._store != NULL) {
+        object._store->detach(object);
+    }
+
+    uint32_t slot = (uint32_t)_owners.size();
+
+    _positions.push_back(object._position);
+    _orientations.push_back(object._orientation);
+    _scales.push_back(object._scale);
+    _models.push_back(object._model);
+    _normals.push_back(glm::mat3(1.0f));
+    _localBounds.push_back(object._oobb);
+    _maxLengths.push_back(object._maxLengthVertex);
+    _aabbs.push_back(object._aabb);
+    _spheres.push_back(object._boundingSphere);
+    _flags.push_back(0);
+    _owners.push_back(&object);
+    _parents.push_back(object._parent);
+
+    object._store = this;
+    object._storeIndex = slot;
+
+    /* A valid model matrix may come from lookAt() and not from the
+     * position, orientation and scale */
+    markDirty(slot, object._modelValid ? DIRTY_BOUNDS : DIRTY_MODEL | DIRTY_BOUNDS);
+}
+
+void TransformStore::detach(Object3D &object)
+{
+    if (object._store != this) {
+        return;
+    }
+
+    uint32_t slot = object._storeIndex;
+    uint32_t last = (uint32_t)_owners.size() - 1;
+
+    /* Give the object back its transform */
+    _updateIfDirty(slot);
+    object._position = _positions[slot];
+    object._orientation = _orientations[slot];
+    object._scale = _scales[slot];
+    object._model = _models[slot];
+    object._modelValid = true;
+    object._boundingVolumesValid = false;
+    object._store = NULL;
+    object._storeIndex = 0;
+
+    /* Move the last slot into the free one */
+    if (slot != last) {
+        bool queued = (_flags[slot] & QUEUED) != 0;
+
+        _positions[slot] = _positions[last];
+        _orientations[slot] = _orientations[last];
+        _scales[slot] = _scales[last];
+        _models[slot] = _models[last];
+        _normals[slot] = _normals[last];
+        _localBounds[slot] = _localBounds[last];
+        _maxLengths[slot] = _maxLengths[last];
+        _aabbs[slot] = _aabbs[last];
+        _spheres[slot] = _spheres[last];
+        _flags[slot] = _flags[last];
+        _owners[slot] = _owners[last];
+        _owners[slot]->_storeIndex = slot;
+        _parents[slot] = _parents[last];
+
+        /* The entry of the moved slot in the dirty list is now out of range */
+        if ((_flags[slot] & QUEUED) != 0 && queued == false) {
+            _dirty.push_back(slot);
+        }
+    }
+
+    _positions.pop_back();
+    _orientations.pop_back();
+    _scales.pop_back();
+    _models.pop_back();
+    _normals.pop_back();
+    _localBounds.pop_back();
+    _maxLengths.pop_back();
+    _aabbs.pop_back();
+    _spheres.pop_back();
+    _flags.pop_back();
+    _owners.pop_back();
+    _parents.pop_back();
+}
+
+void TransformStore::setModelMatrix(uint32_t slot, const glm::mat4 &model)
+{
+    _models[slot] = model;
+    markDirty(slot, DIRTY_BOUNDS);
+    _flags[slot] &= ~DIRTY_MODEL;
+}
+
+void TransformStore::setLocalBounds(uint32_t slot, const BoundingBox &oobb, const glm::vec3 &maxLengthVertex)
+{
+    _localBounds[slot] = oobb;
+    _maxLengths[slot] = maxLengthVertex;
+    markDirty(slot, DIRTY_BOUNDS);
+}
+
+void TransformStore::_updateSlot(uint32_t slot)
+{
+    Object3D *parent = _parents[slot];
+
+    _updateTransform((_flags[slot] & DIRTY_MODEL) != 0, _positions[slot], _orientations[slot], _scales[slot],
+                     parent != NULL ? &parent->getModelMatrix() : NULL, _localBounds[slot], _maxLengths[slot], _models[slot],
+                     _normals[slot], _aabbs[slot], _spheres[slot]);
+    _flags[slot] &= QUEUED;
+}
+
+uint32_t TransformStore::_prepareParent(uint32_t slot)
+{
+    Object3D *parent = _parents[slot];
+    uint32_t depth = 0;
+
+    if (parent != NULL && parent->_store != this) {
+        parent->getModelMatrix();
+    }
+    for (; parent != NULL; parent = parent->_parent) {
+        ++depth;
+    }
+    return depth;
+}
+
+void TransformStore::_updateSlots(const std::vector<uint32_t> &slots)
+{
+    uint32_t count = (uint32_t)slots.size();
+
+    if (count < ParallelThreshold) {
+        for (uint32_t i = 0; i < count; ++i) {
+            _updateSlot(slots[i]);
+        }
+    } else {
+        uint32_t numTasks = (count + SlotsPerTask - 1) / SlotsPerTask;
+
+        WorkerPool::GetInstance()->parallelFor(numTasks, [this, &slots, count](uint32_t task) {
+            uint32_t end = std::min((task + 1) * SlotsPerTask, count);
+
+            for (uint32_t i = task * SlotsPerTask; i < end; ++i) {
+                _updateSlot(slots[i]);
+            }
+        });
+    }
+}
+
+void TransformStore::update(void)
+{
+    /* Collect the slots once each in the bucket of their depth, skipping the
+     * entries left behind by removals and the slots already updated on
+     * access */
+    for (uint32_t i = 0; i < _dirty.size(); ++i) {
+        uint32_t slot = _dirty[i];
+
+        if (slot < _flags.size() && (_flags[slot] & QUEUED) != 0) {
+            _flags[slot] &= ~QUEUED;
+            if ((_flags[slot] & (DIRTY_MODEL | DIRTY_BOUNDS)) != 0) {
+                uint32_t depth = _prepareParent(slot);
+
+                if (depth >= _levels.size()) {
+                    _levels.resize(depth + 1);
+                }
+                _levels[depth].push_back(slot);
+            }
+        }
+    }
+    _dirty.clear();
+
+    /* The parents are updated before their children, one level at a time */
+    for (uint32_t depth = 0; depth < _levels.size(); ++depth) {
+        if (_levels[depth].empty() == false) {
+            _updateSlots(_levels[depth]);
+            _levels[depth].clear();
+        }
+    }
+}
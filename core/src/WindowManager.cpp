@@ -6,14 +6,47 @@
  */
 
 #include "WindowManager.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include "EGLWindowManager.hpp"
 #include "GLFWWindowManager.hpp"
+#include "Logging.hpp"
+
+using namespace Logging;
 
 WindowManager *WindowManager::_windowManager = NULL;
+bool WindowManager::_backendSelected = false;
+WindowManager::Backend WindowManager::_backend = WindowManager::BACKEND_WINDOWED;
+
+void WindowManager::SetBackend(Backend backend)
+{
+    _backend = backend;
+    _backendSelected = true;
+}
+
+WindowManager::Backend WindowManager::GetBackend(void)
+{
+    if (_backendSelected == false) {
+        const char *headless = getenv("ENGINE_HEADLESS");
+
+        _backend = (headless != NULL && *headless != '\0' && strcmp(headless, "0") != 0) ? BACKEND_HEADLESS : BACKEND_WINDOWED;
+        _backendSelected = true;
+    }
+    return _backend;
+}
 
 WindowManager *WindowManager::GetInstance()
 {
     if (_windowManager == NULL) {
-        _windowManager = new GLFWWindowManager();
+        if (GetBackend() == BACKEND_HEADLESS) {
+#if defined(__linux__)
+            _windowManager = new EGLWindowManager();
+#else
+            log("ERROR headless rendering is not supported on this platform\n");
+#endif
+        } else {
+            _windowManager = new GLFWWindowManager();
+        }
     }
     return _windowManager;
 }
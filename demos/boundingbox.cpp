@@ -83,8 +83,8 @@ class ShadowsDemo : public GameHandler
         }
 
         /* Load the geometry */
-        Asset3D *deadpool = game->getRenderer()->loadAsset3D("data/models/internal/deadpool.model");
-        Asset3D *daxter = game->getRenderer()->loadAsset3D("data/models/internal/daxter.model");
+        Asset3DHandle deadpool = game->getResourceManager()->acquireAsset3D("data/models/internal/deadpool.model");
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
         Procedural::Plane *plane= new Procedural::Plane();
 
         if (game->getRenderer()->prepareAsset3D(*plane) == false) {
@@ -89,7 +89,7 @@ class ShadowsDemo : public GameHandler
         _scene.getPointLight("PL_light3")->getShadowMap()->init(_width, _height);
 
         /* Load the geometry */
-        Asset3D *daxter = game->getRenderer()->loadAsset3D("data/models/internal/daxter.model");
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
         Procedural::Plane *plane = new Procedural::Plane();
 
         if (game->getRenderer()->prepareAsset3D(*plane) == false) {
@@ -120,7 +120,7 @@ class Demo : public GameHandler
         _scene.getPointLight("SL_light3")->lookAt(glm::vec3(-120.0f, 0.0f, -100.0f));
 
         /* Load the geometry */
-        Asset3D *daxter = game->getRenderer()->loadAsset3D("data/models/internal/daxter.model");
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
         Procedural::Plane *plane = new Procedural::Plane();
         Procedural::Sphere *sphere1 = new Procedural::Sphere(25.0f, glm::vec3(1.0f, 1.0f, 1.0f), 50, 50);
         Procedural::Sphere *sphere2 = new Procedural::Sphere(25.0f, glm::vec3(1.0f, 1.0f, 1.0f), 50, 50);
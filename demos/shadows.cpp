@@ -114,7 +114,7 @@ class ShadowsDemo : public GameHandler
         /* Load the geometry */
         Procedural::Plane *plane = new Procedural::Plane();
 
-        Asset3D *daxter = game->getRenderer()->loadAsset3D("data/models/internal/daxter.model");
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
         if (game->getRenderer()->prepareAsset3D(*plane) == false) {
             log("ERROR preparing plane asset\n");
             return false;
@@ -86,7 +86,7 @@ class Demo : public GameHandler
         _current = "Normal";
 
         /* Load the geometry */
-        Asset3D *daxter = game->getRenderer()->loadAsset3D("data/models/internal/daxter.model");
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
 
         _scene.add("M3D_daxter1", new Model3D(daxter));
         _scene.getModel("M3D_daxter1")->setScaleFactor(glm::vec3(100.0f, 100.0f, 100.0f));
@@ -0,0 +1,215 @@
+/**
+ * @class	EGLWindowManager
+ * @brief	Headless window manager for machines without a display, like render
+ *          farms, containers or CI. The "window" is an EGL pbuffer surface of the
+ *          requested size, so the whole pipeline, render targets, blits and text,
+ *          renders offscreen exactly as it would on screen, on Mesa (llvmpipe or
+ *          a GPU driver) or on a GPU driver exposing EGL devices.
+ *
+ *          The display is looked up in this order: the first EGL device, the Mesa
+ *          surfaceless platform and finally the default display. There is no input,
+ *          the key and mouse managers accept listeners but never call them.
+ *
+ *          Only available on Linux, select it with WindowManager::SetBackend() or
+ *          the ENGINE_HEADLESS environment variable
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#if defined(__linux__)
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdint.h>
+#include <vector>
+#include "OpenGL.h"
+#include "WindowManager.hpp"
+
+/**
+ * Key manager without keys
+ */
+class HeadlessKeyManager : public KeyManager
+{
+  public:
+    bool registerListener(KeyListener &listener, std::vector<uint32_t> &keys) { return true; }
+};
+
+/**
+ * Mouse manager without mouse
+ */
+class HeadlessMouseManager : public MouseManager
+{
+  public:
+    bool registerListener(MouseListener &listener) { return true; }
+};
+
+class EGLWindowManager : public WindowManager
+{
+  public:
+    /**
+     * Constructor of the class
+     */
+    EGLWindowManager(void);
+
+    /**
+     * Destructor of the class
+     */
+    ~EGLWindowManager(void);
+
+    /**
+     * Gets the associated key manager, which never produces events
+     */
+    KeyManager *getKeyManager() { return &_keyManager; }
+    /**
+     * Gets the associated mouse manager, which never produces events
+     */
+    MouseManager *getMouseManager() { return &_mouseManager; }
+    /**
+     * Opens and initializes the EGL display
+     *
+     * @return	true or false
+     */
+    bool init(void);
+
+    /**
+     * Creates the offscreen surface and its context
+     *
+     * @param	name		Not used
+     * @param	width		Width of the surface, 1920 if 0
+     * @param	height		Height of the surface, 1080 if 0
+     * @param	fullscreen	Not used
+     *
+     * @return  true or false
+     */
+    bool createWindow(std::string &name, uint16_t width, uint16_t height, bool fullscreen);
+
+    /**
+     * Recreates the offscreen surface with the new size
+     *
+     * @param	width	Width of the surface
+     * @param	height	Height of the surface
+     *
+     * @return true or false
+     */
+    bool resize(uint16_t width, uint16_t height);
+
+    /**
+     * Sets a new renderer to handle display requests
+     *
+     * @param	renderer	Renderer that will handle display/reshape requests
+     *
+     * @return	true or false
+     */
+    bool setRenderer(Renderer *renderer);
+
+    /**
+     * Retrieves the size of the offscreen surface
+     *
+     * @param width  Output width of the surface
+     * @param height Output height of the surface
+     *
+     * @return true or false
+     */
+    bool getWindowSize(uint32_t *width, uint32_t *height);
+
+    /**
+     * Finishes the frame, pbuffers are single buffered
+     */
+    void swapBuffers(void);
+
+    /**
+     * There are no input events to poll
+     */
+    void poll(void) {}
+    /**
+     * Creates a context shared with the main one, current on a 1x1 pbuffer
+     */
+    bool createUploadContext(void);
+
+    /**
+     * Makes the upload context current in the calling thread
+     */
+    void makeUploadContextCurrent(bool current);
+
+    /**
+     * Reads back the last frame rendered, e.g. for image regression checks
+     * or batch rendering
+     *
+     * @param pixels  Returns the RGBA texels of the frame, top row first
+     *
+     * @return true or false
+     */
+    bool readPixels(std::vector<uint8_t> &pixels);
+
+  private:
+    /**
+     * Opens the best EGL display available
+     *
+     * @return The display or EGL_NO_DISPLAY
+     */
+    static EGLDisplay _openDisplay(void);
+
+    /**
+     * Creates a pbuffer surface
+     *
+     * @param width   Width of the surface
+     * @param height  Height of the surface
+     *
+     * @return The surface or EGL_NO_SURFACE
+     */
+    EGLSurface _createSurface(uint16_t width, uint16_t height);
+
+    /**
+     * EGL display
+     */
+    EGLDisplay _display;
+
+    /**
+     * Framebuffer configuration of the surfaces
+     */
+    EGLConfig _config;
+
+    /**
+     * Main rendering context
+     */
+    EGLContext _context;
+
+    /**
+     * Offscreen surface the frames are rendered to
+     */
+    EGLSurface _surface;
+
+    /**
+     * Context shared with the main one for the uploads
+     */
+    EGLContext _uploadContext;
+
+    /**
+     * 1x1 surface of the upload context
+     */
+    EGLSurface _uploadSurface;
+
+    /**
+     * Width of the surface
+     */
+    uint16_t _width;
+
+    /**
+     * Height of the surface
+     */
+    uint16_t _height;
+
+    /**
+     * Renderer associated to this manager
+     */
+    Renderer *_renderer;
+
+    /**
+     * Input managers without input
+     */
+    HeadlessKeyManager _keyManager;
+    HeadlessMouseManager _mouseManager;
+};
+
+#endif
@@ -99,6 +99,16 @@ class GLFWWindowManager : public WindowManager
      */
     void poll(void);
 
+    /**
+     * Creates a hidden window whose context is shared with the main one
+     */
+    bool createUploadContext(void);
+
+    /**
+     * Makes the hidden window context current in the calling thread
+     */
+    void makeUploadContextCurrent(bool current);
+
   private:
     /**
      * Static callback for resize of the window
@@ -110,6 +120,11 @@ class GLFWWindowManager : public WindowManager
      */
     GLFWwindow *_window;
 
+    /**
+     * Hidden window holding the upload context
+     */
+    GLFWwindow *_uploadWindow;
+
     /**
      * Width of the created window
      */
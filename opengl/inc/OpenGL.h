@@ -27,6 +27,16 @@
 #error "Platform not supported for OpenGL"
 #endif
 
+/* The allocations the driver makes inside the GL calls are charged to
+ * their own tag, see AllocationTracker
+ */
+#ifdef TRACK_ALLOCATIONS
+#include "AllocationTracker.hpp"
+#define GL_ALLOCATION_SCOPE AllocationScope glAllocationScope(AllocationTracker::TAG_DRIVER);
+#else
+#define GL_ALLOCATION_SCOPE
+#endif
+
 /* Macro for OpenGL debugging. It performs the GL call
  * and then checks the resulting error with glGetError().
  * This approach is over-killing but it helps narrow down
@@ -48,6 +58,7 @@
 
 #define __(call)                                                                                                                         \
     {                                                                                                                                    \
+        GL_ALLOCATION_SCOPE                                                                                                              \
         glGetError();                                                                                                                    \
         call;                                                                                                                            \
         GLuint error = glGetError();                                                                                                     \
@@ -55,6 +66,12 @@
             fprintf(stderr, "ERROR 0x%x (%s) calling:\n\t%s\nin context:\n\t%s (%s:%d)\n\n", error, GL_ERROR_TO_STR(error), #call, __PRETTY_FUNCTION__, __FILE__, __LINE__); \
         }                                                                                                                                \
     }
+#elif defined(TRACK_ALLOCATIONS)
+#define __(call)             \
+    {                        \
+        GL_ALLOCATION_SCOPE  \
+        call;                \
+    }
 #else
 #define __(call) call
 #endif
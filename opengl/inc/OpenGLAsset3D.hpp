@@ -11,8 +11,11 @@
 #pragma once
 
 #include <stdint.h>
+#include <functional>
+#include <memory>
 #include "Asset3D.hpp"
 #include "OpenGL.h"
+#include "OpenGLUploader.hpp"
 
 class OpenGLAsset3D : public Asset3D
 {
@@ -25,6 +28,27 @@ class OpenGLAsset3D : public Asset3D
      */
     const uint32_t NumTexturesMipmaps = 4;
 
+    /**
+     * Constructor
+     */
+    OpenGLAsset3D()
+        : _gVAO(0)
+        , _vertexDataVBO(0)
+        , _indicesBO(0)
+        , _indexType(GL_UNSIGNED_INT)
+        , _indexSize(sizeof(uint32_t))
+        , _uploadStage(UPLOAD_BEGIN)
+        , _uploadOffset(0)
+        , _uploadTexture(0)
+        , _uploadLevel(0)
+    {
+    }
+
+    /**
+     * Destructor, releases the GPU objects of the asset
+     */
+    ~OpenGLAsset3D() { destroy(); }
+
     /**
      * Prepares the asset for use with OpenGL drawing calls. It makes
      * use of the inherited asset 3D data to upload it to the GPU. Only
@@ -36,11 +60,53 @@ class OpenGLAsset3D : public Asset3D
     bool prepare();
 
     /**
-     * Destroyes all allocated buffers and arrays in OpenGL. After this method
-     * is called no other methods can be called except prepare()
+     * Incremental version of prepare(), used to spread the upload of an asset
+     * across several frames. Each call uploads the next part of the data,
+     * at least one piece, until the given budget is consumed
+     *
+     * @param budget  Number of bytes that can be uploaded in this call. It is
+     *                decreased by the number of bytes actually uploaded
+     *
+     * @returns true once the whole asset has been uploaded, false if more
+     *          calls are needed
+     */
+    bool prepareStep(size_t &budget);
+
+    /**
+     * Alternative to prepare() that moves the data to the GPU from the upload
+     * thread. The buffers and textures are created in the calling thread, then
+     * the geometry and the texture levels are uploaded, coarsest levels first.
+     * The asset can be rendered as soon as the geometry and the coarsest level of
+     * every texture are in the GPU, the textures get sharper as the rest of the
+     * levels arrive
+     *
+     * @param uploader  Uploader that runs the upload jobs
+     * @param resident  Called from OpenGLUploader::processCompletions() once the asset
+     *                  can be rendered
+     * @param uploaded  Called from OpenGLUploader::processCompletions() once every
+     *                  level of every texture is in the GPU. The upload jobs read the
+     *                  data of the asset until then, so it must not be released before.
+     *                  Deleting the asset, even from 'resident', cancels the jobs and
+     *                  callbacks still pending
+     */
+    void stream(OpenGLUploader &uploader, const std::function<void()> &resident, const std::function<void()> &uploaded);
+
+    /**
+     * Destroyes all allocated buffers and arrays in OpenGL, and drops the references
+     * to its textures, which are deleted once no other asset uses them. The uploads
+     * started by stream() are cancelled, waiting for the one running if any. After this
+     * method is called no other methods can be called except prepare()
      */
     bool destroy();
 
+    /**
+     * Returns the token of the uploads of the asset, cancelled by destroy(). A copy
+     * of it tells whether the asset was destroyed, for example from a callback
+     *
+     * @return Token of the uploads, NULL if the asset is not prepared
+     */
+    const std::shared_ptr<OpenGLUploader::Token> &getUploadToken() { return _uploadToken; }
+
     /**
      * Retrieves the ID for the vertex array
      *
@@ -61,9 +127,81 @@ class OpenGLAsset3D : public Asset3D
      * @return vector of textures IDs
      */
     const std::vector<uint32_t> &getTexturesIDs() { return _texturesIDs; }
+    /**
+     * Returns the OpenGL type of the indices stored in the indices buffer
+     * object. Assets with less than 65536 vertices use 16-bit indices
+     *
+     * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    GLenum getIndexType() { return _indexType; }
+    /**
+     * Returns the size in bytes of each index in the indices buffer
+     * object, to be used to calculate the offsets of the draw calls
+     *
+     * @return Size in bytes of one index
+     */
+    size_t getIndexSize() { return _indexSize; }
+    /**
+     * Returns the OpenGL primitive mode used to draw the asset
+     *
+     * @return GL_TRIANGLES or GL_TRIANGLE_STRIP
+     */
+    GLenum getPrimitiveMode() { return getPrimitiveType() == PRIMITIVE_TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES; }
+    /**
+     * Returns the primitive restart index matching the type of the
+     * indices buffer object
+     *
+     * @return Primitive restart index
+     */
+    GLuint getRestartIndex() { return _indexType == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF; }
   private:
+    /**
+     * Stages of the upload performed by prepareStep()
+     */
+    enum UploadStage {
+        UPLOAD_BEGIN,    /**< Buffers and textures not created yet */
+        UPLOAD_VERTICES, /**< Uploading the vertex buffer object */
+        UPLOAD_INDICES,  /**< Uploading the indices buffer object */
+        UPLOAD_TEXTURES, /**< Uploading the textures level by level, one group of rows at a time */
+        UPLOAD_DONE      /**< Everything uploaded */
+    };
+
+    /**
+     * Creates the buffers, vertex array and textures with no data
+     */
+    void _beginUpload();
+
+    /**
+     * Number of mipmap levels allocated for a texture, the ones stored in the
+     * asset or NumTexturesMipmaps for textures that only have level 0
+     *
+     * @param texture  Texture to check
+     *
+     * @return Number of mipmap levels
+     */
+    uint32_t _getTextureLevels(const Texture &texture);
+
+    /**
+     * Allocates the storage of a texture and sets its sampling parameters
+     *
+     * @param texture  Texture to allocate, must be bound to GL_TEXTURE_2D
+     *
+     * @return Number of mipmap levels allocated
+     */
+    uint32_t _allocateTexture(const Texture &texture);
+
     GLuint _gVAO;                       /**< Vertex array object ID */
     GLuint _vertexDataVBO;              /**< Vertex buffer object ID */
     GLuint _indicesBO;                  /**< Indices buffer object ID */
+    GLenum _indexType;                  /**< Type of the indices in the indices buffer object */
+    size_t _indexSize;                  /**< Size in bytes of each index in the indices buffer object */
     std::vector<uint32_t> _texturesIDs; /**< Textures ID vector */
+    std::vector<bool> _texturesReused;  /**< Whether each texture was already in the GPU, see ResourceManager */
+
+    UploadStage _uploadStage;                            /**< Current stage of prepareStep() */
+    size_t _uploadOffset;                                /**< Bytes, or texture rows, of the current stage already uploaded */
+    uint32_t _uploadTexture;                             /**< Texture being uploaded */
+    uint32_t _uploadLevel;                               /**< Mipmap level of the texture being uploaded */
+    std::vector<uint16_t> _uploadIndices;                /**< 32-bit indices converted to 16-bit while they are uploaded */
+    std::shared_ptr<OpenGLUploader::Token> _uploadToken; /**< Cancels the uploads of stream(), see destroy() */
 };
@@ -92,7 +92,7 @@ class OpenGLLightingShader : public virtual LightingShader, public OpenGLShader
         _spotLights[numLight].copyLight(spotLight);
     }
 
-    void setMaterial(Material &material) { _material.copyMaterial(material); }
+    void setMaterial(const Material &material) { _material.copyMaterial(material); }
     virtual void setCustomParams() = 0;
 
   private:
@@ -7,14 +7,29 @@
  */
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <list>
+#include <memory>
 #include <vector>
+#include "OpenGLAsset3D.hpp"
 #include "OpenGLShader.hpp"
 #include "OpenGLSolidColorShader.hpp"
+#include "OpenGLUploader.hpp"
 #include "Renderer.hpp"
 
 class OpenGLRenderer : public Renderer
 {
   public:
+    /**
+     * Constructor
+     */
+    OpenGLRenderer() : _wireframeShader(NULL), _uploader(NULL), _gpuTimersSupported(false), _gpuTimerActive(false) {}
+    /**
+     * Destructor
+     */
+    ~OpenGLRenderer();
+
     /**
      * Renderer methods
      */
@@ -25,13 +40,16 @@ class OpenGLRenderer : public Renderer
     const char *getShaderVersion();
     Shader *newShader(void);
     Asset3D *loadAsset3D(const std::string &assetName);
+    Asset3D *loadAsset3DAsync(const std::string &assetName, const Asset3DLoadedCallback &callback = Asset3DLoadedCallback());
+    void processAsyncLoads();
     bool prepareAsset3D(Asset3D &model);
     bool renderModel3DWireframe(Model3D &model, const glm::vec4 &color, Camera &camera, RenderTarget &renderTarget);
-    bool renderModel3D(Model3D &model, Camera &camera, LightingShader &shader, DirectLight *sun, std::vector<PointLight *> &pointLights,
-                       std::vector<SpotLight *> &spotLights, float ambientK, RenderTarget &renderTarget, bool disableDepth = false);
+    bool renderModel3D(Model3D &model, Camera &camera, LightingShader &shader, DirectLight *sun,
+                       const FrameVector<PointLight *> &pointLights, const FrameVector<SpotLight *> &spotLights, float ambientK,
+                       RenderTarget &renderTarget, bool disableDepth = false);
     bool renderToShadowMap(Model3D &model3D, Light &light, NormalShadowMapShader &shader);
     bool renderLight(Light &light, Camera &camera, RenderTarget &renderTarget, uint32_t lightNumber);
-    bool renderLights(std::vector<Light *> &lights, Camera &camera, RenderTarget &renderTarget);
+    bool renderLights(FrameVector<Light *> &lights, Camera &camera, RenderTarget &renderTarget);
     bool renderBoundingBox(const BoundingBox &box, const glm::mat4 &modelMatrix, const glm::vec3 &color, Camera &camera,
                            RenderTarget &renderTarget);
     bool renderBoundingSphere(const BoundingSphere &sphere, const glm::vec3 &center, const glm::vec3 &color, Camera &camera,
@@ -42,8 +60,42 @@ class OpenGLRenderer : public Renderer
     bool resize(uint16_t width, uint16_t height);
     void flush();
     void clear();
+    void beginGPUTimer(const char *name);
+    void endGPUTimer();
+    void resolveGPUTimers();
 
   private:
+    /**
+     * State of an asynchronous load, shared between the worker decoding
+     * the file and the rendering thread
+     */
+    struct AsyncLoad {
+        enum State {
+            STATE_DECODING, /**< The file is being read and decoded in the worker pool */
+            STATE_DECODED,  /**< The data is in 'staging', ready to be uploaded */
+            STATE_FAILED,   /**< The file could not be loaded */
+            STATE_UPLOADING /**< The data has been moved to 'asset' and is being uploaded */
+        };
+
+        std::string name;               /**< Name of the asset file */
+        OpenGLAsset3D *asset;           /**< Asset returned to the user */
+        Asset3D *staging;               /**< Asset the worker decodes the file into */
+        Asset3DLoadedCallback callback; /**< Callback for the user */
+        std::atomic<int> state;         /**< State of the load, see State */
+    };
+
+    /**
+     * Loads in progress, in request order
+     */
+    std::list<std::shared_ptr<AsyncLoad> > _asyncLoads;
+
+    /**
+     * Streams the asynchronous loads to the GPU from a shared context. NULL
+     * if the window manager cannot provide one, then the loads are uploaded
+     * with OpenGLAsset3D::prepareStep() within the upload budget
+     */
+    OpenGLUploader *_uploader;
+
     /**
      * Width of the display
      */
@@ -88,4 +140,39 @@ class OpenGLRenderer : public Renderer
      * Shader to render model normals
      */
     OpenGLShader _renderNormals;
+
+    /**
+     * GPU timer waiting for its result
+     */
+    struct GPUTimer {
+        GLuint query;     /**< GL_TIME_ELAPSED query of the pass */
+        const char *name; /**< Name of the pass */
+        uint64_t frame;   /**< Frame of the pass */
+        double start;     /**< Time when the pass was issued, see Profiler::now() */
+    };
+
+    /**
+     * Frames a GPU timer can be in flight before its result is waited for
+     */
+    static const uint64_t MaxGPUTimerLatency = 4;
+
+    /**
+     * GPU timers issued and not yet resolved, in issue order
+     */
+    std::deque<GPUTimer> _gpuTimers;
+
+    /**
+     * Query objects available for new GPU timers
+     */
+    std::vector<GLuint> _freeQueries;
+
+    /**
+     * Whether the context has timer queries, GL 3.3 or ARB_timer_query
+     */
+    bool _gpuTimersSupported;
+
+    /**
+     * Whether the last GPU timer is still measuring
+     */
+    bool _gpuTimerActive;
 };
@@ -16,5 +16,5 @@ class OpenGLShaderMaterial : public OpenGLUniformBlock
 {
   public:
     void init(uint32_t bindingPoint);
-    void copyMaterial(Material &material);
+    void copyMaterial(const Material &material);
 };
@@ -0,0 +1,183 @@
+/**
+ * @class	OpenGLUploader
+ * @brief	Thread owning a rendering context shared with the main one, used to
+ *          upload buffers and textures to the GPU without stalling the rendering
+ *          thread. Jobs are executed in order in the upload thread, and once the GPU
+ *          has consumed the commands of a job its completion callback is invoked
+ *          from the rendering thread by processCompletions(). Texture data goes
+ *          through a ring of pixel buffer objects that are reused once their
+ *          fence has been signaled
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "OpenGL.h"
+#include "WindowManager.hpp"
+
+class OpenGLUploader
+{
+  public:
+    /**
+     * Number of pixel buffer objects used to stream the textures
+     */
+    static const uint32_t NumPixelBuffers = 3;
+
+    /**
+     * Shared by the jobs of one owner, so they can be cancelled together when
+     * the data they read goes away, see Cancel()
+     */
+    struct Token {
+        Token() : cancelled(false) {}
+        std::mutex mutex; /**< Held while one of the jobs runs */
+        bool cancelled;   /**< Whether the jobs and their completion callbacks are skipped */
+    };
+
+    /**
+     * Constructor
+     */
+    OpenGLUploader();
+
+    /**
+     * Destructor, waits for the upload thread to finish
+     */
+    ~OpenGLUploader();
+
+    /**
+     * Starts the upload thread using the upload context of the window manager,
+     * see WindowManager::createUploadContext()
+     *
+     * @param windowManager  Window manager owning the shared context
+     *
+     * @return true if the upload thread was started, false otherwise
+     */
+    bool init(WindowManager *windowManager);
+
+    /**
+     * Queues a job to be run in the upload thread
+     *
+     * @param job   Function issuing the upload commands, runs in the upload thread
+     * @param done  Function invoked from the rendering thread once the GPU has
+     *              executed the commands of the job
+     * @param token Optional token to cancel the job with, see Cancel()
+     */
+    void submit(const std::function<void()> &job, const std::function<void()> &done,
+                const std::shared_ptr<Token> &token = std::shared_ptr<Token>());
+
+    /**
+     * Cancels the jobs submitted with a token. Waits for the one running in the
+     * upload thread, if any, then the rest are skipped and none of their completion
+     * callbacks is invoked. Must be called from the rendering thread
+     *
+     * @param token  Token of the jobs
+     */
+    static void Cancel(const std::shared_ptr<Token> &token);
+
+    /**
+     * Invokes the completion callbacks of the finished jobs, in submission order.
+     * Must be called from the rendering thread
+     */
+    void processCompletions();
+
+    /**
+     * Fills a buffer object with the given data. Only to be used from jobs
+     *
+     * @param buffer  Buffer object, already allocated with at least 'size' bytes
+     * @param data    Data to copy into the buffer
+     * @param size    Number of bytes to copy
+     */
+    void uploadBuffer(GLuint buffer, const void *data, size_t size);
+
+    /**
+     * Uploads a texture level through one of the pixel buffer objects. Only to
+     * be used from jobs
+     *
+     * @param texture  Texture object, with its storage already allocated
+     * @param level    Mipmap level to upload
+     * @param width    Width of the level
+     * @param height   Height of the level
+     * @param format   Format of the pixels, for example GL_RGB
+     * @param pixels   Pixels of the level, unsigned bytes tightly packed
+     * @param size     Number of bytes in 'pixels'
+     */
+    void uploadTexture(GLuint texture, GLint level, uint32_t width, uint32_t height, GLenum format, const uint8_t *pixels,
+                       size_t size);
+
+    /**
+     * Uploads a block compressed texture level through one of the pixel buffer
+     * objects. Only to be used from jobs
+     *
+     * @param texture         Texture object, with its storage already allocated
+     * @param level           Mipmap level to upload
+     * @param width           Width of the level
+     * @param height          Height of the level
+     * @param internalFormat  Compressed format of the texture
+     * @param data            Blocks of the level
+     * @param size            Number of bytes in 'data'
+     */
+    void uploadCompressedTexture(GLuint texture, GLint level, uint32_t width, uint32_t height, GLenum internalFormat, const uint8_t *data,
+                                 size_t size);
+
+  private:
+    /**
+     * Job already executed by the upload thread, waiting for the GPU
+     */
+    struct Completion {
+        GLsync fence;                 /**< Fence inserted after the job commands */
+        std::function<void()> done;   /**< Completion callback */
+        std::shared_ptr<Token> token; /**< Token of the job, if any */
+    };
+
+    /**
+     * Main loop of the upload thread
+     */
+    void _run();
+
+    /**
+     * Copies data into the next pixel buffer object of the ring, waiting for
+     * the GPU to finish with it first. The buffer is left bound to GL_PIXEL_UNPACK_BUFFER
+     *
+     * @param data  Data to copy
+     * @param size  Number of bytes to copy
+     *
+     * @return Index of the pixel buffer object
+     */
+    uint32_t _fillPixelBuffer(const uint8_t *data, size_t size);
+
+    /**
+     * Unbinds a pixel buffer object once the upload commands that read from it
+     * have been issued, and fences it
+     *
+     * @param index  Index of the pixel buffer object
+     */
+    void _releasePixelBuffer(uint32_t index);
+
+    /**
+     * Job waiting to be run by the upload thread
+     */
+    struct Job {
+        std::function<void()> job;    /**< Upload commands */
+        std::function<void()> done;   /**< Completion callback */
+        std::shared_ptr<Token> token; /**< Token of the job, if any */
+    };
+
+    WindowManager *_windowManager;       /**< Owner of the upload context */
+    std::thread _thread;                 /**< Upload thread */
+    std::mutex _mutex;                   /**< Protects the queues and _exit */
+    std::condition_variable _condition;  /**< Signals new jobs or _exit */
+    std::deque<Job> _jobs;               /**< Jobs waiting to be run */
+    std::deque<Completion> _completions; /**< Jobs already run, waiting for the GPU */
+    bool _exit;                          /**< Tells the upload thread to finish */
+
+    GLuint _pixelBuffers[NumPixelBuffers];      /**< Pixel buffer objects used by uploadTexture() */
+    size_t _pixelBufferSizes[NumPixelBuffers];  /**< Allocated size of each pixel buffer object */
+    GLsync _pixelBufferFences[NumPixelBuffers]; /**< Fence of the last upload from each pixel buffer object */
+    uint32_t _nextPixelBuffer;                  /**< Next pixel buffer object of the ring */
+};
@@ -0,0 +1,280 @@
+/**
+ * @class	EGLWindowManager
+ * @brief	Headless window manager rendering into an EGL pbuffer
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "EGLWindowManager.hpp"
+
+#if defined(__linux__)
+
+#include <string.h>
+#include "Logging.hpp"
+
+using namespace Logging;
+
+/**
+ * Checks whether an extension is in an EGL extensions string
+ */
+static bool _hasExtension(const char *extensions, const char *name)
+{
+    size_t length = strlen(name);
+
+    while (extensions != NULL && *extensions != '\0') {
+        const char *end = strchr(extensions, ' ');
+        size_t size = end != NULL ? (size_t)(end - extensions) : strlen(extensions);
+
+        if (size == length && strncmp(extensions, name, length) == 0) {
+            return true;
+        }
+        extensions = end != NULL ? end + 1 : NULL;
+    }
+    return false;
+}
+
+EGLWindowManager::EGLWindowManager()
+    : _display(EGL_NO_DISPLAY)
+    , _config(NULL)
+    , _context(EGL_NO_CONTEXT)
+    , _surface(EGL_NO_SURFACE)
+    , _uploadContext(EGL_NO_CONTEXT)
+    , _uploadSurface(EGL_NO_SURFACE)
+    , _width(0)
+    , _height(0)
+    , _renderer(NULL)
+{
+}
+
+EGLWindowManager::~EGLWindowManager()
+{
+    if (_display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_uploadContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(_display, _uploadContext);
+    }
+    if (_uploadSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(_display, _uploadSurface);
+    }
+    if (_context != EGL_NO_CONTEXT) {
+        eglDestroyContext(_display, _context);
+    }
+    if (_surface != EGL_NO_SURFACE) {
+        eglDestroySurface(_display, _surface);
+    }
+    eglTerminate(_display);
+}
+
+EGLDisplay EGLWindowManager::_openDisplay(void)
+{
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = NULL;
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    if (_hasExtension(extensions, "EGL_EXT_platform_base")) {
+        getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    }
+
+    /* A GPU without display */
+    if (getPlatformDisplay != NULL && _hasExtension(extensions, "EGL_EXT_platform_device")) {
+        PFNEGLQUERYDEVICESEXTPROC queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+        EGLDeviceEXT device;
+        EGLint numDevices = 0;
+
+        if (queryDevices != NULL && queryDevices(1, &device, &numDevices) == EGL_TRUE && numDevices > 0) {
+            display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, NULL);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL) == EGL_TRUE) {
+                return display;
+            }
+        }
+    }
+
+    /* Mesa, either llvmpipe or a GPU driver */
+    if (getPlatformDisplay != NULL && _hasExtension(extensions, "EGL_MESA_platform_surfaceless")) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL) == EGL_TRUE) {
+            return display;
+        }
+    }
+
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL) == EGL_TRUE) {
+        return display;
+    }
+    return EGL_NO_DISPLAY;
+}
+
+bool EGLWindowManager::init()
+{
+    _display = _openDisplay();
+    if (_display == EGL_NO_DISPLAY) {
+        log("ERROR opening an EGL display\n");
+        return false;
+    }
+
+    if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE) {
+        log("ERROR the EGL display does not support desktop OpenGL\n");
+        return false;
+    }
+
+    log("EGL:            %s (%s)\n", eglQueryString(_display, EGL_VENDOR), eglQueryString(_display, EGL_VERSION));
+    return true;
+}
+
+EGLSurface EGLWindowManager::_createSurface(uint16_t width, uint16_t height)
+{
+    const EGLint attributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+
+    return eglCreatePbufferSurface(_display, _config, attributes);
+}
+
+bool EGLWindowManager::createWindow(std::string &name, uint16_t width, uint16_t height, bool fullscreen)
+{
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_RED_SIZE, 8,
+                                       EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+                                       EGL_NONE};
+    /* Same context than the GLFW window manager, OpenGL 3.2 core */
+    const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+                                        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+                                        EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR, EGL_NONE};
+    EGLint numConfigs = 0;
+
+    _width = width != 0 ? width : 1920;
+    _height = height != 0 ? height : 1080;
+
+    if (eglChooseConfig(_display, configAttributes, &_config, 1, &numConfigs) == EGL_FALSE || numConfigs == 0) {
+        log("ERROR no EGL configuration for an OpenGL pbuffer\n");
+        return false;
+    }
+
+    _surface = _createSurface(_width, _height);
+    if (_surface == EGL_NO_SURFACE) {
+        log("ERROR creating a %ux%u EGL pbuffer\n", _width, _height);
+        return false;
+    }
+
+    _context = eglCreateContext(_display, _config, EGL_NO_CONTEXT, contextAttributes);
+    if (_context == EGL_NO_CONTEXT) {
+        log("ERROR creating an OpenGL 3.2 core EGL context\n");
+        return false;
+    }
+
+    if (eglMakeCurrent(_display, _surface, _surface, _context) == EGL_FALSE) {
+        log("ERROR making the EGL context current\n");
+        return false;
+    }
+
+    /* Initialize GLEW. A GLX build of GLEW loads the GL entry points and then
+     * complains about the missing X display, which is fine here */
+    glewExperimental = true;  // Needed for core profile
+    GLenum result = glewInit();
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+    if (result == GLEW_ERROR_NO_GLX_DISPLAY) {
+        result = GLEW_OK;
+    }
+#endif
+    if (result != GLEW_OK) {
+        log("Failed to initialize GLEW\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool EGLWindowManager::resize(uint16_t width, uint16_t height)
+{
+    EGLSurface surface = _createSurface(width, height);
+    if (surface == EGL_NO_SURFACE) {
+        log("ERROR creating a %ux%u EGL pbuffer\n", width, height);
+        return false;
+    }
+
+    eglMakeCurrent(_display, surface, surface, _context);
+    eglDestroySurface(_display, _surface);
+    _surface = surface;
+    _width = width;
+    _height = height;
+
+    if (_renderer) {
+        _renderer->resize(width, height);
+    }
+    return true;
+}
+
+bool EGLWindowManager::setRenderer(Renderer *renderer)
+{
+    _renderer = renderer;
+    return true;
+}
+
+bool EGLWindowManager::getWindowSize(uint32_t *width, uint32_t *height)
+{
+    *width = _width;
+    *height = _height;
+    return true;
+}
+
+void EGLWindowManager::swapBuffers(void)
+{
+    GL_ALLOCATION_SCOPE
+    eglSwapBuffers(_display, _surface);
+}
+
+bool EGLWindowManager::createUploadContext(void)
+{
+    if (_context == EGL_NO_CONTEXT) {
+        return false;
+    }
+    if (_uploadContext != EGL_NO_CONTEXT) {
+        return true;
+    }
+
+    const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+                                        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+                                        EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR, EGL_NONE};
+
+    _uploadSurface = _createSurface(1, 1);
+    _uploadContext = eglCreateContext(_display, _config, _context, contextAttributes);
+    if (_uploadSurface == EGL_NO_SURFACE || _uploadContext == EGL_NO_CONTEXT) {
+        log("ERROR creating the upload context\n");
+        return false;
+    }
+
+    return true;
+}
+
+void EGLWindowManager::makeUploadContextCurrent(bool current)
+{
+    if (current == true) {
+        eglMakeCurrent(_display, _uploadSurface, _uploadSurface, _uploadContext);
+    } else {
+        eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+}
+
+bool EGLWindowManager::readPixels(std::vector<uint8_t> &pixels)
+{
+    size_t rowSize = (size_t)_width * 4;
+    std::vector<uint8_t> row(rowSize);
+
+    pixels.resize(rowSize * _height);
+
+    __(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+    __(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    __(glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]));
+
+    /* OpenGL returns the bottom row first */
+    for (uint32_t y = 0; y < _height / 2u; ++y) {
+        uint8_t *top = &pixels[y * rowSize];
+        uint8_t *bottom = &pixels[(_height - 1 - y) * rowSize];
+
+        memcpy(&row[0], top, rowSize);
+        memcpy(top, bottom, rowSize);
+        memcpy(bottom, &row[0], rowSize);
+    }
+    return true;
+}
+
+#endif
@@ -13,11 +13,14 @@
 
 using namespace Logging;
 
-GLFWWindowManager::GLFWWindowManager() : _width(0), _height(0), _renderer(NULL) {}
+GLFWWindowManager::GLFWWindowManager() : _window(NULL), _uploadWindow(NULL), _width(0), _height(0), _renderer(NULL) {}
 GLFWWindowManager::~GLFWWindowManager()
 {
     GLFWMouseManager::DisposeMouseManager();
     GLFWKeyManager::DisposeKeyManager();
+    if (_uploadWindow != NULL) {
+        glfwDestroyWindow(_uploadWindow);
+    }
     glfwDestroyWindow(_window);
     glfwTerminate();
 }
@@ -102,7 +105,12 @@ bool GLFWWindowManager::getWindowSize(uint32_t *width, uint32_t *height)
     return true;
 }
 
-void GLFWWindowManager::swapBuffers(void) { glfwSwapBuffers(_window); }
+void GLFWWindowManager::swapBuffers(void)
+{
+    GL_ALLOCATION_SCOPE
+    glfwSwapBuffers(_window);
+}
+
 void GLFWWindowManager::handle_resize(GLFWwindow *w, int width, int height) { WindowManager::GetInstance()->resize(width, height); }
 bool GLFWWindowManager::resize(uint16_t width, uint16_t height)
 {
@@ -113,3 +121,27 @@ bool GLFWWindowManager::resize(uint16_t width, uint16_t height)
 }
 
 void GLFWWindowManager::poll(void) { glfwPollEvents(); }
+
+bool GLFWWindowManager::createUploadContext(void)
+{
+    if (_window == NULL) {
+        return false;
+    }
+    if (_uploadWindow != NULL) {
+        return true;
+    }
+
+    /* Same context attributes than the main window, but never shown */
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    _uploadWindow = glfwCreateWindow(1, 1, "upload", NULL, _window);
+    glfwDefaultWindowHints();
+
+    if (_uploadWindow == NULL) {
+        log("ERROR creating the upload context\n");
+        return false;
+    }
+
+    return true;
+}
+
+void GLFWWindowManager::makeUploadContextCurrent(bool current) { glfwMakeContextCurrent(current == true ? _uploadWindow : NULL); }
@@ -7,15 +7,33 @@
 
 #include "OpenGLAsset3D.hpp"
 #include <glm/gtx/integer.hpp>
+#include <limits>
+#include <memory>
 #include "Logging.hpp"
 #include "OpenGL.h"
+#include "ResourceManager.hpp"
+#include "TextureCodec.hpp"
 
 using namespace Logging;
 
 bool OpenGLAsset3D::prepare()
+{
+    size_t budget = std::numeric_limits<size_t>::max();
+
+    /* The data may have been released after a previous upload */
+    if (reloadCPUData() == false) {
+        return false;
+    }
+
+    return prepareStep(budget);
+}
+
+void OpenGLAsset3D::_beginUpload()
 {
     uint32_t offset;
 
+    _uploadToken = std::make_shared<OpenGLUploader::Token>();
+
     /* Generate a vertex array to reference the attributes */
     __(glGenVertexArrays(1, &_gVAO));
     __(glBindVertexArray(_gVAO));
@@ -24,8 +42,8 @@ bool OpenGLAsset3D::prepare()
         __(glGenBuffers(1, &_vertexDataVBO));
         __(glBindBuffer(GL_ARRAY_BUFFER, _vertexDataVBO));
         {
-            /* Upload the data for this buffer */
-            __(glBufferData(GL_ARRAY_BUFFER, getVertexData().size() * sizeof getVertexData()[0], &(getVertexData()[0]), GL_STATIC_DRAW));
+            /* Allocate the storage for this buffer, the data is uploaded by prepareStep */
+            __(glBufferData(GL_ARRAY_BUFFER, getNumVertices() * sizeof(Asset3D::VertexData), NULL, GL_STATIC_DRAW));
 
             /* First attribute contains the vertex coordinates */
             __(glEnableVertexAttribArray(0));
@@ -64,54 +82,393 @@ bool OpenGLAsset3D::prepare()
         __(glGenBuffers(1, &_indicesBO));
         __(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indicesBO));
         {
-            /* Upload the data */
-            __(glBufferData(GL_ELEMENT_ARRAY_BUFFER, getIndexData().size() * sizeof(getIndexData()[0]), &(getIndexData()[0]),
-                            GL_STATIC_DRAW));
+            /* Use 16-bit indices when all the vertices can be addressed with them,
+             * 0xFFFF is reserved as the primitive restart index. Mapped assets may
+             * already contain 16-bit indices that are uploaded as they are */
+            if (getIndexDataSize() == sizeof(uint16_t)) {
+                _indexType = GL_UNSIGNED_SHORT;
+                _indexSize = sizeof(uint16_t);
+            } else if (getNumVertices() <= 0xFFFF) {
+                const uint32_t *indices = (const uint32_t *)getIndexDataPtr();
+
+                _uploadIndices.resize(getNumIndices());
+                for (size_t i = 0; i < _uploadIndices.size(); ++i) {
+                    _uploadIndices[i] = indices[i] == PrimitiveRestartIndex ? 0xFFFF : (uint16_t)indices[i];
+                }
+
+                _indexType = GL_UNSIGNED_SHORT;
+                _indexSize = sizeof(uint16_t);
+            } else {
+                _indexType = GL_UNSIGNED_INT;
+                _indexSize = sizeof(uint32_t);
+            }
+
+            /* Allocate the storage, the data is uploaded by prepareStep */
+            __(glBufferData(GL_ELEMENT_ARRAY_BUFFER, getNumIndices() * _indexSize, NULL, GL_STATIC_DRAW));
         }
     }
     __(glBindVertexArray(0));
 
-    /* Upload the textures */
+    /* Generate the textures, reusing the ones already in the GPU. Compressed
+     * textures are expanded when the driver cannot sample them */
+    std::vector<Texture> &textures = _textures;
+    ResourceManager *resourceManager = ResourceManager::GetInstance();
+
+    _texturesIDs.assign(textures.size(), 0);
+    _texturesReused.assign(textures.size(), false);
+    for (uint32_t i = 0; i < textures.size(); ++i) {
+        if (textures[i]._width == 0 || textures[i]._height == 0) {
+            continue;
+        }
+        if (textures[i].isCompressed() == true && GLEW_EXT_texture_compression_s3tc == GL_FALSE) {
+            TextureCodec::Decompress(textures[i]);
+        }
+
+        uint64_t hash = ResourceManager::Hash(textures[i]);
+        if (resourceManager->acquireTexture(hash, &_texturesIDs[i]) == true) {
+            _texturesReused[i] = true;
+        } else {
+            __(glGenTextures(1, &_texturesIDs[i]));
+            resourceManager->addTexture(hash, _texturesIDs[i]);
+        }
+    }
+}
+
+/**
+ * OpenGL internal format matching the format of a texture
+ */
+static GLenum _internalFormat(const Texture &texture)
+{
+    switch (texture._format) {
+        case Texture::FORMAT_BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case Texture::FORMAT_BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        default:
+            return GL_RGBA8;
+    }
+}
+
+/**
+ * OpenGL format of the texels of an uncompressed texture
+ */
+static GLenum _pixelFormat(const Texture &texture) { return texture._Bpp == 4 ? GL_RGBA : GL_RGB; }
+/**
+ * Uploads rows of a texture level. Compressed levels are uploaded in rows of
+ * blocks, so 'y' must be a multiple of 4
+ */
+static void _uploadTextureRows(const Texture &texture, uint32_t level, uint32_t y, uint32_t rows)
+{
+    uint32_t width = Texture::GetLevelSize(texture._width, level);
+    const uint8_t *data = texture._texture + texture.getLevelOffset(level);
+
+    if (texture.isCompressed() == true) {
+        size_t rowOffset = Texture::GetImageBytes((Texture::Format)texture._format, width, y, texture._Bpp);
+        size_t size = Texture::GetImageBytes((Texture::Format)texture._format, width, rows, texture._Bpp);
+
+        __(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, _internalFormat(texture), size, data + rowOffset));
+    } else {
+        __(glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, _pixelFormat(texture), GL_UNSIGNED_BYTE,
+                           data + (size_t)y * width * texture._Bpp));
+    }
+}
+
+uint32_t OpenGLAsset3D::_getTextureLevels(const Texture &texture)
+{
+    /* Adjust the maximum number of mipmap levels for small texture. According to OpenGL docs the maximum mipmap
+     * level is defined by:
+     *
+     *    log2( max(width, height) ) + 1
+     */
+    uint32_t maxLevels = glm::log2(glm::max(texture._width, texture._height)) + 1;
+
+    /* Stored mip chains are used as they are, the rest are generated when
+     * possible */
+    if (texture._levels > 1) {
+        return glm::min(texture._levels, maxLevels);
+    } else if (texture.isCompressed() == true) {
+        return 1;
+    }
+    return glm::min(NumTexturesMipmaps, maxLevels);
+}
+
+uint32_t OpenGLAsset3D::_allocateTexture(const Texture &texture)
+{
+    uint32_t mipMapLevels = _getTextureLevels(texture);
+
+    __(glTexStorage2D(GL_TEXTURE_2D, mipMapLevels, _internalFormat(texture), texture._width, texture._height));
+    __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
+
+    return mipMapLevels;
+}
+
+bool OpenGLAsset3D::prepareStep(size_t &budget)
+{
     const std::vector<Texture> &textures = getTextures();
+    bool uploaded = false;
 
-    _texturesIDs.resize(textures.size());
-    __(glGenTextures(textures.size(), &_texturesIDs[0]));
+    /* Buffers are filled through the copy target so the bindings of
+     * the vertex arrays are not modified */
+    while (_uploadStage != UPLOAD_DONE && (budget > 0 || uploaded == false)) {
+        switch (_uploadStage) {
+            case UPLOAD_BEGIN:
+                _beginUpload();
+                _uploadStage = UPLOAD_VERTICES;
+                _uploadOffset = 0;
+                break;
 
-    for (size_t i = 0; i < textures.size(); ++i) {
-        /* Prepare the mipmap generation */
-        if (textures[i]._width == 0 || textures[i]._height == 0) {
+            case UPLOAD_VERTICES:
+            case UPLOAD_INDICES:
+            {
+                bool vertices = _uploadStage == UPLOAD_VERTICES;
+                const uint8_t *data;
+                size_t size;
+
+                if (vertices == true) {
+                    data = (const uint8_t *)getVertexDataPtr();
+                    size = getNumVertices() * sizeof(Asset3D::VertexData);
+                } else {
+                    data = (const uint8_t *)(_uploadIndices.empty() == false ? _uploadIndices.data() : getIndexDataPtr());
+                    size = getNumIndices() * _indexSize;
+                }
+
+                if (_uploadOffset < size) {
+                    size_t chunk = glm::min(size - _uploadOffset, glm::max(budget, (size_t)1));
+
+                    __(glBindBuffer(GL_COPY_WRITE_BUFFER, vertices == true ? _vertexDataVBO : _indicesBO));
+                    __(glBufferSubData(GL_COPY_WRITE_BUFFER, _uploadOffset, chunk, data + _uploadOffset));
+                    __(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+                    _uploadOffset += chunk;
+                    budget -= glm::min(budget, chunk);
+                    uploaded = true;
+                }
+
+                if (_uploadOffset >= size) {
+                    _uploadStage = vertices == true ? UPLOAD_INDICES : UPLOAD_TEXTURES;
+                    _uploadOffset = 0;
+                    _uploadTexture = 0;
+                    _uploadLevel = 0;
+                    if (vertices == false) {
+                        std::vector<uint16_t>().swap(_uploadIndices);
+                    }
+                }
+                break;
+            }
+
+            case UPLOAD_TEXTURES:
+            {
+                if (_uploadTexture >= textures.size()) {
+                    _uploadStage = UPLOAD_DONE;
+                    break;
+                }
+
+                const Texture &texture = textures[_uploadTexture];
+                if (texture._width == 0 || texture._height == 0 || _texturesReused[_uploadTexture] == true) {
+                    ++_uploadTexture;
+                    break;
+                }
+
+                /* TODO: Once we use our own format, this should not be needed */
+                __(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+                __(glBindTexture(GL_TEXTURE_2D, _texturesIDs[_uploadTexture]));
+
+                if (_uploadLevel == 0 && _uploadOffset == 0) {
+                    _allocateTexture(texture);
+                }
+
+                /* Upload as many rows as the budget allows, at least one. Compressed
+                 * textures are uploaded in rows of 4x4 blocks */
+                uint32_t height = Texture::GetLevelSize(texture._height, _uploadLevel);
+                uint32_t rowHeight = texture.isCompressed() == true ? 4 : 1;
+                uint32_t levelWidth = Texture::GetLevelSize(texture._width, _uploadLevel);
+                size_t rowSize = Texture::GetImageBytes((Texture::Format)texture._format, levelWidth, rowHeight, texture._Bpp);
+                uint32_t rows = (uint32_t)glm::max(budget / rowSize, (size_t)1) * rowHeight;
+                rows = glm::min(rows, height - (uint32_t)_uploadOffset);
+
+                _uploadTextureRows(texture, _uploadLevel, _uploadOffset, rows);
+                _uploadOffset += rows;
+                budget -= glm::min(budget, (rows + rowHeight - 1) / rowHeight * rowSize);
+                uploaded = true;
+
+                if (_uploadOffset == height) {
+                    _uploadOffset = 0;
+                    if (++_uploadLevel == glm::min(texture._levels, _getTextureLevels(texture))) {
+                        /* Generate the levels that are not stored in the asset */
+                        if (_uploadLevel < _getTextureLevels(texture)) {
+                            __(glGenerateMipmap(GL_TEXTURE_2D));
+                        }
+                        _uploadLevel = 0;
+                        ++_uploadTexture;
+                    }
+                }
+                __(glBindTexture(GL_TEXTURE_2D, 0));
+                break;
+            }
+
+            case UPLOAD_DONE:
+                break;
+        }
+    }
+
+    return _uploadStage == UPLOAD_DONE;
+}
+
+void OpenGLAsset3D::stream(OpenGLUploader &uploader, const std::function<void()> &resident, const std::function<void()> &uploaded)
+{
+    const std::vector<Texture> &textures = getTextures();
+
+    /* Objects are created here so the vertex array, which cannot be shared
+     * between contexts, belongs to the rendering context */
+    _beginUpload();
+
+    /* Only touched from the completion callbacks, all of them run in this thread.
+     * The jobs read the data of the asset until the finest level of every
+     * texture is uploaded, so it cannot be released before. The asset can be
+     * deleted from the callbacks, the token tells the rest to stop */
+    std::shared_ptr<OpenGLUploader::Token> token = _uploadToken;
+    std::shared_ptr<uint32_t> pending = std::make_shared<uint32_t>(1);
+    std::shared_ptr<uint32_t> uploading = std::make_shared<uint32_t>(1);
+    std::function<void()> finished = [this, token, pending, resident]() {
+        if (token->cancelled == false && --*pending == 0) {
+            _uploadStage = UPLOAD_DONE;
+            if (resident) {
+                resident();
+            }
+        }
+    };
+    std::function<void()> completed = [token, uploading, uploaded]() {
+        if (token->cancelled == false && --*uploading == 0 && uploaded) {
+            uploaded();
+        }
+    };
+
+    for (uint32_t i = 0; i < textures.size(); ++i) {
+        const Texture &texture = textures[i];
+        if (texture._width == 0 || texture._height == 0 || _texturesReused[i] == true) {
             continue;
         }
 
-        /* TODO: Once we use our own format, this should not be needed */
-        __(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
         __(glBindTexture(GL_TEXTURE_2D, _texturesIDs[i]));
-        {
-            /* Adjust the maximum number of mipmap levels for small texture. According to OpenGL docs the maximum mipmap level
-             * is defined by:
-             *
-             *    log2( max(width, height) ) + 1
-             */
-            uint32_t mipMapLevels = glm::min(NumTexturesMipmaps, glm::log2(glm::max(textures[i]._width, textures[i]._height)) + 1);
-
-            __(glTexStorage2D(GL_TEXTURE_2D, mipMapLevels, GL_RGBA8, textures[i]._width, textures[i]._height));
-            __(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textures[i]._width, textures[i]._height, GL_RGB, GL_UNSIGNED_BYTE,
-                               textures[i]._texture));
-            __(glGenerateMipmap(GL_TEXTURE_2D));
-            __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-            __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-            __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-            __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-        }
+        uint32_t levels = _allocateTexture(texture);
+
+        /* Sample only from the levels already uploaded */
+        __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1));
+        __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1));
+        __(glBindTexture(GL_TEXTURE_2D, 0));
+        ++*pending;
+        ++*uploading;
     }
-    __(glBindTexture(GL_TEXTURE_2D, 0));
 
-    return true;
+    /* Make the new objects visible to the upload context */
+    __(glFlush());
+
+    uploader.submit(
+        [this, &uploader]() {
+            uploader.uploadBuffer(_vertexDataVBO, getVertexDataPtr(), getNumVertices() * sizeof(Asset3D::VertexData));
+            uploader.uploadBuffer(_indicesBO, _uploadIndices.empty() == false ? (const void *)_uploadIndices.data() : getIndexDataPtr(),
+                                  getNumIndices() * _indexSize);
+        },
+        [this, finished, completed]() {
+            std::vector<uint16_t>().swap(_uploadIndices);
+            finished();
+            completed();
+        },
+        token);
+
+    for (uint32_t i = 0; i < textures.size(); ++i) {
+        const Texture &texture = textures[i];
+        if (texture._width == 0 || texture._height == 0 || _texturesReused[i] == true) {
+            continue;
+        }
+
+        GLuint textureID = _texturesIDs[i];
+        uint32_t levels = _getTextureLevels(texture);
+
+        /* Levels missing from the asset are built by the upload thread */
+        std::shared_ptr<std::vector<std::vector<uint8_t> > > mipmaps = std::make_shared<std::vector<std::vector<uint8_t> > >(levels);
+        if (texture._levels < levels) {
+            uploader.submit(
+                [&texture, mipmaps, levels]() {
+                    const uint8_t *source = texture._texture;
+
+                    for (uint32_t level = 1; level < levels; ++level) {
+                        std::vector<uint8_t> &mipmap = (*mipmaps)[level];
+
+                        mipmap.resize(texture.getLevelBytes(level));
+                        TextureCodec::Downsample(source, Texture::GetLevelSize(texture._width, level - 1),
+                                                 Texture::GetLevelSize(texture._height, level - 1), texture._Bpp, mipmap.data());
+                        source = mipmap.data();
+                    }
+                },
+                std::function<void()>(), token);
+        }
+
+        for (uint32_t level = levels; level-- > 0;) {
+            uploader.submit(
+                [&uploader, &texture, mipmaps, textureID, level]() {
+                    uint32_t width = Texture::GetLevelSize(texture._width, level);
+                    uint32_t height = Texture::GetLevelSize(texture._height, level);
+                    std::vector<uint8_t> &mipmap = (*mipmaps)[level];
+
+                    if (mipmap.empty() == false) {
+                        uploader.uploadTexture(textureID, level, width, height, _pixelFormat(texture), mipmap.data(), mipmap.size());
+                        std::vector<uint8_t>().swap(mipmap);
+                    } else if (texture.isCompressed() == true) {
+                        uploader.uploadCompressedTexture(textureID, level, width, height, _internalFormat(texture),
+                                                         texture._texture + texture.getLevelOffset(level), texture.getLevelBytes(level));
+                    } else {
+                        uploader.uploadTexture(textureID, level, width, height, _pixelFormat(texture),
+                                               texture._texture + texture.getLevelOffset(level), texture.getLevelBytes(level));
+                    }
+                },
+                [textureID, level, levels, finished, completed]() {
+                    /* Start sampling from the new level */
+                    __(glBindTexture(GL_TEXTURE_2D, textureID));
+                    __(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level));
+                    __(glBindTexture(GL_TEXTURE_2D, 0));
+
+                    if (level == levels - 1) {
+                        finished();
+                    }
+                    if (level == 0) {
+                        completed();
+                    }
+                },
+                token);
+        }
+    }
 }
 
 bool OpenGLAsset3D::destroy()
 {
+    /* Stop the uploads still reading the asset */
+    if (_uploadToken != NULL) {
+        OpenGLUploader::Cancel(_uploadToken);
+        _uploadToken.reset();
+    }
+
+    /* Nothing to release if the asset was never prepared */
+    if (_gVAO == 0) {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < _texturesIDs.size(); ++i) {
+        if (_texturesIDs[i] != 0 && ResourceManager::GetInstance()->releaseTexture(_texturesIDs[i]) == true) {
+            __(glDeleteTextures(1, &_texturesIDs[i]));
+        }
+    }
+    _texturesIDs.clear();
+    _texturesReused.clear();
+
+    __(glDeleteBuffers(1, &_indicesBO));
     __(glDeleteBuffers(1, &_vertexDataVBO));
     __(glDeleteVertexArrays(1, &_gVAO));
+    _indicesBO = 0;
+    _vertexDataVBO = 0;
+    _gVAO = 0;
+    _uploadStage = UPLOAD_BEGIN;
     return true;
 }
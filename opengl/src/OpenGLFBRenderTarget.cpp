@@ -12,6 +12,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "Logging.hpp"
 #include "OpenGLFBRenderTarget.hpp"
+#include "RenderStats.hpp"
 #include "Renderer.hpp"
 #include "WindowManager.hpp"
 
@@ -97,11 +98,17 @@ bool OpenGLFBRenderTarget::init(uint32_t width, uint32_t height, uint32_t maxSam
 void OpenGLFBRenderTarget::bind()
 {
     __(glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer));
+    RenderStats::Add(RenderStats::FRAMEBUFFER_BINDS);
     __(glDrawBuffers(_numTargets, _attachments));
     __(glViewport(0, 0, _width, _height));
 }
 
-void OpenGLFBRenderTarget::bindDepth() { __(glBindTexture(GL_TEXTURE_2D, _depthBuffer)); }
+void OpenGLFBRenderTarget::bindDepth()
+{
+    __(glBindTexture(GL_TEXTURE_2D, _depthBuffer));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
+}
+
 void OpenGLFBRenderTarget::unbind() { __(glBindFramebuffer(GL_FRAMEBUFFER, 0)); }
 bool OpenGLFBRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t width, uint32_t height, uint32_t target, bool bindMainFB)
 {
@@ -10,6 +10,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "Logging.hpp"
 #include "OpenGLFilterRenderTarget.hpp"
+#include "RenderStats.hpp"
 #include "Renderer.hpp"
 #include "WindowManager.hpp"
 
@@ -149,11 +150,17 @@ bool OpenGLFilterRenderTarget::init(uint32_t width, uint32_t height, uint32_t ma
 void OpenGLFilterRenderTarget::bind()
 {
     __(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _frameBuffer));
+    RenderStats::Add(RenderStats::FRAMEBUFFER_BINDS);
     __(glDrawBuffers(_numTargets, _attachments));
     __(glViewport(0, 0, _width, _height));
 }
 
-void OpenGLFilterRenderTarget::bindDepth() { __(glBindTexture(GL_TEXTURE_2D, _depthBuffer)); }
+void OpenGLFilterRenderTarget::bindDepth()
+{
+    __(glBindTexture(GL_TEXTURE_2D, _depthBuffer));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
+}
+
 void OpenGLFilterRenderTarget::unbind() { __(glBindFramebuffer(GL_FRAMEBUFFER, 0)); }
 bool OpenGLFilterRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t width, uint32_t height, uint32_t target, bool bindMainFB)
 {
@@ -187,6 +194,7 @@ bool OpenGLFilterRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t width
     __(glViewport(dstX, dstY, width, height));
     __(glActiveTexture(GL_TEXTURE0));
     __(glBindTexture(GL_TEXTURE_2D, _colorBuffer[target]));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
 
     /* Tell the shader which texture unit to use */
     _shader->attach();
@@ -195,8 +203,10 @@ bool OpenGLFilterRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t width
     setCustomParams();
 
     __(glBindVertexArray(_vertexArray));
+    RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
     {
         __(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+        RenderStats::Add(RenderStats::DRAW_CALLS);
     }
     __(glBindVertexArray(0));
 
@@ -9,6 +9,7 @@
 #include "Logging.hpp"
 #include "MathUtils.hpp"
 #include "OpenGL.h"
+#include "RenderStats.hpp"
 #include "Renderer.hpp"
 #include "glm/gtx/transform.hpp"
 
@@ -144,10 +145,13 @@ bool OpenGLFontRenderer::renderText(uint32_t x, uint32_t y, const char *text, gl
 
         /* Bind the target texture */
         __(glBindTexture(GL_TEXTURE_2D, _glyphTextures[text[i]]));
+        RenderStats::Add(RenderStats::TEXTURE_BINDS);
         {
             __(glBindVertexArray(_glyphVAOs[text[i]]));
+            RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
             {
                 __(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+                RenderStats::Add(RenderStats::DRAW_CALLS);
             }
         }
 
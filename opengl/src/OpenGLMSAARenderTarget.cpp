@@ -9,6 +9,7 @@
 #include "OpenGL.h"
 #include "Logging.hpp"
 #include "OpenGLMSAARenderTarget.hpp"
+#include "RenderStats.hpp"
 #include "Renderer.hpp"
 
 using namespace Logging;
@@ -116,12 +117,18 @@ bool OpenGLMSAARenderTarget::init(uint32_t width, uint32_t height, uint32_t numT
 void OpenGLMSAARenderTarget::bind()
 {
     __(glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer));
+    RenderStats::Add(RenderStats::FRAMEBUFFER_BINDS);
     __(glDrawBuffers(_numTargets, _attachments));
     __(glEnable(GL_MULTISAMPLE));
     __(glViewport(0, 0, _width, _height));
 }
 
-void OpenGLMSAARenderTarget::bindDepth() { __(glBindTexture(GL_TEXTURE_2D, _depthBuffer)); }
+void OpenGLMSAARenderTarget::bindDepth()
+{
+    __(glBindTexture(GL_TEXTURE_2D, _depthBuffer));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
+}
+
 void OpenGLMSAARenderTarget::unbind()
 {
     __(glDisable(GL_MULTISAMPLE));
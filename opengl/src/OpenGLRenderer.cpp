@@ -12,9 +12,34 @@
 #include "OpenGLAsset3D.hpp"
 #include "OpenGLLightingShader.hpp"
 #include "OpenGLRenderer.hpp"
+#include "RenderStats.hpp"
+#include "WindowManager.hpp"
+#include "WorkerPool.hpp"
 
 using namespace Logging;
 
+/* Uniforms of the lighting shaders too long for the small string buffer of
+ * std::string, built once so renderModel3D() does not allocate them per model */
+static const std::string _numDirectLightsUniform("u_numDirectLights");
+static const std::string _shadowMVPDirectLightUniform("u_shadowMVPDirectLight");
+static const std::string _shadowMapDirectLightUniform("u_shadowMapDirectLight");
+static const std::string _shadowMVPPointLightUniform("u_shadowMVPPointLight[0]");
+static const std::string _shadowMapPointLightUniform("u_shadowMapPointLight[0]");
+static const std::string _numPointLightsUniform("u_numPointLights");
+static const std::string _shadowMVPSpotLightUniform("u_shadowMVPSpotLight[0]");
+static const std::string _shadowMapSpotLightUniform("u_shadowMapSpotLight[0]");
+
+OpenGLRenderer::~OpenGLRenderer()
+{
+    for (std::deque<GPUTimer>::iterator it = _gpuTimers.begin(); it != _gpuTimers.end(); ++it) {
+        _freeQueries.push_back(it->query);
+    }
+    if (_freeQueries.empty() == false) {
+        __(glDeleteQueries((GLsizei)_freeQueries.size(), &_freeQueries[0]));
+    }
+    delete _uploader;
+}
+
 bool OpenGLRenderer::init()
 {
     std::string error;
@@ -31,6 +56,8 @@ bool OpenGLRenderer::init()
      * in the shaders */
     //__( glEnable(GL_FRAMEBUFFER_SRGB) );
     __(glCullFace(GL_BACK));
+    /* Grid meshes are stored as triangle strips separated by a restart index */
+    __(glEnable(GL_PRIMITIVE_RESTART));
     __(glDisable(GL_DITHER));
     __(glDisable(GL_LINE_SMOOTH));
     __(glDisable(GL_POLYGON_SMOOTH));
@@ -107,6 +134,20 @@ bool OpenGLRenderer::init()
         return false;
     }
 
+    /* Asynchronous loads are streamed from a second context when possible */
+    _uploader = new OpenGLUploader();
+    if (_uploader->init(WindowManager::GetInstance()) == false) {
+        log("Upload context not available, asynchronous loads use the rendering thread\n");
+        delete _uploader;
+        _uploader = NULL;
+    }
+
+    /* GL_TIME_ELAPSED queries are core since 3.3, the context may be older */
+    _gpuTimersSupported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (_gpuTimersSupported == false) {
+        log("Timer queries not available, the profiler only measures the CPU time of the passes\n");
+    }
+
     /* Call parent to initialize some members related to scene rendering */
     return Renderer::init();
 }
@@ -124,7 +165,8 @@ Asset3D *OpenGLRenderer::loadAsset3D(const std::string &assetName)
         return NULL;
     }
 
-    if (Asset3DStorage::Load(assetName, *asset) == false) {
+    /* Uncompressed geometry is uploaded straight from the file mapping */
+    if (Asset3DStorage::Load(assetName, *asset, true) == false) {
         log("ERROR loading asset %s into an OpenGLAsset3D\n", assetName.c_str());
         delete asset;
         return NULL;
@@ -136,9 +178,116 @@ Asset3D *OpenGLRenderer::loadAsset3D(const std::string &assetName)
         return NULL;
     }
 
+    asset->setResidencyPolicy(getResidencyPolicy());
+    asset->applyResidencyPolicy();
+
     return asset;
 }
 
+Asset3D *OpenGLRenderer::loadAsset3DAsync(const std::string &assetName, const Asset3DLoadedCallback &callback)
+{
+    std::shared_ptr<AsyncLoad> load = std::make_shared<AsyncLoad>();
+
+    load->name = assetName;
+    load->asset = new OpenGLAsset3D();
+    load->staging = Asset3D::New();
+    load->callback = callback;
+    load->state = AsyncLoad::STATE_DECODING;
+
+    if (load->asset == NULL || load->staging == NULL) {
+        log("ERROR allocating memory for OpenGLAsset3D\n");
+        delete load->asset;
+        Asset3D::Delete(load->staging);
+        return NULL;
+    }
+
+    /* Not renderable until processAsyncLoads() finishes the upload */
+    load->asset->setResident(false);
+    load->asset->setResidencyPolicy(getResidencyPolicy());
+    _asyncLoads.push_back(load);
+
+    /* The worker only touches the staging asset, which is handed over
+     * to the rendering thread through the state */
+    WorkerPool::GetInstance()->submit([load]() {
+        bool loaded = Asset3DStorage::Load(load->name, *load->staging, true);
+        load->state = loaded == true ? AsyncLoad::STATE_DECODED : AsyncLoad::STATE_FAILED;
+    });
+
+    return load->asset;
+}
+
+void OpenGLRenderer::processAsyncLoads()
+{
+    size_t budget = getUploadBudget();
+
+    if (_uploader != NULL) {
+        _uploader->processCompletions();
+    }
+
+    std::list<std::shared_ptr<AsyncLoad> >::iterator it = _asyncLoads.begin();
+    while (it != _asyncLoads.end() && budget > 0) {
+        AsyncLoad &load = **it;
+
+        switch (load.state) {
+            case AsyncLoad::STATE_DECODING:
+                ++it;
+                continue;
+
+            case AsyncLoad::STATE_FAILED:
+                log("ERROR loading asset %s into an OpenGLAsset3D\n", load.name.c_str());
+                Asset3D::Delete(load.staging);
+                if (load.callback) {
+                    load.callback(load.asset, false);
+                }
+                it = _asyncLoads.erase(it);
+                continue;
+
+            case AsyncLoad::STATE_DECODED:
+                load.asset->swap(*load.staging);
+                Asset3D::Delete(load.staging);
+                load.staging = NULL;
+                load.state = AsyncLoad::STATE_UPLOADING;
+
+                if (_uploader != NULL) {
+                    OpenGLAsset3D *asset = load.asset;
+                    Asset3DLoadedCallback callback = load.callback;
+
+                    asset->stream(*_uploader,
+                                  [asset, callback]() {
+                                      asset->setResident(true);
+                                      if (callback) {
+                                          callback(asset, true);
+                                      }
+                                  },
+                                  /* Not invoked if the callback deleted the asset */
+                                  [asset]() { asset->applyResidencyPolicy(); });
+                    it = _asyncLoads.erase(it);
+                    continue;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (load.asset->prepareStep(budget) == false) {
+            ++it;
+            continue;
+        }
+
+        /* The callback can delete the asset, which cancels its token */
+        std::shared_ptr<OpenGLUploader::Token> token = load.asset->getUploadToken();
+        load.asset->setResident(true);
+        if (load.callback) {
+            load.callback(load.asset, true);
+        }
+        if (token->cancelled == false) {
+            load.asset->applyResidencyPolicy();
+        }
+        it = _asyncLoads.erase(it);
+    }
+}
+
 bool OpenGLRenderer::prepareAsset3D(Asset3D &source)
 {
     OpenGLAsset3D &glAsset3D = static_cast<OpenGLAsset3D &>(source);
@@ -190,12 +339,17 @@ bool OpenGLRenderer::renderModel3DWireframe(Model3D &model3D, const glm::vec4 &c
 
         /* Draw the model */
         __(glBindVertexArray(glObject->getVertexArrayID()));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
         {
-            std::vector<uint32_t> offset = glObject->getIndicesOffsets();
-            std::vector<uint32_t> count = glObject->getIndicesCount();
+            const std::vector<uint32_t> &offset = glObject->getIndicesOffsets();
+            const std::vector<uint32_t> &count = glObject->getIndicesCount();
+
+            __(glPrimitiveRestartIndex(glObject->getRestartIndex()));
 
             for (size_t i = 0; i < offset.size(); ++i) {
-                __(glDrawElements(GL_TRIANGLES, count[i], GL_UNSIGNED_INT, (void *)(offset[i] * sizeof(GLuint))));
+                __(glDrawElements(glObject->getPrimitiveMode(), count[i], glObject->getIndexType(),
+                                  (void *)(offset[i] * glObject->getIndexSize())));
+                RenderStats::Add(RenderStats::DRAW_CALLS);
             }
         }
         __(glBindVertexArray(0));
@@ -209,8 +363,8 @@ bool OpenGLRenderer::renderModel3DWireframe(Model3D &model3D, const glm::vec4 &c
 }
 
 bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingShader &shader, DirectLight *sun,
-                                   std::vector<PointLight *> &pointLights, std::vector<SpotLight *> &spotLights, float ambientK,
-                                   RenderTarget &renderTarget, bool disableDepth)
+                                   const FrameVector<PointLight *> &pointLights, const FrameVector<SpotLight *> &spotLights,
+                                   float ambientK, RenderTarget &renderTarget, bool disableDepth)
 {
     glm::mat4 biasMatrix(0.5, 0.0, 0.0, 0.0, 0.0, 0.5, 0.0, 0.0, 0.0, 0.0, 0.5, 0.0, 0.5, 0.5, 0.5, 1.0);
     GLuint textureUnit = 0;
@@ -222,7 +376,7 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
     glm::mat4 MVP = camera.getPerspectiveMatrix() * camera.getViewMatrix() * model3D.getModelMatrix();
 
     /* Calculate normal matrix */
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model3D.getModelMatrix())));
+    glm::mat3 normalMatrix = model3D.getNormalMatrix();
 
     /* Cast the model into an internal type */
     OpenGLAsset3D *glObject = static_cast<OpenGLAsset3D *>(model3D.getAsset3D());
@@ -269,6 +423,7 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
         dummyTextureUnit = textureUnit++;
         __(glActiveTexture(GL_TEXTURE0 + dummyTextureUnit));
         __(glBindTexture(GL_TEXTURE_2D, _dummyTexture));
+        RenderStats::Add(RenderStats::TEXTURE_BINDS);
 
         /* Set the sun light */
         if (sun != NULL) {
@@ -276,27 +431,28 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
             shadowMVP = biasMatrix * shadowMVP;
 
             shader.setDirectLight(*sun);
-            shader.setUniformUint("u_numDirectLights", 1);
+            shader.setUniformUint(_numDirectLightsUniform, 1);
 
             /* TODO: This has to be set in a matrix array */
-            shader.setUniformMat4("u_shadowMVPDirectLight", &shadowMVP);
-            shader.setUniformTexture2D("u_shadowMapDirectLight", textureUnit);
+            shader.setUniformMat4(_shadowMVPDirectLightUniform, &shadowMVP);
+            shader.setUniformTexture2D(_shadowMapDirectLightUniform, textureUnit);
 
             __(glActiveTexture(GL_TEXTURE0 + textureUnit));
             if (model3D.isShadowReceiver()) {
                 sun->getShadowMap()->bindDepth();
             } else {
                 __(glBindTexture(GL_TEXTURE_2D, _noshadowTexture));
+                RenderStats::Add(RenderStats::TEXTURE_BINDS);
             }
 
             textureUnit++;
         } else {
-            shader.setUniformUint("u_numDirectLights", 0);
-            shader.setUniformTexture2D("u_shadowMapDirectLight", dummyTextureUnit);
+            shader.setUniformUint(_numDirectLightsUniform, 0);
+            shader.setUniformTexture2D(_shadowMapDirectLightUniform, dummyTextureUnit);
         }
 
         /* Point lights */
-        glm::mat4 *shadowMVPArray = new glm::mat4[pointLights.size()];
+        glm::mat4 *shadowMVPArray = FrameArena::GetInstance()->newArray<glm::mat4>(pointLights.size());
         GLuint texturesArray[OpenGLLightingShader::MAX_LIGHTS];
 
         for (uint32_t numLight = 0; numLight < pointLights.size(); ++numLight) {
@@ -314,6 +470,7 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
                 pointLights[numLight]->getShadowMap()->bindDepth();
             } else {
                 __(glBindTexture(GL_TEXTURE_2D, _noshadowTexture));
+                RenderStats::Add(RenderStats::TEXTURE_BINDS);
             }
 
             textureUnit++;
@@ -322,15 +479,12 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
             texturesArray[numLight] = dummyTextureUnit;
         }
 
-        shader.setUniformMat4("u_shadowMVPPointLight[0]", shadowMVPArray, pointLights.size());
-        shader.setUniformTexture2DArray("u_shadowMapPointLight[0]", texturesArray, OpenGLLightingShader::MAX_LIGHTS);
-        shader.setUniformUint("u_numPointLights", pointLights.size());
-
-        /* Free the resources */
-        delete[] shadowMVPArray;
+        shader.setUniformMat4(_shadowMVPPointLightUniform, shadowMVPArray, pointLights.size());
+        shader.setUniformTexture2DArray(_shadowMapPointLightUniform, texturesArray, OpenGLLightingShader::MAX_LIGHTS);
+        shader.setUniformUint(_numPointLightsUniform, pointLights.size());
 
         /* Spotlights */
-        shadowMVPArray = new glm::mat4[spotLights.size()];
+        shadowMVPArray = FrameArena::GetInstance()->newArray<glm::mat4>(spotLights.size());
 
         for (uint32_t numLight = 0; numLight < spotLights.size(); ++numLight) {
             shader.setSpotLight(numLight, *spotLights[numLight]);
@@ -347,6 +501,7 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
                 spotLights[numLight]->getShadowMap()->bindDepth();
             } else {
                 __(glBindTexture(GL_TEXTURE_2D, _noshadowTexture));
+                RenderStats::Add(RenderStats::TEXTURE_BINDS);
             }
 
             textureUnit++;
@@ -355,31 +510,34 @@ bool OpenGLRenderer::renderModel3D(Model3D &model3D, Camera &camera, LightingSha
             texturesArray[numLight] = dummyTextureUnit;
         }
 
-        shader.setUniformMat4("u_shadowMVPSpotLight[0]", shadowMVPArray, spotLights.size());
-        shader.setUniformTexture2DArray("u_shadowMapSpotLight[0]", texturesArray, OpenGLLightingShader::MAX_LIGHTS);
+        shader.setUniformMat4(_shadowMVPSpotLightUniform, shadowMVPArray, spotLights.size());
+        shader.setUniformTexture2DArray(_shadowMapSpotLightUniform, texturesArray, OpenGLLightingShader::MAX_LIGHTS);
         shader.setUniformUint("u_numSpotLights", spotLights.size());
 
-        /* Free the resources */
-        delete[] shadowMVPArray;
-
         /* Set the shader custom parameters */
         shader.setCustomParams();
 
         /* Draw the model */
         __(glBindVertexArray(glObject->getVertexArrayID()));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
         {
             __(glActiveTexture(GL_TEXTURE0));
 
-            std::vector<Material> materials = glObject->getMaterials();
-            std::vector<uint32_t> texturesIDs = glObject->getTexturesIDs();
-            std::vector<uint32_t> offset = glObject->getIndicesOffsets();
-            std::vector<uint32_t> count = glObject->getIndicesCount();
+            const std::vector<Material> &materials = glObject->getMaterials();
+            const std::vector<uint32_t> &texturesIDs = glObject->getTexturesIDs();
+            const std::vector<uint32_t> &offset = glObject->getIndicesOffsets();
+            const std::vector<uint32_t> &count = glObject->getIndicesCount();
+
+            __(glPrimitiveRestartIndex(glObject->getRestartIndex()));
 
             for (size_t i = 0; i < materials.size(); ++i) {
                 __(glBindTexture(GL_TEXTURE_2D, texturesIDs[i]));
+                RenderStats::Add(RenderStats::TEXTURE_BINDS);
                 shader.setMaterial(materials[i]);
 
-                __(glDrawElements(GL_TRIANGLES, count[i], GL_UNSIGNED_INT, (void *)(offset[i] * sizeof(GLuint))));
+                __(glDrawElements(glObject->getPrimitiveMode(), count[i], glObject->getIndexType(),
+                                  (void *)(offset[i] * glObject->getIndexSize())));
+                RenderStats::Add(RenderStats::DRAW_CALLS);
             }
         }
         __(glBindVertexArray(0));
@@ -398,7 +556,7 @@ bool OpenGLRenderer::renderToShadowMap(Model3D &model3D, Light &light, NormalSha
     glm::mat4 MVP = light.getProjectionMatrix() * light.getViewMatrix() * model3D.getModelMatrix();
 
     /* Calculate normal matrix */
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model3D.getModelMatrix())));
+    glm::mat3 normalMatrix = model3D.getNormalMatrix();
 
     /* Cast the model into an internal type */
     OpenGLAsset3D *glObject = static_cast<OpenGLAsset3D *>(model3D.getAsset3D());
@@ -417,12 +575,17 @@ bool OpenGLRenderer::renderToShadowMap(Model3D &model3D, Light &light, NormalSha
 
         /* Draw the model */
         __(glBindVertexArray(glObject->getVertexArrayID()));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
         {
-            std::vector<uint32_t> offset = glObject->getIndicesOffsets();
-            std::vector<uint32_t> count = glObject->getIndicesCount();
+            const std::vector<uint32_t> &offset = glObject->getIndicesOffsets();
+            const std::vector<uint32_t> &count = glObject->getIndicesCount();
+
+            __(glPrimitiveRestartIndex(glObject->getRestartIndex()));
 
             for (size_t i = 0; i < count.size(); ++i) {
-                __(glDrawElements(GL_TRIANGLES, count[i], GL_UNSIGNED_INT, (void *)(offset[i] * sizeof(GLuint))));
+                __(glDrawElements(glObject->getPrimitiveMode(), count[i], glObject->getIndexType(),
+                                  (void *)(offset[i] * glObject->getIndexSize())));
+                RenderStats::Add(RenderStats::DRAW_CALLS);
             }
         }
         __(glBindVertexArray(0));
@@ -465,14 +628,18 @@ bool OpenGLRenderer::renderLight(Light &light, Camera &camera, RenderTarget &ren
 
         __(glGenVertexArrays(1, &lightPosVAO));
         __(glBindVertexArray(lightPosVAO));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
 
         __(glGenBuffers(1, &lightPosVBO));
 
+        glm::vec3 position = light.getWorldPosition();
+
         __(glBindBuffer(GL_ARRAY_BUFFER, lightPosVBO));
-        __(glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3), &light.getPosition()[0], GL_STATIC_DRAW));
+        __(glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3), &position[0], GL_STATIC_DRAW));
 
         __(glEnable(GL_PROGRAM_POINT_SIZE));
         __(glDrawArrays(GL_POINTS, 0, 1));
+        RenderStats::Add(RenderStats::DRAW_CALLS);
 
         __(glDisable(GL_PROGRAM_POINT_SIZE));
 
@@ -489,13 +656,15 @@ bool OpenGLRenderer::renderLight(Light &light, Camera &camera, RenderTarget &ren
     return true;
 }
 
-bool OpenGLRenderer::renderLights(std::vector<Light *> &lights, Camera &camera, RenderTarget &renderTarget)
+bool OpenGLRenderer::renderLights(FrameVector<Light *> &lights, Camera &camera, RenderTarget &renderTarget)
 {
     struct light_compare {
         light_compare(Camera &c) : _camera(c) {}
-        inline bool operator()(const Light *light1, const Light *light2)
+        inline bool operator()(Light *light1, Light *light2)
         {
-            return glm::length(_camera.getPosition() - light1->getPosition()) > glm::length(_camera.getPosition() - light2->getPosition());
+            glm::vec3 position = _camera.getWorldPosition();
+
+            return glm::length(position - light1->getWorldPosition()) > glm::length(position - light2->getWorldPosition());
         }
         Camera &_camera;
     };
@@ -504,7 +673,7 @@ bool OpenGLRenderer::renderLights(std::vector<Light *> &lights, Camera &camera,
     std::sort(lights.begin(), lights.end(), light_compare(camera));
 
     uint32_t n = 0;
-    for (std::vector<Light *>::iterator it = lights.begin(); it != lights.end(); ++it, ++n) {
+    for (FrameVector<Light *>::iterator it = lights.begin(); it != lights.end(); ++it, ++n) {
         if (renderLight(*(*it), camera, renderTarget, n) == false) {
             return false;
         }
@@ -555,6 +724,7 @@ bool OpenGLRenderer::renderBoundingBox(const BoundingBox &box, const glm::mat4 &
 
         __(glGenVertexArrays(1, &boxPosVAO));
         __(glBindVertexArray(boxPosVAO));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
 
         __(glGenBuffers(1, &boxPosVBO));
 
@@ -572,6 +742,7 @@ bool OpenGLRenderer::renderBoundingBox(const BoundingBox &box, const glm::mat4 &
                                  ));
 
         __(glDrawArrays(GL_LINES, 0, sizeof boxFaces / (2 * sizeof *boxFaces)));
+        RenderStats::Add(RenderStats::DRAW_CALLS);
 
         __(glBindVertexArray(0));
 
@@ -613,6 +784,7 @@ bool OpenGLRenderer::renderBoundingSphere(const BoundingSphere &sphere, const gl
 
         __(glGenVertexArrays(1, &boxPosVAO));
         __(glBindVertexArray(boxPosVAO));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
 
         __(glGenBuffers(1, &boxPosVBO));
 
@@ -630,6 +802,7 @@ bool OpenGLRenderer::renderBoundingSphere(const BoundingSphere &sphere, const gl
                                  ));
 
         __(glDrawArrays(GL_POINTS, 0, 1));
+        RenderStats::Add(RenderStats::DRAW_CALLS);
 
         __(glBindVertexArray(0));
 
@@ -648,7 +821,7 @@ bool OpenGLRenderer::renderBoundingVolumes(Object3D &object, Camera &camera, Ren
                                            bool showOOBB)
 {
     if (showSphere) {
-        if (renderBoundingSphere(object.getBoundingSphere(), object.getPosition(), glm::vec3(1.0f, 0.0f, 0.0f), camera, renderTarget) ==
+        if (renderBoundingSphere(object.getBoundingSphere(), object.getWorldPosition(), glm::vec3(1.0f, 0.0f, 0.0f), camera, renderTarget) ==
             false) {
             return false;
         }
@@ -672,7 +845,7 @@ bool OpenGLRenderer::renderModelNormals(Model3D &model3D, Camera &camera, Render
     glm::mat4 MVP = camera.getPerspectiveMatrix() * camera.getViewMatrix() * model3D.getModelMatrix();
 
     /* Calculate normal matrix */
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model3D.getModelMatrix())));
+    glm::mat3 normalMatrix = model3D.getNormalMatrix();
 
     /* Cast the model into an internal type */
     OpenGLAsset3D *glObject = static_cast<OpenGLAsset3D *>(model3D.getAsset3D());
@@ -688,12 +861,17 @@ bool OpenGLRenderer::renderModelNormals(Model3D &model3D, Camera &camera, Render
 
         /* Draw the model */
         __(glBindVertexArray(glObject->getVertexArrayID()));
+        RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
         {
-            std::vector<uint32_t> offset = glObject->getIndicesOffsets();
-            std::vector<uint32_t> count = glObject->getIndicesCount();
+            const std::vector<uint32_t> &offset = glObject->getIndicesOffsets();
+            const std::vector<uint32_t> &count = glObject->getIndicesCount();
+
+            __(glPrimitiveRestartIndex(glObject->getRestartIndex()));
 
             for (size_t i = 0; i < offset.size(); ++i) {
-                __(glDrawElements(GL_TRIANGLES, count[i], GL_UNSIGNED_INT, (void *)(offset[i] * sizeof(GLuint))));
+                __(glDrawElements(glObject->getPrimitiveMode(), count[i], glObject->getIndexType(),
+                                  (void *)(offset[i] * glObject->getIndexSize())));
+                RenderStats::Add(RenderStats::DRAW_CALLS);
             }
         }
         __(glBindVertexArray(0));
@@ -714,6 +892,59 @@ bool OpenGLRenderer::resize(uint16_t width, uint16_t height)
 }
 
 void OpenGLRenderer::flush() { glFinish(); }
+void OpenGLRenderer::beginGPUTimer(const char *name)
+{
+    if (Profiler::IsEnabled() == false || _gpuTimersSupported == false || _gpuTimerActive) {
+        return;
+    }
+
+    GPUTimer timer;
+    if (_freeQueries.empty()) {
+        __(glGenQueries(1, &timer.query));
+    } else {
+        timer.query = _freeQueries.back();
+        _freeQueries.pop_back();
+    }
+    timer.name = name;
+    timer.frame = Profiler::GetInstance()->getFrame();
+    timer.start = Profiler::GetInstance()->now();
+
+    __(glBeginQuery(GL_TIME_ELAPSED, timer.query));
+    _gpuTimers.push_back(timer);
+    _gpuTimerActive = true;
+}
+
+void OpenGLRenderer::endGPUTimer()
+{
+    if (_gpuTimerActive) {
+        __(glEndQuery(GL_TIME_ELAPSED));
+        _gpuTimerActive = false;
+    }
+}
+
+void OpenGLRenderer::resolveGPUTimers()
+{
+    uint64_t frame = Profiler::GetInstance()->getFrame();
+
+    while (_gpuTimers.empty() == false && (_gpuTimerActive == false || _gpuTimers.size() > 1)) {
+        GPUTimer &timer = _gpuTimers.front();
+        GLuint available = GL_FALSE;
+        GLuint64 elapsed = 0;
+
+        /* Results come in order, stop at the first one not ready unless it is
+         * so old that it is better to wait for it */
+        __(glGetQueryObjectuiv(timer.query, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (available == GL_FALSE && frame - timer.frame < MaxGPUTimerLatency) {
+            break;
+        }
+        __(glGetQueryObjectui64v(timer.query, GL_QUERY_RESULT, &elapsed));
+
+        Profiler::GetInstance()->addGPUEvent(timer.name, timer.frame, timer.start, elapsed / 1000.0);
+        _freeQueries.push_back(timer.query);
+        _gpuTimers.pop_front();
+    }
+}
+
 void OpenGLRenderer::clear()
 {
     __(glBindFramebuffer(GL_FRAMEBUFFER, 0));
@@ -11,6 +11,7 @@
 #include "OpenGL.h"
 #include "Logging.hpp"
 #include "OpenGLSSAARenderTarget.hpp"
+#include "RenderStats.hpp"
 #include "Renderer.hpp"
 
 using namespace Logging;
@@ -127,11 +128,17 @@ bool OpenGLSSAARenderTarget::init(uint32_t width, uint32_t height, uint32_t fact
 void OpenGLSSAARenderTarget::bind()
 {
     __(glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer));
+    RenderStats::Add(RenderStats::FRAMEBUFFER_BINDS);
     __(glDrawBuffers(_numTargets, _attachments));
     __(glViewport(0, 0, _width, _height));
 }
 
-void OpenGLSSAARenderTarget::bindDepth() { __(glBindTexture(GL_TEXTURE_2D, _depthBuffer)); }
+void OpenGLSSAARenderTarget::bindDepth()
+{
+    __(glBindTexture(GL_TEXTURE_2D, _depthBuffer));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
+}
+
 void OpenGLSSAARenderTarget::unbind() { __(glBindFramebuffer(GL_FRAMEBUFFER, 0)); }
 bool OpenGLSSAARenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t width, uint32_t height, uint32_t target, bool bindMainFB)
 {
@@ -12,6 +12,7 @@
 #include <iostream>
 #include "OpenGLShader.hpp"
 #include "OpenGLShaderMaterial.hpp"
+#include "RenderStats.hpp"
 
 OpenGLShader::OpenGLShader(void) : _programID(0) {}
 OpenGLShader::~OpenGLShader(void)
@@ -158,6 +159,7 @@ bool OpenGLShader::linkProgram(std::string &error)
 bool OpenGLShader::attach(void)
 {
     __(glUseProgram(_programID));
+    RenderStats::Add(RenderStats::SHADER_BINDS);
     return true;
 }
 
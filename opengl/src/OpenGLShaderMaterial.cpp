@@ -21,7 +21,7 @@ void OpenGLShaderMaterial::init(uint32_t bindingPoint)
     addParamName("shininess");
 }
 
-void OpenGLShaderMaterial::copyMaterial(Material &material)
+void OpenGLShaderMaterial::copyMaterial(const Material &material)
 {
     setParamValue("ambient", material.getAmbient());
     setParamValue("diffuse", material.getDiffuse());
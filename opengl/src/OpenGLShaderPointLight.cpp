@@ -25,7 +25,7 @@ void OpenGLShaderPointLight::init(uint32_t bindingPoint, uint32_t lightIndex)
 
 void OpenGLShaderPointLight::copyLight(PointLight &light)
 {
-    setParamValue("position", light.getPosition());
+    setParamValue("position", light.getWorldPosition());
     setParamValue("ambient", light.getAmbient());
     setParamValue("diffuse", light.getDiffuse());
     setParamValue("specular", light.getSpecular());
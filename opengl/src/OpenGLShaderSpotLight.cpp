@@ -28,7 +28,7 @@ void OpenGLShaderSpotLight::init(uint32_t bindingPoint, uint32_t lightIndex)
 
 void OpenGLShaderSpotLight::copyLight(SpotLight &light)
 {
-    setParamValue("position", light.getPosition());
+    setParamValue("position", light.getWorldPosition());
     setParamValue("direction", light.getDirection());
     setParamValue("ambient", light.getAmbient());
     setParamValue("diffuse", light.getDiffuse());
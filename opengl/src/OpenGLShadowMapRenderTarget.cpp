@@ -10,6 +10,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "Logging.hpp"
 #include "OpenGLShadowMapRenderTarget.hpp"
+#include "RenderStats.hpp"
 #include "Renderer.hpp"
 #include "WindowManager.hpp"
 
@@ -100,10 +101,16 @@ bool OpenGLShadowMapRenderTarget::init(uint32_t width, uint32_t height, uint32_t
 void OpenGLShadowMapRenderTarget::bind()
 {
     __(glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer));
+    RenderStats::Add(RenderStats::FRAMEBUFFER_BINDS);
     __(glViewport(0, 0, _width, _height));
 }
 
-void OpenGLShadowMapRenderTarget::bindDepth() { __(glBindTexture(GL_TEXTURE_2D, _depthBuffer)); }
+void OpenGLShadowMapRenderTarget::bindDepth()
+{
+    __(glBindTexture(GL_TEXTURE_2D, _depthBuffer));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
+}
+
 void OpenGLShadowMapRenderTarget::unbind() { __(glBindFramebuffer(GL_FRAMEBUFFER, 0)); }
 bool OpenGLShadowMapRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t width, uint32_t height, uint32_t target, bool bindMainFB)
 {
@@ -120,6 +127,7 @@ bool OpenGLShadowMapRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t wi
     __(glViewport(dstX, dstY, width, height));
     __(glActiveTexture(GL_TEXTURE0));
     __(glBindTexture(GL_TEXTURE_2D, _depthBuffer));
+    RenderStats::Add(RenderStats::TEXTURE_BINDS);
 
     /* Tell the shader which texture unit to use */
     _shader->attach();
@@ -130,8 +138,10 @@ bool OpenGLShadowMapRenderTarget::blit(uint32_t dstX, uint32_t dstY, uint32_t wi
     //__( glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) );
 
     __(glBindVertexArray(_vertexArray));
+    RenderStats::Add(RenderStats::VERTEX_ARRAY_BINDS);
     {
         __(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+        RenderStats::Add(RenderStats::DRAW_CALLS);
     }
     __(glBindVertexArray(0));
 
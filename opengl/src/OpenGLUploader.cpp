@@ -0,0 +1,226 @@
+/**
+ * @class	OpenGLUploader
+ * @brief	Thread owning a rendering context shared with the main one, used to
+ *          upload buffers and textures to the GPU without stalling the rendering
+ *          thread
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "OpenGLUploader.hpp"
+#include <string.h>
+#include "Logging.hpp"
+
+using namespace Logging;
+
+OpenGLUploader::OpenGLUploader() : _windowManager(NULL), _exit(false), _nextPixelBuffer(0)
+{
+    for (uint32_t i = 0; i < NumPixelBuffers; ++i) {
+        _pixelBuffers[i] = 0;
+        _pixelBufferSizes[i] = 0;
+        _pixelBufferFences[i] = NULL;
+    }
+}
+
+OpenGLUploader::~OpenGLUploader()
+{
+    if (_thread.joinable() == true) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _exit = true;
+        }
+        _condition.notify_one();
+        _thread.join();
+    }
+
+    /* Fences are shared between the contexts, release the ones whose
+     * jobs were not completed */
+    for (std::deque<Completion>::iterator it = _completions.begin(); it != _completions.end(); ++it) {
+        __(glDeleteSync(it->fence));
+    }
+}
+
+bool OpenGLUploader::init(WindowManager *windowManager)
+{
+    if (windowManager == NULL || windowManager->createUploadContext() == false) {
+        return false;
+    }
+
+    _windowManager = windowManager;
+    _thread = std::thread(&OpenGLUploader::_run, this);
+
+    return true;
+}
+
+void OpenGLUploader::submit(const std::function<void()> &job, const std::function<void()> &done, const std::shared_ptr<Token> &token)
+{
+    Job entry = {job, done, token};
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(entry);
+    }
+    _condition.notify_one();
+}
+
+void OpenGLUploader::Cancel(const std::shared_ptr<Token> &token)
+{
+    std::lock_guard<std::mutex> lock(token->mutex);
+    token->cancelled = true;
+}
+
+void OpenGLUploader::processCompletions()
+{
+    for (;;) {
+        Completion completion;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_completions.empty() == true) {
+                return;
+            }
+            completion = _completions.front();
+        }
+
+        /* Do not block, the remaining jobs are checked in the next frame */
+        GLenum status = glClientWaitSync(completion.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _completions.pop_front();
+        }
+        __(glDeleteSync(completion.fence));
+
+        /* The token is only cancelled from this thread */
+        if (completion.done && (completion.token == NULL || completion.token->cancelled == false)) {
+            completion.done();
+        }
+    }
+}
+
+void OpenGLUploader::uploadBuffer(GLuint buffer, const void *data, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    /* The copy target does not interfere with any vertex array binding */
+    __(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+    void *destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (destination != NULL) {
+        memcpy(destination, data, size);
+        __(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+    } else {
+        __(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data));
+    }
+    __(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+uint32_t OpenGLUploader::_fillPixelBuffer(const uint8_t *data, size_t size)
+{
+    uint32_t index = _nextPixelBuffer;
+    _nextPixelBuffer = (_nextPixelBuffer + 1) % NumPixelBuffers;
+
+    /* Wait until the GPU has finished with the previous upload from this buffer */
+    if (_pixelBufferFences[index] != NULL) {
+        glClientWaitSync(_pixelBufferFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        __(glDeleteSync(_pixelBufferFences[index]));
+        _pixelBufferFences[index] = NULL;
+    }
+
+    __(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pixelBuffers[index]));
+    if (_pixelBufferSizes[index] < size) {
+        __(glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW));
+        _pixelBufferSizes[index] = size;
+    }
+
+    /* Copy the data into the buffer, then the driver transfers it from
+     * there asynchronously */
+    void *destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (destination != NULL) {
+        memcpy(destination, data, size);
+        __(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    } else {
+        __(glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, size, data));
+    }
+
+    return index;
+}
+
+void OpenGLUploader::_releasePixelBuffer(uint32_t index)
+{
+    __(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    _pixelBufferFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void OpenGLUploader::uploadTexture(GLuint texture, GLint level, uint32_t width, uint32_t height, GLenum format, const uint8_t *pixels,
+                                   size_t size)
+{
+    uint32_t index = _fillPixelBuffer(pixels, size);
+
+    __(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    __(glBindTexture(GL_TEXTURE_2D, texture));
+    __(glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, GL_UNSIGNED_BYTE, (const void *)0));
+    __(glBindTexture(GL_TEXTURE_2D, 0));
+
+    _releasePixelBuffer(index);
+}
+
+void OpenGLUploader::uploadCompressedTexture(GLuint texture, GLint level, uint32_t width, uint32_t height, GLenum internalFormat,
+                                             const uint8_t *data, size_t size)
+{
+    uint32_t index = _fillPixelBuffer(data, size);
+
+    __(glBindTexture(GL_TEXTURE_2D, texture));
+    __(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, internalFormat, size, (const void *)0));
+    __(glBindTexture(GL_TEXTURE_2D, 0));
+
+    _releasePixelBuffer(index);
+}
+
+void OpenGLUploader::_run()
+{
+    _windowManager->makeUploadContextCurrent(true);
+
+    __(glGenBuffers(NumPixelBuffers, _pixelBuffers));
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _exit == true || _jobs.empty() == false; });
+            if (_exit == true) {
+                break;
+            }
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        if (job.token == NULL) {
+            job.job();
+        } else {
+            /* Cancel() waits for the job while it reads the data of its owner */
+            std::lock_guard<std::mutex> lock(job.token->mutex);
+            if (job.token->cancelled == false) {
+                job.job();
+            }
+        }
+
+        /* The fence tells the rendering thread when the GPU has the data,
+         * the flush makes sure it gets to the GPU */
+        Completion completion = {glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), job.done, job.token};
+        __(glFlush());
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _completions.push_back(completion);
+    }
+
+    for (uint32_t i = 0; i < NumPixelBuffers; ++i) {
+        if (_pixelBufferFences[i] != NULL) {
+            __(glDeleteSync(_pixelBufferFences[i]));
+        }
+    }
+    __(glDeleteBuffers(NumPixelBuffers, _pixelBuffers));
+
+    _windowManager->makeUploadContextCurrent(false);
+}
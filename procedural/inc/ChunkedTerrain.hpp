@@ -0,0 +1,274 @@
+/**
+ * @class	ChunkedTerrain
+ * @brief	Terrain of unlimited size made of square tiles, generated around the
+ *          camera as it moves and with less detail the further they are.
+ *
+ *          Each tile samples the octave perlin noise function of its own part
+ *          of the world, so neighbour tiles match along their edges. The
+ *          sampling step is a power of two and the offsets are reduced to the
+ *          period of the noise, so the samples shared by two tiles are exactly
+ *          the same anywhere in the world.
+ *
+ *          The detail follows geomipmapping: level 0 has tileResolution quads
+ *          along each side and every next level halves them. The level of a
+ *          tile depends on its distance to the camera, and it differs in at
+ *          most one from the level of its neighbours. Along the edges shared
+ *          with a coarser neighbour the odd vertices are moved onto the edge of
+ *          the neighbour, so there are no cracks between levels.
+ *
+ *          The heights and the meshes are generated by the WorkerPool and
+ *          uploaded a few per frame. The changes of the tiles shown are applied
+ *          all at once when every new mesh is ready, so the visible tiles always
+ *          fit together. Tiles out of view stay cached until the cache is full,
+ *          then the least recently used ones are deleted, so the memory used
+ *          does not depend on the size of the world
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <glm/glm.hpp>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Scene.hpp"
+
+class Asset3D;
+class LightingShader;
+class Model3D;
+class Renderer;
+
+namespace Procedural
+{
+class ChunkedTerrain
+{
+  public:
+    /**
+     * Constructor
+     *
+     * @param scene           Scene where the visible tiles are added
+     * @param renderer        Renderer used to upload the tiles, or NULL to only
+     *                        generate them, for tools without a rendering context
+     * @param tileSize        Width and depth of each tile
+     * @param height          Maximum height of the terrain along the y-axis
+     * @param slice           Slice number for the perlin noise function, see Terrain
+     * @param color           Default color for the terrain material
+     * @param tileResolution  Quads along each side of the most detailed tiles, a
+     *                        power of two
+     * @param numLods         Number of levels of detail, each one with half the quads
+     *                        per side than the previous one
+     * @param tilesPerNoise   Tiles covered by a unit of the perlin noise function, a
+     *                        power of two. The bigger, the wider the hills
+     * @param complexity      Number of octaves of the perlin noise function, see Terrain
+     * @param persistence     Persistence of the octaves, see Terrain
+     */
+    ChunkedTerrain(Scene &scene, Renderer *renderer, float tileSize = 256.0f, float height = 300.0f, uint32_t slice = 0,
+                   const glm::vec3 &color = glm::vec3(1.0f, 1.0f, 1.0f), uint32_t tileResolution = 64, uint32_t numLods = 4,
+                   uint32_t tilesPerNoise = 4, uint32_t complexity = 5, float persistence = 0.5f);
+
+    /**
+     * Destructor, waits for the tiles being generated and removes the
+     * visible ones from the scene
+     */
+    ~ChunkedTerrain();
+
+    /**
+     * Sets the number of tiles shown around the tile of the camera along each
+     * axis, the terrain shown has 2 * radius + 1 tiles per side. The cache
+     * grows to hold at least twice the tiles shown
+     *
+     * @param radius  Number of tiles around the camera
+     */
+    void setViewRadius(uint32_t radius);
+
+    /**
+     * Sets the distance from the camera where the tiles start using the
+     * level of detail 1. Level 2 starts at twice the distance, level 3 at four
+     * times and so on
+     *
+     * @param distance  Distance to the nearest point of the tile
+     */
+    void setLodDistance(float distance) { _lodDistance = distance; }
+    /**
+     * Sets the maximum number of tiles kept, shown or not
+     *
+     * @param numTiles  Number of tiles
+     */
+    void setCacheSize(uint32_t numTiles);
+
+    /**
+     * Sets the maximum number of tile meshes uploaded in each update()
+     *
+     * @param numTiles  Number of meshes
+     */
+    void setUploadsPerFrame(uint32_t numTiles) { _uploadsPerFrame = numTiles > 0 ? numTiles : 1; }
+    /**
+     * Settings applied to the models of the tiles generated from now on
+     */
+    void setLightingShader(LightingShader *shader) { _lightingShader = shader; }
+    void setShadowCaster(bool flag) { _isShadowCaster = flag; }
+    /**
+     * Generates, uploads and shows the tiles around the camera. Must be
+     * called from the rendering thread before rendering each frame
+     *
+     * @param cameraPosition  Position of the camera in world coordinates
+     */
+    void update(const glm::vec3 &cameraPosition);
+
+    /**
+     * Accessors
+     */
+    float getTileSize() const { return _tileSize; }
+    uint32_t getNumTiles() const { return (uint32_t)_tiles.size(); }
+    uint32_t getNumVisibleTiles() const { return (uint32_t)_visible.size(); }
+    uint32_t getNumPendingTiles() const { return _numPending; }
+    uint32_t getCacheSize() const { return _cacheSize; }
+    /**
+     * Returns the level of detail of a visible tile
+     *
+     * @param x  Index of the tile along the x-axis
+     * @param z  Index of the tile along the z-axis
+     *
+     * @return The level of detail or -1 if the tile is not visible
+     */
+    int32_t getTileLod(int32_t x, int32_t z) const;
+
+    /**
+     * Returns the model of a visible tile
+     *
+     * @param x  Index of the tile along the x-axis
+     * @param z  Index of the tile along the z-axis
+     *
+     * @return The model or NULL if the tile is not visible
+     */
+    Model3D *getTileModel(int32_t x, int32_t z) const;
+
+  private:
+    ChunkedTerrain(const ChunkedTerrain &);
+    ChunkedTerrain &operator=(const ChunkedTerrain &);
+
+    /**
+     * Edges of a tile whose odd vertices are moved onto the edge of a
+     * coarser neighbour
+     */
+    enum StitchFlags {
+        STITCH_WEST = 1,  /**< Edge at the lowest x */
+        STITCH_EAST = 2,  /**< Edge at the highest x */
+        STITCH_NORTH = 4, /**< Edge at the lowest z */
+        STITCH_SOUTH = 8  /**< Edge at the highest z */
+    };
+
+    /**
+     * Mesh of a tile generated by the WorkerPool
+     */
+    struct Build {
+        int32_t x;                                    /**< Index of the tile along the x-axis */
+        int32_t z;                                    /**< Index of the tile along the z-axis */
+        uint8_t lod;                                  /**< Level of detail */
+        uint8_t stitch;                               /**< StitchFlags */
+        std::shared_ptr<std::vector<float> > heights; /**< Heights of the tile, generated if NULL */
+        Asset3D *asset;                               /**< Mesh generated */
+        std::atomic<bool> done;                       /**< Set by the worker when the mesh is ready */
+    };
+
+    /**
+     * Tile generated or being generated
+     */
+    struct Tile {
+        int32_t x;                                    /**< Index of the tile along the x-axis */
+        int32_t z;                                    /**< Index of the tile along the z-axis */
+        std::shared_ptr<std::vector<float> > heights; /**< Heights of the tile with a border of one sample, NULL until generated */
+        std::shared_ptr<Build> build;                 /**< Mesh being generated, if any */
+        Model3D *model;                               /**< Mesh shown, or kept while the tile is not visible */
+        uint8_t lod;                                  /**< Level of detail of model */
+        uint8_t stitch;                               /**< StitchFlags of model */
+        Model3D *ready;                               /**< Mesh uploaded and waiting to replace model */
+        uint8_t readyLod;                             /**< Level of detail of ready */
+        uint8_t readyStitch;                          /**< StitchFlags of ready */
+        Scene::ModelHandle handle;                    /**< Handle of model in the scene, null if not visible */
+        uint64_t lastUsed;                            /**< Last update() that needed the tile */
+        std::list<uint64_t>::iterator lru;            /**< Position in _lru */
+    };
+
+    /**
+     * Tile of the layout wanted around the camera
+     */
+    struct Wanted {
+        Tile *tile;     /**< Tile */
+        uint8_t lod;    /**< Level of detail */
+        uint8_t stitch; /**< StitchFlags */
+    };
+
+    static uint64_t _key(int32_t x, int32_t z) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z; }
+    /**
+     * Returns a tile, creating it if it does not exist, and marks it as the
+     * most recently used
+     */
+    Tile &_getTile(int32_t x, int32_t z);
+
+    /**
+     * Queues the generation of a mesh of a tile in the WorkerPool
+     */
+    void _submit(Tile &tile, uint8_t lod, uint8_t stitch);
+
+    /**
+     * Uploads the meshes finished by the workers, up to _uploadsPerFrame
+     */
+    void _collect(void);
+
+    /**
+     * Calculates the tiles, levels of detail and stitching wanted around the
+     * camera
+     */
+    void _layout(const glm::vec3 &cameraPosition, std::vector<Wanted> &wanted);
+
+    /**
+     * Shows the tiles wanted, replacing the visible ones
+     */
+    void _commit(const std::vector<Wanted> &wanted);
+
+    /**
+     * Deletes the least recently used tiles not needed until the cache is
+     * not over its size
+     */
+    void _evict(void);
+
+    /**
+     * Deletes a tile mesh and its asset
+     */
+    static void _deleteModel(Model3D *model);
+
+    /**
+     * Generates the heights of a tile, if needed, and its mesh. Run by the
+     * workers
+     */
+    void _generate(Build &build) const;
+
+    Scene &_scene;                         /**< Scene where the visible tiles are added */
+    Renderer *_renderer;                   /**< Renderer used to upload the meshes */
+    float _tileSize;                       /**< Width and depth of a tile */
+    float _height;                         /**< Maximum height */
+    uint32_t _slice;                       /**< Slice of the perlin noise function */
+    glm::vec3 _color;                      /**< Color of the material */
+    uint32_t _tileResolution;              /**< Quads per side of the most detailed meshes */
+    uint32_t _numLods;                     /**< Levels of detail */
+    uint32_t _samplesPerNoise;             /**< Height samples per unit of the perlin noise function */
+    uint32_t _complexity;                  /**< Octaves of the perlin noise function */
+    float _persistence;                    /**< Persistence of the octaves */
+    uint32_t _viewRadius;                  /**< Tiles shown around the tile of the camera */
+    float _lodDistance;                    /**< Distance where the level of detail 1 starts */
+    uint32_t _cacheSize;                   /**< Maximum number of tiles */
+    uint32_t _uploadsPerFrame;             /**< Maximum number of meshes uploaded per update */
+    LightingShader *_lightingShader;       /**< Lighting shader of the tiles */
+    bool _isShadowCaster;                  /**< Whether the tiles cast shadows */
+    uint64_t _frame;                       /**< Number of update() calls */
+    uint32_t _numPending;                  /**< Tiles wanted whose mesh is not ready yet */
+    std::map<uint64_t, Tile *> _tiles;     /**< Tiles by their key */
+    std::list<uint64_t> _lru;              /**< Keys of the tiles, the most recently used first */
+    std::vector<Tile *> _visible;          /**< Tiles in the scene */
+    std::vector<Wanted> _wanted;           /**< Layout wanted in the last update(), kept to reuse the memory */
+};
+};
@@ -50,7 +50,14 @@ namespace Procedural
  *                    If higher than 0.0 then the farther a vertex is from the center,
  *                    the closer it will be to the xz-plane. With a value of 2*PI along
  *                    a value of 2*PI for 'angleWidth' a sphere will be generated
+ * @param numVertsWidth  Number of vertices to generate along the x-axis
+ * @param numVertsHeight Number of vertices to generate along the z-axis
+ * @param strips      If true the grid is emitted as one triangle strip per row of quads,
+ *                    separated by Asset3D::PrimitiveRestartIndex, and the asset primitive
+ *                    type is set to PRIMITIVE_TRIANGLE_STRIP. This needs roughly a third
+ *                    of the indices of the triangles list. Only valid when the asset
+ *                    does not contain any previous geometry
  */
 void AppendBentPlane(Asset3D &asset, float width, float height, float angleWidth, float angleHeight, float angleRadius,
-                     uint32_t numVertsWidth, uint32_t numVertsHeight);
+                     uint32_t numVertsWidth, uint32_t numVertsHeight, bool strips = false);
 };
@@ -19,6 +19,6 @@ using namespace Procedural;
 BentPlane::BentPlane(float width, float height, const glm::vec3 &color, float angle, uint32_t numVertsWidth, uint32_t numVertsHeight)
     : _width(width), _height(height), _color(color), _angle(angle), _numVertsWidth(numVertsWidth), _numVertsHeight(numVertsHeight)
 {
-    AppendBentPlane(*this, _width, _height, _angle, 0.0f, 0.0f, _numVertsWidth, _numVertsHeight);
+    AppendBentPlane(*this, _width, _height, _angle, 0.0f, 0.0f, _numVertsWidth, _numVertsHeight, true);
     Asset3DTransform::SetUniqueMaterialFromColor(*this, _color);
 }
@@ -0,0 +1,417 @@
+/**
+ * @class	ChunkedTerrain
+ * @brief	Terrain of unlimited size made of square tiles, generated around the
+ *          camera as it moves and with less detail the further they are
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "ChunkedTerrain.hpp"
+#include <math.h>
+#include <algorithm>
+#include <thread>
+#include "Asset3D.hpp"
+#include "Asset3DTransform.hpp"
+#include "Logging.hpp"
+#include "MathUtils.hpp"
+#include "Model3D.hpp"
+#include "ProceduralUtils.hpp"
+#include "Renderer.hpp"
+#include "WorkerPool.hpp"
+
+using namespace Logging;
+using namespace Procedural;
+using namespace MathUtils;
+
+ChunkedTerrain::ChunkedTerrain(Scene &scene, Renderer *renderer, float tileSize, float height, uint32_t slice, const glm::vec3 &color,
+                               uint32_t tileResolution, uint32_t numLods, uint32_t tilesPerNoise, uint32_t complexity, float persistence)
+    : _scene(scene)
+    , _renderer(renderer)
+    , _tileSize(tileSize)
+    , _height(height)
+    , _slice(slice)
+    , _color(color)
+    , _tileResolution(clp2(std::max(tileResolution, 2u)))
+    , _numLods(1)
+    , _samplesPerNoise(_tileResolution * clp2(std::max(tilesPerNoise, 1u)))
+    , _complexity(complexity)
+    , _persistence(persistence)
+    , _viewRadius(4)
+    , _lodDistance(2.0f * tileSize)
+    , _cacheSize(0)
+    , _uploadsPerFrame(8)
+    , _lightingShader(NULL)
+    , _isShadowCaster(true)
+    , _frame(0)
+    , _numPending(0)
+{
+    /* The coarsest level must still have the odd vertices needed to stitch
+     * it to a finer neighbour, so it needs at least 2 quads per side */
+    while (_numLods < numLods && (_tileResolution >> _numLods) >= 2) {
+        ++_numLods;
+    }
+    setCacheSize(0);
+}
+
+ChunkedTerrain::~ChunkedTerrain()
+{
+    for (std::map<uint64_t, Tile *>::iterator it = _tiles.begin(); it != _tiles.end(); ++it) {
+        Tile *tile = it->second;
+
+        if (tile->build != NULL) {
+            while (tile->build->done == false) {
+                std::this_thread::yield();
+            }
+            Asset3D::Delete(tile->build->asset);
+        }
+        if (tile->handle) {
+            _scene.remove(tile->handle);
+        }
+        _deleteModel(tile->model);
+        _deleteModel(tile->ready);
+        delete tile;
+    }
+}
+
+void ChunkedTerrain::setViewRadius(uint32_t radius)
+{
+    _viewRadius = radius;
+    setCacheSize(_cacheSize);
+}
+
+void ChunkedTerrain::setCacheSize(uint32_t numTiles)
+{
+    /* Room for the tiles shown and the ones replacing them */
+    uint32_t side = 2 * _viewRadius + 1;
+
+    _cacheSize = std::max(numTiles, 2 * side * side);
+}
+
+int32_t ChunkedTerrain::getTileLod(int32_t x, int32_t z) const
+{
+    std::map<uint64_t, Tile *>::const_iterator it = _tiles.find(_key(x, z));
+    if (it == _tiles.end() || !it->second->handle) {
+        return -1;
+    }
+    return it->second->lod;
+}
+
+Model3D *ChunkedTerrain::getTileModel(int32_t x, int32_t z) const
+{
+    std::map<uint64_t, Tile *>::const_iterator it = _tiles.find(_key(x, z));
+    if (it == _tiles.end() || !it->second->handle) {
+        return NULL;
+    }
+    return it->second->model;
+}
+
+void ChunkedTerrain::update(const glm::vec3 &cameraPosition)
+{
+    ++_frame;
+
+    _collect();
+    _layout(cameraPosition, _wanted);
+
+    /* Generate the meshes missing, one at a time per tile */
+    _numPending = 0;
+    for (std::vector<Wanted>::iterator it = _wanted.begin(); it != _wanted.end(); ++it) {
+        Tile &tile = *it->tile;
+
+        if ((tile.model != NULL && tile.lod == it->lod && tile.stitch == it->stitch) ||
+            (tile.ready != NULL && tile.readyLod == it->lod && tile.readyStitch == it->stitch)) {
+            continue;
+        }
+
+        ++_numPending;
+        if (tile.build == NULL) {
+            _submit(tile, it->lod, it->stitch);
+        }
+    }
+
+    /* The visible tiles only change when all of them can change */
+    if (_numPending == 0) {
+        _commit(_wanted);
+    }
+
+    _evict();
+}
+
+ChunkedTerrain::Tile &ChunkedTerrain::_getTile(int32_t x, int32_t z)
+{
+    uint64_t key = _key(x, z);
+    Tile *tile;
+
+    std::map<uint64_t, Tile *>::iterator it = _tiles.find(key);
+    if (it == _tiles.end()) {
+        tile = new Tile();
+        tile->x = x;
+        tile->z = z;
+        tile->model = NULL;
+        tile->lod = 0;
+        tile->stitch = 0;
+        tile->ready = NULL;
+        tile->readyLod = 0;
+        tile->readyStitch = 0;
+
+        _lru.push_front(key);
+        tile->lru = _lru.begin();
+        _tiles[key] = tile;
+    } else {
+        tile = it->second;
+        _lru.splice(_lru.begin(), _lru, tile->lru);
+    }
+
+    tile->lastUsed = _frame;
+    return *tile;
+}
+
+void ChunkedTerrain::_submit(Tile &tile, uint8_t lod, uint8_t stitch)
+{
+    std::shared_ptr<Build> build = std::make_shared<Build>();
+
+    build->x = tile.x;
+    build->z = tile.z;
+    build->lod = lod;
+    build->stitch = stitch;
+    build->heights = tile.heights;
+    build->asset = NULL;
+    build->done = false;
+    tile.build = build;
+
+    /* The destructor waits for the build, so the terrain outlives it */
+    WorkerPool::GetInstance()->submit([this, build]() {
+        _generate(*build);
+        build->done = true;
+    });
+}
+
+void ChunkedTerrain::_collect(void)
+{
+    uint32_t uploads = 0;
+
+    for (std::map<uint64_t, Tile *>::iterator it = _tiles.begin(); it != _tiles.end(); ++it) {
+        Tile &tile = *it->second;
+
+        if (tile.build == NULL || tile.build->done == false) {
+            continue;
+        }
+
+        Build &build = *tile.build;
+        if (tile.heights == NULL) {
+            tile.heights = build.heights;
+        }
+        if (uploads == _uploadsPerFrame) {
+            continue;
+        }
+        ++uploads;
+
+        if (_renderer != NULL && _renderer->prepareAsset3D(*build.asset) == false) {
+            log("ERROR preparing the asset of the terrain tile %d, %d\n", tile.x, tile.z);
+            Asset3D::Delete(build.asset);
+            tile.build.reset();
+            continue;
+        }
+
+        Model3D *model = new Model3D(build.asset);
+        model->setPosition(glm::vec3((tile.x + 0.5f) * _tileSize, 0.0f, (tile.z + 0.5f) * _tileSize));
+        model->setLightingShader(_lightingShader);
+        model->setShadowCaster(_isShadowCaster);
+
+        _deleteModel(tile.ready);
+        tile.ready = model;
+        tile.readyLod = build.lod;
+        tile.readyStitch = build.stitch;
+        tile.build.reset();
+    }
+}
+
+void ChunkedTerrain::_layout(const glm::vec3 &cameraPosition, std::vector<Wanted> &wanted)
+{
+    int32_t radius = (int32_t)_viewRadius, side = 2 * radius + 1;
+    int32_t firstX = (int32_t)floorf(cameraPosition.x / _tileSize) - radius;
+    int32_t firstZ = (int32_t)floorf(cameraPosition.z / _tileSize) - radius;
+    float dy = std::max(std::max(-cameraPosition.y, cameraPosition.y - _height), 0.0f);
+    std::vector<uint8_t> lods(side * side);
+
+    /* Level of detail by the distance to the nearest point of each tile */
+    for (int32_t z = 0; z < side; ++z) {
+        for (int32_t x = 0; x < side; ++x) {
+            float minX = (firstX + x) * _tileSize, minZ = (firstZ + z) * _tileSize;
+            float dx = std::max(std::max(minX - cameraPosition.x, cameraPosition.x - minX - _tileSize), 0.0f);
+            float dz = std::max(std::max(minZ - cameraPosition.z, cameraPosition.z - minZ - _tileSize), 0.0f);
+            float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+            uint8_t lod = 0;
+
+            for (float limit = _lodDistance; distance >= limit && lod + 1u < _numLods; limit *= 2.0f) {
+                ++lod;
+            }
+            lods[z * side + x] = lod;
+        }
+    }
+
+    /* Neighbours can only differ in one level, finer levels win */
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int32_t z = 0; z < side; ++z) {
+            for (int32_t x = 0; x < side; ++x) {
+                uint8_t &lod = lods[z * side + x];
+                uint8_t finest = lod;
+
+                finest = x > 0 ? std::min(finest, lods[z * side + x - 1]) : finest;
+                finest = x + 1 < side ? std::min(finest, lods[z * side + x + 1]) : finest;
+                finest = z > 0 ? std::min(finest, lods[(z - 1) * side + x]) : finest;
+                finest = z + 1 < side ? std::min(finest, lods[(z + 1) * side + x]) : finest;
+                if (lod > finest + 1) {
+                    lod = finest + 1;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    wanted.clear();
+    for (int32_t z = 0; z < side; ++z) {
+        for (int32_t x = 0; x < side; ++x) {
+            Wanted entry;
+
+            entry.tile = &_getTile(firstX + x, firstZ + z);
+            entry.lod = lods[z * side + x];
+            entry.stitch = 0;
+            entry.stitch |= x > 0 && lods[z * side + x - 1] > entry.lod ? STITCH_WEST : 0;
+            entry.stitch |= x + 1 < side && lods[z * side + x + 1] > entry.lod ? STITCH_EAST : 0;
+            entry.stitch |= z > 0 && lods[(z - 1) * side + x] > entry.lod ? STITCH_NORTH : 0;
+            entry.stitch |= z + 1 < side && lods[(z + 1) * side + x] > entry.lod ? STITCH_SOUTH : 0;
+            wanted.push_back(entry);
+        }
+    }
+}
+
+void ChunkedTerrain::_commit(const std::vector<Wanted> &wanted)
+{
+    /* Hide the tiles no longer wanted, their meshes stay cached */
+    for (std::vector<Tile *>::iterator it = _visible.begin(); it != _visible.end(); ++it) {
+        if ((*it)->lastUsed != _frame) {
+            _scene.remove((*it)->handle);
+            (*it)->handle = Scene::ModelHandle();
+        }
+    }
+
+    _visible.clear();
+    for (std::vector<Wanted>::const_iterator it = wanted.begin(); it != wanted.end(); ++it) {
+        Tile &tile = *it->tile;
+
+        if (tile.model == NULL || tile.lod != it->lod || tile.stitch != it->stitch) {
+            if (tile.handle) {
+                _scene.remove(tile.handle);
+                tile.handle = Scene::ModelHandle();
+            }
+            _deleteModel(tile.model);
+            tile.model = tile.ready;
+            tile.lod = tile.readyLod;
+            tile.stitch = tile.readyStitch;
+            tile.ready = NULL;
+        } else if (tile.ready != NULL) {
+            /* A mesh of a layout that was never shown */
+            _deleteModel(tile.ready);
+            tile.ready = NULL;
+        }
+
+        if (!tile.handle) {
+            tile.handle = _scene.add(tile.model);
+        }
+        _visible.push_back(&tile);
+    }
+}
+
+void ChunkedTerrain::_evict(void)
+{
+    std::list<uint64_t>::iterator it = _lru.end();
+
+    while (_tiles.size() > _cacheSize && it != _lru.begin()) {
+        --it;
+
+        Tile *tile = _tiles[*it];
+        if (tile->lastUsed == _frame || tile->handle || tile->build != NULL) {
+            continue;
+        }
+
+        _deleteModel(tile->model);
+        _deleteModel(tile->ready);
+        _tiles.erase(*it);
+        it = _lru.erase(it);
+        delete tile;
+    }
+}
+
+void ChunkedTerrain::_deleteModel(Model3D *model)
+{
+    if (model == NULL) {
+        return;
+    }
+
+    Asset3D *asset = model->getAsset3D();
+    delete model;
+    Asset3D::Delete(asset);
+}
+
+void ChunkedTerrain::_generate(Build &build) const
+{
+    uint32_t side = _tileResolution + 3;
+
+    /* Heights with a border of one sample, for the normals of the edges.
+     * The step is a power of two and the offsets are reduced to the period
+     * of the noise, 256, so every coordinate is exact in single precision and
+     * the samples shared with the neighbours are the same */
+    if (build.heights == NULL) {
+        int64_t period = 256 * (int64_t)_samplesPerNoise;
+        int64_t firstX = (((int64_t)build.x * _tileResolution) % period + period) % period;
+        int64_t firstZ = (((int64_t)build.z * _tileResolution) % period + period) % period;
+        float step = 1.0f / _samplesPerNoise;
+
+        build.heights = std::make_shared<std::vector<float> >(side * side);
+        Perlin::OctaveGrid(&(*build.heights)[0], side, side, glm::vec3((firstX - 1) * step, (float)_slice, (firstZ - 1) * step),
+                           glm::vec3(0.0f, 0.0f, step), glm::vec3(step, 0.0f, 0.0f), _complexity, _persistence);
+    }
+
+    uint32_t stride = 1u << build.lod;
+    uint32_t numVerts = (_tileResolution >> build.lod) + 1;
+    float slope = _height * _tileResolution / (2.0f * _tileSize);
+    const float *heights = &(*build.heights)[0];
+    Asset3D *asset = Asset3D::New();
+
+    /* The rows of the plane go along the z-axis */
+    AppendBentPlane(*asset, _tileSize, _tileSize, 0.0f, 0.0f, 0.0f, numVerts, numVerts, true);
+
+    Asset3D::VertexData *data = &asset->_vertexData[0];
+    for (uint32_t i = 0; i < numVerts; ++i) {
+        for (uint32_t j = 0; j < numVerts; ++j) {
+            const float *sample = heights + (i * stride + 1) * side + j * stride + 1;
+
+            data[i * numVerts + j].vertex.y = sample[0] * _height;
+            data[i * numVerts + j].normal =
+                glm::normalize(glm::vec3((sample[-1] - sample[1]) * slope, 1.0f, (sample[-(int32_t)side] - sample[side]) * slope));
+        }
+    }
+
+    /* Move the odd vertices of the edges shared with coarser neighbours to
+     * the middle of the even ones, which is where the edge of the neighbour is */
+    uint32_t last = numVerts - 1;
+    for (uint32_t k = 1; k < last; k += 2) {
+        if (build.stitch & STITCH_WEST) {
+            data[k * numVerts].vertex.y = (data[(k - 1) * numVerts].vertex.y + data[(k + 1) * numVerts].vertex.y) * 0.5f;
+        }
+        if (build.stitch & STITCH_EAST) {
+            data[k * numVerts + last].vertex.y =
+                (data[(k - 1) * numVerts + last].vertex.y + data[(k + 1) * numVerts + last].vertex.y) * 0.5f;
+        }
+        if (build.stitch & STITCH_NORTH) {
+            data[k].vertex.y = (data[k - 1].vertex.y + data[k + 1].vertex.y) * 0.5f;
+        }
+        if (build.stitch & STITCH_SOUTH) {
+            data[last * numVerts + k].vertex.y = (data[last * numVerts + k - 1].vertex.y + data[last * numVerts + k + 1].vertex.y) * 0.5f;
+        }
+    }
+
+    Asset3DTransform::SetUniqueMaterialFromColor(*asset, _color);
+    asset->calculateBounds();
+    build.asset = asset;
+}
@@ -15,7 +15,7 @@ using namespace Logging;
 #define PI 3.14159265358979323846
 
 void Procedural::AppendBentPlane(Asset3D &asset, float width, float height, float angleWidth, float angleHeight, float angleRadius,
-                                 uint32_t numVertsWidth, uint32_t numVertsHeight)
+                                 uint32_t numVertsWidth, uint32_t numVertsHeight, bool strips)
 {
     float radiusWidth, offsetWidth, angleIncrementWidth;
     float radiusHeight, offsetHeight, angleIncrementHeight;
@@ -37,14 +37,19 @@ void Procedural::AppendBentPlane(Asset3D &asset, float width, float height, floa
     float halfHeight = height / 2.0f;
 
     /*
-     * For each row of vertices of the plane two indices are needed
-     * per column, plus one at the beggining and other at the end
-     * for degenerate triangles. That is number of 2*columns + 2.
-     * Then multiplied by the number of rows minus one, as the last
-     * row does have to generate more triangles
+     * For triangle strips each row of quads needs two indices per
+     * column, plus the restart index to finish the strip except for
+     * the last row. For triangles lists each quad needs 2 triangles
+     * with 3 vertices each
      */
     asset._vertexData.resize(numVertsWidth * numVertsHeight);
-    asset._vertexIndices.resize((size_t)(2 * 3 * numEdgesWidth * numEdgesHeight)); /** 2 triangles, 3 vertices each */
+    if (strips) {
+        asset._vertexIndices.resize((size_t)((2 * numVertsWidth + 1) * numEdgesHeight - 1));
+        asset._primitiveType = Asset3D::PRIMITIVE_TRIANGLE_STRIP;
+    } else {
+        asset._vertexIndices.resize((size_t)(2 * 3 * numEdgesWidth * numEdgesHeight));
+        asset._primitiveType = Asset3D::PRIMITIVE_TRIANGLES;
+    }
 
     Asset3D::VertexData *data = &asset._vertexData[0];
 
@@ -119,6 +124,24 @@ void Procedural::AppendBentPlane(Asset3D &asset, float width, float height, floa
 
     /* Generate the indices */
     uint32_t *index = &asset._vertexIndices[0];
+
+    if (strips) {
+        /* Each strip zig-zags between two consecutive rows of vertices, which
+         * produces the same triangles and winding than the triangles list */
+        for (unsigned int i = 0, count = 0; i < numEdgesHeight; ++i) {
+            uint32_t span = i * numVertsWidth;
+
+            if (i != 0) {
+                index[count++] = Asset3D::PrimitiveRestartIndex;
+            }
+            for (unsigned int j = 0; j < numVertsWidth; ++j) {
+                index[count++] = j + span;
+                index[count++] = j + span + numVertsWidth;
+            }
+        }
+        return;
+    }
+
     for (unsigned int i = 0, count = 0; i < numEdgesHeight; ++i) {
         for (unsigned int j = 0; j < numEdgesWidth; ++j) {
             uint32_t span = i * numVertsWidth;
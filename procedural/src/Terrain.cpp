@@ -7,6 +7,8 @@
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #include "Terrain.hpp"
+#include <algorithm>
+#include <vector>
 #include <glm/glm.hpp>
 #include "Asset3DTransform.hpp"
 #include "Logging.hpp"
@@ -27,34 +29,23 @@ Terrain::Terrain(float width, float depth, float height, uint32_t slice, const g
     , _numVertsWidth(numVertsWidth)
     , _numVertsDepth(numVertsDepth)
 {
-    float minHeight = _height;
-    uint32_t nData = 0;
+    uint32_t numVerts = numVertsWidth * numVertsDepth;
+    std::vector<float> heights(numVerts);
 
-    AppendBentPlane(*this, _width, _depth, 0.0f, 0.0f, 0.0f, _numVertsWidth, _numVertsDepth);
+    AppendBentPlane(*this, _width, _depth, 0.0f, 0.0f, 0.0f, _numVertsWidth, _numVertsDepth, true);
 
-    /* Now modify the height according to the octave perlin noise function */
-    Asset3D::VertexData *data = &_asset->_vertexData[0];
+    /* Sample the octave perlin noise function at every vertex, the rows of
+     * the plane go along the x-axis */
+    Perlin::OctaveGrid(&heights[0], numVertsWidth, numVertsDepth, glm::vec3(0.0f, (float)_slice, 0.0f),
+                       glm::vec3(1.0f / _numVertsWidth, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f / _numVertsDepth), numOctaves,
+                       persistence);
 
-    for (uint32_t i = 0; i < numVertsWidth; ++i) {
-        for (uint32_t j = 0; j < numVertsDepth; ++j) {
-            /* Generate the vertex height */
-            data[nData].vertex.y =
-                (float)(Perlin::Octave(i / (float)_numVertsWidth, (float)_slice, j / (float)_numVertsDepth, numOctaves, persistence) *
-                        _height);
-            if (data[nData].vertex.y < minHeight) {
-                minHeight = data[nData].vertex.y;
-            }
-            nData++;
-        }
-    }
+    /* Now modify the height and adjust it to the minimum value */
+    Asset3D::VertexData *data = &_asset->_vertexData[0];
+    float minHeight = *std::min_element(heights.begin(), heights.end()) * _height;
 
-    /* Adjust the height to the minimum value and
-     * readjust the normals */
-    nData = 0;
-    for (uint32_t i = 0; i < numVertsWidth; ++i) {
-        for (uint32_t j = 0; j < numVertsDepth; ++j) {
-            data[nData++].vertex.y -= minHeight;
-        }
+    for (uint32_t i = 0; i < numVerts; ++i) {
+        data[i].vertex.y = heights[i] * _height - minHeight;
     }
 
     Asset3DTransform::RecalculateNormals(*this);
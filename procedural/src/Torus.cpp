@@ -24,6 +24,6 @@ Torus::Torus(float outerRadius, float innerRadius, const glm::vec3 &color, uint3
     }
 
     AppendBentPlane(*this, (float)((_outerRadius - _innerRadius) * 2.0f * PI), (float)(_outerRadius * 2.0f * PI), (float)(2.0f * PI),
-                    (float)(2.0f * PI), 0.0f, _numVertsToroidal + 1, _numVertsPoloidal + 1);
+                    (float)(2.0f * PI), 0.0f, _numVertsToroidal + 1, _numVertsPoloidal + 1, true);
     Asset3DTransform::SetUniqueMaterialFromColor(*this, _color);
 }
@@ -0,0 +1,254 @@
+/**
+ * @file    CullingTests.cpp
+ * @brief   Tests of FrustumCulling
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <random>
+#include <vector>
+#include "Camera.hpp"
+#include "FrustumCulling.hpp"
+#include "Test.hpp"
+
+/**
+ * Bounds of an object, a sphere and an AABB around the same center
+ */
+struct Bounds {
+    glm::vec3 center;  /**< Center of both */
+    float radius;      /**< Radius of the sphere */
+    glm::vec3 extent;  /**< Half extents of the AABB */
+};
+
+/**
+ * Reference test of one object, without plane coherency. The operations are
+ * done in the same order than in the kernels, objects touching a plane give
+ * the same result
+ */
+static bool _isVisible(const glm::vec4 *planes, const Bounds &bounds)
+{
+    glm::vec3 aabbMin = bounds.center - bounds.extent, aabbMax = bounds.center + bounds.extent;
+    glm::vec3 center = (aabbMin + aabbMax) * 0.5f, extent = (aabbMax - aabbMin) * 0.5f;
+    bool inside = true;
+
+    for (uint32_t i = 0; i < FrustumCulling::NumPlanes; ++i) {
+        const glm::vec4 &p = planes[i];
+        float distance = p.x * bounds.center.x + p.y * bounds.center.y + p.z * bounds.center.z + p.w;
+
+        if (distance < -bounds.radius) {
+            return false;
+        }
+        inside = inside && distance >= bounds.radius;
+    }
+    for (uint32_t i = 0; i < FrustumCulling::NumPlanes && inside == false; ++i) {
+        const glm::vec4 &p = planes[i];
+        float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w + fabsf(p.x) * extent.x + fabsf(p.y) * extent.y +
+                         fabsf(p.z) * extent.z;
+
+        if (distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Camera at the origin looking along -z, or in a random pose
+ */
+static void _setCamera(Camera &camera, std::mt19937 *random)
+{
+    camera.setProjection(1280.0f, 720.0f, 0.1f, 250.0f);
+    if (random == NULL) {
+        camera.setPosition(glm::vec3(0.0f, 0.0f, 0.0f));
+        camera.lookAt(glm::vec3(0.0f, 0.0f, -1.0f));
+    } else {
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+        camera.setPosition(glm::vec3(position(*random), position(*random), position(*random)));
+        camera.lookAt(glm::vec3(position(*random), position(*random), position(*random)));
+    }
+    camera.recalculateFrustum();
+}
+
+/**
+ * Objects scattered over a cube around the origin, with AABBs both tighter and
+ * looser than their spheres
+ */
+static std::vector<Bounds> _scatter(std::mt19937 &random, uint32_t count)
+{
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.5f, 20.0f);
+    std::vector<Bounds> objects(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        objects[i].center = glm::vec3(position(random), position(random), position(random));
+        objects[i].extent = glm::vec3(size(random), size(random), size(random));
+        objects[i].radius = glm::length(objects[i].extent) * (i % 2 ? 1.0f : 0.8f);
+    }
+    return objects;
+}
+
+static void _add(CullingBounds &bounds, const Bounds &object)
+{
+    bounds.add(object.center, object.radius, object.center - object.extent, object.center + object.extent);
+}
+
+/**
+ * Culls with both kernels and checks them against the reference
+ *
+ * @param culled  Indices added with addCulled()
+ */
+static bool _checkCull(const glm::vec4 *planes, CullingBounds &bounds, const std::vector<Bounds> &objects,
+                       const std::vector<bool> &culled = std::vector<bool>())
+{
+    /* One word more than needed, the kernels must not write it */
+    std::vector<uint32_t> simd(bounds.getMaskWords() + 1, 0xdeadbeef), scalar(bounds.getMaskWords() + 1, 0xdeadbeef);
+
+    FrustumCulling::Cull(planes, bounds, simd.data());
+    FrustumCulling::CullScalar(planes, bounds, scalar.data());
+    CHECK(simd.back() == 0xdeadbeef && scalar.back() == 0xdeadbeef);
+
+    for (uint32_t i = 0; i < bounds.size(); ++i) {
+        bool expected = (i >= culled.size() || culled[i] == false) && _isVisible(planes, objects[i]);
+
+        if (FrustumCulling::IsVisible(simd.data(), i) != expected || FrustumCulling::IsVisible(scalar.data(), i) != expected) {
+            fprintf(stderr, "ERROR object %u of %u is %s visible\n", i, bounds.size(), expected ? "not" : "");
+            return false;
+        }
+    }
+
+    /* The bits past the last object, the padding included, are never set */
+    for (uint32_t i = bounds.size(); i < bounds.getMaskWords() * 32; ++i) {
+        CHECK(FrustumCulling::IsVisible(simd.data(), i) == false && FrustumCulling::IsVisible(scalar.data(), i) == false);
+    }
+    return true;
+}
+
+TEST(CullingRandomScenes, "culling.randomScenes")
+{
+    const uint32_t counts[] = {100, 1000, 10000};
+    std::mt19937 random(1234);
+    Camera camera;
+
+    for (uint32_t scene = 0; scene < 20; ++scene) {
+        std::vector<Bounds> objects = _scatter(random, counts[scene % 3]);
+        CullingBounds bounds;
+
+        _setCamera(camera, &random);
+        for (uint32_t i = 0; i < objects.size(); ++i) {
+            _add(bounds, objects[i]);
+        }
+        CHECK(_checkCull(camera.getFrustumPlanes(), bounds, objects));
+    }
+    return true;
+}
+
+/**
+ * Counts not multiple of the lanes, in a fresh CullingBounds and in one that
+ * held more objects the previous frame, all of them visible
+ */
+TEST(CullingPadding, "culling.padding")
+{
+    const uint32_t counts[] = {1, 7, 9, 13, 31, 33};
+    std::vector<Bounds> objects(64);
+    CullingBounds reused;
+    Camera camera;
+
+    _setCamera(camera, NULL);
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        objects[i].center = glm::vec3(0.0f, 0.0f, -50.0f - i);
+        objects[i].radius = 1.0f;
+        objects[i].extent = glm::vec3(0.5f);
+    }
+
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        _add(reused, objects[i]);
+    }
+    CHECK(_checkCull(camera.getFrustumPlanes(), reused, objects));
+
+    for (uint32_t i = 0; i < sizeof counts / sizeof counts[0]; ++i) {
+        CullingBounds bounds;
+
+        reused.clear();
+        for (uint32_t j = 0; j < counts[i]; ++j) {
+            _add(bounds, objects[j]);
+            _add(reused, objects[j]);
+        }
+        CHECK(bounds.getPaddedSize() % CullingBounds::Lanes == 0 && bounds.getPaddedSize() - bounds.size() < CullingBounds::Lanes);
+        CHECK(_checkCull(camera.getFrustumPlanes(), bounds, objects));
+        CHECK(_checkCull(camera.getFrustumPlanes(), reused, objects));
+    }
+    return true;
+}
+
+/**
+ * Objects added with addCulled() are never visible and do not move the
+ * indices of the rest
+ */
+TEST(CullingAddCulled, "culling.addCulled")
+{
+    std::mt19937 random(5678);
+    std::vector<Bounds> objects = _scatter(random, 1000);
+    std::vector<bool> culled(objects.size());
+    CullingBounds bounds;
+    Camera camera;
+
+    _setCamera(camera, NULL);
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        culled[i] = random() % 3 == 0;
+        CHECK((culled[i] ? bounds.addCulled() : bounds.add(objects[i].center, objects[i].radius, objects[i].center - objects[i].extent,
+                                                          objects[i].center + objects[i].extent)) == i);
+    }
+    CHECK(_checkCull(camera.getFrustumPlanes(), bounds, objects, culled));
+
+    /* Culled even when they are inside the frustum */
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        culled[i] = _isVisible(camera.getFrustumPlanes(), objects[i]);
+    }
+    bounds.clear();
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        if (culled[i]) {
+            bounds.addCulled();
+        } else {
+            _add(bounds, objects[i]);
+        }
+    }
+    CHECK(_checkCull(camera.getFrustumPlanes(), bounds, objects, culled));
+    return true;
+}
+
+/**
+ * The plane that culled each object in the previous frame must not change
+ * the results, whether the camera or the objects moved since then
+ */
+TEST(CullingPlaneCoherency, "culling.planeCoherency")
+{
+    std::mt19937 random(9012);
+    std::vector<Bounds> objects = _scatter(random, 5000);
+    CullingBounds bounds;
+    Camera camera;
+
+    for (uint32_t frame = 0; frame < 10; ++frame) {
+        /* Same camera twice in a row, then a new one */
+        if (frame % 2 == 0) {
+            _setCamera(camera, &random);
+        }
+        /* A quarter of the objects moves every frame */
+        bounds.clear();
+        for (uint32_t i = 0; i < objects.size(); ++i) {
+            if (random() % 4 == 0) {
+                objects[i].center = -objects[i].center;
+            }
+            _add(bounds, objects[i]);
+        }
+        CHECK(_checkCull(camera.getFrustumPlanes(), bounds, objects));
+
+        /* Replaced in place too */
+        for (uint32_t i = 0; i < objects.size(); i += 3) {
+            objects[i].center.x += 50.0f;
+            bounds.set(i, objects[i].center, objects[i].radius, objects[i].center - objects[i].extent, objects[i].center + objects[i].extent);
+        }
+        CHECK(_checkCull(camera.getFrustumPlanes(), bounds, objects));
+    }
+    return true;
+}
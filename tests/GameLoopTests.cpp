@@ -0,0 +1,157 @@
+/**
+ * @file    GameLoopTests.cpp
+ * @brief   Tests of the game loop
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <string.h>
+#include <glm/glm.hpp>
+#include "AllocationTracker.hpp"
+#include "BlinnPhongShader.hpp"
+#include "Camera.hpp"
+#include "Cube.hpp"
+#include "DirectLight.hpp"
+#include "Game.hpp"
+#include "NOAARenderTarget.hpp"
+#include "Plane.hpp"
+#include "PointLight.hpp"
+#include "Scene.hpp"
+#include "Sphere.hpp"
+#include "SpotLight.hpp"
+#include "Test.hpp"
+#include "Torus.hpp"
+
+/**
+ * Renders a scene with models, shadow casting lights and the text console
+ * while the camera orbits it, and keeps the allocation statistics of the
+ * first frame after the warm-up
+ */
+class SteadyFrameHandler : public GameHandler
+{
+  public:
+    SteadyFrameHandler() : _viewport(0, 0, 0, 0), _shader(NULL), _frames(0), _measured(false)
+    {
+        memset(_stats, 0, sizeof _stats);
+        memset(&_total, 0, sizeof _total);
+    }
+    bool handleInit(Game *game)
+    {
+        uint32_t width, height;
+
+        game->getWindowManager()->getWindowSize(&width, &height);
+        _viewport = Viewport(0, 0, width, height);
+
+        _scene.add("RT_noaa", NOAARenderTarget::New());
+        _scene.getRenderTarget("RT_noaa")->init(width, height);
+
+        _scene.add("PL_light", new PointLight(glm::vec3(1.0f, 1.0f, 0.2f), glm::vec3(1.0f, 1.0f, 0.2f), glm::vec3(1.0f, 1.0f, 0.2f),
+                                              glm::vec3(-100.0f, 100.0f, 100.0f), 0.0000099999f, 1000.0f));
+        _scene.getPointLight("PL_light")->setProjection((float)width, (float)height, 0.1f, 10000.0f);
+        _scene.getPointLight("PL_light")->getShadowMap()->init(width, height);
+
+        _scene.add("SL_light", new SpotLight(glm::vec3(2.0f, 0.5f, 0.5f), glm::vec3(2.0f, 0.5f, 0.5f), glm::vec3(2.0f, 0.5f, 0.5f),
+                                             glm::vec3(160.0f, 170.0f, 0.0f), 15.0f, 3.0f, 0.0000099999f, 1000.0f));
+        _scene.getSpotLight("SL_light")->setProjection((float)width, (float)height, 0.1f, 10000.0f);
+        _scene.getSpotLight("SL_light")->getShadowMap()->init(width, height);
+
+        _scene.add("DL_light", new DirectLight(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.4f, 0.4f, 0.4f),
+                                               glm::vec3(-100.0f, -100.0f, -100.0f)));
+        _scene.getDirectLight("DL_light")->setPosition(glm::vec3(-200.0f, 200.0f, -150.0f));
+        _scene.getDirectLight("DL_light")->setProjection((float)width, (float)height, 0.1f, 1000.0f);
+        _scene.getDirectLight("DL_light")->getShadowMap()->init(width, height);
+
+        _shader = BlinnPhongShader::New();
+        if (_shader->init() == false) {
+            return false;
+        }
+
+        if (_add(game, "M3D_plane", new Procedural::Plane(), glm::vec3(0.0f, -70.0f, 0.0f), false) == false ||
+            _add(game, "M3D_sphere", new Procedural::Sphere(), glm::vec3(-40.0f, 0.0f, 0.0f), true) == false ||
+            _add(game, "M3D_cube", new Procedural::Cube(), glm::vec3(40.0f, 0.0f, 0.0f), true) == false ||
+            _add(game, "M3D_torus", new Procedural::Torus(), glm::vec3(0.0f, 0.0f, 40.0f), true) == false) {
+            return false;
+        }
+        _scene.getModel("M3D_plane")->setScaleFactor(glm::vec3(500.0f, 1.0f, 500.0f));
+
+        _scene.add("C_camera", new Camera());
+        _scene.getCamera("C_camera")->setProjection((float)width, (float)height, 0.1f, 1000.0f, 45.0f);
+        return true;
+    }
+    bool handleTick(Game *game, double elapsedMs)
+    {
+        /* Statistics of the frame rendered since the previous tick */
+        if (_frames == WarmupFrames + 1) {
+            for (uint32_t tag = 0; tag < AllocationTracker::TAG_COUNT; ++tag) {
+                _stats[tag] = AllocationTracker::GetFrameStats((AllocationTracker::Tag)tag);
+            }
+            _total = AllocationTracker::GetFrameTotal();
+            _measured = true;
+            return false;
+        }
+
+        float angle = _frames * 0.1f;
+        _scene.getActiveCamera()->setPosition(glm::vec3(210.0f * cosf(angle), 100.0f, 210.0f * sinf(angle)));
+        _scene.getActiveCamera()->lookAt(glm::vec3(0.0f, 0.0f, 0.0f));
+        _scene.getModel("M3D_torus")->rotate(glm::rotate(0.05f, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        ++_frames;
+        return true;
+    }
+    bool handleRender(Game *game) { return game->getRenderer()->renderScene(_scene, _viewport); }
+    bool isMeasured() const { return _measured; }
+    const AllocationTracker::Stats &getStats(AllocationTracker::Tag tag) const { return _stats[tag]; }
+    const AllocationTracker::Stats &getTotal() const { return _total; }
+  private:
+    /**
+     * Frames rendered before measuring, enough for the frame arena, the
+     * containers of the renderer and the profiler to reach their sizes
+     */
+    static const uint32_t WarmupFrames = 10;
+
+    bool _add(Game *game, const char *name, Model3D *model, const glm::vec3 &position, bool shadowCaster)
+    {
+        if (game->getRenderer()->prepareAsset3D(*model) == false) {
+            return false;
+        }
+        _scene.add(name, model);
+        model->setPosition(position);
+        model->setLightingShader(_shader);
+        model->setShadowCaster(shadowCaster);
+        return true;
+    }
+
+    Scene _scene;                                                  /**< Scene rendered */
+    Viewport _viewport;                                            /**< Whole window */
+    BlinnPhongShader *_shader;                                     /**< Lighting shader of the models */
+    uint32_t _frames;                                              /**< Frames rendered */
+    bool _measured;                                                /**< Whether the frame after the warm-up was measured */
+    AllocationTracker::Stats _stats[AllocationTracker::TAG_COUNT]; /**< Allocations of each tag in that frame */
+    AllocationTracker::Stats _total;                               /**< Allocations of the engine in that frame */
+};
+
+/**
+ * Once warmed up, a frame must not allocate from the general heap: the
+ * transient data of the renderer comes from the FrameArena. Needs the engine
+ * built with TRACK_ALLOCATIONS, see "make test-allocations"
+ */
+TEST(SteadyFrameAllocations, "allocations.steadyFrame")
+{
+    if (AllocationTracker::IsEnabled() == false) {
+        SKIP("the engine was built without TRACK_ALLOCATIONS");
+    }
+
+    SteadyFrameHandler handler;
+    CHECK(Test::RunGame(handler));
+    CHECK(handler.isMeasured());
+
+    for (uint32_t tag = 0; tag < AllocationTracker::TAG_COUNT; ++tag) {
+        const AllocationTracker::Stats &stats = handler.getStats((AllocationTracker::Tag)tag);
+        if (stats.allocations > 0 && tag != AllocationTracker::TAG_DRIVER) {
+            fprintf(stderr, "%s: %llu allocations, %llu bytes\n", AllocationTracker::GetTagName((AllocationTracker::Tag)tag),
+                    (unsigned long long)stats.allocations, (unsigned long long)stats.bytes);
+        }
+    }
+    CHECK(handler.getTotal().allocations == 0);
+    return true;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file    PerlinTests.cpp
+ * @brief   Tests of MathUtils::Perlin
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "MathUtils.hpp"
+#include "Test.hpp"
+
+/**
+ * Checks a grid sampled with octaveGrid() against octave(), one value at a time
+ */
+static bool _checkGrid(const MathUtils::Perlin &perlin, uint32_t rows, uint32_t columns, const glm::vec3 &origin, uint8_t octaves)
+{
+    const glm::vec3 rowStep(0.05f, 0.0f, 0.0f), columnStep(0.0f, 0.0f, 0.05f);
+    std::vector<float> values(rows * columns + 1, -1.0f);
+
+    perlin.octaveGrid(&values[0], rows, columns, origin, rowStep, columnStep, octaves, 0.5f);
+    CHECK(values.back() == -1.0f);
+
+    for (uint32_t row = 0; row < rows; ++row) {
+        for (uint32_t column = 0; column < columns; ++column) {
+            glm::vec3 p = origin + rowStep * (float)row + columnStep * (float)column;
+            double expected = perlin.octave(p.x, p.y, p.z, octaves, 0.5);
+
+            if (fabs(expected - values[row * columns + column]) > 1e-4) {
+                fprintf(stderr, "ERROR perlin grid %ux%u (%u, %u) is %f instead of %f\n", rows, columns, row, column,
+                        values[row * columns + column], expected);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * The SIMD kernel matches the scalar one, with negative coordinates, rows
+ * that are not a multiple of the lanes and grids big enough to be sampled in
+ * parallel
+ */
+TEST(PerlinOctaveGrid, "perlin.octaveGrid")
+{
+    const uint8_t octaves[] = {1, 4, 8};
+    MathUtils::Perlin perlin(7);
+
+    for (uint32_t i = 0; i < sizeof octaves / sizeof octaves[0]; ++i) {
+        CHECK(_checkGrid(perlin, 256, 256, glm::vec3(-6.4f, 0.5f, -3.2f), octaves[i]));
+        CHECK(_checkGrid(perlin, 13, MathUtils::Perlin::GetLanes() * 3 + 1, glm::vec3(2.1f, -0.7f, -9.3f), octaves[i]));
+        CHECK(_checkGrid(perlin, 1, 1, glm::vec3(-0.3f, 0.2f, 0.9f), octaves[i]));
+    }
+    return true;
+}
+
+/**
+ * Different seeds give different noise, and the static functions use the
+ * default one
+ */
+TEST(PerlinSeeds, "perlin.seeds")
+{
+    CHECK(MathUtils::Perlin(1).noise(0.3, 0.6, 0.9) != MathUtils::Perlin(2).noise(0.3, 0.6, 0.9));
+    CHECK(MathUtils::Perlin(7).noise(0.3, 0.6, 0.9) == MathUtils::Perlin(7).noise(0.3, 0.6, 0.9));
+    CHECK(MathUtils::Perlin().noise(0.3, 0.6, 0.9) == MathUtils::Perlin::Noise(0.3, 0.6, 0.9));
+    return true;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file    RendererTests.cpp
+ * @brief   Tests of the asynchronous asset loads of the renderer
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "Asset3DStorage.hpp"
+#include "Asset3DTransform.hpp"
+#include "Game.hpp"
+#include "OpenGL.h"
+#include "OpenGLAsset3D.hpp"
+#include "ProceduralUtils.hpp"
+#include "Test.hpp"
+
+/**
+ * Loads an asset with loadAsset3DAsync() and, once the CPU copy of its data
+ * has been released, reads every level of its texture back from the GPU. Or
+ * deletes the asset from the callback of the load and keeps rendering frames
+ * while the rest of its upload is cancelled
+ */
+class AsyncLoadHandler : public GameHandler
+{
+  public:
+    AsyncLoadHandler(const std::string &file, const Texture &texture, bool deleteWhenResident)
+        : _file(file)
+        , _texture(texture)
+        , _deleteWhenResident(deleteWhenResident)
+        , _asset(NULL)
+        , _frames(0)
+        , _framesDeleted(0)
+        , _loaded(false)
+        , _dataWhenResident(false)
+        , _ok(false)
+    {
+    }
+    ~AsyncLoadHandler() { delete _asset; }
+    bool handleInit(Game *game)
+    {
+        game->getRenderer()->setResidencyPolicy(Asset3D::RESIDENCY_RELEASE_CPU_DATA);
+        _asset = game->getRenderer()->loadAsset3DAsync(_file, [this](Asset3D *asset, bool loaded) {
+            _loaded = loaded;
+            _dataWhenResident = asset->hasCPUData();
+            if (_deleteWhenResident == true) {
+                delete asset;
+                _asset = NULL;
+            }
+        });
+        return _asset != NULL;
+    }
+    bool handleTick(Game *game, double elapsedMs)
+    {
+        if (_deleteWhenResident == true) {
+            if (_loaded == false && ++_frames < MaxFrames) {
+                return true;
+            }
+            /* Give the upload thread time to reach the cancelled jobs */
+            if (_loaded == true && ++_framesDeleted < FramesAfterDelete) {
+                return true;
+            }
+            _ok = _loaded == true && _dataWhenResident == true && _asset == NULL;
+            return false;
+        }
+        if (_asset->hasCPUData() == true && ++_frames < MaxFrames) {
+            return true;
+        }
+        _ok = _check();
+        return false;
+    }
+    bool handleRender(Game *game) { return true; }
+    bool isOk() const { return _ok; }
+  private:
+    static const uint32_t MaxFrames = 1000;
+    static const uint32_t FramesAfterDelete = 100;
+
+    bool _check(void)
+    {
+        const std::vector<uint32_t> &textures = static_cast<OpenGLAsset3D *>(_asset)->getTexturesIDs();
+        std::vector<uint8_t> pixels(_texture.getLevelBytes(0));
+
+        CHECK(_loaded == true && _asset->isResident() == true);
+        CHECK(_dataWhenResident == true);
+        CHECK(_asset->hasCPUData() == false);
+        CHECK(textures.size() == 1 && textures[0] != 0);
+
+        __(glBindTexture(GL_TEXTURE_2D, textures[0]));
+        __(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        for (uint32_t level = 0; level < _texture._levels; ++level) {
+            memset(pixels.data(), 0, pixels.size());
+            __(glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+            if (memcmp(pixels.data(), _texture._texture + _texture.getLevelOffset(level), _texture.getLevelBytes(level)) != 0) {
+                fprintf(stderr, "ERROR level %u of the texture differs from the asset\n", level);
+                return false;
+            }
+        }
+        __(glBindTexture(GL_TEXTURE_2D, 0));
+        return true;
+    }
+
+    std::string _file;        /**< Asset file loaded */
+    Texture _texture;         /**< Texture stored in the asset, with all its levels */
+    bool _deleteWhenResident; /**< Whether the callback of the load deletes the asset */
+    Asset3D *_asset;          /**< Asset being loaded, NULL once deleted */
+    uint32_t _frames;         /**< Frames waited for the load */
+    uint32_t _framesDeleted;  /**< Frames rendered since the asset was deleted */
+    bool _loaded;             /**< Result passed to the callback of the load */
+    bool _dataWhenResident;   /**< Whether the asset had its CPU data when it became resident */
+    bool _ok;                 /**< Whether the checks passed */
+};
+
+/**
+ * The asset becomes resident with the coarsest level of its texture, while
+ * the upload thread still has to read the finer ones from the asset, so its
+ * data must not be released until the last level is uploaded. Neither can the
+ * jobs read it once the callback deleted the asset. The levels are big enough
+ * for the freed memory to be unmapped, reading it would crash
+ */
+TEST(AsyncLoadReleasesAfterUpload, "renderer.asyncLoadReleasesAfterUpload")
+{
+    const uint32_t size = 1024;
+    std::vector<uint8_t> pixels(size * size * 4);
+    Asset3D *asset = Asset3D::New();
+    char file[] = "/tmp/engine-test-XXXXXX";
+
+    srand(1234);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = (uint8_t)rand();
+    }
+
+    Procedural::AppendBentPlane(*asset, 2.0f, 2.0f, 0.0f, 0.0f, 0.0f, 16, 16, false);
+    Asset3DTransform::SetUniqueMaterial(*asset, Material(), Texture(pixels.data(), size, size, 4));
+    Asset3DTransform::GenerateMipmaps(*asset);
+    CHECK(asset->getTextures()[0]._levels > 1);
+
+    int fd = mkstemp(file);
+    CHECK(fd != -1);
+    close(fd);
+    CHECK(Asset3DStorage::Save(file, *asset));
+
+    AsyncLoadHandler handler(file, asset->getTextures()[0], false), deleting(file, asset->getTextures()[0], true);
+    Asset3D::Delete(asset);
+    bool ok = Test::RunGame(handler) && Test::RunGame(deleting);
+    unlink(file);
+
+    CHECK(ok);
+    CHECK(handler.isOk());
+    CHECK(deleting.isOk());
+    return true;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file    SceneTests.cpp
+ * @brief   Tests of Scene
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <string>
+#include <vector>
+#include "Model3D.hpp"
+#include "Scene.hpp"
+#include "Test.hpp"
+
+/**
+ * Every name and handle gives its model after half of them were removed and
+ * added again, and the handles of the removed ones give NULL
+ */
+TEST(SceneLookup, "scene.lookup")
+{
+    const uint32_t size = 1000;
+    std::vector<Model3D *> models(size);
+    std::vector<Scene::ModelHandle> handles(size), removed;
+    std::vector<std::string> names(size);
+    Scene scene;
+    char name[64];
+
+    for (uint32_t i = 0; i < size; ++i) {
+        snprintf(name, sizeof(name), "M3D_model%u", i);
+        names[i] = name;
+        models[i] = new Model3D((Asset3D *)NULL);
+        handles[i] = scene.add(names[i], models[i]);
+        CHECK(handles[i]);
+    }
+
+    /* The slots are reused with a new generation */
+    for (uint32_t i = 1; i < size; i += 2) {
+        removed.push_back(handles[i]);
+        CHECK(scene.remove(handles[i]));
+        CHECK(scene.getModel(names[i]) == NULL);
+    }
+    for (uint32_t i = 1; i < size; i += 2) {
+        handles[i] = scene.add(names[i], models[i]);
+    }
+
+    CHECK(scene.getModels().size() == size);
+    CHECK(!scene.add(names[0], models[0]));
+    for (uint32_t i = 0; i < size; ++i) {
+        CHECK(scene.getModel(names[i]) == models[i] && scene.getModel(handles[i]) == models[i]);
+    }
+    for (uint32_t i = 0; i < removed.size(); ++i) {
+        CHECK(scene.getModel(removed[i]) == NULL && scene.remove(removed[i]) == false);
+    }
+
+    for (uint32_t i = 0; i < size; ++i) {
+        delete models[i];
+    }
+    return true;
+}
+
+/**
+ * Removing an element in the middle of a hierarchy leaves its children where
+ * they were, as roots that keep moving with their own children
+ */
+static bool _checkRemoveKeepsChildren(bool useStore)
+{
+    Scene scene;
+    Model3D root((Asset3D *)NULL), middle((Asset3D *)NULL), leaf((Asset3D *)NULL);
+    std::vector<Model3D *> children;
+    std::vector<glm::mat4> worlds;
+
+    scene.useTransformStore(useStore);
+    scene.add(&root);
+    Scene::ModelHandle handle = scene.add(&middle);
+    root.setPosition(glm::vec3(10.0f, 0.0f, 0.0f));
+    root.setOrientation(glm::rotate(0.5f, glm::vec3(0.0f, 1.0f, 0.0f)));
+    root.setScaleFactor(glm::vec3(2.0f, 2.0f, 2.0f));
+    middle.setPosition(glm::vec3(0.0f, 3.0f, 0.0f));
+    middle.setOrientation(glm::rotate(1.0f, glm::vec3(1.0f, 0.0f, 0.0f)));
+    middle.setScaleFactor(glm::vec3(1.0f, 3.0f, 0.5f));
+    CHECK(scene.setParent(&middle, &root));
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        children.push_back(new Model3D((Asset3D *)NULL));
+        scene.add(children.back());
+        children.back()->setPosition(glm::vec3((float)i, 1.0f, -2.0f));
+        children.back()->setOrientation(glm::rotate((float)i, glm::vec3(0.0f, 0.0f, 1.0f)));
+        CHECK(scene.setParent(children.back(), &middle));
+    }
+    scene.add(&leaf);
+    leaf.setPosition(glm::vec3(0.0f, 0.0f, 5.0f));
+    CHECK(scene.setParent(&leaf, children[0]));
+
+    scene.getTransformStore().update();
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        worlds.push_back(children[i]->getModelMatrix());
+    }
+    glm::mat4 leafWorld = leaf.getModelMatrix();
+
+    CHECK(scene.remove(handle));
+    scene.getTransformStore().update();
+    CHECK(middle.getParent() == NULL && middle.getFirstChild() == NULL && root.getFirstChild() == NULL);
+
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        const glm::mat4 &world = children[i]->getModelMatrix();
+
+        CHECK(children[i]->getParent() == NULL);
+        for (uint32_t j = 0; j < 4; ++j) {
+            CHECK(glm::length(world[j] - worlds[i][j]) < 1e-4f);
+        }
+    }
+    for (uint32_t j = 0; j < 4; ++j) {
+        CHECK(glm::length(leaf.getModelMatrix()[j] - leafWorld[j]) < 1e-4f);
+    }
+    CHECK(std::find(scene.getRoots().begin(), scene.getRoots().end(), children[0]) != scene.getRoots().end());
+
+    /* The leaf still follows its parent */
+    children[0]->move(glm::vec3(1.0f, 0.0f, 0.0f));
+    scene.getTransformStore().update();
+    CHECK(glm::length(glm::vec3(leaf.getModelMatrix()[3]) - glm::vec3(leafWorld[3]) - glm::vec3(1.0f, 0.0f, 0.0f)) < 1e-4f);
+
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        delete children[i];
+    }
+    return true;
+}
+
+TEST(SceneRemoveKeepsChildren, "scene.removeKeepsChildren")
+{
+    CHECK(_checkRemoveKeepsChildren(false));
+    CHECK(_checkRemoveKeepsChildren(true));
+    return true;
+}
+
+/**
+ * The roots are the elements with children and without parent, whatever the
+ * order in which hierarchies are built, reparented and removed
+ */
+TEST(SceneRoots, "scene.roots")
+{
+    const uint32_t size = 200;
+    std::vector<Model3D *> models(size);
+    std::vector<Scene::ModelHandle> handles(size);
+    std::vector<bool> added(size, true);
+    Scene scene;
+
+    srand(1234);
+    for (uint32_t i = 0; i < size; ++i) {
+        models[i] = new Model3D((Asset3D *)NULL);
+        handles[i] = scene.add(models[i]);
+    }
+
+    for (uint32_t step = 0; step < 2000; ++step) {
+        uint32_t child = rand() % size, parent = rand() % size;
+
+        if (step % 50 == 49) {
+            if (added[child] == true) {
+                CHECK(scene.remove(handles[child]));
+            } else {
+                handles[child] = scene.add(models[child]);
+            }
+            added[child] = !added[child];
+        } else if (added[child] == true && added[parent] == true) {
+            /* Fails when the parent is a descendant, which keeps the roots as they were */
+            scene.setParent(models[child], rand() % 4 == 0 ? NULL : models[parent]);
+        }
+
+        std::vector<Object3D *> &roots = scene.getRoots();
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < size; ++i) {
+            if (models[i]->getParent() == NULL && models[i]->getFirstChild() != NULL) {
+                CHECK(std::find(roots.begin(), roots.end(), models[i]) != roots.end());
+                ++count;
+            }
+        }
+        CHECK(roots.size() == count);
+    }
+
+    for (uint32_t i = 0; i < size; ++i) {
+        if (added[i] == true) {
+            scene.remove(handles[i]);
+        }
+        delete models[i];
+    }
+    return true;
+}
@@ -0,0 +1,416 @@
+/**
+ * @file    StorageTests.cpp
+ * @brief   Tests of the formats stored in the asset files: ZCompression block
+ *          streams, GeometryCodec filters, TextureCodec blocks and the
+ *          Asset3DStorage container
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Asset3DStorage.hpp"
+#include "Asset3DTransform.hpp"
+#include "GeometryCodec.hpp"
+#include "ProceduralUtils.hpp"
+#include "Test.hpp"
+#include "TextureCodec.hpp"
+#include "ZCompression.hpp"
+
+/**
+ * Data that compresses well, a sequence repeated with a few changes, or
+ * random bytes that do not compress at all
+ */
+static std::vector<uint8_t> _newData(std::mt19937 &random, size_t size, bool compressible)
+{
+    std::vector<uint8_t> data(size);
+
+    for (size_t i = 0; i < size; ++i) {
+        if (compressible == false) {
+            data[i] = (uint8_t)random();
+        } else if (i >= 64 && random() % 16 != 0) {
+            data[i] = data[i - 64];
+        } else {
+            data[i] = (uint8_t)(random() % 8);
+        }
+    }
+    return data;
+}
+
+/**
+ * Compresses and decompresses the data, the result must be the same
+ */
+static bool _roundTrip(Codec::Type codec, const std::vector<uint8_t> &data, uint32_t blockSize, std::vector<uint8_t> &compressed)
+{
+    std::vector<uint8_t> decompressed(data.size() + 1, 0xAA);
+
+    CHECK(ZCompression::Compress(codec, data.data(), data.size(), compressed, blockSize));
+    CHECK(ZDecompression::Decompress(compressed.data(), compressed.size(), decompressed.data(), data.size()));
+    CHECK(memcmp(decompressed.data(), data.data(), data.size()) == 0 && decompressed.back() == 0xAA);
+    return true;
+}
+
+/**
+ * Both codecs give back the same data, for sizes that are and are not multiple
+ * of the blocks, and store the blocks that do not compress as they are
+ */
+TEST(CompressionRoundTrip, "storage.compressionRoundTrip")
+{
+    const Codec::Type codecs[] = {Codec::TYPE_NONE, Codec::TYPE_ZLIB, Codec::TYPE_LZ};
+    const size_t sizes[] = {0, 1, 100, 4096, 4097, 300000, 1 << 20};
+    std::mt19937 random(1234);
+
+    for (uint32_t c = 0; c < sizeof codecs / sizeof codecs[0]; ++c) {
+        for (uint32_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s) {
+            std::vector<uint8_t> compressible = _newData(random, sizes[s], true), noise = _newData(random, sizes[s], false);
+            std::vector<uint8_t> compressed;
+
+            CHECK(_roundTrip(codecs[c], compressible, 4096, compressed));
+            CHECK(_roundTrip(codecs[c], compressible, ZCompression::BlockSize, compressed));
+            if (codecs[c] != Codec::TYPE_NONE && sizes[s] >= 4096) {
+                CHECK(compressed.size() < sizes[s] / 2);
+            }
+
+            /* Stored blocks only add the headers */
+            CHECK(_roundTrip(codecs[c], noise, 4096, compressed));
+            CHECK(compressed.size() <= sizes[s] + 16 + (sizes[s] + 4095) / 4096 * 8);
+        }
+    }
+    return true;
+}
+
+/**
+ * Streams with a flipped bit, truncated, or decompressed with a different size
+ * never give wrong data. A change can still decode to the same data, a match
+ * pointing to an equal copy for example, anything else is caught by the codec
+ * or by the CRC of the block
+ */
+TEST(CompressionCorruption, "storage.compressionCorruption")
+{
+    const Codec::Type codecs[] = {Codec::TYPE_ZLIB, Codec::TYPE_LZ};
+    std::mt19937 random(5678);
+
+    for (uint32_t c = 0; c < sizeof codecs / sizeof codecs[0]; ++c) {
+        for (uint32_t compressible = 0; compressible < 2; ++compressible) {
+            std::vector<uint8_t> data = _newData(random, 20000, compressible == 1), compressed;
+            std::vector<uint8_t> output(data.size());
+
+            CHECK(_roundTrip(codecs[c], data, 4096, compressed));
+            CHECK(ZDecompression::Decompress(compressed.data(), compressed.size(), output.data(), data.size() - 1) == false);
+
+            for (uint32_t i = 0; i < 300; ++i) {
+                std::vector<uint8_t> corrupted = compressed;
+                size_t position = i < 100 ? i % corrupted.size() : random() % corrupted.size();
+
+                corrupted[position] ^= (uint8_t)(1 << (random() % 8));
+                if (ZDecompression::Decompress(corrupted.data(), corrupted.size(), output.data(), data.size()) == true &&
+                    memcmp(output.data(), data.data(), data.size()) != 0) {
+                    fprintf(stderr, "ERROR stream with byte %zu of %zu corrupted gave wrong data\n", position, corrupted.size());
+                    return false;
+                }
+            }
+            for (size_t size = 0; size < compressed.size(); size += 1 + compressed.size() / 64) {
+                CHECK(ZDecompression::Decompress(compressed.data(), size, output.data(), data.size()) == false);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Blocks that did not compress are copied as they are, only their CRC tells
+ * whether they changed. The stream is a 16-byte header, then the size and the
+ * CRC of each block, then the blocks
+ */
+TEST(CompressionChecksum, "storage.compressionChecksum")
+{
+    std::mt19937 random(3456);
+    std::vector<uint8_t> data = _newData(random, 3 * 4096, false), compressed, corrupted;
+    std::vector<uint8_t> output(data.size());
+
+    CHECK(_roundTrip(Codec::TYPE_LZ, data, 4096, compressed));
+    CHECK(compressed.size() == 16 + 3 * 8 + data.size());
+
+    /* The data of the second block */
+    corrupted = compressed;
+    corrupted[16 + 3 * 8 + 4096 + 100] ^= 0x01;
+    CHECK(ZDecompression::Decompress(corrupted.data(), corrupted.size(), output.data(), data.size()) == false);
+
+    /* The CRC of the third block */
+    corrupted = compressed;
+    corrupted[16 + 2 * 8 + 4] ^= 0x80;
+    CHECK(ZDecompression::Decompress(corrupted.data(), corrupted.size(), output.data(), data.size()) == false);
+    return true;
+}
+
+/**
+ * The filters are lossless for any bit pattern, including NaNs, restart
+ * indices and differences that wrap around
+ */
+TEST(GeometryFilterRoundTrip, "storage.geometryFilterRoundTrip")
+{
+    const uint32_t counts[] = {0, 1, 2, 7, 1000};
+    const uint32_t strides[] = {4, 12, 32};
+    std::mt19937 random(9012);
+
+    for (uint32_t c = 0; c < sizeof counts / sizeof counts[0]; ++c) {
+        for (uint32_t s = 0; s < sizeof strides / sizeof strides[0]; ++s) {
+            std::vector<uint32_t> vertices(counts[c] * strides[s] / sizeof(uint32_t));
+            std::vector<uint8_t> filtered(vertices.size() * sizeof(uint32_t));
+            std::vector<uint32_t> decoded(vertices.size() + 1, 0xAAAAAAAA);
+
+            for (uint32_t i = 0; i < vertices.size(); ++i) {
+                float value = (float)(random() % 2000) / 100.0f - 10.0f;
+                memcpy(&vertices[i], &value, sizeof value);
+                if (i % 97 == 0) {
+                    vertices[i] = random();
+                }
+            }
+            GeometryCodec::EncodeVertices(vertices.data(), counts[c], strides[s], filtered.data());
+            GeometryCodec::DecodeVertices(filtered.data(), counts[c], strides[s], decoded.data());
+            CHECK(memcmp(decoded.data(), vertices.data(), filtered.size()) == 0 && decoded.back() == 0xAAAAAAAA);
+        }
+
+        std::vector<uint32_t> indices(counts[c]), decoded(counts[c] + 1, 0xAAAAAAAA);
+        std::vector<uint16_t> shortIndices(counts[c]), shortDecoded(counts[c] + 1, 0xAAAA);
+        std::vector<uint8_t> filtered(counts[c] * sizeof(uint32_t));
+
+        for (uint32_t i = 0; i < counts[c]; ++i) {
+            indices[i] = i % 13 == 0 ? 0xFFFFFFFF : (i % 5 == 0 ? random() : i / 3 + random() % 4);
+            shortIndices[i] = (uint16_t)indices[i];
+        }
+        GeometryCodec::EncodeIndices(indices.data(), counts[c], sizeof(uint32_t), filtered.data());
+        GeometryCodec::DecodeIndices(filtered.data(), counts[c], sizeof(uint32_t), decoded.data());
+        CHECK(memcmp(decoded.data(), indices.data(), counts[c] * sizeof(uint32_t)) == 0 && decoded.back() == 0xAAAAAAAA);
+
+        GeometryCodec::EncodeIndices(shortIndices.data(), counts[c], sizeof(uint16_t), filtered.data());
+        GeometryCodec::DecodeIndices(filtered.data(), counts[c], sizeof(uint16_t), shortDecoded.data());
+        CHECK(memcmp(shortDecoded.data(), shortIndices.data(), counts[c] * sizeof(uint16_t)) == 0 && shortDecoded.back() == 0xAAAA);
+    }
+    return true;
+}
+
+/**
+ * Encodes an image and decodes it back, returning the largest and the root
+ * mean square error of the color channels, and the largest of the alpha
+ */
+static void _blockError(Texture::Format format, const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t Bpp,
+                        float &maxColor, float &rmsColor, float &maxAlpha)
+{
+    std::vector<uint8_t> blocks(Texture::GetImageBytes(format, width, height, Bpp));
+    std::vector<uint8_t> decoded(width * height * 4);
+    double sum = 0.0;
+
+    TextureCodec::Encode(format, pixels.data(), width, height, Bpp, blocks.data());
+    TextureCodec::Decode(format, blocks.data(), width, height, decoded.data());
+
+    maxColor = rmsColor = maxAlpha = 0.0f;
+    for (uint32_t i = 0; i < width * height; ++i) {
+        for (uint32_t channel = 0; channel < 3; ++channel) {
+            float error = fabsf((float)decoded[i * 4 + channel] - pixels[i * Bpp + channel]);
+            maxColor = fmaxf(maxColor, error);
+            sum += error * error;
+        }
+        if (Bpp == 4) {
+            maxAlpha = fmaxf(maxAlpha, fabsf((float)decoded[i * 4 + 3] - pixels[i * 4 + 3]));
+        }
+    }
+    rmsColor = (float)sqrt(sum / (width * height * 3));
+}
+
+/**
+ * Smooth gradients, with sizes that are not multiple of the blocks, stay
+ * within the precision of the formats. Blocks of one color that can be
+ * represented in RGB565 are exact
+ */
+TEST(TextureBlocks, "storage.textureBlocks")
+{
+    const uint32_t sizes[][2] = {{64, 64}, {30, 18}, {1, 1}, {2, 7}};
+
+    for (uint32_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s) {
+        uint32_t width = sizes[s][0], height = sizes[s][1];
+
+        for (uint32_t Bpp = 3; Bpp <= 4; ++Bpp) {
+            Texture::Format format = Bpp == 3 ? Texture::FORMAT_BC1 : Texture::FORMAT_BC3;
+            std::vector<uint8_t> gradient(width * height * Bpp), solid(width * height * Bpp);
+            float maxColor, rmsColor, maxAlpha;
+
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    uint8_t *texel = &gradient[(y * width + x) * Bpp];
+                    texel[0] = (uint8_t)(x * 4);
+                    texel[1] = (uint8_t)(y * 4);
+                    texel[2] = (uint8_t)((x + y) * 2);
+                    if (Bpp == 4) {
+                        texel[3] = (uint8_t)(255 - y * 4);
+                    }
+
+                    texel = &solid[(y * width + x) * Bpp];
+                    texel[0] = 0xFF;
+                    texel[1] = 0x82;
+                    texel[2] = 0x00;
+                    if (Bpp == 4) {
+                        texel[3] = 0x80;
+                    }
+                }
+            }
+
+            /* RGB565 endpoints are 8 or 4 levels apart, plus the interpolation */
+            _blockError(format, gradient, width, height, Bpp, maxColor, rmsColor, maxAlpha);
+            CHECK(maxColor <= 12.0f && rmsColor <= 4.0f && maxAlpha <= 3.0f);
+
+            _blockError(format, solid, width, height, Bpp, maxColor, rmsColor, maxAlpha);
+            CHECK(maxColor == 0.0f && maxAlpha == 0.0f);
+        }
+    }
+    return true;
+}
+
+static std::vector<uint8_t> _readFile(const char *name)
+{
+    std::ifstream file(name, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static bool _writeFile(const char *name, const std::vector<uint8_t> &data)
+{
+    std::ofstream file(name, std::ios::binary | std::ios::trunc);
+    file.write((const char *)data.data(), data.size());
+    return file.good();
+}
+
+/**
+ * End of the last section of a file, files cut before it lack some data
+ */
+static size_t _getSectionsEnd(const std::vector<uint8_t> &data)
+{
+    Asset3DStorage::FileHeader header;
+    size_t end = 0;
+
+    memcpy(&header, data.data(), sizeof header);
+    for (uint32_t i = 0; i < header.numSections; ++i) {
+        Asset3DStorage::SectionEntry entry;
+
+        memcpy(&entry, &data[header.directoryOffset + i * sizeof entry], sizeof entry);
+        end = std::max(end, (size_t)(entry.offset + entry.size));
+    }
+    return end;
+}
+
+/**
+ * Truncates a file in the middle of its sections and writes the directory
+ * again after them, so the sections past the cut are out of bounds
+ */
+static std::vector<uint8_t> _truncateSections(const std::vector<uint8_t> &data, size_t size)
+{
+    Asset3DStorage::FileHeader header;
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+
+    memcpy(&header, data.data(), sizeof header);
+    size_t directorySize = header.numSections * sizeof(Asset3DStorage::SectionEntry);
+    truncated.resize((size + Asset3DStorage::SectionAlignment - 1) & ~(size_t)(Asset3DStorage::SectionAlignment - 1));
+    truncated.insert(truncated.end(), data.begin() + header.directoryOffset, data.begin() + header.directoryOffset + directorySize);
+
+    header.directoryOffset = truncated.size() - directorySize;
+    memcpy(truncated.data(), &header, sizeof header);
+    return truncated;
+}
+
+/**
+ * Applies a change to the directory entry of a section
+ */
+template <typename F>
+static std::vector<uint8_t> _editSection(const std::vector<uint8_t> &data, Asset3DStorage::SectionType type, F edit)
+{
+    Asset3DStorage::FileHeader header;
+    std::vector<uint8_t> edited = data;
+
+    memcpy(&header, data.data(), sizeof header);
+    for (uint32_t i = 0; i < header.numSections; ++i) {
+        Asset3DStorage::SectionEntry entry;
+        uint8_t *position = &edited[header.directoryOffset + i * sizeof entry];
+
+        memcpy(&entry, position, sizeof entry);
+        if (entry.type == (uint32_t)type) {
+            edit(entry);
+            memcpy(position, &entry, sizeof entry);
+        }
+    }
+    return edited;
+}
+
+static bool _load(const char *file, const std::vector<uint8_t> &data, bool mapGeometry, Asset3D *&asset)
+{
+    Asset3D::Delete(asset);
+    asset = Asset3D::New();
+    return _writeFile(file, data) && Asset3DStorage::Load(file, *asset, mapGeometry);
+}
+
+/**
+ * Files truncated anywhere after the header are rejected, with or without a
+ * directory, whether the geometry is mapped or copied. So are geometry sections
+ * whose size does not match their elements, and misaligned sections are copied
+ * instead of mapped
+ */
+TEST(StorageTruncated, "storage.truncated")
+{
+    const Codec::Type codecs[] = {Codec::TYPE_NONE, Codec::TYPE_LZ};
+    std::vector<uint8_t> pixels(64 * 64 * 4, 0x80);
+    Asset3D *source = Asset3D::New(), *asset = NULL;
+    char file[] = "/tmp/engine-test-XXXXXX";
+
+    Procedural::AppendBentPlane(*source, 2.0f, 2.0f, 0.0f, 0.0f, 0.0f, 32, 32, false);
+    Asset3DTransform::SetUniqueMaterial(*source, Material(), Texture(pixels.data(), 64, 64, 4));
+
+    int fd = mkstemp(file);
+    CHECK(fd != -1);
+    close(fd);
+
+    for (uint32_t c = 0; c < sizeof codecs / sizeof codecs[0]; ++c) {
+        CHECK(Asset3DStorage::Save(file, *source, codecs[c]));
+        std::vector<uint8_t> data = _readFile(file);
+
+        for (uint32_t map = 0; map < 2; ++map) {
+            CHECK(_load(file, data, map == 1, asset));
+            CHECK(asset->isGeometryMapped() == (map == 1 && codecs[c] == Codec::TYPE_NONE));
+            CHECK(asset->getNumVertices() == source->getNumVertices() && asset->getNumIndices() == source->getNumIndices());
+
+            for (size_t size = sizeof(Asset3DStorage::FileHeader); size < data.size(); size += 1 + data.size() / 97) {
+                std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+
+                CHECK(_load(file, truncated, map == 1, asset) == false);
+                if (size < _getSectionsEnd(data)) {
+                    CHECK(_load(file, _truncateSections(data, size), map == 1, asset) == false);
+                }
+            }
+
+            /* The stored size of the vertices no longer matches their count */
+            std::vector<uint8_t> edited = _editSection(data, Asset3DStorage::SECTION_VERTEX_DATA, [](Asset3DStorage::SectionEntry &entry) {
+                entry.count *= 64;
+                entry.rawSize *= 64;
+            });
+            CHECK(_load(file, edited, map == 1, asset) == false);
+        }
+
+        /* Moved by 4 bytes, still inside the file */
+        std::vector<uint8_t> misaligned = _editSection(data, Asset3DStorage::SECTION_INDICES, [](Asset3DStorage::SectionEntry &entry) {
+            entry.offset += 4;
+        });
+        if (codecs[c] == Codec::TYPE_NONE) {
+            CHECK(_load(file, misaligned, true, asset));
+            CHECK(asset->isGeometryMapped() == false && asset->getNumIndices() == source->getNumIndices());
+        }
+    }
+
+    unlink(file);
+    Asset3D::Delete(asset);
+    Asset3D::Delete(source);
+    return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    TerrainTests.cpp
+ * @brief   Tests of Procedural::ChunkedTerrain
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "ChunkedTerrain.hpp"
+#include "Model3D.hpp"
+#include "Scene.hpp"
+#include "Test.hpp"
+
+/**
+ * Height of an edge of a tile at t in [0, 1]
+ */
+static float _edgeHeight(Model3D *model, bool east, float t)
+{
+    const std::vector<Asset3D::VertexData> &data = model->getAsset3D()->getVertexData();
+    uint32_t numVerts = (uint32_t)sqrt((double)data.size()), position = (uint32_t)(t * (numVerts - 1));
+    float weight = t * (numVerts - 1) - position;
+    uint32_t column = east ? numVerts - 1 : 0;
+
+    if (position == numVerts - 1) {
+        return data[position * numVerts + column].vertex.y;
+    }
+    return data[position * numVerts + column].vertex.y * (1.0f - weight) + data[(position + 1) * numVerts + column].vertex.y * weight;
+}
+
+/**
+ * Checks the tiles around the camera: all of them visible, the cache within
+ * its size, and each tile matching its east neighbour without cracks or LOD
+ * jumps of more than one level
+ */
+static bool _checkTiles(Procedural::ChunkedTerrain &terrain, float cameraX, uint32_t radius)
+{
+    int32_t first = (int32_t)floorf(cameraX / 256.0f) - (int32_t)radius;
+
+    CHECK(terrain.getNumPendingTiles() == 0);
+    CHECK(terrain.getNumTiles() <= terrain.getCacheSize());
+    CHECK(terrain.getNumVisibleTiles() == (2 * radius + 1) * (2 * radius + 1));
+
+    for (int32_t z = -(int32_t)radius; z <= (int32_t)radius; ++z) {
+        for (int32_t x = first; x < first + 2 * (int32_t)radius; ++x) {
+            Model3D *west = terrain.getTileModel(x, z), *east = terrain.getTileModel(x + 1, z);
+
+            CHECK(west != NULL && east != NULL);
+            CHECK(abs(terrain.getTileLod(x, z) - terrain.getTileLod(x + 1, z)) <= 1);
+            for (float t = 0.0f; t <= 1.0f; t += 1.0f / 64.0f) {
+                float a = _edgeHeight(west, true, t), b = _edgeHeight(east, false, t);
+
+                if (fabsf(a - b) > 1e-3f) {
+                    fprintf(stderr, "ERROR crack between terrain tiles %d and %d, %d: %f and %f\n", x, x + 1, z, a, b);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Every visible tile matches its neighbours, also across the period of the
+ * noise (262144 units with these settings), for several view radii
+ */
+TEST(TerrainStream, "terrain.stream")
+{
+    const uint32_t radii[] = {2, 4};
+    const float positions[] = {-300.0f, 1200.0f, 262144.0f, -786332.0f, 1000000.0f};
+
+    for (uint32_t r = 0; r < sizeof radii / sizeof radii[0]; ++r) {
+        Scene scene;
+        Procedural::ChunkedTerrain terrain(scene, NULL, 256.0f, 300.0f, 0, glm::vec3(1.0f), 32);
+
+        terrain.setViewRadius(radii[r]);
+        terrain.setLodDistance(256.0f);
+        terrain.setUploadsPerFrame(1000);
+
+        for (uint32_t p = 0; p < sizeof positions / sizeof positions[0]; ++p) {
+            glm::vec3 camera(positions[p], 100.0f, 0.0f);
+
+            terrain.update(camera);
+            for (uint32_t i = 0; i < 4 && terrain.getNumPendingTiles() > 0; ++i) {
+                terrain.update(camera);
+            }
+            if (_checkTiles(terrain, positions[p], radii[r]) == false) {
+                fprintf(stderr, "ERROR terrain around %f with radius %u\n", positions[p], radii[r]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
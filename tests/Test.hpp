@@ -0,0 +1,86 @@
+/**
+ * @file    Test.hpp
+ * @brief   Registration and checks of the engine tests, see tests.cpp.
+ *
+ *          A test is a function returning whether it passed, defined with
+ *          TEST(). CHECK() logs the condition that failed with its location
+ *          and makes the test fail, SKIP() ends the test without failing it
+ *          when something it needs is not available
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+class GameHandler;
+
+class Test
+{
+  public:
+    typedef bool (*Function)(void);
+
+    /**
+     * Exit status of the process of a skipped test
+     */
+    static const int SkippedStatus = 77;
+
+    /**
+     * Constructor, registers the test
+     *
+     * @param name      Name of the test, "area.what"
+     * @param function  Body of the test
+     */
+    Test(const char *name, Function function) : _name(name), _function(function) { GetTests().push_back(this); }
+    const char *getName() const { return _name; }
+    bool run() const { return _function(); }
+    /**
+     * Tests registered, in no particular order
+     */
+    static std::vector<Test *> &GetTests(void)
+    {
+        static std::vector<Test *> tests;
+        return tests;
+    }
+
+    /**
+     * Runs a Game with a headless window until the handler stops it from
+     * handleTick()
+     *
+     * @param handler  Handler of the game
+     * @param width    Width of the window
+     * @param height   Height of the window
+     *
+     * @return true if the game was initialized and its loop finished, false otherwise
+     */
+    static bool RunGame(GameHandler &handler, uint32_t width = 320, uint32_t height = 240);
+
+  private:
+    Test(const Test &);
+    Test &operator=(const Test &);
+
+    const char *_name;  /**< Name of the test */
+    Function _function; /**< Body of the test */
+};
+
+#define TEST(function, name)                      \
+    static bool function(void);                   \
+    static Test _test_##function(name, function); \
+    static bool function(void)
+
+#define CHECK(condition)                                                                        \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            fprintf(stderr, "ERROR %s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return false;                                                                       \
+        }                                                                                       \
+    } while (0)
+
+#define SKIP(reason)                              \
+    do {                                          \
+        fprintf(stderr, "Skipped: %s\n", reason); \
+        exit(Test::SkippedStatus);                \
+    } while (0)
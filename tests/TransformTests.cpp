@@ -0,0 +1,354 @@
+/**
+ * @file    TransformTests.cpp
+ * @brief   Tests of TransformStore and of the hierarchies of Object3D
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <random>
+#include <vector>
+#include "Asset3DTransform.hpp"
+#include "Model3D.hpp"
+#include "ProceduralUtils.hpp"
+#include "Scene.hpp"
+#include "Test.hpp"
+#include "TransformStore.hpp"
+
+#define PI 3.14159265358979323846
+
+/**
+ * Sphere of about 'vertices' vertices, one unit below the origin
+ */
+static Asset3D *_newSphereAsset(uint32_t vertices)
+{
+    Asset3D *asset = Asset3D::New();
+    uint32_t side = (uint32_t)sqrt((double)vertices);
+
+    Procedural::AppendBentPlane(*asset, (float)(2.0f * PI), 2.0f, (float)(2.0f * PI), 0.0f, (float)(2.0f * PI), side + 1, side, true);
+    Asset3DTransform::Translate(*asset, glm::vec3(0.0f, -1.0f, 0.0f));
+    return asset;
+}
+
+static float _distance(const glm::mat4 &a, const glm::mat4 &b)
+{
+    float error = 0.0f;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        error += glm::length(a[i] - b[i]);
+    }
+    return error;
+}
+
+/**
+ * Whether two objects have the same world transform and bounds
+ */
+static bool _sameWorld(Object3D &a, Object3D &b)
+{
+    glm::mat3 normalA = a.getNormalMatrix(), normalB = b.getNormalMatrix();
+    float error = _distance(a.getModelMatrix(), b.getModelMatrix());
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        error += glm::length(normalA[i] - normalB[i]);
+    }
+    error += glm::length(a.getAABB().getMin() - b.getAABB().getMin()) + glm::length(a.getAABB().getMax() - b.getAABB().getMax());
+    error += fabsf(a.getBoundingSphere().getRadius() - b.getBoundingSphere().getRadius());
+    return error < 1e-3f;
+}
+
+/**
+ * Applies the same random change to two objects
+ */
+static void _change(std::mt19937 &random, Object3D &a, Object3D &b)
+{
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> factor(0.5f, 2.0f);
+    glm::vec3 v(value(random), value(random), value(random));
+
+    switch (random() % 4) {
+    case 0:
+        a.move(v);
+        b.move(v);
+        break;
+    case 1:
+        a.rotate(glm::rotate(v.x, glm::normalize(v)));
+        b.rotate(glm::rotate(v.x, glm::normalize(v)));
+        break;
+    case 2:
+        v = glm::vec3(factor(random), factor(random), factor(random));
+        a.scale(v);
+        b.scale(v);
+        break;
+    default:
+        a.lookAt(v);
+        b.lookAt(v);
+        break;
+    }
+}
+
+/**
+ * Objects attached to a store give the same results than detached ones,
+ * whether they are read after update() or before it, and in stores big
+ * enough to be updated in parallel
+ */
+TEST(TransformStoreMatchesObject3D, "transform.store")
+{
+    const uint32_t counts[] = {1, 3, 4, 7, 100, 3000};
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    Asset3D *asset = _newSphereAsset(100);
+
+    for (uint32_t c = 0; c < sizeof counts / sizeof counts[0]; ++c) {
+        std::vector<Model3D *> detached, attached;
+        TransformStore store;
+
+        for (uint32_t i = 0; i < counts[c]; ++i) {
+            glm::vec3 p(position(random), position(random), position(random));
+            glm::mat4 orientation = glm::rotate(position(random), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            detached.push_back(new Model3D(asset));
+            attached.push_back(new Model3D(asset));
+            for (Model3D *model : {detached.back(), attached.back()}) {
+                model->setPosition(p);
+                model->setOrientation(orientation);
+                model->setScaleFactor(glm::vec3(1.0f, 2.0f, 1.0f));
+            }
+            /* Half of them attached with their matrices already valid */
+            if (i % 2 == 0) {
+                attached.back()->getAABB();
+            }
+            store.attach(*attached.back());
+        }
+        CHECK(store.size() == counts[c]);
+        store.update();
+        CHECK(store.getNumDirty() == 0);
+        for (uint32_t i = 0; i < counts[c]; ++i) {
+            CHECK(_sameWorld(*detached[i], *attached[i]));
+        }
+
+        for (uint32_t frame = 0; frame < 4; ++frame) {
+            for (uint32_t i = 0; i < counts[c]; ++i) {
+                if (random() % 3 != 0) {
+                    _change(random, *detached[i], *attached[i]);
+                }
+            }
+            /* A few read before the update */
+            for (uint32_t i = 0; i < counts[c]; i += 5) {
+                CHECK(_sameWorld(*detached[i], *attached[i]));
+            }
+            store.update();
+            for (uint32_t i = 0; i < counts[c]; ++i) {
+                CHECK(_sameWorld(*detached[i], *attached[i]));
+            }
+        }
+
+        /* Detached objects keep their transform, the rest keep their slots valid */
+        for (uint32_t i = 0; i < counts[c]; i += 2) {
+            store.detach(*attached[i]);
+        }
+        for (uint32_t i = 0; i < counts[c]; ++i) {
+            _change(random, *detached[i], *attached[i]);
+        }
+        store.update();
+        for (uint32_t i = 0; i < counts[c]; ++i) {
+            CHECK(_sameWorld(*detached[i], *attached[i]));
+            delete detached[i];
+            delete attached[i];
+        }
+        CHECK(store.size() == 0);
+    }
+    Asset3D::Delete(asset);
+    return true;
+}
+
+/**
+ * Vehicles with parts attached, and a light on some of the parts, in a
+ * scene with or without transform store
+ */
+class Vehicles
+{
+  public:
+    static const uint32_t PartsPerVehicle = 40;
+
+    Vehicles(Asset3D *asset, uint32_t count, bool useStore) : _asset(asset)
+    {
+        _scene.useTransformStore(useStore);
+        for (uint32_t i = 0; i < count; ++i) {
+            Model3D *vehicle = _newModel();
+
+            vehicle->setPosition(glm::vec3(i * 10.0f, 0.0f, 0.0f));
+            vehicle->setOrientation(glm::rotate((float)i, glm::vec3(0.0f, 1.0f, 0.0f)));
+            vehicle->setScaleFactor(glm::vec3(2.0f, 2.0f, 2.0f));
+            _vehicles.push_back(vehicle);
+
+            for (uint32_t j = 0; j < PartsPerVehicle; ++j) {
+                Model3D *part = _newModel();
+
+                part->setPosition(glm::vec3((float)(j % 8) - 4.0f, 1.0f, (float)(j / 8) - 2.0f));
+                part->setScaleFactor(glm::vec3(0.25f, 0.25f, 0.25f));
+                _scene.setParent(part, vehicle);
+
+                /* Three levels deep */
+                if (j % 10 == 0) {
+                    Model3D *light = _newModel();
+
+                    light->setPosition(glm::vec3(0.0f, 2.0f, 0.0f));
+                    _scene.setParent(light, part);
+                }
+            }
+        }
+    }
+    ~Vehicles()
+    {
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            delete _models[i];
+        }
+    }
+
+    Scene &getScene(void) { return _scene; }
+    std::vector<Model3D *> &getVehicles(void) { return _vehicles; }
+    std::vector<Model3D *> &getModels(void) { return _models; }
+    void update(void) { _scene.getTransformStore().update(); }
+  private:
+    Model3D *_newModel(void)
+    {
+        _models.push_back(new Model3D(_asset));
+        _scene.add(_models.back());
+        return _models.back();
+    }
+
+    Asset3D *_asset;                  /**< Geometry shared by all the models */
+    Scene _scene;                     /**< Scene with the hierarchies */
+    std::vector<Model3D *> _models;   /**< Every model, in creation order */
+    std::vector<Model3D *> _vehicles; /**< Roots of the hierarchies */
+};
+
+/**
+ * Whether the world matrices of the descendants of an object are the ones of
+ * their parents times their local transforms, and their bounds are inside
+ * the subtree bounds of the object
+ */
+static bool _checkSubtree(Object3D &object, const BoundingBox &subtree)
+{
+    for (Object3D *child = object.getFirstChild(); child != NULL; child = child->getNextSibling()) {
+        glm::mat4 local = glm::scale(glm::translate(glm::mat4(), child->getPosition()) * child->getOrientation(), child->getScaleFactor());
+        const BoundingBox &aabb = child->getAABB();
+
+        if (_distance(child->getModelMatrix(), object.getModelMatrix() * local) > 1e-3f ||
+            glm::any(glm::lessThan(aabb.getMin(), subtree.getMin())) || glm::any(glm::greaterThan(aabb.getMax(), subtree.getMax())) ||
+            _checkSubtree(*child, subtree) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The parts follow their vehicles, with and without transform store, and
+ * both give the same results
+ */
+TEST(TransformHierarchy, "transform.hierarchy")
+{
+    const uint32_t count = 30;
+    Asset3D *asset = _newSphereAsset(100);
+    Vehicles detached(asset, count, false), attached(asset, count, true);
+
+    CHECK(detached.getScene().getRoots().size() == count && attached.getScene().getRoots().size() == count);
+    CHECK(attached.getScene().getTransformStore().size() == attached.getModels().size());
+
+    for (uint32_t frame = 0; frame < 4; ++frame) {
+        /* The subtree bounds are read before the moves, the parts must follow */
+        for (uint32_t i = frame % 2; i < count; i += 2) {
+            for (Vehicles *vehicles : {&detached, &attached}) {
+                vehicles->getVehicles()[i]->getSubtreeAABB();
+                vehicles->getVehicles()[i]->move(glm::vec3(0.0f, 5.0f, 0.0f));
+                vehicles->getVehicles()[i]->rotate(glm::rotate(0.1f, glm::vec3(0.0f, 1.0f, 0.0f)));
+            }
+        }
+        attached.update();
+
+        for (Vehicles *vehicles : {&detached, &attached}) {
+            for (uint32_t i = 0; i < count; ++i) {
+                Model3D *vehicle = vehicles->getVehicles()[i];
+
+                if (_checkSubtree(*vehicle, vehicle->getSubtreeAABB()) == false) {
+                    fprintf(stderr, "ERROR wrong transform or bounds of a part of vehicle %u\n", i);
+                    return false;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < detached.getModels().size(); ++i) {
+            CHECK(_sameWorld(*detached.getModels()[i], *attached.getModels()[i]));
+        }
+    }
+
+    /* Parts moved to another vehicle keep their local transform, and roots
+     * moved under a part get one level deeper */
+    for (Vehicles *vehicles : {&detached, &attached}) {
+        Scene &scene = vehicles->getScene();
+        std::vector<Model3D *> &v = vehicles->getVehicles();
+
+        for (uint32_t i = 0; i + 1 < count; i += 3) {
+            CHECK(scene.setParent(v[i]->getFirstChild(), v[i + 1]));
+            CHECK(scene.setParent(v[i + 1]->getFirstChild()->getNextSibling(), NULL));
+        }
+        CHECK(scene.setParent(v[count - 1], v[0]->getFirstChild()));
+    }
+    attached.update();
+    for (uint32_t i = 0; i < detached.getModels().size(); ++i) {
+        CHECK(_sameWorld(*detached.getModels()[i], *attached.getModels()[i]));
+    }
+    CHECK(_checkSubtree(*attached.getVehicles()[0], attached.getVehicles()[0]->getSubtreeAABB()));
+
+    /* Detaching the first models moves the last slots, parts included, into
+     * their places */
+    TransformStore &store = attached.getScene().getTransformStore();
+
+    for (uint32_t i = 0; i < Vehicles::PartsPerVehicle; ++i) {
+        store.detach(*attached.getModels()[i]);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        for (Vehicles *vehicles : {&detached, &attached}) {
+            vehicles->getVehicles()[i]->move(glm::vec3(0.0f, 0.0f, 3.0f));
+        }
+    }
+    attached.update();
+    for (uint32_t i = 0; i < detached.getModels().size(); ++i) {
+        CHECK(_sameWorld(*detached.getModels()[i], *attached.getModels()[i]));
+    }
+
+    Asset3D::Delete(asset);
+    return true;
+}
+
+/**
+ * Deleting an object leaves its children where they were in the world, with
+ * their own children still following them
+ */
+TEST(TransformDeleteKeepsChildren, "transform.deleteKeepsChildren")
+{
+    Scene scene;
+    Object3D root, *middle = new Object3D(), child, leaf;
+
+    root.setPosition(glm::vec3(10.0f, 0.0f, 0.0f));
+    root.setOrientation(glm::rotate(0.5f, glm::vec3(0.0f, 1.0f, 0.0f)));
+    middle->setPosition(glm::vec3(0.0f, 3.0f, 0.0f));
+    middle->setScaleFactor(glm::vec3(2.0f, 1.0f, 0.5f));
+    child.setPosition(glm::vec3(1.0f, 1.0f, -2.0f));
+    leaf.setPosition(glm::vec3(0.0f, 0.0f, 5.0f));
+    CHECK(scene.setParent(middle, &root));
+    CHECK(scene.setParent(&child, middle));
+    CHECK(scene.setParent(&leaf, &child));
+
+    glm::mat4 childWorld = child.getModelMatrix(), leafWorld = leaf.getModelMatrix();
+    delete middle;
+
+    CHECK(child.getParent() == NULL && root.getFirstChild() == NULL && leaf.getParent() == &child);
+    CHECK(_distance(child.getModelMatrix(), childWorld) < 1e-4f);
+    CHECK(_distance(leaf.getModelMatrix(), leafWorld) < 1e-4f);
+
+    child.move(glm::vec3(1.0f, 0.0f, 0.0f));
+    CHECK(glm::length(glm::vec3(leaf.getModelMatrix()[3]) - glm::vec3(leafWorld[3]) - glm::vec3(1.0f, 0.0f, 0.0f)) < 1e-4f);
+    return true;
+}
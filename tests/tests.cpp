@@ -0,0 +1,141 @@
+/**
+ * @file    tests.cpp
+ * @brief   Runs the tests of the engine.
+ *
+ *          Each test runs in its own process, so a test that crashes is
+ *          reported as failed and the rest still run. Without arguments every
+ *          test runs, otherwise only the ones whose name starts with one of
+ *          the arguments. The tests that render use a headless window (see
+ *          EGLWindowManager) and, like the demos, must be run from the root
+ *          of the repository.
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Game.hpp"
+#include "Test.hpp"
+
+bool Test::RunGame(GameHandler &handler, uint32_t width, uint32_t height)
+{
+    bool ok = false;
+
+    WindowManager::SetBackend(WindowManager::BACKEND_HEADLESS);
+
+    Game *game = new Game("Test");
+    game->setHandler(&handler);
+    game->setWindowSize(width, height, false);
+    game->setFPS(60, true);
+
+    if (game->init() == true) {
+        ok = game->loop();
+    }
+    delete game;
+    return ok;
+}
+
+static bool _compareNames(const Test *a, const Test *b) { return strcmp(a->getName(), b->getName()) < 0; }
+static bool _selected(const Test &test, const std::vector<std::string> &prefixes)
+{
+    if (prefixes.empty()) {
+        return true;
+    }
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+        if (strncmp(test.getName(), prefixes[i].c_str(), prefixes[i].size()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs a test in a child process
+ *
+ * @return Exit status of the child, 0 if the test passed
+ */
+static int _run(const Test &test)
+{
+    int status = 1;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t child = fork();
+    if (child == 0) {
+        bool ok = test.run();
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+    if (child < 0 || waitpid(child, &status, 0) != child) {
+        fprintf(stderr, "ERROR running test %s\n", test.getName());
+        return 1;
+    }
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "ERROR test %s killed by signal %d\n", test.getName(), WTERMSIG(status));
+        return 1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+static void _usage(void)
+{
+    fprintf(stderr, "Usage: tests [-l] [test ...]\n\n");
+    fprintf(stderr, "-l    - list the tests instead of running them\n");
+    fprintf(stderr, "test  - prefix of the names of the tests to run, all by default\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Test *> tests = Test::GetTests();
+    std::vector<std::string> prefixes;
+    uint32_t passed = 0, failed = 0, skipped = 0;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-l") == 0) {
+            list = true;
+        } else if (argv[i][0] == '-') {
+            _usage();
+            return 2;
+        } else {
+            prefixes.push_back(argv[i]);
+        }
+    }
+
+    std::sort(tests.begin(), tests.end(), _compareNames);
+    for (size_t i = 0; i < tests.size(); ++i) {
+        if (_selected(*tests[i], prefixes) == false) {
+            continue;
+        }
+        if (list) {
+            printf("%s\n", tests[i]->getName());
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int status = _run(*tests[i]);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (status == 0) {
+            printf("PASS  %s (%.1f ms)\n", tests[i]->getName(), ms);
+            ++passed;
+        } else if (status == Test::SkippedStatus) {
+            printf("SKIP  %s\n", tests[i]->getName());
+            ++skipped;
+        } else {
+            printf("FAIL  %s (%.1f ms)\n", tests[i]->getName(), ms);
+            ++failed;
+        }
+    }
+
+    if (list == false) {
+        printf("\n%u passed, %u failed, %u skipped\n", passed, failed, skipped);
+    }
+    return failed == 0 ? 0 : 1;
+}
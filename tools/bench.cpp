@@ -0,0 +1,1198 @@
+/**
+ * @file    bench.cpp
+ * @brief   Deterministic scene benchmark runner.
+ *
+ *          Renders scenes equivalent to the shadows, HDR, procedural and
+ *          anti-aliasing demos, plus a streamed terrain, with the camera
+ *          following a scripted orbit,
+ *          for a fixed number of frames with the frame rate unbound and,
+ *          where available, offscreen (see EGLWindowManager). The animation
+ *          advances per frame and not per elapsed time, so every run renders
+ *          exactly the same images.
+ *
+ *          Each scene runs in its own process, so one scene cannot warm the
+ *          caches or leak memory into the next one. The results, frame time
+ *          percentiles, CPU and GPU time of each pass, draw calls and state
+ *          changes per frame and memory, are written as JSON. The compare
+ *          mode diffs two of those files and fails when a metric regressed.
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AllocationTracker.hpp"
+#include "BentPlane.hpp"
+#include "BlinnPhongShader.hpp"
+#include "Camera.hpp"
+#include "ChunkedTerrain.hpp"
+#include "Circle.hpp"
+#include "Cube.hpp"
+#include "Cylinder.hpp"
+#include "DirectLight.hpp"
+#include "FXAA2RenderTarget.hpp"
+#include "FXAARenderTarget.hpp"
+#include "FrameArena.hpp"
+#include "Game.hpp"
+#include "GaussianBlurRenderTarget.hpp"
+#include "HDRRenderTarget.hpp"
+#include "LightEmitShader.hpp"
+#include "Logging.hpp"
+#include "MSAARenderTarget.hpp"
+#include "NOAARenderTarget.hpp"
+#include "OpenGL.h"
+#include "Plane.hpp"
+#include "PointLight.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "SSAARenderTarget.hpp"
+#include "Scene.hpp"
+#include "Sphere.hpp"
+#include "SpotLight.hpp"
+#include "Terrain.hpp"
+#include "Torus.hpp"
+#include "Triangle.hpp"
+
+#define PI 3.14159265358979323846
+
+using namespace Logging;
+
+/**
+ * Options of a run
+ */
+struct Options {
+    uint32_t width;
+    uint32_t height;
+    uint32_t frames;
+    uint32_t warmup;
+    bool headless;
+    std::string output;
+    std::string trace;
+};
+
+/**
+ * Summary of a set of samples
+ */
+struct Summary {
+    double mean;
+    double stddev;
+    double min;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+static Summary _summarize(std::vector<double> samples)
+{
+    Summary summary = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+    if (samples.empty()) {
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    /* Percentiles interpolated between the closest ranks */
+    double *sorted = &samples[0];
+    size_t count = samples.size();
+    auto percentile = [sorted, count](double p) {
+        double rank = p * (count - 1);
+        size_t lower = (size_t)rank;
+        size_t upper = lower + 1 < count ? lower + 1 : lower;
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        summary.mean += sorted[i];
+    }
+    summary.mean /= count;
+    for (size_t i = 0; i < count; ++i) {
+        summary.stddev += (sorted[i] - summary.mean) * (sorted[i] - summary.mean);
+    }
+    summary.stddev = sqrt(summary.stddev / count);
+    summary.min = sorted[0];
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = sorted[count - 1];
+
+    return summary;
+}
+
+static void _writeSummary(FILE *file, const char *name, const std::vector<double> &samples)
+{
+    Summary summary = _summarize(samples);
+
+    fprintf(file, "\"%s\": {\"mean\": %.4f, \"stddev\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            name, summary.mean, summary.stddev, summary.min, summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+/**
+ * Resident set size of the process in bytes
+ */
+static uint64_t _residentBytes(void)
+{
+    unsigned long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm == NULL) {
+        return 0;
+    }
+    if (fscanf(statm, "%lu %lu", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+
+    return (uint64_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Highest resident set size of the process in bytes
+ */
+static uint64_t _peakResidentBytes(void)
+{
+    struct rusage usage;
+
+    uint64_t resident = _residentBytes();
+    uint64_t peak;
+
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    peak = (uint64_t)usage.ru_maxrss;
+#else
+    peak = (uint64_t)usage.ru_maxrss * 1024;
+#endif
+    return peak > resident ? peak : resident;
+}
+
+/**
+ * Drives a scene along the scripted path and collects the measurements
+ */
+class BenchmarkHandler : public GameHandler
+{
+  public:
+    BenchmarkHandler(const char *name, const Options &options)
+        : _viewport(NULL)
+        , _width(0)
+        , _height(0)
+        , _name(name)
+        , _options(options)
+        , _tick(0)
+        , _firstProfilerFrame(0)
+        , _nextGPUFrame(0)
+        , _stateChanges(0)
+        , _allocations(0)
+        , _allocatedBytes(0)
+    {
+        memset(_counters, 0, sizeof _counters);
+    }
+    virtual ~BenchmarkHandler() { delete _viewport; }
+    const char *getName() const { return _name; }
+    bool handleInit(Game *game)
+    {
+        game->getWindowManager()->getWindowSize(&_width, &_height);
+        _viewport = new Viewport(0, 0, _width, _height);
+
+        _renderer = game->getRenderer()->getName();
+
+        if (_setup(game) == false) {
+            return false;
+        }
+        _last = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    bool handleTick(Game *game, double elapsedMs)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        uint32_t totalFrames = _options.warmup + _options.frames;
+
+        /* Measurements of the frame rendered since the previous tick */
+        if (_tick > _options.warmup) {
+            _frameMs.push_back(std::chrono::duration<double, std::milli>(now - _last).count());
+            _collectFrame();
+        } else if (_tick == _options.warmup) {
+            _firstProfilerFrame = _nextGPUFrame = Profiler::GetInstance()->getFrame();
+        }
+        _collectGPU(false);
+        _last = now;
+
+        if (_tick == totalFrames) {
+            return false;
+        }
+
+        /* One orbit around the scene over the whole run */
+        float t = (float)_tick / (float)totalFrames;
+        float angle = (float)(2.0 * PI) * t;
+        Camera *camera = _scene.getActiveCamera();
+
+        camera->setPosition(_center + glm::vec3(_radius * cosf(angle), _elevation + 0.25f * _elevation * sinf(2.0f * angle),
+                                                _radius * sinf(angle)));
+        camera->lookAt(_center);
+
+        _animate(t);
+
+        ++_tick;
+        return true;
+    }
+
+    bool handleRender(Game *game) { return _render(game); }
+    /**
+     * Writes the results of the run as the JSON member of the scene
+     *
+     * @param file  File to write to
+     */
+    void writeResults(FILE *file)
+    {
+        _collectGPU(true);
+
+        fprintf(file, "\"%s\": {\n", _name);
+        fprintf(file, "    \"renderer\": \"%s\",\n", _renderer.c_str());
+        fprintf(file, "    \"frames\": %u,\n", (uint32_t)_frameMs.size());
+        fprintf(file, "    ");
+        _writeSummary(file, "frameMs", _frameMs);
+        fprintf(file, ",\n");
+
+        _writePasses(file, "cpuPassesMs", _cpuPasses);
+        _writePasses(file, "gpuPassesMs", _gpuPasses);
+
+        fprintf(file, "    \"counters\": {");
+        for (uint32_t counter = 0; counter < RenderStats::COUNTER_COUNT; ++counter) {
+            fprintf(file, "\"%s\": %.2f, ", RenderStats::GetCounterName((RenderStats::Counter)counter), _perFrame(_counters[counter]));
+        }
+        fprintf(file, "\"stateChanges\": %.2f},\n", _perFrame(_stateChanges));
+
+        fprintf(file, "    \"memory\": {\"residentBytes\": %llu, \"peakResidentBytes\": %llu, \"frameArenaBytes\": %llu",
+                (unsigned long long)_residentBytes(), (unsigned long long)_peakResidentBytes(),
+                (unsigned long long)FrameArena::GetInstance()->getCapacity());
+        if (AllocationTracker::IsEnabled()) {
+            fprintf(file, ", \"liveHeapBytes\": %llu, \"allocationsPerFrame\": %.2f, \"allocatedBytesPerFrame\": %.2f",
+                    (unsigned long long)AllocationTracker::GetLiveBytes(), _perFrame(_allocations), _perFrame(_allocatedBytes));
+        }
+        fprintf(file, "}\n}");
+    }
+
+  protected:
+    /**
+     * Builds the scene and sets the camera path
+     */
+    virtual bool _setup(Game *game) = 0;
+
+    /**
+     * Moves the scene elements
+     *
+     * @param t  Position in the run, from 0 to 1
+     */
+    virtual void _animate(float t) {}
+    /**
+     * Renders a frame
+     */
+    virtual bool _render(Game *game) { return game->getRenderer()->renderScene(_scene, *_viewport); }
+    /**
+     * Sets the orbit of the camera
+     */
+    void _setPath(const glm::vec3 &center, float radius, float elevation)
+    {
+        _center = center;
+        _radius = radius;
+        _elevation = elevation;
+    }
+
+    Scene _scene;
+    Viewport *_viewport;
+    uint32_t _width;
+    uint32_t _height;
+
+  private:
+    double _perFrame(uint64_t total) { return _frameMs.empty() ? 0.0 : (double)total / _frameMs.size(); }
+    /**
+     * Accumulates the counters and the CPU timings of the last frame
+     */
+    void _collectFrame()
+    {
+        Profiler::Event events[64];
+        size_t numEvents = Profiler::GetInstance()->getFrameEvents(Profiler::GetInstance()->getFrame() - 1, false, events, 64);
+
+        _addPasses(_cpuPasses, events, numEvents);
+
+        for (uint32_t counter = 0; counter < RenderStats::COUNTER_COUNT; ++counter) {
+            _counters[counter] += RenderStats::Get((RenderStats::Counter)counter);
+        }
+        _stateChanges += RenderStats::GetStateChanges();
+
+        AllocationTracker::Stats total = AllocationTracker::GetFrameTotal();
+        _allocations += total.allocations;
+        _allocatedBytes += total.bytes;
+    }
+
+    /**
+     * Accumulates the GPU timings resolved since the last call
+     *
+     * @param all  Whether to take the frames still in flight too
+     */
+    void _collectGPU(bool all)
+    {
+        Profiler *profiler = Profiler::GetInstance();
+        uint64_t lastFrame = all ? profiler->getFrame() : profiler->getLastGPUFrame() + 1;
+        uint64_t endFrame = _firstProfilerFrame + _options.frames;
+        Profiler::Event events[64];
+
+        for (; _nextGPUFrame < lastFrame && _nextGPUFrame < endFrame && _tick >= _options.warmup; ++_nextGPUFrame) {
+            _addPasses(_gpuPasses, events, profiler->getFrameEvents(_nextGPUFrame, true, events, 64));
+        }
+    }
+
+    static void _addPasses(std::map<std::string, std::vector<double> > &passes, const Profiler::Event *events, size_t numEvents)
+    {
+        std::map<std::string, double> frame;
+
+        /* A pass may run several times in a frame */
+        for (size_t i = 0; i < numEvents; ++i) {
+            frame[events[i].name] += events[i].duration / 1000.0;
+        }
+        for (std::map<std::string, double>::iterator it = frame.begin(); it != frame.end(); ++it) {
+            passes[it->first].push_back(it->second);
+        }
+    }
+
+    static void _writePasses(FILE *file, const char *name, const std::map<std::string, std::vector<double> > &passes)
+    {
+        fprintf(file, "    \"%s\": {", name);
+        for (std::map<std::string, std::vector<double> >::const_iterator it = passes.begin(); it != passes.end(); ++it) {
+            fprintf(file, "%s\n        ", it == passes.begin() ? "" : ",");
+            _writeSummary(file, it->first.c_str(), it->second);
+        }
+        fprintf(file, "},\n");
+    }
+
+    const char *_name;
+    Options _options;
+    std::string _renderer;
+    uint32_t _tick;
+    uint64_t _firstProfilerFrame;
+    uint64_t _nextGPUFrame;
+    std::chrono::steady_clock::time_point _last;
+
+    glm::vec3 _center;
+    float _radius;
+    float _elevation;
+
+    std::vector<double> _frameMs;
+    std::map<std::string, std::vector<double> > _cpuPasses;
+    std::map<std::string, std::vector<double> > _gpuPasses;
+    uint64_t _counters[RenderStats::COUNTER_COUNT];
+    uint64_t _stateChanges;
+    uint64_t _allocations;
+    uint64_t _allocatedBytes;
+};
+
+/**
+ * Shadows demo: point, spot and direct lights casting shadows
+ */
+class ShadowsBenchmark : public BenchmarkHandler
+{
+  public:
+    ShadowsBenchmark(const Options &options) : BenchmarkHandler("shadows", options) {}
+  protected:
+    bool _setup(Game *game)
+    {
+        const char *pointLights[] = {"PL_light1", "PL_light2", "PL_light3"};
+        const glm::vec3 pointColors[] = {glm::vec3(1.0f, 1.0f, 0.2f), glm::vec3(0.5f, 1.0f, 0.5f), glm::vec3(0.5f, 0.5f, 1.0f)};
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            _scene.add(pointLights[i], new PointLight(pointColors[i], pointColors[i], pointColors[i], glm::vec3(-100.0f, 100.0f, 100.0f),
+                                                      0.0000099999f, 1000.0f));
+            _scene.getPointLight(pointLights[i])->setProjection((float)_width / 4.0f, (float)_height / 4.0f, 0.1f, 10000.0f);
+            _scene.getPointLight(pointLights[i])->getShadowMap()->init(_width, _height);
+        }
+
+        _scene.add("SL_light1", new SpotLight(glm::vec3(2.0f, 0.5f, 0.5f), glm::vec3(2.0f, 0.5f, 0.5f), glm::vec3(2.0f, 0.5f, 0.5f),
+                                              glm::vec3(160.0f, 170.0f, 0.0f), 15.0f, 3.0f, 0.0000099999f, 1000.0f));
+        _scene.getSpotLight("SL_light1")->setProjection((float)_width / 4.0f, (float)_height / 4.0f, 0.1f, 10000.0f);
+        _scene.getSpotLight("SL_light1")->getShadowMap()->init(_width, _height);
+
+        _scene.add("DL_light1", new DirectLight(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.4f, 0.4f, 0.4f),
+                                                glm::vec3(-100.0f, -100.0f, -100.0f)));
+        _scene.getDirectLight("DL_light1")->setPosition(glm::vec3(-200.0f, 200.0f, -150.0f));
+        _scene.getDirectLight("DL_light1")->setProjection((float)_width / 4.0f, (float)_height / 4.0f, 0.1f, 1000.0f);
+        _scene.getDirectLight("DL_light1")->getShadowMap()->init(_width, _height);
+
+        _scene.add("RT_noaa", NOAARenderTarget::New());
+        _scene.getRenderTarget("RT_noaa")->init(_width, _height);
+        _scene.getRenderTarget("RT_noaa")->setClearColor(0.0, 0.0, 0.0, 1.0);
+
+        BlinnPhongShader *shader = BlinnPhongShader::New();
+        if (shader->init() == false) {
+            log("ERROR initializing blinn-phong shader\n");
+            return false;
+        }
+
+        Procedural::Plane *plane = new Procedural::Plane();
+        if (game->getRenderer()->prepareAsset3D(*plane) == false) {
+            log("ERROR preparing plane asset\n");
+            return false;
+        }
+
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
+        if (!daxter) {
+            return false;
+        }
+
+        _scene.add("M3D_daxter", new Model3D(daxter));
+        _scene.getModel("M3D_daxter")->setScaleFactor(glm::vec3(100.0f, 100.0f, 100.0f));
+        _scene.getModel("M3D_daxter")->setLightingShader(shader);
+        _scene.getModel("M3D_daxter")->rotate(glm::toMat4(glm::quat(glm::vec3(0.0f, 45.0f, 0.0f))));
+
+        _scene.add("M3D_plane", plane);
+        _scene.getModel("M3D_plane")->setScaleFactor(glm::vec3(500.0f, 1.0f, 500.0f));
+        _scene.getModel("M3D_plane")->setPosition(glm::vec3(0.0f, -70.0f, 0.0f));
+        _scene.getModel("M3D_plane")->setLightingShader(shader);
+        _scene.getModel("M3D_plane")->setShadowCaster(false);
+
+        _scene.add("C_camera1", new Camera());
+        _scene.getCamera("C_camera1")->setProjection((float)_width, (float)_height, 0.1f, 1000.0f, 45.0f);
+
+        _setPath(glm::vec3(0.0f, 0.0f, 0.0f), 210.0f, 100.0f);
+        return true;
+    }
+
+    /* Same light motion than the demo, several turns per run */
+    void _animate(float t)
+    {
+        float angle = fmodf(t * 8.0f, 1.0f) * (float)(2.0 * PI);
+        std::vector<PointLight *> &pointLights = _scene.getPointLights();
+
+        for (int i = 0; i < (int)pointLights.size(); ++i) {
+            int sign = i % 2 ? -1 : 1;
+            if (i == 0) {
+                pointLights[i]->setPosition(glm::vec3(10.0, 300.0, 300.0 * glm::cos((i + 1) * sign * angle)));
+            } else {
+                pointLights[i]->setPosition(
+                    glm::vec3(200.0 * glm::sin((i + 1) * sign * angle), 200.0, 200.0 * glm::cos((i + 1) * sign * angle)));
+            }
+        }
+
+        SpotLight *spotLight = _scene.getSpotLight("SL_light1");
+        spotLight->setPosition(glm::vec3(240.0 * glm::sin(angle), 250.0, 260.0 * glm::cos(angle)));
+        spotLight->lookAt(glm::vec3(0.0f, 0.0f, 0.0f));
+    }
+};
+
+/**
+ * HDR demo: bright lights, tone mapping and bloom
+ */
+class HDRBenchmark : public BenchmarkHandler
+{
+  public:
+    HDRBenchmark(const Options &options) : BenchmarkHandler("hdr", options), _gaussianBlurH(NULL), _gaussianBlurV(NULL) {}
+  protected:
+    bool _setup(Game *game)
+    {
+        const char *lights[] = {"PL_light1", "PL_light2", "PL_light3"};
+        const glm::vec3 colors[] = {glm::vec3(0.5f, 0.5f, 0.4f), glm::vec3(10.0f, 10.0f, 8.0f), glm::vec3(50.0f, 50.0f, 40.0f)};
+        const glm::vec3 positions[] = {glm::vec3(0.0f, 150.0f, 150.0f), glm::vec3(160.0f, 150.0f, -100.0f),
+                                       glm::vec3(-160.0f, 150.0f, -100.0f)};
+        const glm::vec3 models[] = {glm::vec3(0.0f, 0.0f, 150.0f), glm::vec3(160.0f, 0.0f, -100.0f), glm::vec3(-160.0f, 0.0f, -100.0f)};
+
+        _scene.add("RT_HDR", HDRRenderTarget::New());
+        _scene.getRenderTarget("RT_HDR")->init(_width, _height, 0, 2);
+        _scene.getRenderTarget("RT_HDR")->setClearColor(0.0, 0.0, 0.0, 0.0);
+
+        _gaussianBlurH = GaussianBlurRenderTarget::New();
+        _gaussianBlurH->init(_width, _height);
+        _gaussianBlurH->setClearColor(0.0, 0.0, 0.0, 1.0);
+        _gaussianBlurH->setHorizontal(true);
+
+        _gaussianBlurV = GaussianBlurRenderTarget::New();
+        _gaussianBlurV->init(_width, _height);
+        _gaussianBlurV->setClearColor(0.0, 0.0, 0.0, 1.0);
+        _gaussianBlurV->setHorizontal(false);
+
+        BlinnPhongShader *shader = BlinnPhongShader::New();
+        if (shader->init() == false) {
+            log("ERROR initializing blinn-phong shader\n");
+            return false;
+        }
+        LightEmitShader *emitShader = LightEmitShader::New();
+        if (emitShader->init() == false) {
+            log("ERROR initializing light emit shader\n");
+            return false;
+        }
+
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
+        if (!daxter) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            std::string index(1, (char)('1' + i));
+
+            _scene.add(lights[i], new PointLight(colors[i], colors[i], colors[i], positions[i], 0.0000099999f, 240.0f));
+            _scene.getPointLight(lights[i])->setProjection((float)_width / 4.0f, (float)_height / 4.0f, 0.1f, 10000.0f);
+            _scene.getPointLight(lights[i])->getShadowMap()->init(_width, _height);
+            _scene.getPointLight(lights[i])->lookAt(models[i]);
+
+            _scene.add("M3D_daxter" + index, new Model3D(daxter));
+            _scene.getModel("M3D_daxter" + index)->setScaleFactor(glm::vec3(100.0f, 100.0f, 100.0f));
+            _scene.getModel("M3D_daxter" + index)->setPosition(models[i]);
+            _scene.getModel("M3D_daxter" + index)->setLightingShader(shader);
+
+            Procedural::Sphere *sphere = new Procedural::Sphere(25.0f, glm::vec3(1.0f, 1.0f, 1.0f), 50, 50);
+            if (game->getRenderer()->prepareAsset3D(*sphere) == false) {
+                log("ERROR preparing sphere asset\n");
+                return false;
+            }
+            _scene.add("M3D_sphere" + index, sphere);
+            sphere->setPosition(positions[i]);
+            sphere->setLightingShader(emitShader);
+            sphere->setShadowCaster(false);
+            sphere->setShadowReceiver(false);
+        }
+
+        Procedural::Plane *plane = new Procedural::Plane();
+        if (game->getRenderer()->prepareAsset3D(*plane) == false) {
+            log("ERROR preparing plane asset\n");
+            return false;
+        }
+        _scene.add("M3D_plane", plane);
+        plane->setScaleFactor(glm::vec3(600.0f, 1.0f, 600.0f));
+        plane->setPosition(glm::vec3(0.0f, -70.0f, 0.0f));
+        plane->setLightingShader(shader);
+        plane->setShadowCaster(false);
+
+        _scene.add("C_camera1", new Camera());
+        _scene.getCamera("C_camera1")->setProjection((float)_width, (float)_height, 0.1f, 10000.0f, 45.0f);
+
+        _setPath(glm::vec3(0.0f, 0.0f, 0.0f), 400.0f, 250.0f);
+        return true;
+    }
+
+    /* Render to the HDR target and add the bloom like the demo does */
+    bool _render(Game *game)
+    {
+        HDRRenderTarget *hdr = dynamic_cast<HDRRenderTarget *>(_scene.getActiveRenderTarget());
+
+        game->getRenderer()->renderScene(_scene, *_viewport, false);
+        hdr->blit();
+
+        _gaussianBlurH->clear();
+        _gaussianBlurV->clear();
+
+        _gaussianBlurV->bind();
+        hdr->disableToneMapping();
+        hdr->setBlendingMode(RenderTarget::BLENDING_NONE);
+        hdr->blit(0, 0, _width, _height, 1, false);
+        _gaussianBlurV->unbind();
+
+        _gaussianBlurH->bind();
+        _gaussianBlurV->blit(0, 0, _width, _height, 0, false);
+        _gaussianBlurH->unbind();
+
+        hdr->bind();
+        _gaussianBlurH->blit(0, 0, _width, _height, 0, false);
+        hdr->unbind();
+
+        hdr->enableToneMapping();
+        hdr->setBlendingMode(RenderTarget::BLENDING_ADDITIVE);
+        hdr->blit();
+
+        return true;
+    }
+
+  private:
+    GaussianBlurRenderTarget *_gaussianBlurH;
+    GaussianBlurRenderTarget *_gaussianBlurV;
+};
+
+/**
+ * Procedural demo: terrain and the procedural shapes lit by the sun
+ */
+class ProceduralBenchmark : public BenchmarkHandler
+{
+  public:
+    ProceduralBenchmark(const Options &options) : BenchmarkHandler("procedural", options) {}
+  protected:
+    bool _setup(Game *game)
+    {
+        float sunIntensity = 1.0f;
+
+        _scene.add("RT_noaa", NOAARenderTarget::New());
+        _scene.getRenderTarget("RT_noaa")->init(_width, _height);
+        _scene.getRenderTarget("RT_noaa")->setClearColor(135.0f / 255.0f, 206.0f / 255.0f, 250.0f / 255.0f, 1.0);
+
+        _scene.add("Sun", new DirectLight(glm::vec3(64.0 / 255.0f, 156.0f / 255.0f, 255.0f / 255.0f) * sunIntensity,
+                                          glm::vec3(1.0f, 1.0f, 1.0f) * sunIntensity, glm::vec3(1.0f, 1.0f, 1.0f) * sunIntensity,
+                                          glm::vec3(-100.0f, -100.0f, -100.0f)));
+        _scene.getDirectLight("Sun")->setPosition(glm::vec3(0.0f, 300.0f, 170.0f));
+        _scene.getDirectLight("Sun")->setProjection((float)_width / 4.0f, (float)_height / 4.0f, 0.1f, 1000.0f);
+        _scene.getDirectLight("Sun")->getShadowMap()->init(_width, _height);
+
+        _shader = BlinnPhongShader::New();
+        if (_shader->init() == false) {
+            log("ERROR initializing blinn-phong shader\n");
+            return false;
+        }
+
+        Procedural::BentPlane *plane1 = new Procedural::BentPlane(500.0f, 500.0f, glm::vec3(1.0, 0.8f, 0.1f), (float)(PI / 2.0f), 20, 20);
+        Procedural::BentPlane *plane2 = new Procedural::BentPlane(500.0f, 500.0f, glm::vec3(0.8, 1.0f, 0.1f), (float)PI, 20, 20);
+        Procedural::Triangle *triangle = new Procedural::Triangle(glm::vec3(-100.0f, 10.0f, 130.0f), glm::vec3(0.0f, 30.0f, 130.0f),
+                                                                  glm::vec3(-50.0f, 80.0f, 100.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+        Procedural::Torus *torus = new Procedural::Torus(10.0f, 4.0f, glm::vec3(1.0f, 0.0f, 0.0f), 50, 50);
+
+        if (_add(game, "M3D_terrain",
+                 new Procedural::Terrain(500.0f, 500.0f, 700.0f, 0, glm::vec3(1.0, 0.3f, 0.6f), 100, 100, 5, 0.5),
+                 glm::vec3(0.0f, -100.0f, 0.0f), false) == false ||
+            _add(game, "M3D_plane1", plane1, glm::vec3(-300.0f, 220.0f, -300.0f), false) == false ||
+            _add(game, "M3D_plane2", plane2, glm::vec3(300.0f, 220.0f, -300.0f), false) == false ||
+            _add(game, "M3D_triangle", triangle, glm::vec3(0.0f, 0.0f, 0.0f), true) == false ||
+            _add(game, "M3D_torus", torus, glm::vec3(120.0f, 100.0f, 100.0f), true) == false ||
+            _add(game, "M3D_cube", new Procedural::Cube(150.0f, 50.0f, 100.0f, glm::vec3(0.5f, 0.3f, 1.0f), 10, 8, 2),
+                 glm::vec3(0.0f, 60.0f, 0.0f), true) == false ||
+            _add(game, "M3D_circle", new Procedural::Circle(100.0f, glm::vec3(0.8f, 0.9f, 0.1f), 50), glm::vec3(0.0f, 1.0f, 0.0f),
+                 true) == false ||
+            _add(game, "M3D_cylinder", new Procedural::Cylinder(20.0f, 40.0f, glm::vec3(0.2f, 1.0f, 0.4f), 50, 50),
+                 glm::vec3(0.0f, 90.0f, 150.0f), true) == false ||
+            _add(game, "M3D_sphere", new Procedural::Sphere(30.0f, glm::vec3(0.4, 0.8f, 0.9f), 50, 50), glm::vec3(-120.0f, 30.0f, 200.0f),
+                 true) == false) {
+            return false;
+        }
+
+        plane1->setOrientation(glm::toMat4(glm::quat(glm::vec3(0.0f, PI / 2.0f, 0.0f))));
+        plane1->rotate(glm::toMat4(glm::quat(glm::vec3(PI / 2.0, PI / 4.0f, 0.0f))));
+        plane2->setOrientation(glm::toMat4(glm::quat(glm::vec3(PI / 2.0, -PI / 4.0f, 0.0f))));
+        torus->setOrientation(glm::toMat4(glm::quat(glm::vec3(0.0f, -PI / 2.0f, 0.0f))));
+        torus->rotate(glm::toMat4(glm::quat(glm::vec3(-PI / 4.0f, 0.0f, 0.0f))));
+
+        _scene.add("Camera1", new Camera());
+        _scene.getCamera("Camera1")->setProjection((float)_width, (float)_height, 0.1f, 10000.0f, 45.0f);
+
+        _setPath(glm::vec3(0.0f, 0.0f, 0.0f), 470.0f, 120.0f);
+        return true;
+    }
+
+  private:
+    bool _add(Game *game, const std::string &name, Model3D *model, const glm::vec3 &position, bool shadowCaster)
+    {
+        if (game->getRenderer()->prepareAsset3D(*model) == false) {
+            log("ERROR preparing the %s asset\n", name.c_str());
+            return false;
+        }
+
+        _scene.add(name, model);
+        model->setPosition(position);
+        model->setLightingShader(_shader);
+        model->setShadowCaster(shadowCaster);
+        return true;
+    }
+
+    BlinnPhongShader *_shader;
+};
+
+/**
+ * Streamed terrain: a chunked terrain generated around a camera orbiting far
+ * enough for tiles to be generated and evicted during the run
+ */
+class TerrainBenchmark : public BenchmarkHandler
+{
+  public:
+    TerrainBenchmark(const Options &options) : BenchmarkHandler("terrain", options), _terrain(NULL) {}
+    ~TerrainBenchmark() { delete _terrain; }
+  protected:
+    bool _setup(Game *game)
+    {
+        _scene.add("RT_noaa", NOAARenderTarget::New());
+        _scene.getRenderTarget("RT_noaa")->init(_width, _height);
+        _scene.getRenderTarget("RT_noaa")->setClearColor(135.0f / 255.0f, 206.0f / 255.0f, 250.0f / 255.0f, 1.0);
+
+        _scene.add("Sun", new DirectLight(glm::vec3(64.0 / 255.0f, 156.0f / 255.0f, 255.0f / 255.0f), glm::vec3(1.0f, 1.0f, 1.0f),
+                                          glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(-100.0f, -100.0f, -100.0f)));
+        _scene.getDirectLight("Sun")->setPosition(glm::vec3(0.0f, 300.0f, 170.0f));
+        _scene.getDirectLight("Sun")->setProjection((float)_width / 4.0f, (float)_height / 4.0f, 0.1f, 1000.0f);
+        _scene.getDirectLight("Sun")->getShadowMap()->init(_width, _height);
+
+        BlinnPhongShader *shader = BlinnPhongShader::New();
+        if (shader->init() == false) {
+            log("ERROR initializing blinn-phong shader\n");
+            return false;
+        }
+
+        _terrain = new Procedural::ChunkedTerrain(_scene, game->getRenderer(), 256.0f, 300.0f, 0, glm::vec3(1.0, 0.3f, 0.6f));
+        _terrain->setLightingShader(shader);
+        _terrain->setShadowCaster(false);
+        _terrain->setUploadsPerFrame(1000);
+
+        _scene.add("Camera1", new Camera());
+        _scene.getCamera("Camera1")->setProjection((float)_width, (float)_height, 0.1f, 10000.0f, 45.0f);
+
+        _setPath(glm::vec3(0.0f, 0.0f, 0.0f), 3000.0f, 400.0f);
+        return true;
+    }
+
+    bool _render(Game *game)
+    {
+        /* Waiting for the tiles keeps the images the same in every run, the
+         * time spent generating them counts in the frame */
+        _terrain->update(_scene.getActiveCamera()->getPosition());
+        while (_terrain->getNumPendingTiles() > 0) {
+            std::this_thread::yield();
+            _terrain->update(_scene.getActiveCamera()->getPosition());
+        }
+        return BenchmarkHandler::_render(game);
+    }
+
+  private:
+    Procedural::ChunkedTerrain *_terrain;
+};
+
+/**
+ * Anti-aliasing comparison demo, one scene per technique
+ */
+class AntiAliasingBenchmark : public BenchmarkHandler
+{
+  public:
+    AntiAliasingBenchmark(const char *name, const Options &options) : BenchmarkHandler(name, options) {}
+  protected:
+    bool _setup(Game *game)
+    {
+        std::string name = getName();
+        RenderTarget *target;
+
+        if (name == "msaa") {
+            uint32_t samples = MSAARenderTarget::getMaxSamples() < 4 ? MSAARenderTarget::getMaxSamples() : 4;
+
+            target = MSAARenderTarget::New();
+            static_cast<MSAARenderTarget *>(target)->init(_width, _height, samples);
+        } else if (name == "ssaa") {
+            target = SSAARenderTarget::New();
+            static_cast<SSAARenderTarget *>(target)->init(_width, _height, 4);
+        } else {
+            if (name == "fxaa") {
+                target = FXAARenderTarget::New();
+            } else if (name == "fxaa2") {
+                target = FXAA2RenderTarget::New();
+            } else {
+                target = NOAARenderTarget::New();
+            }
+            target->init(_width, _height);
+        }
+        _scene.add("RT_" + name, target);
+
+        _scene.add("PL_light1", new PointLight(glm::vec3(4.0, 4.0, 4.0), glm::vec3(5.0, 5.0, 5.0), glm::vec3(5.0, 5.0, 5.0),
+                                               glm::vec3(0.0, 150.0, 50.0), 0.0000099999f, 1000.0f));
+        _scene.add("PL_light2", new PointLight(glm::vec3(2.0, 2.0, 1.6), glm::vec3(0.0, 0.0, 3.0), glm::vec3(0.0, 0.0, 3.0),
+                                               glm::vec3(50.0, 20.0, -150.0), 0.0000099999f, 1000.0f));
+        _scene.add("PL_light3", new PointLight(glm::vec3(2.0, 1.6, 2.0), glm::vec3(1.0, 0.0, 1.0), glm::vec3(1.0, 0.0, 1.0),
+                                               glm::vec3(30.0, 20.0, 0.0), 0.0000099999f, 1000.0f));
+        _scene.getPointLight("PL_light1")->getShadowMap()->init(1, 1);
+        _scene.getPointLight("PL_light2")->getShadowMap()->init(1, 1);
+        _scene.getPointLight("PL_light3")->getShadowMap()->init(1, 1);
+
+        BlinnPhongShader *shader = BlinnPhongShader::New();
+        if (shader->init() == false) {
+            log("ERROR initializing blinn-phong shader\n");
+            return false;
+        }
+
+        /* The demo model is not shipped, use the one the other scenes load */
+        Asset3DHandle daxter = game->getResourceManager()->acquireAsset3D("data/models/internal/daxter.model");
+        if (!daxter) {
+            return false;
+        }
+
+        _scene.add("M3D_daxter", new Model3D(daxter));
+        _scene.getModel("M3D_daxter")->setScaleFactor(glm::vec3(100.0f, 100.0f, 100.0f));
+        _scene.getModel("M3D_daxter")->setLightingShader(shader);
+        _scene.getModel("M3D_daxter")->setShadowCaster(false);
+
+        _scene.add("C_camera1", new Camera());
+        _scene.getCamera("C_camera1")->setProjection((float)_width, (float)_height, 0.1f, 1000.0f, 45.0f);
+
+        _setPath(glm::vec3(0.0f, 20.0f, 0.0f), 210.0f, 80.0f);
+        return true;
+    }
+};
+
+static const char *_sceneNames[] = {"shadows", "hdr", "procedural", "terrain", "noaa", "msaa", "ssaa", "fxaa", "fxaa2"};
+
+static BenchmarkHandler *_newBenchmark(const std::string &name, const Options &options)
+{
+    if (name == "shadows") {
+        return new ShadowsBenchmark(options);
+    } else if (name == "hdr") {
+        return new HDRBenchmark(options);
+    } else if (name == "procedural") {
+        return new ProceduralBenchmark(options);
+    } else if (name == "terrain") {
+        return new TerrainBenchmark(options);
+    }
+    for (size_t i = 4; i < sizeof _sceneNames / sizeof *_sceneNames; ++i) {
+        if (name == _sceneNames[i]) {
+            return new AntiAliasingBenchmark(_sceneNames[i], options);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs a scene and writes its results
+ *
+ * @return true if the scene rendered all its frames
+ */
+static bool _runScene(const std::string &name, const Options &options, FILE *results)
+{
+    BenchmarkHandler *benchmark = _newBenchmark(name, options);
+    bool ok = true;
+
+    if (options.headless) {
+        WindowManager::SetBackend(WindowManager::BACKEND_HEADLESS);
+    }
+    Profiler::GetInstance()->setEnabled(true);
+
+    Game *game = new Game("Benchmark " + name);
+    game->setHandler(benchmark);
+    game->setWindowSize(options.width, options.height, false);
+    game->setFPS(60, true);
+
+    if (game->init() == false) {
+        log("ERROR initializing scene %s\n", name.c_str());
+        ok = false;
+    } else {
+        game->loop();
+        benchmark->writeResults(results);
+
+        if (options.trace.empty() == false) {
+            Profiler::GetInstance()->exportChromeTrace(options.trace + "." + name + ".json");
+        }
+    }
+
+    delete game;
+    delete benchmark;
+    return ok;
+}
+
+/**
+ * Runs every scene in a child process and gathers the results
+ */
+static int _run(const std::vector<std::string> &scenes, const Options &options)
+{
+    FILE *output = fopen(options.output.c_str(), "w");
+    if (output == NULL) {
+        fprintf(stderr, "ERROR opening %s\n", options.output.c_str());
+        return 1;
+    }
+
+    fprintf(output, "{\n\"version\": 1,\n\"width\": %u,\n\"height\": %u,\n\"frames\": %u,\n\"warmup\": %u,\n\"headless\": %s,\n",
+            options.width, options.height, options.frames, options.warmup, options.headless ? "true" : "false");
+    fprintf(output, "\"scenes\": {\n");
+
+    int ret = 0;
+    for (size_t i = 0; i < scenes.size(); ++i) {
+        int pipeFds[2];
+        std::string results;
+        char buffer[4096];
+        ssize_t bytesRead;
+        int status = 1;
+
+        fflush(output);
+        fflush(stdout);
+        if (pipe(pipeFds) != 0) {
+            fprintf(stderr, "ERROR creating pipe\n");
+            return 1;
+        }
+
+        pid_t child = fork();
+        if (child == 0) {
+            FILE *pipeFile = fdopen(pipeFds[1], "w");
+            close(pipeFds[0]);
+            bool ok = _runScene(scenes[i], options, pipeFile);
+            fclose(pipeFile);
+            fflush(stdout);
+            _exit(ok ? 0 : 1);
+        }
+
+        close(pipeFds[1]);
+        while ((bytesRead = read(pipeFds[0], buffer, sizeof buffer)) > 0) {
+            results.append(buffer, bytesRead);
+        }
+        close(pipeFds[0]);
+        waitpid(child, &status, 0);
+
+        if (child < 0 || WIFEXITED(status) == false || WEXITSTATUS(status) != 0 || results.empty()) {
+            fprintf(stderr, "ERROR running scene %s\n", scenes[i].c_str());
+            ret = 1;
+            continue;
+        }
+        fprintf(output, "%s%s", i == 0 || results.empty() ? "" : ",\n", results.c_str());
+    }
+
+    fprintf(output, "\n}\n}\n");
+    fclose(output);
+
+    return ret;
+}
+
+/**
+ * Minimal JSON reader, flattens every number of the document into
+ * "member.member.member" keys
+ */
+class JSONReader
+{
+  public:
+    JSONReader(const std::string &text) : _text(text), _pos(0) {}
+    bool read(std::map<std::string, double> &values) { return _value("", values) && (_skip(), _pos == _text.size()); }
+  private:
+    void _skip()
+    {
+        while (_pos < _text.size() && strchr(" \t\r\n", _text[_pos]) != NULL) {
+            ++_pos;
+        }
+    }
+
+    bool _string(std::string &string)
+    {
+        _skip();
+        if (_pos >= _text.size() || _text[_pos++] != '"') {
+            return false;
+        }
+        while (_pos < _text.size() && _text[_pos] != '"') {
+            if (_text[_pos] == '\\') {
+                ++_pos;
+            }
+            string += _text[_pos++];
+        }
+        return _pos++ < _text.size();
+    }
+
+    bool _value(const std::string &key, std::map<std::string, double> &values)
+    {
+        _skip();
+        if (_pos >= _text.size()) {
+            return false;
+        }
+
+        char c = _text[_pos];
+        if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            uint32_t index = 0;
+
+            ++_pos;
+            _skip();
+            if (_pos < _text.size() && _text[_pos] == close) {
+                ++_pos;
+                return true;
+            }
+            do {
+                std::string member;
+                if (c == '{') {
+                    if (_string(member) == false || (_skip(), _text[_pos++] != ':')) {
+                        return false;
+                    }
+                } else {
+                    member = std::to_string(index++);
+                }
+                if (_value(key.empty() ? member : key + "." + member, values) == false) {
+                    return false;
+                }
+                _skip();
+            } while (_pos < _text.size() && _text[_pos++] == ',');
+            return _text[_pos - 1] == close;
+        } else if (c == '"') {
+            std::string string;
+            return _string(string);
+        } else if (_text.compare(_pos, 4, "true") == 0 || _text.compare(_pos, 4, "null") == 0) {
+            _pos += 4;
+            return true;
+        } else if (_text.compare(_pos, 5, "false") == 0) {
+            _pos += 5;
+            return true;
+        }
+
+        char *end;
+        double number = strtod(_text.c_str() + _pos, &end);
+        if (end == _text.c_str() + _pos) {
+            return false;
+        }
+        _pos = end - _text.c_str();
+        values[key] = number;
+        return true;
+    }
+
+    const std::string &_text;
+    size_t _pos;
+};
+
+static bool _readResults(const char *filename, std::map<std::string, double> &values)
+{
+    FILE *file = fopen(filename, "r");
+    std::string text;
+    char buffer[4096];
+    size_t bytesRead;
+
+    if (file == NULL) {
+        fprintf(stderr, "ERROR opening %s\n", filename);
+        return false;
+    }
+    while ((bytesRead = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        text.append(buffer, bytesRead);
+    }
+    fclose(file);
+
+    if (JSONReader(text).read(values) == false) {
+        fprintf(stderr, "ERROR parsing %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+static bool _endsWith(const std::string &string, const char *suffix)
+{
+    size_t length = strlen(suffix);
+    return string.size() >= length && string.compare(string.size() - length, length, suffix) == 0;
+}
+
+/**
+ * Diffs two runs, fails if any cost grew more than the threshold.
+ *
+ * Timings only count as regressions when the change is also above the
+ * noise of the runs, twice the standard error of both sets of samples.
+ * The spread statistics are not compared, counters and memory are
+ */
+static int _compare(const char *baseFile, const char *newFile, double threshold)
+{
+    std::map<std::string, double> base, current;
+    uint32_t regressions = 0;
+
+    if (_readResults(baseFile, base) == false || _readResults(newFile, current) == false) {
+        return 2;
+    }
+
+    if (base["width"] != current["width"] || base["height"] != current["height"] || base["frames"] != current["frames"]) {
+        printf("WARNING the runs have different settings\n");
+    }
+
+    printf("%-60s %14s %14s %9s\n", "metric", "base", "new", "change");
+    for (std::map<std::string, double>::iterator it = base.begin(); it != base.end(); ++it) {
+        const std::string &key = it->first;
+        std::map<std::string, double>::iterator other = current.find(key);
+
+        if (other == current.end() || key.compare(0, 7, "scenes.") != 0 || _endsWith(key, ".frames") || _endsWith(key, ".min") ||
+            _endsWith(key, ".max") || _endsWith(key, ".stddev")) {
+            continue;
+        }
+
+        double delta = other->second - it->second;
+        double change = it->second != 0.0 ? 100.0 * delta / it->second : (other->second != 0.0 ? 100.0 : 0.0);
+        bool regression = change > threshold;
+
+        if (_endsWith(key, ".mean") || _endsWith(key, ".p50") || _endsWith(key, ".p95") || _endsWith(key, ".p99")) {
+            std::string summary = key.substr(0, key.rfind('.'));
+            std::string frames = key.substr(0, key.find('.', 7)) + ".frames";
+            double baseError = base[summary + ".stddev"] / sqrt(base[frames] > 1.0 ? base[frames] : 1.0);
+            double newError = current[summary + ".stddev"] / sqrt(current[frames] > 1.0 ? current[frames] : 1.0);
+
+            regression = regression && delta > 2.0 * sqrt(baseError * baseError + newError * newError);
+        }
+
+        printf("%-60s %14.4f %14.4f %+8.2f%%%s\n", key.c_str() + 7, it->second, other->second, change, regression ? " REGRESSION" : "");
+        regressions += regression;
+    }
+
+    for (std::map<std::string, double>::iterator it = current.begin(); it != current.end(); ++it) {
+        if (it->first.compare(0, 7, "scenes.") == 0 && base.count(it->first) == 0) {
+            printf("%-60s %14s %14.4f\n", it->first.c_str() + 7, "-", it->second);
+        }
+    }
+
+    printf("\n%u regressions over %.1f%%\n", regressions, threshold);
+    return regressions == 0 ? 0 : 1;
+}
+
+static void _usage(void)
+{
+    fprintf(stderr, "Deterministic scene benchmark\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "    bench [options] [scene...]\n");
+    fprintf(stderr, "    bench compare <base.json> <new.json> [threshold]\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "scene      - shadows, hdr, procedural, terrain, noaa, msaa, ssaa, fxaa or fxaa2, all by default\n");
+    fprintf(stderr, "-f frames  - Frames measured, 300 by default\n");
+    fprintf(stderr, "-w frames  - Frames rendered before measuring, 30 by default\n");
+    fprintf(stderr, "-r WxH     - Resolution, 1280x720 by default\n");
+    fprintf(stderr, "-o file    - JSON results, bench.json by default\n");
+    fprintf(stderr, "-t prefix  - Also export a Chrome trace per scene to <prefix>.<scene>.json\n");
+    fprintf(stderr, "--windowed - Render on a window instead of offscreen\n");
+    fprintf(stderr, "threshold  - Change in percent considered a regression, 5 by default\n");
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    Options options = {1280, 720, 300, 30, true, "bench.json", ""};
+    std::vector<std::string> scenes;
+
+    if (argc >= 2 && strcmp(argv[1], "compare") == 0) {
+        if (argc < 4) {
+            _usage();
+            return 2;
+        }
+        return _compare(argv[2], argv[3], argc > 4 ? atof(argv[4]) : 5.0);
+    }
+
+#if !defined(__linux__)
+    options.headless = false;
+#endif
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-f" && hasValue) {
+            options.frames = atoi(argv[++i]);
+        } else if (arg == "-w" && hasValue) {
+            options.warmup = atoi(argv[++i]);
+        } else if (arg == "-r" && hasValue) {
+            if (sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2) {
+                _usage();
+                return 2;
+            }
+        } else if (arg == "-o" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "-t" && hasValue) {
+            options.trace = argv[++i];
+        } else if (arg == "--windowed") {
+            options.headless = false;
+        } else if (arg == "all") {
+            scenes.assign(_sceneNames, _sceneNames + sizeof _sceneNames / sizeof *_sceneNames);
+        } else if (std::find(_sceneNames, _sceneNames + sizeof _sceneNames / sizeof *_sceneNames, arg) !=
+                   _sceneNames + sizeof _sceneNames / sizeof *_sceneNames) {
+            scenes.push_back(arg);
+        } else {
+            _usage();
+            return 2;
+        }
+    }
+
+    if (options.frames == 0) {
+        _usage();
+        return 2;
+    }
+    if (scenes.empty()) {
+        scenes.assign(_sceneNames, _sceneNames + sizeof _sceneNames / sizeof *_sceneNames);
+    }
+
+    return _run(scenes, options);
+}
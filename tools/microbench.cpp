@@ -0,0 +1,1188 @@
+/**
+ * @file    microbench.cpp
+ * @brief   Microbenchmarks of the CPU kernels of the engine.
+ *
+ *          Each kernel runs with a set of problem sizes. The number of runs
+ *          per sample is calibrated so that a sample lasts long enough for
+ *          the clock resolution not to matter, then after a warm-up sample
+ *          many samples are taken. The reported cost per operation is the
+ *          median of the samples with its median absolute deviation, both
+ *          robust against the odd sample disturbed by the OS, along with the
+ *          mean, standard deviation, minimum and 95th percentile.
+ *
+ *          The kernels only need the CPU, no OpenGL context is created, so
+ *          this tool runs anywhere the engine library links. The results
+ *          are printed as a table and can also be written as JSON.
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <random>
+#include <string>
+#include <vector>
+#include "Asset3D.hpp"
+#include "Asset3DLoaders.hpp"
+#include "Asset3DStorage.hpp"
+#include "Asset3DTransform.hpp"
+#include "Camera.hpp"
+#include "ChunkedTerrain.hpp"
+#include "FrustumCulling.hpp"
+#include "MathUtils.hpp"
+#include "Model3D.hpp"
+#include "OpenGLShader.hpp"
+#include "ProceduralUtils.hpp"
+#include "Scene.hpp"
+#include "Terrain.hpp"
+#include "TransformStore.hpp"
+#include "ZCompression.hpp"
+
+#define PI 3.14159265358979323846
+
+/**
+ * Options of a run
+ */
+struct Options {
+    uint32_t samples;            /**< Samples measured per kernel and size */
+    double sampleTime;           /**< Minimum duration of a sample in milliseconds */
+    std::vector<uint32_t> sizes; /**< Sizes replacing the default ones of the kernels, if any */
+    std::string output;          /**< JSON results, none if empty */
+};
+
+/**
+ * Results of a kernel are accumulated here so the compiler cannot discard
+ * the work done
+ */
+static volatile double _sink = 0.0;
+
+static void _consume(double value) { _sink = _sink + value; }
+static double _clockNanoseconds(void)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Creates an asset with a sphere of about 'vertices' vertices, as
+ * Procedural::Sphere does
+ */
+static Asset3D *_newSphereAsset(uint32_t vertices)
+{
+    Asset3D *asset = Asset3D::New();
+    uint32_t side = (uint32_t)sqrt((double)vertices);
+
+    side = side < 3 ? 3 : side;
+    Procedural::AppendBentPlane(*asset, (float)(2.0f * PI), 2.0f, (float)(2.0f * PI), 0.0f, (float)(2.0f * PI), side + 1, side, true);
+    Asset3DTransform::Translate(*asset, glm::vec3(0.0f, -1.0f, 0.0f));
+    Asset3DTransform::SetUniqueMaterialFromColor(*asset, glm::vec3(0.8f, 0.2f, 0.2f));
+    return asset;
+}
+
+/**
+ * Temporary file name for the kernels writing to disk
+ */
+static std::string _tempName(const char *name)
+{
+    const char *dir = getenv("TMPDIR");
+    return std::string(dir != NULL ? dir : "/tmp") + "/microbench-" + std::to_string(getpid()) + "-" + name;
+}
+
+/**
+ * Base class of the kernels. setup() prepares the data for a size, run()
+ * executes the kernel once over that data and teardown() releases it
+ */
+class Microbenchmark
+{
+  public:
+    Microbenchmark(const char *name, const char *unit, const std::vector<uint32_t> &sizes)
+        : _name(name), _unit(unit), _sizes(sizes), _ops(1)
+    {
+    }
+    virtual ~Microbenchmark() {}
+    const char *getName() const { return _name; }
+    /**
+     * What an operation is, e.g. "object" or "byte"
+     */
+    const char *getUnit() const { return _unit; }
+    /**
+     * Default problem sizes
+     */
+    const std::vector<uint32_t> &getSizes() const { return _sizes; }
+    /**
+     * Number of operations done by every run() for the size being measured
+     */
+    uint64_t getOps() const { return _ops; }
+    /**
+     * Prepares the data of the kernel
+     *
+     * @param size  Problem size
+     *
+     * @return true or false
+     */
+    virtual bool setup(uint32_t size) = 0;
+
+    /**
+     * Runs the kernel once
+     */
+    virtual void run(void) = 0;
+
+    /**
+     * Releases the data of the kernel
+     */
+    virtual void teardown(void) {}
+  protected:
+    const char *_name;            /**< Name of the kernel */
+    const char *_unit;            /**< Name of the operations counted */
+    std::vector<uint32_t> _sizes; /**< Default problem sizes */
+    uint64_t _ops;                /**< Operations done by every run() */
+};
+
+/**
+ * Exposes the bounding volume methods of Model3D
+ */
+class BoundsModel3D : public Model3D
+{
+  public:
+    BoundsModel3D(Asset3D *asset) : Model3D(asset) {}
+    using Model3D::_calculateBoundingVolumes;
+    using Object3D::_updateBoundingVolumes;
+    const BoundingBox &getCurrentAABB() const { return _aabb; }
+};
+
+/**
+ * Scatters 'count' models sharing one asset over a cube in front of the
+ * camera, a part of them outside the frustum
+ */
+class ObjectsMicrobenchmark : public Microbenchmark
+{
+  public:
+    ObjectsMicrobenchmark(const char *name) : Microbenchmark(name, "object", {100, 1000, 10000, 100000}), _asset(NULL) {}
+    bool setup(uint32_t size)
+    {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+        std::uniform_real_distribution<float> angle(0.0f, (float)(2.0f * PI));
+
+        _asset = _newSphereAsset(400);
+        _models.resize(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            _models[i] = new BoundsModel3D(_asset);
+            _models[i]->setPosition(glm::vec3(position(random), position(random), position(random)));
+            _models[i]->setOrientation(glm::rotate(angle(random), glm::vec3(0.0f, 1.0f, 0.0f)));
+            _models[i]->getBoundingSphere();
+        }
+
+        _camera.setProjection(1280.0f, 720.0f, 0.1f, 250.0f);
+        _camera.setPosition(glm::vec3(0.0f, 0.0f, 0.0f));
+        _camera.lookAt(glm::vec3(0.0f, 0.0f, -1.0f));
+
+        _ops = size;
+        return true;
+    }
+    void teardown(void)
+    {
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            delete _models[i];
+        }
+        _models.clear();
+        Asset3D::Delete(_asset);
+    }
+
+  protected:
+    Asset3D *_asset;                      /**< Geometry shared by all the models */
+    std::vector<BoundsModel3D *> _models; /**< Models scattered around */
+    Camera _camera;                       /**< Camera looking at the models */
+};
+
+/**
+ * Camera::recalculateFrustum() once and Camera::isObjectVisible() for each object
+ */
+class FrustumMicrobenchmark : public ObjectsMicrobenchmark
+{
+  public:
+    FrustumMicrobenchmark() : ObjectsMicrobenchmark("camera.frustumCulling") {}
+    void run(void)
+    {
+        uint32_t visible = 0;
+
+        _camera.recalculateFrustum();
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            visible += _camera.isObjectVisible(*_models[i]);
+        }
+        _consume(visible);
+    }
+};
+
+/**
+ * FrustumCulling::Cull() or FrustumCulling::CullScalar() of the bounds of
+ * the objects
+ */
+class CullingMicrobenchmark : public ObjectsMicrobenchmark
+{
+  public:
+    CullingMicrobenchmark(bool simd) : ObjectsMicrobenchmark(simd ? "culling.simd" : "culling.scalar"), _simd(simd) {}
+    bool setup(uint32_t size)
+    {
+        if (ObjectsMicrobenchmark::setup(size) == false) {
+            return false;
+        }
+
+        _bounds.clear();
+        for (uint32_t i = 0; i < size; ++i) {
+            const BoundingBox &aabb = _models[i]->getAABB();
+            _bounds.add(_models[i]->getPosition(), _models[i]->getBoundingSphere().getRadius(), aabb.getMin(), aabb.getMax());
+        }
+        _visible.resize(_bounds.getMaskWords());
+        return true;
+    }
+    void run(void)
+    {
+        uint32_t visible = 0;
+
+        _camera.recalculateFrustum();
+        if (_simd) {
+            FrustumCulling::Cull(_camera.getFrustumPlanes(), _bounds, _visible.data());
+        } else {
+            FrustumCulling::CullScalar(_camera.getFrustumPlanes(), _bounds, _visible.data());
+        }
+        for (uint32_t i = 0; i < _visible.size(); ++i) {
+            visible += _visible[i];
+        }
+        _consume(visible);
+    }
+
+  private:
+    bool _simd;                     /**< Whether the SIMD or the scalar kernel is measured */
+    CullingBounds _bounds;          /**< Bounds of the objects */
+    std::vector<uint32_t> _visible; /**< Visibility bitmask */
+};
+
+/**
+ * Object3D::_updateBoundingVolumes() for each object
+ */
+class UpdateBoundsMicrobenchmark : public ObjectsMicrobenchmark
+{
+  public:
+    UpdateBoundsMicrobenchmark() : ObjectsMicrobenchmark("object3d.updateBoundingVolumes") {}
+    void run(void)
+    {
+        float sum = 0.0f;
+
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            _models[i]->_updateBoundingVolumes();
+            sum += _models[i]->getCurrentAABB().getMax().x;
+        }
+        _consume(sum);
+    }
+};
+
+/**
+ * Moves all the objects and reads their model matrix, normal matrix and
+ * AABB, either updating each object on access or with the objects attached
+ * to a TransformStore updated in one batch, see tests/TransformTests.cpp
+ */
+class TransformMicrobenchmark : public ObjectsMicrobenchmark
+{
+  public:
+    TransformMicrobenchmark(bool store) : ObjectsMicrobenchmark(store ? "transform.store" : "transform.object3d"), _useStore(store) {}
+    bool setup(uint32_t size)
+    {
+        if (ObjectsMicrobenchmark::setup(size) == false) {
+            return false;
+        }
+        if (_useStore) {
+            for (uint32_t i = 0; i < size; ++i) {
+                _store.attach(*_models[i]);
+            }
+            _store.update();
+        }
+        return true;
+    }
+    void run(void)
+    {
+        float sum = 0.0f;
+
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            _models[i]->move(glm::vec3(0.0f, (i & 1) ? 1.0f : -1.0f, 0.0f));
+        }
+        if (_useStore) {
+            _store.update();
+        }
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            sum += _models[i]->getModelMatrix()[3].y + _models[i]->getNormalMatrix()[1].y + _models[i]->getAABB().getMax().x;
+        }
+        _consume(sum);
+    }
+
+  private:
+    bool _useStore;        /**< Whether the objects are attached to _store */
+    TransformStore _store; /**< Store of the objects */
+};
+
+/**
+ * Vehicles with 40 parts attached each. Every run moves one vehicle out of
+ * ten and reads the subtree bounds of all of them, so only the moved
+ * subtrees are recalculated
+ */
+class HierarchyMicrobenchmark : public Microbenchmark
+{
+  public:
+    HierarchyMicrobenchmark(bool store)
+        : Microbenchmark(store ? "hierarchy.store" : "hierarchy.object3d", "vehicle", {10, 100, 1000}), _useStore(store), _asset(NULL),
+          _scene(NULL), _frame(0)
+    {
+    }
+    bool setup(uint32_t size)
+    {
+        _asset = _newSphereAsset(100);
+        _scene = new Scene();
+        _scene->useTransformStore(_useStore);
+        _vehicles.clear();
+
+        for (uint32_t i = 0; i < size; ++i) {
+            Model3D *vehicle = _newModel("vehicle", i);
+
+            vehicle->setPosition(glm::vec3(i * 10.0f, 0.0f, 0.0f));
+            vehicle->setOrientation(glm::rotate((float)i, glm::vec3(0.0f, 1.0f, 0.0f)));
+            vehicle->setScaleFactor(glm::vec3(2.0f, 2.0f, 2.0f));
+            _vehicles.push_back(vehicle);
+
+            for (uint32_t j = 0; j < PartsPerVehicle; ++j) {
+                Model3D *part = _newModel("part", i * PartsPerVehicle + j);
+
+                part->setPosition(glm::vec3((float)(j % 8) - 4.0f, 1.0f, (float)(j / 8) - 2.0f));
+                part->setScaleFactor(glm::vec3(0.25f, 0.25f, 0.25f));
+                _scene->setParent(part, vehicle);
+            }
+        }
+        _scene->getTransformStore().update();
+
+        _ops = size;
+        return true;
+    }
+    void run(void)
+    {
+        float sum = 0.0f;
+
+        for (uint32_t i = _frame++ % 10; i < _vehicles.size(); i += 10) {
+            _vehicles[i]->move(glm::vec3(0.0f, (_frame & 1) ? 1.0f : -1.0f, 0.0f));
+        }
+        _scene->getTransformStore().update();
+
+        for (uint32_t i = 0; i < _vehicles.size(); ++i) {
+            sum += _vehicles[i]->getSubtreeAABB().getMax().y;
+        }
+        _consume(sum);
+    }
+    void teardown(void)
+    {
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            delete _models[i];
+        }
+        _models.clear();
+        delete _scene;
+        Asset3D::Delete(_asset);
+    }
+
+  private:
+    static const uint32_t PartsPerVehicle = 40;
+
+    Model3D *_newModel(const char *prefix, uint32_t index)
+    {
+        char name[64];
+        Model3D *model = new Model3D(_asset);
+
+        snprintf(name, sizeof(name), "%s%u", prefix, index);
+        _scene->add(name, model);
+        _models.push_back(model);
+        return model;
+    }
+
+    bool _useStore;                   /**< Whether the objects are attached to the transform store of the scene */
+    Asset3D *_asset;                  /**< Geometry shared by all the models */
+    Scene *_scene;                    /**< Scene with the hierarchies */
+    std::vector<Model3D *> _models;   /**< Vehicles and parts */
+    std::vector<Model3D *> _vehicles; /**< Roots of the hierarchies */
+    uint32_t _frame;                  /**< Runs done, selects the vehicles moved */
+};
+
+/**
+ * Scene lookups of models by name or by handle, in a scene where half of the
+ * models were removed and added again, see tests/SceneTests.cpp
+ */
+class SceneLookupMicrobenchmark : public Microbenchmark
+{
+  public:
+    SceneLookupMicrobenchmark(bool byName)
+        : Microbenchmark(byName ? "scene.getModelByName" : "scene.getModelByHandle", "lookup", {100, 10000, 100000}), _byName(byName),
+          _scene(NULL)
+    {
+    }
+    bool setup(uint32_t size)
+    {
+        char name[64];
+
+        _scene = new Scene();
+        _models.resize(size);
+        _handles.resize(size);
+        _names.resize(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            snprintf(name, sizeof(name), "M3D_model%u", i);
+            _names[i] = name;
+            _models[i] = new Model3D((Asset3D *)NULL);
+            _handles[i] = _scene->add(_names[i], _models[i]);
+        }
+
+        /* Remove the odd ones and add them again, the slots are reused with
+         * a new generation */
+        for (uint32_t i = 1; i < size; i += 2) {
+            _scene->remove(_handles[i]);
+        }
+        for (uint32_t i = 1; i < size; i += 2) {
+            _handles[i] = _scene->add(_names[i], _models[i]);
+        }
+
+        _ops = size;
+        return true;
+    }
+    void run(void)
+    {
+        uintptr_t sum = 0;
+
+        if (_byName) {
+            for (uint32_t i = 0; i < _names.size(); ++i) {
+                sum += (uintptr_t)_scene->getModel(_names[i]);
+            }
+        } else {
+            for (uint32_t i = 0; i < _handles.size(); ++i) {
+                sum += (uintptr_t)_scene->getModel(_handles[i]);
+            }
+        }
+        _consume(sum);
+    }
+    void teardown(void)
+    {
+        for (uint32_t i = 0; i < _models.size(); ++i) {
+            delete _models[i];
+        }
+        _models.clear();
+        delete _scene;
+    }
+
+  private:
+    bool _byName;                             /**< Whether the models are looked up by name or by handle */
+    Scene *_scene;                            /**< Scene with the models */
+    std::vector<Model3D *> _models;           /**< Models of the scene */
+    std::vector<Scene::ModelHandle> _handles; /**< Handle of each model */
+    std::vector<std::string> _names;          /**< Name of each model */
+};
+
+/**
+ * Model3D::_calculateBoundingVolumes() of an asset without precomputed
+ * bounds, which loops all of its vertices
+ */
+class CalculateBoundsMicrobenchmark : public Microbenchmark
+{
+  public:
+    CalculateBoundsMicrobenchmark()
+        : Microbenchmark("model3d.calculateBoundingVolumes", "vertex", {1000, 16000, 256000}), _asset(NULL), _model(NULL)
+    {
+    }
+    bool setup(uint32_t size)
+    {
+        _asset = _newSphereAsset(size);
+        _model = new BoundsModel3D(_asset);
+        _ops = _asset->getNumVertices();
+        return true;
+    }
+    void run(void)
+    {
+        _asset->calculateBounds();
+        _model->_calculateBoundingVolumes();
+        _consume(_model->getCurrentAABB().getMax().x);
+    }
+    void teardown(void)
+    {
+        delete _model;
+        Asset3D::Delete(_asset);
+    }
+
+  private:
+    Asset3D *_asset;       /**< Geometry of the model */
+    BoundsModel3D *_model; /**< Model whose bounds are calculated */
+};
+
+/**
+ * Perlin::Octave() over a 64x64 grid, the size is the number of octaves
+ */
+class PerlinMicrobenchmark : public Microbenchmark
+{
+  public:
+    PerlinMicrobenchmark() : Microbenchmark("perlin.octave", "sample", {1, 4, 8}), _octaves(1) {}
+    bool setup(uint32_t size)
+    {
+        _octaves = size > 255 ? 255 : (uint8_t)size;
+        _ops = GridSize * GridSize;
+        return true;
+    }
+    void run(void)
+    {
+        double sum = 0.0;
+
+        for (uint32_t y = 0; y < GridSize; ++y) {
+            for (uint32_t x = 0; x < GridSize; ++x) {
+                sum += MathUtils::Perlin::Octave(x * 0.05, y * 0.05, 0.5, _octaves, 0.5);
+            }
+        }
+        _consume(sum);
+    }
+
+  private:
+    static const uint32_t GridSize = 64;
+
+    uint8_t _octaves; /**< Octaves sampled */
+};
+
+/**
+ * Perlin::octaveGrid() of a 256x256 tile, the size is the number of
+ * octaves, see tests/PerlinTests.cpp
+ */
+class PerlinGridMicrobenchmark : public Microbenchmark
+{
+  public:
+    PerlinGridMicrobenchmark() : Microbenchmark("perlin.octaveGrid", "sample", {1, 4, 8}), _perlin(7), _octaves(1) {}
+    bool setup(uint32_t size)
+    {
+        _octaves = size > 255 ? 255 : (uint8_t)size;
+        _ops = GridSize * GridSize;
+        _values.resize(GridSize * GridSize);
+        return true;
+    }
+    void run(void)
+    {
+        _perlin.octaveGrid(&_values[0], GridSize, GridSize, glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.05f, 0.0f, 0.0f),
+                           glm::vec3(0.0f, 0.0f, 0.05f), _octaves, 0.5f);
+        _consume(_values[GridSize + 1]);
+    }
+
+  private:
+    static const uint32_t GridSize = 256;
+
+    MathUtils::Perlin _perlin;  /**< Noise sampled */
+    uint8_t _octaves;           /**< Octaves sampled */
+    std::vector<float> _values; /**< Samples of the last run */
+};
+
+/**
+ * Procedural::Terrain of 'size' x 'size' vertices with 5 octaves
+ */
+class TerrainMicrobenchmark : public Microbenchmark
+{
+  public:
+    TerrainMicrobenchmark() : Microbenchmark("terrain.generate", "vertex", {256, 1024, 2048}), _size(2) {}
+    bool setup(uint32_t size)
+    {
+        _size = size;
+        _ops = size * size;
+        return true;
+    }
+    void run(void)
+    {
+        Procedural::Terrain *terrain = new Procedural::Terrain(500.0f, 500.0f, 700.0f, 0, glm::vec3(1.0f), _size, _size, 5, 0.5f);
+
+        _consume(terrain->getAsset3D()->getVertexData()[_size + 1].vertex.y);
+        Asset3D::Delete(terrain->getAsset3D());
+        delete terrain;
+    }
+
+  private:
+    uint32_t _size; /**< Vertices along each side */
+};
+
+/**
+ * Procedural::ChunkedTerrain::update() of a camera flying over the terrain
+ * without a renderer, the size is the view radius in tiles, see
+ * tests/TerrainTests.cpp
+ */
+class TerrainStreamMicrobenchmark : public Microbenchmark
+{
+  public:
+    TerrainStreamMicrobenchmark() : Microbenchmark("terrain.stream", "frame", {2, 4, 8}), _terrain(NULL), _frame(0) {}
+    bool setup(uint32_t size)
+    {
+        _terrain = new Procedural::ChunkedTerrain(_scene, NULL, 256.0f, 300.0f, 0, glm::vec3(1.0f), 32);
+        _terrain->setViewRadius(size);
+        _terrain->setLodDistance(256.0f);
+        _terrain->setUploadsPerFrame(1000);
+        _frame = 0;
+        _ops = 1;
+        return true;
+    }
+    void run(void)
+    {
+        _terrain->update(glm::vec3(_frame * 32.0f, 100.0f, _frame * 8.0f));
+        _consume(_terrain->getNumVisibleTiles());
+        ++_frame;
+    }
+    void teardown(void) { delete _terrain; }
+  private:
+    Scene _scene;                         /**< Scene of the tiles */
+    Procedural::ChunkedTerrain *_terrain; /**< Terrain streamed */
+    uint32_t _frame;                      /**< Frames run */
+};
+
+/**
+ * Asset3DTransform::RecalculateNormals() of a sphere
+ */
+class NormalsMicrobenchmark : public Microbenchmark
+{
+  public:
+    NormalsMicrobenchmark() : Microbenchmark("asset3d.recalculateNormals", "vertex", {1000, 16000, 256000}), _asset(NULL) {}
+    bool setup(uint32_t size)
+    {
+        _asset = _newSphereAsset(size);
+        _ops = _asset->getNumVertices();
+        return true;
+    }
+    void run(void)
+    {
+        Asset3DTransform::RecalculateNormals(*_asset);
+        _consume(_asset->getVertexData()[0].normal.x);
+    }
+    void teardown(void) { Asset3D::Delete(_asset); }
+  private:
+    Asset3D *_asset; /**< Sphere whose normals are recalculated */
+};
+
+/**
+ * Asset3DLoaders::LoadOBJ() of a generated grid of 'size' vertices
+ */
+class LoadOBJMicrobenchmark : public Microbenchmark
+{
+  public:
+    LoadOBJMicrobenchmark() : Microbenchmark("loaders.loadOBJ", "vertex", {1000, 16000, 256000}), _stdout(-1) {}
+    bool setup(uint32_t size)
+    {
+        uint32_t side = (uint32_t)sqrt((double)size);
+
+        side = side < 2 ? 2 : side;
+        _directory = _tempName("obj");
+        if (mkdir(_directory.c_str(), 0700) != 0) {
+            fprintf(stderr, "ERROR creating directory %s\n", _directory.c_str());
+            return false;
+        }
+
+        FILE *file = fopen((_directory + "/material.mtl").c_str(), "w");
+        if (file == NULL) {
+            return false;
+        }
+        fprintf(file, "newmtl Grid\nNs 10.0\nKa 0.1 0.1 0.1\nKd 0.8 0.8 0.8\nKs 0.5 0.5 0.5\n");
+        fclose(file);
+
+        file = fopen((_directory + "/geometry.obj").c_str(), "w");
+        if (file == NULL) {
+            return false;
+        }
+        fprintf(file, "mtllib material.mtl\no Grid\n");
+        for (uint32_t y = 0; y < side; ++y) {
+            for (uint32_t x = 0; x < side; ++x) {
+                float height = (float)MathUtils::Perlin::Noise(x * 0.1, y * 0.1, 0.5);
+                fprintf(file, "v %f %f %f\n", (float)x / side, height, (float)y / side);
+                fprintf(file, "vt %f %f\n", (float)x / side, (float)y / side);
+                fprintf(file, "vn 0.0 1.0 0.0\n");
+            }
+        }
+        fprintf(file, "usemtl Grid\n");
+        for (uint32_t y = 0; y < side - 1; ++y) {
+            for (uint32_t x = 0; x < side - 1; ++x) {
+                uint32_t a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+                fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, b, b, b);
+                fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", b, b, b, c, c, c, d, d, d);
+            }
+        }
+        fclose(file);
+
+        /* Load it once to validate it, then silence the message printed
+         * by every load */
+        Asset3D *asset = Asset3D::New();
+        bool loaded = Asset3DLoaders::LoadOBJ(*asset, _directory);
+        _ops = asset->getNumVertices();
+        Asset3D::Delete(asset);
+        if (loaded == false) {
+            return false;
+        }
+
+        fflush(stdout);
+        _stdout = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+        return true;
+    }
+    void run(void)
+    {
+        Asset3D *asset = Asset3D::New();
+
+        Asset3DLoaders::LoadOBJ(*asset, _directory);
+        _consume(asset->getNumIndices());
+        Asset3D::Delete(asset);
+    }
+    void teardown(void)
+    {
+        if (_stdout != -1) {
+            fflush(stdout);
+            dup2(_stdout, STDOUT_FILENO);
+            close(_stdout);
+            _stdout = -1;
+        }
+        unlink((_directory + "/geometry.obj").c_str());
+        unlink((_directory + "/material.mtl").c_str());
+        rmdir(_directory.c_str());
+    }
+
+  private:
+    std::string _directory; /**< Directory of the generated OBJ model */
+    int _stdout;            /**< Original stdout while it is silenced */
+};
+
+/**
+ * Asset3DStorage::Save() or Asset3DStorage::Load() of a sphere
+ */
+class StorageMicrobenchmark : public Microbenchmark
+{
+  public:
+    StorageMicrobenchmark(bool save)
+        : Microbenchmark(save ? "storage.save" : "storage.load", "vertex", {1000, 16000, 256000}), _save(save), _asset(NULL)
+    {
+    }
+    bool setup(uint32_t size)
+    {
+        _asset = _newSphereAsset(size);
+        _ops = _asset->getNumVertices();
+        _file = _tempName("asset");
+        return Asset3DStorage::Save(_file, *_asset);
+    }
+    void run(void)
+    {
+        if (_save) {
+            Asset3DStorage::Save(_file, *_asset);
+        } else {
+            Asset3D *asset = Asset3D::New();
+
+            Asset3DStorage::Load(_file, *asset);
+            _consume(asset->getNumVertices());
+            Asset3D::Delete(asset);
+        }
+    }
+    void teardown(void)
+    {
+        unlink(_file.c_str());
+        Asset3D::Delete(_asset);
+    }
+
+  private:
+    bool _save;        /**< Whether save or load is measured */
+    Asset3D *_asset;   /**< Sphere stored */
+    std::string _file; /**< Asset file */
+};
+
+/**
+ * ZCompression::Compress() or ZDecompression::Decompress() of vertex
+ * data with one codec, the size is in KiB
+ */
+class CompressionMicrobenchmark : public Microbenchmark
+{
+  public:
+    CompressionMicrobenchmark(const char *name, Codec::Type codec, bool compress)
+        : Microbenchmark(name, "byte", {64, 1024, 16384}), _codec(codec), _compress(compress)
+    {
+    }
+    bool setup(uint32_t size)
+    {
+        /* Vertex data of spheres, as compressible as the asset files */
+        Asset3D *asset = _newSphereAsset(16000);
+        const uint8_t *vertices = (const uint8_t *)asset->getVertexDataPtr();
+        size_t verticesSize = asset->getNumVertices() * sizeof(Asset3D::VertexData);
+
+        _data.resize((size_t)size * 1024);
+        for (size_t offset = 0; offset < _data.size(); offset += verticesSize) {
+            memcpy(&_data[offset], vertices, std::min(verticesSize, _data.size() - offset));
+        }
+        Asset3D::Delete(asset);
+
+        _output.resize(_data.size());
+        _ops = _data.size();
+        return ZCompression::Compress(_codec, &_data[0], _data.size(), _compressed);
+    }
+    void run(void)
+    {
+        if (_compress) {
+            ZCompression::Compress(_codec, &_data[0], _data.size(), _compressed);
+            _consume(_compressed.size());
+        } else {
+            ZDecompression::Decompress(&_compressed[0], _compressed.size(), &_output[0], _output.size());
+            _consume(_output[0]);
+        }
+    }
+    void teardown(void)
+    {
+        std::vector<uint8_t>().swap(_data);
+        std::vector<uint8_t>().swap(_compressed);
+        std::vector<uint8_t>().swap(_output);
+    }
+
+  private:
+    Codec::Type _codec;               /**< Codec of the blocks */
+    bool _compress;                   /**< Whether compression or decompression is measured */
+    std::vector<uint8_t> _data;       /**< Uncompressed data */
+    std::vector<uint8_t> _compressed; /**< Compressed data */
+    std::vector<uint8_t> _output;     /**< Decompressed data */
+};
+
+/**
+ * Shader with the uniforms map filled by hand instead of by a linked program
+ */
+class UniformsShader : public OpenGLShader
+{
+  public:
+    void setUniformNames(const std::vector<std::string> &names)
+    {
+        _uniformNames.clear();
+        for (uint32_t i = 0; i < names.size(); ++i) {
+            _uniformNames[names[i]] = i;
+        }
+    }
+};
+
+/**
+ * OpenGLShader::getUniformID() of every uniform of a shader with 'size'
+ * uniforms, named like the ones of the lighting shaders
+ */
+class UniformLookupMicrobenchmark : public Microbenchmark
+{
+  public:
+    UniformLookupMicrobenchmark() : Microbenchmark("shader.getUniformID", "lookup", {8, 32, 128})
+    {
+        /* The destructor deletes the program, which needs a context. This
+         * shader never has one, so it is never destroyed */
+        _shader = new UniformsShader();
+    }
+    bool setup(uint32_t size)
+    {
+        static const char *fields[] = {"position", "ambient", "diffuse", "specular", "attenuation", "direction", "cutoff"};
+
+        _names.resize(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            _names[i] = "uPointLight[" + std::to_string(i / 7) + "]." + fields[i % 7];
+        }
+        _shader->setUniformNames(_names);
+        _ops = size;
+        return true;
+    }
+    void run(void)
+    {
+        uint32_t sum = 0, id = 0;
+
+        for (uint32_t i = 0; i < _names.size(); ++i) {
+            _shader->getUniformID(_names[i], &id);
+            sum += id;
+        }
+        _consume(sum);
+    }
+
+  private:
+    UniformsShader *_shader;         /**< Shader whose uniforms are looked up */
+    std::vector<std::string> _names; /**< Names of the uniforms */
+};
+
+/**
+ * Statistics of the samples of a kernel, in nanoseconds per operation
+ */
+struct Result {
+    std::string name;
+    const char *unit;
+    uint32_t size;
+    uint64_t ops;
+    uint64_t runs;
+    uint32_t samples;
+    double median;
+    double mad;
+    double mean;
+    double stddev;
+    double min;
+    double p95;
+    uint32_t outliers;
+};
+
+static double _median(std::vector<double> &values)
+{
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+/**
+ * Time of 'runs' consecutive runs of the kernel in nanoseconds
+ */
+static double _sample(Microbenchmark &benchmark, uint64_t runs)
+{
+    double start = _clockNanoseconds();
+    for (uint64_t i = 0; i < runs; ++i) {
+        benchmark.run();
+    }
+    return _clockNanoseconds() - start;
+}
+
+static bool _measure(Microbenchmark &benchmark, uint32_t size, const Options &options, Result &result)
+{
+    if (benchmark.setup(size) == false) {
+        benchmark.teardown();
+        fprintf(stderr, "ERROR preparing %s with size %u\n", benchmark.getName(), size);
+        return false;
+    }
+
+    /* Calibrate the runs per sample, doubling them until a sample is long
+     * enough, which also warms up the caches and the branch predictors */
+    double target = options.sampleTime * 1e6;
+    uint64_t runs = 1;
+    double elapsed = _sample(benchmark, runs);
+
+    while (elapsed < target && runs < (1ull << 40)) {
+        runs = elapsed > target / 16.0 ? (uint64_t)ceil(runs * target / elapsed) : runs * 16;
+        elapsed = _sample(benchmark, runs);
+    }
+
+    /* Warm-up sample with the final number of runs */
+    _sample(benchmark, runs);
+
+    std::vector<double> samples(options.samples);
+    double perOp = 1.0 / ((double)runs * benchmark.getOps());
+
+    for (uint32_t i = 0; i < options.samples; ++i) {
+        samples[i] = _sample(benchmark, runs) * perOp;
+    }
+
+    result.name = benchmark.getName();
+    result.unit = benchmark.getUnit();
+    result.size = size;
+    result.ops = benchmark.getOps();
+    result.runs = runs;
+    result.samples = options.samples;
+
+    result.mean = 0.0;
+    for (uint32_t i = 0; i < samples.size(); ++i) {
+        result.mean += samples[i];
+    }
+    result.mean /= samples.size();
+    result.stddev = 0.0;
+    for (uint32_t i = 0; i < samples.size(); ++i) {
+        result.stddev += (samples[i] - result.mean) * (samples[i] - result.mean);
+    }
+    result.stddev = sqrt(result.stddev / samples.size());
+
+    /* Sorts the samples */
+    result.median = _median(samples);
+    result.min = samples[0];
+    result.p95 = samples[(size_t)(0.95 * (samples.size() - 1))];
+
+    /* Median absolute deviation, scaled to match the standard deviation of
+     * normally distributed samples. Samples further than three of them from
+     * the median are reported as outliers */
+    std::vector<double> deviations(samples.size());
+    for (uint32_t i = 0; i < samples.size(); ++i) {
+        deviations[i] = fabs(samples[i] - result.median);
+    }
+    result.mad = 1.4826 * _median(deviations);
+    result.outliers = 0;
+    for (uint32_t i = 0; i < samples.size(); ++i) {
+        result.outliers += fabs(samples[i] - result.median) > 3.0 * result.mad;
+    }
+
+    benchmark.teardown();
+    return true;
+}
+
+static bool _writeResults(const std::string &filename, const Options &options, const std::vector<Result> &results)
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR opening %s\n", filename.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\n  \"samples\": %u,\n  \"sampleTimeMs\": %.2f,\n  \"kernels\": {", options.samples, options.sampleTime);
+    for (uint32_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+
+        fprintf(file, "%s\n    \"%s/%u\": {\"unit\": \"%s\", \"ops\": %llu, \"runs\": %llu, \"outliers\": %u, ", i ? "," : "",
+                result.name.c_str(), result.size, result.unit, (unsigned long long)result.ops, (unsigned long long)result.runs,
+                result.outliers);
+        fprintf(file, "\"nsPerOp\": {\"median\": %.4f, \"mad\": %.4f, \"mean\": %.4f, \"stddev\": %.4f, \"min\": %.4f, \"p95\": %.4f}}",
+                result.median, result.mad, result.mean, result.stddev, result.min, result.p95);
+    }
+    fprintf(file, "\n  }\n}\n");
+
+    bool written = ferror(file) == 0;
+    if (fclose(file) != 0 || written == false) {
+        fprintf(stderr, "ERROR writing %s\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Formats a cost in nanoseconds with a readable unit
+ */
+static std::string _formatTime(double ns)
+{
+    char buffer[32];
+
+    if (ns >= 1e6) {
+        snprintf(buffer, sizeof buffer, "%.3f ms", ns / 1e6);
+    } else if (ns >= 1e3) {
+        snprintf(buffer, sizeof buffer, "%.3f us", ns / 1e3);
+    } else {
+        snprintf(buffer, sizeof buffer, "%.3f ns", ns);
+    }
+    return buffer;
+}
+
+static void _usage(void)
+{
+    fprintf(stderr, "Microbenchmarks of the CPU kernels\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "    microbench [options] [kernel...]\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "kernel     - Kernels whose name starts with it, all by default\n");
+    fprintf(stderr, "-l         - Lists the kernels and their default sizes\n");
+    fprintf(stderr, "-n samples - Samples per kernel and size, 30 by default\n");
+    fprintf(stderr, "-t ms      - Minimum duration of a sample, 10 by default\n");
+    fprintf(stderr, "-s sizes   - Comma separated sizes used instead of the default ones\n");
+    fprintf(stderr, "-o file    - Also write the results as JSON\n");
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    Options options = {30, 10.0, std::vector<uint32_t>(), ""};
+    std::vector<std::string> filters;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-l") {
+            list = true;
+        } else if (arg == "-n" && hasValue) {
+            options.samples = atoi(argv[++i]);
+        } else if (arg == "-t" && hasValue) {
+            options.sampleTime = atof(argv[++i]);
+        } else if (arg == "-s" && hasValue) {
+            for (char *size = strtok(argv[++i], ","); size != NULL; size = strtok(NULL, ",")) {
+                options.sizes.push_back(atoi(size));
+            }
+        } else if (arg == "-o" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg[0] != '-') {
+            filters.push_back(arg);
+        } else {
+            _usage();
+            return 2;
+        }
+    }
+
+    if (options.samples < 2 || options.sampleTime <= 0.0 ||
+        std::find(options.sizes.begin(), options.sizes.end(), 0u) != options.sizes.end()) {
+        _usage();
+        return 2;
+    }
+
+    std::vector<Microbenchmark *> benchmarks = {new FrustumMicrobenchmark(),
+                                                new CullingMicrobenchmark(false),
+                                                new CullingMicrobenchmark(true),
+                                                new UpdateBoundsMicrobenchmark(),
+                                                new TransformMicrobenchmark(false),
+                                                new TransformMicrobenchmark(true),
+                                                new HierarchyMicrobenchmark(false),
+                                                new HierarchyMicrobenchmark(true),
+                                                new SceneLookupMicrobenchmark(true),
+                                                new SceneLookupMicrobenchmark(false),
+                                                new CalculateBoundsMicrobenchmark(),
+                                                new PerlinMicrobenchmark(),
+                                                new PerlinGridMicrobenchmark(),
+                                                new TerrainMicrobenchmark(),
+                                                new TerrainStreamMicrobenchmark(),
+                                                new NormalsMicrobenchmark(),
+                                                new LoadOBJMicrobenchmark(),
+                                                new StorageMicrobenchmark(true),
+                                                new StorageMicrobenchmark(false),
+                                                new CompressionMicrobenchmark("zcompression.none", Codec::TYPE_NONE, true),
+                                                new CompressionMicrobenchmark("zcompression.zlib", Codec::TYPE_ZLIB, true),
+                                                new CompressionMicrobenchmark("zcompression.lz", Codec::TYPE_LZ, true),
+                                                new CompressionMicrobenchmark("zdecompression.none", Codec::TYPE_NONE, false),
+                                                new CompressionMicrobenchmark("zdecompression.zlib", Codec::TYPE_ZLIB, false),
+                                                new CompressionMicrobenchmark("zdecompression.lz", Codec::TYPE_LZ, false),
+                                                new UniformLookupMicrobenchmark()};
+    std::vector<Result> results;
+    bool failed = false;
+
+    if (list == false) {
+        printf("%-34s %8s %12s %12s %8s %12s %12s %9s\n", "kernel", "size", "unit", "median/op", "mad", "min/op", "p95/op", "outliers");
+    }
+
+    for (uint32_t i = 0; i < benchmarks.size(); ++i) {
+        Microbenchmark *benchmark = benchmarks[i];
+        bool selected = filters.empty();
+
+        for (uint32_t j = 0; j < filters.size(); ++j) {
+            selected |= strncmp(benchmark->getName(), filters[j].c_str(), filters[j].size()) == 0;
+        }
+        if (selected == false) {
+            continue;
+        }
+
+        const std::vector<uint32_t> &sizes = options.sizes.empty() ? benchmark->getSizes() : options.sizes;
+
+        if (list == true) {
+            printf("%-34s", benchmark->getName());
+            for (uint32_t j = 0; j < sizes.size(); ++j) {
+                printf(" %u", sizes[j]);
+            }
+            printf("\n");
+            continue;
+        }
+
+        for (uint32_t j = 0; j < sizes.size(); ++j) {
+            Result result;
+
+            if (_measure(*benchmark, sizes[j], options, result) == false) {
+                failed = true;
+                continue;
+            }
+            printf("%-34s %8u %12s %12s %7.2f%% %12s %12s %9u\n", result.name.c_str(), result.size, result.unit,
+                   _formatTime(result.median).c_str(), result.median > 0.0 ? 100.0 * result.mad / result.median : 0.0,
+                   _formatTime(result.min).c_str(), _formatTime(result.p95).c_str(), result.outliers);
+            fflush(stdout);
+            results.push_back(result);
+        }
+    }
+
+    for (uint32_t i = 0; i < benchmarks.size(); ++i) {
+        delete benchmarks[i];
+    }
+
+    if (options.output.empty() == false && _writeResults(options.output, options, results) == false) {
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -1,5 +1,7 @@
+#include <string.h>
 #include "Asset3DLoaders.hpp"
 #include "Asset3DStorage.hpp"
+#include "Asset3DTransform.hpp"
 #include "Logging.hpp"
 
 using namespace Logging;
@@ -9,24 +11,67 @@ int main(int argc, char **argv)
     if (argc < 3) {
         log("OBJ asset files to engine internal asset file converter\n\n");
         log("Usage:\n");
-        log("    OBJ2Engine <input_obj> <output_engine>\n");
+        log("    OBJ2Engine <input_obj> <output_engine> [-u] [-m] [-c] [-s <size>] [-g <codec>] [-d <codec>]\n");
         log("\n");
         log("input_obj: directory containing the geometry.obj, material.mtl and all textures files\n");
         log("output_engine: filename for the engine binary representation file\n");
+        log("-u: store the asset uncompressed so the geometry can be mapped directly from disk\n");
+        log("-m: store the mipmaps of the textures, so they are not generated at load time\n");
+        log("-c: block compress the textures (BC1, or BC3 for textures with alpha) including their mipmaps\n");
+        log("-s: maximum width and height of the textures, bigger ones are loaded at a reduced resolution\n");
+        log("-g: codec for the vertices and indices: none, zlib or lz (default lz)\n");
+        log("-d: codec for the materials and textures: none, zlib or lz (default lz)\n");
         log("\n");
         exit(1);
     }
 
+    Codec::Type geometryCodec = Codec::TYPE_LZ;
+    Codec::Type dataCodec = Codec::TYPE_LZ;
+    bool generateMipmaps = false;
+    bool compressTextures = false;
+    uint32_t maxTextureSize = 0;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "-u") == 0) {
+            geometryCodec = dataCodec = Codec::TYPE_NONE;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            generateMipmaps = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            compressTextures = true;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            maxTextureSize = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc && Codec::FromName(argv[i + 1], geometryCodec) == true) {
+            ++i;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc && Codec::FromName(argv[i + 1], dataCodec) == true) {
+            ++i;
+        } else {
+            log("ERROR unknown option %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
     Asset3D *asset = Asset3D::New();
 
-    if (Asset3DLoaders::LoadOBJ(*asset, argv[1]) == false) {
+    if (Asset3DLoaders::LoadOBJ(*asset, argv[1], maxTextureSize) == false) {
         log("ERROR opening input OBJ asset %s\n", argv[1]);
         exit(2);
     }
 
     log("Asset info", *asset);
 
-    if (Asset3DStorage::Save(argv[2], *asset) == false) {
+    /* Better for rendering and makes the geometry compress better */
+    Asset3DTransform::OptimizeVertexCache(*asset);
+
+    /* The mipmaps are built first so that the compressed ones reuse them */
+    if (generateMipmaps == true) {
+        Asset3DTransform::GenerateMipmaps(*asset);
+    }
+    if (compressTextures == true) {
+        Asset3DTransform::CompressTextures(*asset);
+    }
+
+    Codec::Type codecs[Asset3DStorage::SECTION_COUNT] = {geometryCodec, geometryCodec, dataCodec, dataCodec, dataCodec, dataCodec};
+
+    if (Asset3DStorage::Save(argv[2], *asset, codecs) == false) {
         log("ERROR storing asset to output file %s\n", argv[2]);
         exit(3);
     }
@@ -0,0 +1,148 @@
+/**
+ * @class AllocationTracker
+ * @brief Counts the heap allocations of the engine per subsystem and per frame,
+ *        to find allocation churn in the game loop.
+ *
+ *        The tracking is opt-in, the engine must be built with TRACK_ALLOCATIONS
+ *        defined (make TRACK_ALLOCATIONS=1). On glibc malloc(), calloc(), realloc(),
+ *        free() and the aligned variants are interposed, so operator new and the
+ *        C libraries (libpng, libjpeg, zlib, FreeType) are counted too. Elsewhere
+ *        the global operator new and delete are replaced instead.
+ *
+ *        Allocations are charged to the tag of the calling thread, set with an
+ *        AllocationScope. Frees are charged to the tag of the thread releasing the
+ *        memory, as the hooks have no room to remember who allocated it. The
+ *        allocations of the graphics driver inside the GL calls are charged to
+ *        TAG_DRIVER (see OpenGL.h), they are reported but left out of the frame
+ *        total and the budget, as the engine does not control them. Without
+ *        TRACK_ALLOCATIONS all the counters stay at zero
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class AllocationTracker
+{
+  public:
+    /**
+     * Subsystems the allocations are charged to
+     */
+    enum Tag { TAG_GENERAL = 0, TAG_RENDERER, TAG_LOADERS, TAG_CONSOLE, TAG_SCENE, TAG_DRIVER, TAG_COUNT };
+
+    /**
+     * Allocation statistics of a tag
+     */
+    struct Stats {
+        uint64_t allocations; /**< Number of allocations in the frame */
+        uint64_t frees;       /**< Number of frees in the frame */
+        uint64_t bytes;       /**< Bytes allocated in the frame */
+        uint64_t peakBytes;   /**< Highest number of bytes allocated in a single frame */
+    };
+
+    /**
+     * Returns whether the allocation hooks were built in
+     *
+     * @return true if the allocations are being tracked, false otherwise
+     */
+    static bool IsEnabled(void);
+
+    /**
+     * Sets the tag the allocations of the calling thread are charged to
+     *
+     * @param tag  New tag of the thread
+     *
+     * @return Previous tag of the thread
+     */
+    static Tag SetCurrentTag(Tag tag);
+
+    /**
+     * Returns the tag the allocations of the calling thread are charged to
+     *
+     * @return Current tag of the thread
+     */
+    static Tag GetCurrentTag(void);
+
+    /**
+     * Returns the printable name of a tag
+     *
+     * @param tag  Tag to name
+     *
+     * @return Name of the tag
+     */
+    static const char *GetTagName(Tag tag);
+
+    /**
+     * Closes the current frame, its statistics become available through
+     * GetFrameStats() and the counters start again from zero
+     *
+     * @return false if the frame exceeded the budget set with SetFrameBudget(),
+     *         true otherwise
+     */
+    static bool EndFrame(void);
+
+    /**
+     * Returns the statistics of a tag in the last closed frame
+     *
+     * @param tag  Tag to query
+     *
+     * @return Statistics of the tag
+     */
+    static const Stats &GetFrameStats(Tag tag);
+
+    /**
+     * Returns the statistics of the engine in the last closed frame
+     *
+     * @return Sum of the statistics of all the tags but TAG_DRIVER
+     */
+    static Stats GetFrameTotal(void);
+
+    /**
+     * Returns the number of bytes currently allocated
+     *
+     * @return Live bytes
+     */
+    static uint64_t GetLiveBytes(void);
+
+    /**
+     * Returns the highest number of bytes allocated at the same time
+     * during the last closed frame
+     *
+     * @return Peak of live bytes
+     */
+    static uint64_t GetFramePeakLiveBytes(void);
+
+    /**
+     * Sets the allocation budget of a frame, EndFrame() reports the frames
+     * exceeding it
+     *
+     * @param maxAllocations  Maximum number of allocations per frame, 0 for no limit
+     * @param maxBytes        Maximum number of bytes allocated per frame, 0 for no limit
+     */
+    static void SetFrameBudget(uint64_t maxAllocations, uint64_t maxBytes);
+
+    /**
+     * Returns the number of frames that exceeded the budget
+     *
+     * @return Frames over budget
+     */
+    static uint64_t GetFramesOverBudget(void);
+};
+
+/**
+ * Charges the allocations of the calling thread to a tag while the scope
+ * is alive, restoring the previous tag on exit
+ */
+class AllocationScope
+{
+  public:
+    AllocationScope(AllocationTracker::Tag tag) : _previous(AllocationTracker::SetCurrentTag(tag)) {}
+    ~AllocationScope() { AllocationTracker::SetCurrentTag(_previous); }
+  private:
+    AllocationScope(const AllocationScope &);
+    AllocationScope &operator=(const AllocationScope &);
+
+    AllocationTracker::Tag _previous; /**< Tag to restore */
+};
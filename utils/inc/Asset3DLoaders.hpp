@@ -55,10 +55,18 @@ class Asset3DLoaders
      * renderer can loop per material, and then for each material a list of indexed display
      * lists are provided.
      *
-     * @param model  The Asset3D where the data will be loaded into
-     * @param name   Path and name of the model in disk
+     * Both files are memory mapped and parsed in a single pass with no limit on the line
+     * length. Big geometry files are split in chunks at line boundaries that are parsed in
+     * parallel by the WorkerPool and merged afterwards in file order. The textures referenced
+     * by the materials are collected while parsing them and decoded in parallel afterwards,
+     * each file only once.
+     *
+     * @param model           The Asset3D where the data will be loaded into
+     * @param name            Path and name of the model in disk
+     * @param maxTextureSize  Maximum width and height of the textures, bigger ones are loaded
+     *                        at a reduced resolution. 0 loads them at their original size
      *
      * @return true of the model was loaded and false if it wasn't
      */
-    static bool LoadOBJ(Asset3D &asset, const std::string &name);
+    static bool LoadOBJ(Asset3D &asset, const std::string &name, uint32_t maxTextureSize = 0);
 };
@@ -2,35 +2,148 @@
  * @class Asset3DStorage
  * @brief Takes care of saving an existing in-memory model to disk and viceversa
  *
+ *        Assets are stored in a versioned container with the following layout:
+ *
+ *            * FileHeader: magic number, version, primitive type and precomputed
+ *              bounds of the geometry, plus the location of the section directory
+ *            * Sections payloads, each one starting at a 16-byte aligned offset
+ *            * Section directory: one SectionEntry per section with its type, codec,
+ *              offset and size in the file, and its size once decoded
+ *
+ *        Each section is encoded with its own Codec, compressed sections are split
+ *        in independent blocks by ZCompression. Compressed vertex and index
+ *        sections are filtered first by GeometryCodec. Sections stored with
+ *        Codec::TYPE_NONE can be used directly from a memory mapping of the file.
+ *        Files written before the container was introduced (version 1) have no
+ *        header and are loaded through a compatibility path.
+ *
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #pragma once
 
+#include <stdint.h>
 #include <string>
+#include <vector>
 #include "Asset3D.hpp"
+#include "ZCompression.hpp"
 
 class Asset3DStorage
 {
   public:
+    /**
+     * Identifies the file as an engine asset, "E3DA" in disk
+     */
+    static const uint32_t Magic = 0x41443345;
+
+    /**
+     * Current version of the container
+     */
+    static const uint16_t Version = 3;
+
+    /**
+     * Alignment in bytes of the sections payloads in the file
+     */
+    static const uint32_t SectionAlignment = 16;
+
+    /**
+     * Type of the data contained in a section
+     */
+    enum SectionType {
+        SECTION_VERTEX_DATA = 0,     /**< Asset3D::VertexData array */
+        SECTION_INDICES = 1,         /**< 16 or 32 bit indices, see SectionEntry::elementSize */
+        SECTION_INDICES_OFFSETS = 2, /**< uint32_t offsets of each rendering list */
+        SECTION_INDICES_COUNT = 3,   /**< uint32_t indices count of each rendering list */
+        SECTION_MATERIALS = 4,       /**< Material fields as consecutive floats */
+        SECTION_TEXTURES = 5,        /**< uint32_t width, height, Bpp, format and levels followed by the data, per texture.
+                                          Version 2 files only have width, height and Bpp */
+        SECTION_COUNT
+    };
+
+    /**
+     * Reversible transformation applied to a section payload before
+     * encoding it with its codec, see GeometryCodec
+     */
+    enum Filter {
+        FILTER_NONE = 0,     /**< Payload is encoded as it is */
+        FILTER_VERTICES = 1, /**< GeometryCodec::EncodeVertices() with SectionEntry::elementSize as stride */
+        FILTER_INDICES = 2   /**< GeometryCodec::EncodeIndices() with SectionEntry::elementSize as index size */
+    };
+
+    /**
+     * Header at the beginning of the file
+     */
+    struct FileHeader {
+        uint32_t magic;              /**< Must be Magic */
+        uint16_t version;            /**< Version of the container */
+        uint16_t primitiveType;      /**< Asset3D::PrimitiveType of the indices */
+        uint32_t numSections;        /**< Number of entries in the section directory */
+        uint32_t reserved;           /**< Must be 0 */
+        uint64_t directoryOffset;    /**< Offset of the section directory in the file */
+        float boundsMin[3];          /**< See Asset3D::getBoundsMin() */
+        float boundsMax[3];          /**< See Asset3D::getBoundsMax() */
+        float maxLengthVertex[3];    /**< See Asset3D::getMaxLengthVertex() */
+        uint32_t reserved2;          /**< Must be 0 */
+    };
+
+    /**
+     * Entry of the section directory
+     */
+    struct SectionEntry {
+        uint32_t type;        /**< SectionType */
+        uint16_t codec;       /**< Codec::Type used for the payload */
+        uint16_t filter;      /**< Filter applied to the payload before the codec */
+        uint64_t offset;      /**< Offset of the payload in the file */
+        uint64_t size;        /**< Size of the payload in the file */
+        uint64_t rawSize;     /**< Size of the payload once decoded */
+        uint32_t count;       /**< Number of elements in the section */
+        uint32_t elementSize; /**< Size of each element, for the sections where it applies */
+    };
+
     /**
      * Saves a Asset3D3D to disk with the given name
      *
      * @param name   Name of the model
      * @param model  Asset3D to be saved to disk
+     * @param codec  Codec used for all the sections. Use Codec::TYPE_NONE to allow the
+     *               geometry to be mapped when loading the file. Use
+     *               Asset3DTransform::OptimizeVertexCache() before to get smaller files
+     *
+     * @return true if the model was saved correctly or false
+     *         otherwise
+     */
+    static bool Save(const std::string &name, const Asset3D &model, Codec::Type codec = Codec::TYPE_LZ);
+
+    /**
+     * Saves a Asset3D3D to disk with the given name
+     *
+     * @param name    Name of the model
+     * @param model   Asset3D to be saved to disk
+     * @param codecs  Codec used for each SectionType
      *
      * @return true if the model was saved correctly or false
      *         otherwise
      */
-    static bool Save(const std::string &name, const Asset3D &model);
+    static bool Save(const std::string &name, const Asset3D &model, const Codec::Type (&codecs)[SECTION_COUNT]);
 
     /**
      * Loads a Asset3D3D from disk with the given name
      *
-     * @param name   Name of the model
-     * @param model  Asset3D to be loaded to disk
+     * @param name          Name of the model
+     * @param model         Asset3D to be loaded to disk
+     * @param mapGeometry   If true and the vertex and indices sections are not encoded,
+     *                      the geometry is not copied into the asset vectors but
+     *                      kept in a memory mapping of the file, accessible through
+     *                      Asset3D::getVertexDataPtr() and Asset3D::getIndexDataPtr()
      *
      * @return true if the model was loaded correctly or false
      *         otherwise
      */
-    static bool Load(const std::string &name, Asset3D &model);
+    static bool Load(const std::string &name, Asset3D &model, bool mapGeometry = false);
+
+  private:
+    /**
+     * Loads files written in version 1 of the format, which consists
+     * of a single zlib stream with no header
+     */
+    static bool _LoadV1(const std::string &name, Asset3D &model);
 };
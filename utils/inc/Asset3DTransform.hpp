@@ -7,6 +7,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <vector>
 #include "Asset3D.hpp"
 
 class Asset3DTransform
@@ -30,7 +31,8 @@ class Asset3DTransform
 
     /**
      * Appends one asset to other and recalculates the indices, the offsets
-     * and the indices count
+     * and the indices count. Assets whose geometry is mapped from disk or was
+     * released are rejected, see Asset3D::reloadCPUData()
      *
      * @param to            Model to append the data to
      * @param from          Model where the data is taken from
@@ -41,7 +43,8 @@ class Asset3DTransform
      * Appends one asset geometry to other and recalculates the indices, the offsets
      * and the indices count. The materials are not copied over. Typically used
      * to construct geometry without generating materials. At the end SetOnlyMaterial
-     * can be used to assign a single material to the generated asset
+     * can be used to assign a single material to the generated asset. Assets
+     * whose geometry is mapped from disk or was released are rejected
      *
      * @param to            Model to append the data to
      * @param from          Model where the data is taken from
@@ -77,4 +80,53 @@ class Asset3DTransform
      * @param asset  Model whose normals will be recalculated
      */
     static void RecalculateNormals(Asset3D &asset);
+
+    /**
+     * Generates an independent triangles list from the asset indices, along
+     * with the offsets and counts of each material range inside of the new list.
+     * Assets that are already made of triangles are copied as they are
+     *
+     * @param asset    Asset whose indices will be converted
+     * @param indices  Output triangles list
+     * @param offsets  Output offsets of each material range in the triangles list
+     * @param counts   Output number of indices of each material range in the triangles list
+     */
+    static void TriangulateIndices(const Asset3D &asset, std::vector<uint32_t> &indices, std::vector<uint32_t> &offsets,
+                                   std::vector<uint32_t> &counts);
+
+    /**
+     * Converts the asset primitive to independent triangles, updating the
+     * indices, offsets and counts arrays
+     *
+     * @param asset  Asset to be converted
+     */
+    static void ConvertToTriangles(Asset3D &asset);
+
+    /**
+     * Merges the identical vertices, reorders the triangles of each rendering
+     * list to make better use of the GPU post-transform vertex cache, and then
+     * the vertices in the order they are first used by the indices, so consecutive
+     * indices and vertices stay close to each other. Unused vertices are removed.
+     * The rendered geometry does not change. Only assets made of triangles get
+     * their triangles reordered
+     *
+     * @param asset  Asset to be optimized
+     */
+    static void OptimizeVertexCache(Asset3D &asset);
+
+    /**
+     * Block compresses the textures of the asset with their full mip chain,
+     * see TextureCodec::Compress()
+     *
+     * @param asset  Asset whose textures are compressed
+     */
+    static void CompressTextures(Asset3D &asset);
+
+    /**
+     * Builds the full mip chain of the uncompressed textures of the asset, see
+     * TextureCodec::GenerateMipmaps()
+     *
+     * @param asset  Asset whose textures get their mip chain
+     */
+    static void GenerateMipmaps(Asset3D &asset);
 };
@@ -0,0 +1,155 @@
+/**
+ * @class FrameArena
+ * @brief Linear allocator for the transient data of a frame: visibility lists,
+ *        light matrices and the like. Allocations just bump a pointer and are
+ *        never freed individually, the whole arena is reset at the end of the
+ *        frame. When a frame needs more memory than the arena has, new blocks
+ *        are chained and merged into a single one on the next reset, so after a
+ *        few frames the arena stops touching the general heap.
+ *
+ *        FrameAllocator and FrameVector allow the STL containers to use the
+ *        arena. Their contents must not outlive the frame and their destructors
+ *        are not called on reset, so only trivially destructible data must be
+ *        stored in them.
+ *
+ *        The arena is not thread safe, it must only be used from the rendering
+ *        thread
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <vector>
+
+class FrameArena
+{
+  public:
+    /**
+     * Frame arena factory
+     *
+     * @return Pointer to the frame arena
+     */
+    static FrameArena *GetInstance(void);
+
+    /**
+     * Frame arena disposal. All the memory handed out becomes invalid
+     */
+    static void DisposeInstance(void);
+
+    /**
+     * Allocates memory valid until the next reset()
+     *
+     * @param size       Size of the allocation in bytes
+     * @param alignment  Alignment of the allocation, must be a power of two
+     *
+     * @return Pointer to the memory
+     */
+    void *allocate(size_t size, size_t alignment = sizeof(void *) * 2);
+
+    /**
+     * Allocates and value initializes an array valid until the next reset()
+     *
+     * @param count  Number of elements
+     *
+     * @return Pointer to the first element
+     */
+    template <class T>
+    T *newArray(size_t count)
+    {
+        T *array = static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < count; ++i) {
+            new (array + i) T();
+        }
+        return array;
+    }
+
+    /**
+     * Releases all the allocations of the frame, merging the blocks used
+     * into a single one big enough for the whole frame
+     */
+    void reset(void);
+
+    /**
+     * Returns the number of bytes allocated since the last reset
+     *
+     * @return Bytes in use
+     */
+    size_t getUsed(void) const { return _used; }
+    /**
+     * Returns the number of bytes the arena can hand out without growing
+     *
+     * @return Capacity of the arena in bytes
+     */
+    size_t getCapacity(void) const { return _capacity; }
+  private:
+    FrameArena();
+    ~FrameArena();
+
+    /**
+     * Chains a new block able to hold at least 'size' bytes
+     *
+     * @param size  Minimum size of the block
+     */
+    void _grow(size_t size);
+
+    /**
+     * Block of memory of the arena
+     */
+    struct Block {
+        uint8_t *data; /**< Memory of the block */
+        size_t size;   /**< Size of the block in bytes */
+    };
+
+    static FrameArena *_frameArena; /**< Current frame arena */
+
+    std::vector<Block> _blocks; /**< Blocks of the arena, allocations are taken from the last one */
+    size_t _offset;             /**< Offset of the first free byte in the last block */
+    size_t _used;               /**< Bytes allocated since the last reset */
+    size_t _capacity;           /**< Total size of the blocks */
+};
+
+/**
+ * STL allocator taking its memory from the frame arena
+ */
+template <class T>
+class FrameAllocator
+{
+  public:
+    typedef T value_type;
+
+    template <class U>
+    struct rebind {
+        typedef FrameAllocator<U> other;
+    };
+
+    FrameAllocator() {}
+    template <class U>
+    FrameAllocator(const FrameAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t count) { return static_cast<T *>(FrameArena::GetInstance()->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+};
+
+template <class T, class U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &)
+{
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &)
+{
+    return false;
+}
+
+/**
+ * Vector living in the frame arena. Reserve its size up front whenever it
+ * is known, as the memory of the previous buffer is not reused on growth
+ */
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
@@ -0,0 +1,191 @@
+/**
+ * @class FrustumCulling
+ * @brief Frustum culling of many objects at once.
+ *
+ *        The bounds of the objects are packed in CullingBounds in groups of
+ *        8 objects, each group storing every component for the 8 of them
+ *        together, so the culling kernel tests 4 (SSE) or 8 (AVX) objects per
+ *        iteration against each plane and writes the result as a visibility
+ *        bitmask. The bounding sphere is tested first. Objects whose sphere
+ *        crosses a plane are then tested with their AABB, which fits most
+ *        objects tighter than the sphere.
+ *
+ *        The SIMD kernel tests the spheres against all the planes without
+ *        branches, which mispredict on scenes bigger than the branch history,
+ *        and collects the iterations with a visible sphere crossing a plane.
+ *        Their AABBs are tested in a second loop, kept apart from the spheres
+ *        so the AABBs of the rest are never read. The scalar kernel tests one
+ *        object at a time, starting with the plane that rejected it the last
+ *        time, as objects tend to be rejected by the same plane frame after
+ *        frame.
+ *
+ *        The SIMD path is chosen at compile time. AVX needs -mavx or
+ *        /arch:AVX, SSE is always available on x86-64. Other architectures
+ *        use the scalar kernel, which gives the same results
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * Bounds of a set of objects, in groups of CullingBounds::Lanes objects. The
+ * last group is padded with bounds that are always culled
+ */
+class CullingBounds
+{
+  public:
+    /**
+     * Widest SIMD path, the arrays are padded to a multiple of it
+     */
+    static const uint32_t Lanes = 8;
+
+    CullingBounds() : _size(0) {}
+    /**
+     * Removes all the bounds, keeping the memory. The plane coherency
+     * information is kept too, so the same objects should be added in the
+     * same order every frame
+     */
+    void clear(void) { _size = 0; }
+    /**
+     * Reserves memory for a number of bounds
+     *
+     * @param count  Number of bounds
+     */
+    void reserve(uint32_t count);
+
+    /**
+     * Adds the bounds of an object
+     *
+     * @param center   Center of the bounding sphere in world coordinates
+     * @param radius   Radius of the bounding sphere
+     * @param aabbMin  Minimum of the world AABB
+     * @param aabbMax  Maximum of the world AABB
+     *
+     * @return Index of the object in the visibility bitmask
+     */
+    uint32_t add(const glm::vec3 &center, float radius, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax);
+
+    /**
+     * Adds an object known to be culled, like the ones of a subtree already
+     * culled as a whole, so the indices of the rest do not change
+     *
+     * @return Index of the object in the visibility bitmask
+     */
+    uint32_t addCulled(void);
+
+    /**
+     * Replaces the bounds of an object
+     *
+     * @param index    Index returned by add()
+     * @param center   Center of the bounding sphere in world coordinates
+     * @param radius   Radius of the bounding sphere
+     * @param aabbMin  Minimum of the world AABB
+     * @param aabbMax  Maximum of the world AABB
+     */
+    void set(uint32_t index, const glm::vec3 &center, float radius, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax);
+
+    /**
+     * Number of objects
+     */
+    uint32_t size(void) const { return _size; }
+    /**
+     * Number of objects including the padding
+     */
+    uint32_t getPaddedSize(void) const { return (_size + Lanes - 1) / Lanes * Lanes; }
+    /**
+     * Number of 32 bit words of the visibility bitmask
+     */
+    uint32_t getMaskWords(void) const { return (_size + 31) / 32; }
+    friend class FrustumCulling;
+
+  private:
+    /**
+     * Grows the arrays to hold 'count' objects plus the padding
+     */
+    void _resize(uint32_t count);
+
+    /**
+     * Fills the padding after the last object with bounds that are always culled
+     */
+    void _pad(void);
+
+    /**
+     * Sets bounds that are always culled
+     */
+    void _setCulled(uint32_t index);
+
+    /**
+     * Position of a component of an object in _spheres or _boxes
+     *
+     * @param index       Index of the object
+     * @param component   Component, SPHERE_* or BOX_*
+     * @param components  SPHERE_COUNT or BOX_COUNT
+     */
+    static uint32_t _at(uint32_t index, uint32_t component, uint32_t components)
+    {
+        return (index / Lanes * components + component) * Lanes + index % Lanes;
+    }
+
+    enum { SPHERE_X = 0, SPHERE_Y, SPHERE_Z, SPHERE_RADIUS, SPHERE_COUNT };
+    enum { BOX_X = 0, BOX_Y, BOX_Z, BOX_EXTENT_X, BOX_EXTENT_Y, BOX_EXTENT_Z, BOX_COUNT };
+
+    /**
+     * Iteration of the SIMD kernel with visible spheres crossing a plane
+     */
+    struct Crossing {
+        uint32_t first; /**< First object of the iteration */
+        uint32_t lanes; /**< Bit set for each object crossing a plane */
+    };
+
+    std::vector<float> _spheres;     /**< Sphere centers and radii, each component of a group of Lanes objects together */
+    std::vector<float> _boxes;       /**< AABB centers and half extents, grouped like _spheres */
+    std::vector<uint8_t> _lastPlane; /**< Plane that rejected each object the last time, see CullScalar() */
+    std::vector<Crossing> _crossing; /**< Iterations whose AABBs have to be tested, scratch of Cull() */
+    uint32_t _size;                  /**< Number of objects */
+};
+
+class FrustumCulling
+{
+  public:
+    /**
+     * Number of planes of a frustum
+     */
+    static const uint32_t NumPlanes = 6;
+
+    /**
+     * Culls the objects against a frustum with the widest SIMD path available
+     *
+     * @param planes   Normalized planes of the frustum, pointing inwards, as
+     *                 calculated by Camera::recalculateFrustum()
+     * @param bounds   Bounds of the objects
+     * @param visible  Returns a bit set for each visible object, with
+     *                 bounds.getMaskWords() words
+     */
+    static void Cull(const glm::vec4 planes[NumPlanes], CullingBounds &bounds, uint32_t *visible);
+
+    /**
+     * Culls the objects against a frustum one at a time, same results as Cull()
+     *
+     * @param planes   Normalized planes of the frustum, pointing inwards
+     * @param bounds   Bounds of the objects
+     * @param visible  Returns a bit set for each visible object, with
+     *                 bounds.getMaskWords() words
+     */
+    static void CullScalar(const glm::vec4 planes[NumPlanes], CullingBounds &bounds, uint32_t *visible);
+
+    /**
+     * Returns the objects tested per iteration by Cull()
+     *
+     * @return 8 for AVX, 4 for SSE or 1 for the scalar kernel
+     */
+    static uint32_t GetLanes(void);
+
+    /**
+     * Returns whether an object is visible in a bitmask filled by Cull()
+     */
+    static bool IsVisible(const uint32_t *visible, uint32_t index) { return (visible[index / 32] & (1u << (index % 32))) != 0; }
+};
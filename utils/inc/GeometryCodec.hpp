@@ -0,0 +1,66 @@
+/**
+ * @class GeometryCodec
+ * @brief Reversible filters for vertex and index streams that make them
+ *        much easier to compress by a generic codec afterwards
+ *
+ *        Each stream is seen as a list of elements made of one or more
+ *        integer components. Every component is replaced by the zig-zag encoded
+ *        difference with the same component of the previous element, and
+ *        the result is transposed into byte planes: first the low bytes of
+ *        all the elements for the first component, then the next byte and
+ *        so on. Vertex floats are handled through their bit patterns, so the
+ *        filter is lossless.
+ *
+ *        Neighbour vertices and indices are similar, so most of the high
+ *        byte planes end up being long runs of zeroes. Indices benefit
+ *        the most after Asset3DTransform::OptimizeVertexCache()
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+
+class GeometryCodec
+{
+  public:
+    /**
+     * Filters a list of vertices
+     *
+     * @param vertices  Vertices to filter
+     * @param count     Number of vertices
+     * @param stride    Size of each vertex in bytes, must be a multiple of 4
+     * @param output    Buffer of count * stride bytes for the filtered data
+     */
+    static void EncodeVertices(const void *vertices, uint32_t count, uint32_t stride, uint8_t *output);
+
+    /**
+     * Reverts EncodeVertices()
+     *
+     * @param input     Filtered data
+     * @param count     Number of vertices
+     * @param stride    Size of each vertex in bytes, must be a multiple of 4
+     * @param vertices  Buffer of count * stride bytes for the vertices
+     */
+    static void DecodeVertices(const uint8_t *input, uint32_t count, uint32_t stride, void *vertices);
+
+    /**
+     * Filters a list of indices
+     *
+     * @param indices    Indices to filter
+     * @param count      Number of indices
+     * @param indexSize  Size of each index, 2 or 4 bytes
+     * @param output     Buffer of count * indexSize bytes for the filtered data
+     */
+    static void EncodeIndices(const void *indices, uint32_t count, uint32_t indexSize, uint8_t *output);
+
+    /**
+     * Reverts EncodeIndices()
+     *
+     * @param input      Filtered data
+     * @param count      Number of indices
+     * @param indexSize  Size of each index, 2 or 4 bytes
+     * @param indices    Buffer of count * indexSize bytes for the indices
+     */
+    static void DecodeIndices(const uint8_t *input, uint32_t count, uint32_t indexSize, void *indices);
+};
@@ -0,0 +1,182 @@
+/**
+ * @class HandlePool
+ * @brief Set of pointers referenced by generational handles.
+ *
+ *        The pointers are kept packed in one array, in no particular order, so
+ *        iterating them is as fast as iterating a vector. Removing one moves
+ *        the last into its place. Handles do not point into that array but to
+ *        a slot with the current position of the element and a generation
+ *        number, which is increased when the element is removed. A handle
+ *        stores the generation of its slot when the element was added, so a
+ *        handle to a removed element is detected even if the slot was reused
+ *        afterwards. Adding, removing and looking up elements, by handle or by
+ *        name, take constant time.
+ *
+ *        Elements may have a name, the names are unique within a pool
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "NameTable.hpp"
+
+/**
+ * Reference to an element of a HandlePool<T>. The null handle converts to
+ * false
+ */
+template <class T>
+class Handle
+{
+  public:
+    Handle() : _id(0) {}
+    explicit Handle(uint32_t id) : _id(id) {}
+    uint32_t getId(void) const { return _id; }
+    explicit operator bool() const { return _id != 0; }
+    bool operator==(const Handle &other) const { return _id == other._id; }
+    bool operator!=(const Handle &other) const { return _id != other._id; }
+  private:
+    uint32_t _id; /**< Generation in the upper bits and slot in the lower ones, 0 for the null handle */
+};
+
+template <class T>
+class HandlePool
+{
+  public:
+    /**
+     * Bits of the handle used for the slot, the rest hold the generation
+     */
+    static const uint32_t SlotBits = 20;
+
+    /**
+     * Maximum number of elements
+     */
+    static const uint32_t MaxElements = 1u << SlotBits;
+
+    /**
+     * Adds an element
+     *
+     * @param elem  Element to add
+     * @param name  Name of the element, optional
+     *
+     * @return Handle of the element, or the null handle if the name already
+     *         exists or the pool is full
+     */
+    Handle<T> add(T *elem, const std::string &name = std::string())
+    {
+        if (_elements.size() == MaxElements || (name.empty() == false && find(name))) {
+            return Handle<T>();
+        }
+
+        uint32_t slot;
+        if (_free.empty()) {
+            slot = (uint32_t)_generations.size();
+            _generations.push_back(1);
+            _positions.push_back(0);
+            _names.push_back(std::string());
+        } else {
+            slot = _free.back();
+            _free.pop_back();
+        }
+
+        Handle<T> handle((_generations[slot] << SlotBits) | slot);
+        if (name.empty() == false) {
+            _nameTable.insert(name, handle);
+        }
+
+        _positions[slot] = (uint32_t)_elements.size();
+        _names[slot] = name;
+        _elements.push_back(elem);
+        _slots.push_back(slot);
+        return handle;
+    }
+
+    /**
+     * Removes an element, invalidating its handle
+     *
+     * @param handle  Handle of the element
+     *
+     * @return true if the element was removed or false if the handle is not valid
+     */
+    bool remove(Handle<T> handle)
+    {
+        uint32_t slot = handle.getId() & (MaxElements - 1);
+        if (get(handle) == NULL) {
+            return false;
+        }
+
+        uint32_t position = _positions[slot];
+        uint32_t last = (uint32_t)_elements.size() - 1;
+
+        /* Move the last element into the free position */
+        _elements[position] = _elements[last];
+        _slots[position] = _slots[last];
+        _positions[_slots[position]] = position;
+        _elements.pop_back();
+        _slots.pop_back();
+
+        if (_names[slot].empty() == false) {
+            _nameTable.erase(_names[slot]);
+            _names[slot].clear();
+        }
+
+        /* The generation skips 0, so no handle is ever null */
+        _generations[slot] = (_generations[slot] + 1) & ((1u << (32 - SlotBits)) - 1);
+        if (_generations[slot] == 0) {
+            _generations[slot] = 1;
+        }
+        _free.push_back(slot);
+        return true;
+    }
+
+    /**
+     * Returns the element of a handle
+     *
+     * @param handle  Handle of the element
+     *
+     * @return The element or NULL if the handle is null or the element was removed
+     */
+    T *get(Handle<T> handle) const
+    {
+        uint32_t slot = handle.getId() & (MaxElements - 1);
+
+        if (slot >= _generations.size() || _generations[slot] != handle.getId() >> SlotBits) {
+            return NULL;
+        }
+        return _elements[_positions[slot]];
+    }
+
+    /**
+     * Returns the handle of a name
+     *
+     * @param name  Name of the element
+     *
+     * @return The handle or the null handle if the name does not exist
+     */
+    Handle<T> find(const std::string &name) const
+    {
+        Handle<T> handle;
+
+        _nameTable.find(name, handle);
+        return handle;
+    }
+
+    /**
+     * Packed array of the elements, invalidated by add() and remove()
+     */
+    std::vector<T *> &getElements(void) { return _elements; }
+    /**
+     * Number of elements
+     */
+    uint32_t size(void) const { return (uint32_t)_elements.size(); }
+  private:
+    std::vector<T *> _elements;         /**< Elements, packed */
+    std::vector<uint32_t> _slots;       /**< Slot of each element */
+    std::vector<uint32_t> _positions;   /**< Position in _elements of the element of each slot */
+    std::vector<uint32_t> _generations; /**< Current generation of each slot */
+    std::vector<std::string> _names;    /**< Name of the element of each slot, empty if none */
+    std::vector<uint32_t> _free;        /**< Slots not in use */
+    NameTable<Handle<T> > _nameTable;   /**< Handles of the named elements */
+};
@@ -2,6 +2,17 @@
  * @file    ImageLoader.h
  * @brief	Several image loader helpers
  *
+ *          The images are decoded straight into their final location, which is
+ *          provided by the caller once the size of the image is known: a heap
+ *          buffer, the data of a Texture or a mapped pixel buffer. Images are
+ *          always decoded into 8-bit RGB or RGBA texels.
+ *
+ *          A maximum dimension can be requested to load reduced versions of big
+ *          images, e.g. for previews or low end machines. JPEG images are scaled
+ *          by the DCT itself, which is much cheaper than a full decode, and PNG
+ *          images skip the rows and columns not needed. The reduction is by powers
+ *          of two, up to 1/8 for JPEG images
+ *
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #pragma once
@@ -9,9 +20,47 @@
 #include <stdint.h>
 #include <stdio.h>   // Because jpeg.h does not include it for FILE *sighs*
 #include <stdlib.h>  // Because jpeg.h does not include it for size_t *sighs*
+#include <functional>
 
 namespace ImageLoaders
 {
-int loadJPEG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel);
-int loadPNG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel);
+/**
+ * Provides the destination of a decoded image, it is called once the size of
+ * the image is known and must return a buffer of width * height * bytesPerPixel
+ * bytes, or NULL to abort the decoding
+ */
+typedef std::function<uint8_t *(uint32_t width, uint32_t height, uint32_t bytesPerPixel)> ImageAllocator;
+
+/**
+ * Decodes a JPEG image into the destination provided by 'allocate'
+ *
+ * @param filename      Path and name of the image
+ * @param allocate      Provides the destination of the image
+ * @param maxDimension  Maximum width and height of the decoded image, 0 for the original size
+ * @param width         Returns the width of the decoded image
+ * @param height        Returns the height of the decoded image
+ * @param bytesPerPixel Returns the bytes per texel of the decoded image
+ *
+ * @return 0 if the image was decoded, -1 otherwise
+ */
+int decodeJPEG(const char *filename, const ImageAllocator &allocate, uint32_t maxDimension, uint32_t *width, uint32_t *height,
+               uint32_t *bytesPerPixel);
+
+/**
+ * Decodes a PNG image into the destination provided by 'allocate'
+ *
+ * @see decodeJPEG()
+ */
+int decodePNG(const char *filename, const ImageAllocator &allocate, uint32_t maxDimension, uint32_t *width, uint32_t *height,
+              uint32_t *bytesPerPixel);
+
+/**
+ * Loads a JPEG image into a buffer allocated with malloc()
+ */
+int loadJPEG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel, uint32_t maxDimension = 0);
+
+/**
+ * Loads a PNG image into a buffer allocated with malloc()
+ */
+int loadPNG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel, uint32_t maxDimension = 0);
 };
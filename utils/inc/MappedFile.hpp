@@ -0,0 +1,67 @@
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a file. The whole file is mapped in
+ *        the process address space so it can be parsed or handed over
+ *        to other APIs without copying it into intermediate buffers
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+     * Maps the given file in memory. Any previously mapped file
+     * is unmapped first
+     *
+     * @param name  Path and name of the file in disk
+     *
+     * @return true if the file was mapped, false otherwise
+     */
+    bool open(const std::string &name);
+
+    /**
+     * Unmaps the file. The pointer returned by getData() is no longer
+     * valid after this call
+     */
+    void close();
+
+    /**
+     * Returns whether a file is currently mapped
+     *
+     * @return true if a file is mapped, false otherwise
+     */
+    bool isOpen() const { return _isOpen; }
+    /**
+     * Returns the start of the mapped file. Empty files return NULL
+     *
+     * @return Pointer to the first byte of the file
+     */
+    const uint8_t *getData() const { return _data; }
+    /**
+     * Returns the size of the mapped file
+     *
+     * @return Size in bytes of the file
+     */
+    size_t getSize() const { return _size; }
+  private:
+    /* Mappings cannot be shared between instances */
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const uint8_t *_data; /**< Start of the mapped file */
+    size_t _size;         /**< Size of the mapped file */
+    bool _isOpen;         /**< Whether a file is currently mapped */
+#if defined(_WIN32) || defined(_WIN64)
+    void *_file;    /**< Handle of the file */
+    void *_mapping; /**< Handle of the file mapping object */
+#endif
+};
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <glm/glm.hpp>
 
 namespace MathUtils
 {
@@ -17,11 +18,29 @@ float restrictAngle(float angle);
  *
  * https://flafla2.github.io/2014/08/09/perlinnoise.html
  *
- * including octaves noise
+ * including octaves noise.
+ *
+ * Each instance has its own permutation table, shuffled from a seed, and
+ * is not modified after construction, so it can be sampled from several
+ * threads at once. The static functions use a shared instance with seed 0,
+ * the permutation of the reference implementation.
+ *
+ * octaveGrid() samples a whole grid of coordinates in single precision.
+ * Its kernel evaluates 4 (SSE2) or 8 (AVX2) samples at once and the rows of
+ * the grid are split among the WorkerPool threads. AVX2 needs -mavx2 or
+ * /arch:AVX2, other architectures use a scalar kernel
  */
 class Perlin
 {
   public:
+    /**
+     * Constructor
+     *
+     * @param seed  Seed of the permutation table. Instances with the same seed
+     *              give the same noise
+     */
+    Perlin(uint32_t seed = 0);
+
     /**
      * Returns the perlin noise at the specified coordinate
      *
@@ -33,7 +52,7 @@ class Perlin
      *
      * @return Value between 0.0 and 1.0
      */
-    static double Noise(double x, double y, double z);
+    double noise(double x, double y, double z) const;
 
     /**
      * Returns the perlin noise at the specified location after sampling
@@ -53,23 +72,58 @@ class Perlin
      *
      * @return Value between 0.0 and 1.0
      */
+    double octave(double x, double y, double z, uint8_t octaves, double persistence) const;
+
+    /**
+     * Fills a grid with the octave perlin noise of a set of coordinates. The
+     * value of the grid at (row, column) is the noise at
+     * origin + row * rowStep + column * columnStep
+     *
+     * @param values       Grid to fill, rows * columns values stored by rows
+     * @param rows         Number of rows
+     * @param columns      Number of columns
+     * @param origin       Coordinate of the first value
+     * @param rowStep      Distance between the coordinates of two consecutive rows
+     * @param columnStep   Distance between the coordinates of two consecutive columns
+     * @param octaves      Number of octaves to sample, up to 255
+     * @param persistence  Persistance of each subsequent octave being sampled,
+     *                     with a value greater than 0.0
+     */
+    void octaveGrid(float *values, uint32_t rows, uint32_t columns, const glm::vec3 &origin, const glm::vec3 &rowStep,
+                    const glm::vec3 &columnStep, uint8_t octaves, float persistence) const;
+
+    /**
+     * Same as noise(), octave() and octaveGrid() with the shared instance
+     */
+    static double Noise(double x, double y, double z);
     static double Octave(double x, double y, double z, uint8_t octaves, double persistence);
+    static void OctaveGrid(float *values, uint32_t rows, uint32_t columns, const glm::vec3 &origin, const glm::vec3 &rowStep,
+                           const glm::vec3 &columnStep, uint8_t octaves, float persistence);
+
+    /**
+     * Returns the number of samples evaluated at once by octaveGrid()
+     */
+    static uint32_t GetLanes(void);
 
   private:
     /**
-     * Singleton accessor
+     * Minimum number of values of a grid to split it among the workers
      */
-    static Perlin *_getPerlin();
+    static const uint32_t ParallelThreshold = 16384;
 
     /**
-     * Constructor
+     * Shared instance, with seed 0
+     */
+    static const Perlin &_getPerlin();
+
+    /**
+     * Samples the octaves of one row of a grid
      */
-    Perlin();
+    void _octaveRow(float *values, uint32_t columns, const glm::vec3 &origin, const glm::vec3 &columnStep, uint8_t octaves,
+                    float persistence) const;
 
-    double _noise(double x, double y, double z);
-    double _octave(double x, double y, double z, uint8_t octaves, double persistence);
-    double _grad(uint8_t hash, double x, double y, double z);
-    double _fade(double v);
-    uint8_t *_perms;
+    static double _grad(int32_t hash, double x, double y, double z);
+    static double _fade(double v);
+    int32_t _perms[512]; /**< Permutation of [0, 255], repeated twice to avoid wrapping the indices */
 };
 }
@@ -0,0 +1,177 @@
+/**
+ * @class NameTable
+ * @brief Hash table from names to values with open addressing.
+ *
+ *        The entries live in a single array and collisions are solved with
+ *        linear probing, so a lookup usually reads one or two consecutive
+ *        entries. The hash of each name is kept in its entry and compared
+ *        before the name itself. Erasing shifts back the entries that follow,
+ *        so there are no tombstones and lookups never degrade after many
+ *        insertions and removals. The table doubles its size when it is more
+ *        than half full
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+template <class V>
+class NameTable
+{
+  public:
+    NameTable() : _size(0) {}
+    /**
+     * Adds a name
+     *
+     * @param name   Name of the value
+     * @param value  Value
+     *
+     * @return true if the name was added or false if it already exists
+     */
+    bool insert(const std::string &name, const V &value)
+    {
+        if ((_size + 1) * 2 > _entries.size()) {
+            _grow();
+        }
+
+        uint32_t hash = _hash(name);
+        uint32_t index = _find(name, hash);
+
+        if (_entries[index].used) {
+            return false;
+        }
+        _entries[index].used = true;
+        _entries[index].hash = hash;
+        _entries[index].name = name;
+        _entries[index].value = value;
+        ++_size;
+        return true;
+    }
+
+    /**
+     * Looks up a name
+     *
+     * @param name   Name to look up
+     * @param value  Returns the value of the name, if found
+     *
+     * @return true if the name exists, false otherwise
+     */
+    bool find(const std::string &name, V &value) const
+    {
+        if (_size == 0) {
+            return false;
+        }
+
+        const Entry &entry = _entries[_find(name, _hash(name))];
+        if (entry.used == false) {
+            return false;
+        }
+        value = entry.value;
+        return true;
+    }
+
+    /**
+     * Removes a name
+     *
+     * @param name  Name to remove
+     *
+     * @return true if the name was removed or false if it does not exist
+     */
+    bool erase(const std::string &name)
+    {
+        if (_size == 0) {
+            return false;
+        }
+
+        uint32_t mask = (uint32_t)_entries.size() - 1;
+        uint32_t hole = _find(name, _hash(name));
+        if (_entries[hole].used == false) {
+            return false;
+        }
+
+        /* Move back the entries of the probe sequence, so no lookup stops
+         * at the hole before reaching them */
+        for (uint32_t index = (hole + 1) & mask; _entries[index].used; index = (index + 1) & mask) {
+            uint32_t home = _entries[index].hash & mask;
+
+            if (((index - home) & mask) >= ((index - hole) & mask)) {
+                std::swap(_entries[hole], _entries[index]);
+                hole = index;
+            }
+        }
+        _entries[hole].used = false;
+        _entries[hole].name.clear();
+        --_size;
+        return true;
+    }
+
+    /**
+     * Number of names
+     */
+    uint32_t size(void) const { return _size; }
+  private:
+    /**
+     * Slot of the table
+     */
+    struct Entry {
+        Entry() : used(false), hash(0), value() {}
+        bool used;        /**< Whether the slot holds a name */
+        uint32_t hash;    /**< Hash of the name */
+        std::string name; /**< Name */
+        V value;          /**< Value of the name */
+    };
+
+    /**
+     * FNV-1a hash of a name
+     */
+    static uint32_t _hash(const std::string &name)
+    {
+        uint32_t hash = 2166136261u;
+
+        for (size_t i = 0; i < name.size(); ++i) {
+            hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * Returns the slot of a name, or the empty slot where it would be added
+     */
+    uint32_t _find(const std::string &name, uint32_t hash) const
+    {
+        uint32_t mask = (uint32_t)_entries.size() - 1;
+        uint32_t index = hash & mask;
+
+        while (_entries[index].used && (_entries[index].hash != hash || _entries[index].name != name)) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    /**
+     * Doubles the number of slots and adds the names again
+     */
+    void _grow(void)
+    {
+        std::vector<Entry> entries(_entries.empty() ? 16 : _entries.size() * 2);
+
+        _entries.swap(entries);
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].used) {
+                Entry &entry = _entries[_find(entries[i].name, entries[i].hash)];
+
+                entry.used = true;
+                entry.hash = entries[i].hash;
+                entry.name.swap(entries[i].name);
+                entry.value = entries[i].value;
+            }
+        }
+    }
+
+    std::vector<Entry> _entries; /**< Slots, a power of two */
+    uint32_t _size;              /**< Number of names */
+};
@@ -0,0 +1,197 @@
+/**
+ * @class Profiler
+ * @brief Hierarchical CPU/GPU frame profiler.
+ *
+ *        CPU time is measured with ProfileScope markers, which only read a
+ *        flag when the profiler is disabled. GPU passes are measured by the
+ *        renderer with timer queries and handed to the profiler a few frames
+ *        later, once the GPU has finished them. All the timings go into a
+ *        ring buffer that keeps the last frames, which can be queried for an
+ *        overlay or exported in the Chrome trace event format
+ *        (chrome://tracing, Perfetto).
+ *
+ *        Marker names are not copied, they must be string literals or
+ *        otherwise outlive the profiler
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Profiler
+{
+  public:
+    /**
+     * Timing of a marker
+     */
+    struct Event {
+        const char *name; /**< Name of the marker */
+        uint64_t frame;   /**< Frame the marker belongs to */
+        double start;     /**< Start time in microseconds, for GPU events when the pass was issued */
+        double duration;  /**< Duration in microseconds */
+        uint32_t thread;  /**< Track of the event: GPUThread or a CPU thread index */
+        uint32_t depth;   /**< Nesting level of the marker in its thread */
+    };
+
+    /**
+     * Track of the GPU events, CPU threads are numbered from 1 in order of
+     * first use
+     */
+    static const uint32_t GPUThread = 0;
+
+    /**
+     * Profiler factory
+     *
+     * @return Pointer to the profiler
+     */
+    static Profiler *GetInstance(void);
+
+    /**
+     * Profiler disposal
+     */
+    static void DisposeInstance(void);
+
+    /**
+     * Returns whether the markers are being recorded. Cheap enough to be
+     * checked by every marker
+     *
+     * @return true if the profiler is enabled, false otherwise
+     */
+    static bool IsEnabled(void) { return _enabled.load(std::memory_order_relaxed); }
+    /**
+     * Starts or stops recording markers. The ring buffer is allocated the
+     * first time the profiler is enabled
+     *
+     * @param enable  Whether to record the markers
+     */
+    void setEnabled(bool enable);
+
+    /**
+     * Starts a new frame, the markers recorded from now on belong to it
+     */
+    void beginFrame(void) { _frame.fetch_add(1, std::memory_order_relaxed); }
+    /**
+     * Returns the frame in progress
+     *
+     * @return Frame number
+     */
+    uint64_t getFrame(void) const { return _frame.load(std::memory_order_relaxed); }
+    /**
+     * Returns the last frame with GPU timings
+     *
+     * @return Frame number
+     */
+    uint64_t getLastGPUFrame(void) const { return _lastGPUFrame; }
+    /**
+     * Returns the time since the profiler was created
+     *
+     * @return Time in microseconds
+     */
+    double now(void) const;
+
+    /**
+     * Opens a CPU marker in the calling thread, see ProfileScope
+     *
+     * @return Start time of the marker
+     */
+    double beginCPU(void);
+
+    /**
+     * Closes the last CPU marker opened in the calling thread and records it
+     *
+     * @param name   Name of the marker
+     * @param start  Start time returned by beginCPU()
+     */
+    void endCPU(const char *name, double start);
+
+    /**
+     * Records the timing of a GPU pass
+     *
+     * @param name      Name of the pass
+     * @param frame     Frame the pass belongs to
+     * @param start     Time when the pass was issued, see now()
+     * @param duration  Time the GPU spent in the pass in microseconds
+     */
+    void addGPUEvent(const char *name, uint64_t frame, double start, double duration);
+
+    /**
+     * Retrieves the events of a frame still in the ring buffer, in the order
+     * they were closed
+     *
+     * @param frame      Frame to query
+     * @param gpu        Whether to retrieve the GPU events or the CPU events
+     * @param events     Returns the events
+     * @param maxEvents  Capacity of 'events'
+     *
+     * @return Number of events retrieved
+     */
+    size_t getFrameEvents(uint64_t frame, bool gpu, Event *events, size_t maxEvents);
+
+    /**
+     * Writes the events in the ring buffer in the Chrome trace event format
+     *
+     * @param filename  Name of the JSON file
+     *
+     * @return true if the file was written, false otherwise
+     */
+    bool exportChromeTrace(const std::string &filename);
+
+  private:
+    Profiler();
+
+    /**
+     * Stores an event in the ring buffer
+     *
+     * @param event  Event to store
+     */
+    void _record(const Event &event);
+
+    /**
+     * Number of events kept in the ring buffer
+     */
+    static const size_t RingSize = 16384;
+
+    static Profiler *_profiler;        /**< Current profiler */
+    static std::atomic<bool> _enabled; /**< Whether the markers are recorded */
+
+    std::mutex _mutex;                 /**< Protects the ring buffer */
+    std::vector<Event> _events;        /**< Ring buffer of events */
+    uint64_t _numEvents;               /**< Number of events recorded, the next one goes to _numEvents % RingSize */
+    std::atomic<uint64_t> _frame;      /**< Frame in progress */
+    uint64_t _lastGPUFrame;            /**< Last frame with GPU events */
+    std::atomic<uint32_t> _numThreads; /**< Number of CPU threads seen */
+    double _origin;                    /**< Creation time in microseconds since the clock epoch */
+};
+
+/**
+ * Measures the CPU time of the enclosing scope
+ */
+class ProfileScope
+{
+  public:
+    ProfileScope(const char *name) : _name(NULL)
+    {
+        if (Profiler::IsEnabled()) {
+            _name = name;
+            _start = Profiler::GetInstance()->beginCPU();
+        }
+    }
+    ~ProfileScope()
+    {
+        if (_name != NULL) {
+            Profiler::GetInstance()->endCPU(_name, _start);
+        }
+    }
+
+  private:
+    ProfileScope(const ProfileScope &);
+    ProfileScope &operator=(const ProfileScope &);
+
+    const char *_name; /**< Name of the marker, NULL if the profiler was disabled */
+    double _start;     /**< Start time of the marker */
+};
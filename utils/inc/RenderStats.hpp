@@ -0,0 +1,73 @@
+/**
+ * @class RenderStats
+ * @brief Counts the draw calls and the state changes submitted to the GPU
+ *        per frame.
+ *
+ *        The counters are bumped by the OpenGL backend next to the calls they
+ *        count, only from the render thread, so they are plain integers. The
+ *        game loop closes each frame with EndFrame(), after which the totals
+ *        of that frame can be read with Get()
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+
+class RenderStats
+{
+  public:
+    /**
+     * Operations counted
+     */
+    enum Counter {
+        DRAW_CALLS = 0,     /**< glDraw* calls */
+        SHADER_BINDS,       /**< Programs made current */
+        TEXTURE_BINDS,      /**< Textures bound for sampling */
+        VERTEX_ARRAY_BINDS, /**< Vertex arrays bound for drawing */
+        FRAMEBUFFER_BINDS,  /**< Render targets bound */
+        COUNTER_COUNT
+    };
+
+    /**
+     * Adds to a counter of the frame in progress
+     *
+     * @param counter  Counter to increase
+     * @param count    Amount to add
+     */
+    static void Add(Counter counter, uint32_t count = 1) { _current[counter] += count; }
+    /**
+     * Closes the current frame, its totals become available through Get()
+     * and the counters start again from zero
+     */
+    static void EndFrame(void);
+
+    /**
+     * Returns a counter of the last closed frame
+     *
+     * @param counter  Counter to read
+     *
+     * @return Total of the frame
+     */
+    static uint64_t Get(Counter counter) { return _frame[counter]; }
+    /**
+     * Returns the number of state changes of the last closed frame, that is
+     * every counter but the draw calls
+     *
+     * @return Number of state changes
+     */
+    static uint64_t GetStateChanges(void);
+
+    /**
+     * Returns the printable name of a counter
+     *
+     * @param counter  Counter to name
+     *
+     * @return Name of the counter
+     */
+    static const char *GetCounterName(Counter counter);
+
+  private:
+    static uint64_t _current[COUNTER_COUNT]; /**< Counters of the frame in progress */
+    static uint64_t _frame[COUNTER_COUNT];   /**< Counters of the last closed frame */
+};
@@ -0,0 +1,91 @@
+/**
+ * @class TextureCodec
+ * @brief Offline block compression of textures for the GPU
+ *
+ *        Opaque textures are encoded as BC1 (DXT1), 4 bits per texel, and
+ *        textures with alpha as BC3 (DXT5), 8 bits per texel. Each 4x4 block
+ *        is encoded independently: the endpoints are taken from the principal
+ *        axis of the block colors and then refined with a least squares fit
+ *        of the selected indices. Rows of blocks are encoded in parallel in the
+ *        WorkerPool.
+ *
+ *        The decoder is only meant as a fallback for drivers without S3TC
+ *        support, the GPU decodes the blocks when sampling
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include "Texture.hpp"
+
+class TextureCodec
+{
+  public:
+    /**
+     * Encodes an image as BC1 or BC3
+     *
+     * @param format  Texture::FORMAT_BC1 or Texture::FORMAT_BC3
+     * @param pixels  Image to encode, RGB or RGBA bytes
+     * @param width   Width of the image
+     * @param height  Height of the image
+     * @param Bpp     Bytes per texel of the image, 3 or 4
+     * @param output  Buffer of Texture::GetImageBytes() bytes for the blocks
+     */
+    static void Encode(Texture::Format format, const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t Bpp, uint8_t *output);
+
+    /**
+     * Decodes a BC1 or BC3 image into RGBA bytes
+     *
+     * @param format  Texture::FORMAT_BC1 or Texture::FORMAT_BC3
+     * @param input   Blocks of the image
+     * @param width   Width of the image
+     * @param height  Height of the image
+     * @param pixels  Buffer of width * height * 4 bytes for the image
+     */
+    static void Decode(Texture::Format format, const uint8_t *input, uint32_t width, uint32_t height, uint8_t *pixels);
+
+    /**
+     * Halves an image with a 2x2 box filter, the last row or column is
+     * repeated for odd sizes. RGB and RGBA images are filtered in linear
+     * space, with SSE2 when available, the alpha is filtered as it is
+     *
+     * @param source       Image to reduce
+     * @param width        Width of the image
+     * @param height       Height of the image
+     * @param Bpp          Bytes per texel
+     * @param destination  Buffer for the reduced image
+     */
+    static void Downsample(const uint8_t *source, uint32_t width, uint32_t height, uint32_t Bpp, uint8_t *destination);
+
+    /**
+     * Builds the full mip chain of an uncompressed texture in place, so that
+     * the levels are stored with the asset and not generated at load time
+     *
+     * @param texture  Texture with a single level, its previous data is freed
+     *
+     * @return true if the mip chain was built, false if the texture is compressed
+     *         or already has several levels
+     */
+    static bool GenerateMipmaps(Texture &texture);
+
+    /**
+     * Compresses an uncompressed texture in place, BC1 if it is opaque and BC3
+     * otherwise. The compressed data contains the full mip chain, or the levels
+     * already stored in the texture
+     *
+     * @param texture  Texture to compress, its previous data is freed
+     *
+     * @return true if the texture was compressed, false if it was not a
+     *         RGB or RGBA texture
+     */
+    static bool Compress(Texture &texture);
+
+    /**
+     * Decompresses a compressed texture in place into RGBA texels, keeping
+     * its mip chain
+     *
+     * @param texture  Texture to decompress, its previous data is freed
+     */
+    static void Decompress(Texture &texture);
+};
@@ -0,0 +1,80 @@
+/**
+ * @class WorkerPool
+ * @brief Pool of worker threads shared by the engine to run CPU heavy
+ *        jobs like parsing, decoding or procedural generation in parallel
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+  public:
+    /**
+     * Worker pool factory. The pool is created on first use with
+     * as many workers as hardware threads minus one, as the caller
+     * thread also takes part in parallelFor()
+     *
+     * @return Pointer to the worker pool
+     */
+    static WorkerPool *GetInstance(void);
+
+    /**
+     * Worker pool disposal. Waits for the queued tasks to finish
+     */
+    static void DisposeInstance(void);
+
+    /**
+     * Returns the number of worker threads in the pool
+     *
+     * @return Number of worker threads
+     */
+    uint32_t getNumWorkers() const { return (uint32_t)_workers.size(); }
+    /**
+     * Queues a task to be run by one of the workers. The task is
+     * run asynchronously and the caller must provide its own means
+     * of synchronization
+     *
+     * @param task  Function to be run
+     */
+    void submit(const std::function<void()> &task);
+
+    /**
+     * Runs 'func' for every index in [0, count) and waits for all of them
+     * to finish. The calling thread also takes indices, so it is safe to call
+     * parallelFor() from inside a task, and with no workers it degrades
+     * into a plain loop
+     *
+     * @param count  Number of indices to process
+     * @param func   Function to be called for each index
+     */
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)> &func);
+
+  private:
+    WorkerPool(uint32_t numWorkers);
+    ~WorkerPool();
+
+    /**
+     * Main loop of each worker thread
+     */
+    void _run();
+
+    std::vector<std::thread> _workers;         /**< Worker threads */
+    std::deque<std::function<void()> > _tasks; /**< Tasks waiting to be run */
+    std::mutex _mutex;                         /**< Protects the tasks queue */
+    std::condition_variable _condition;        /**< Signaled when a task is queued or the pool is stopped */
+    bool _stop;                                /**< Set when the pool is being disposed */
+
+    /**
+     * Current worker pool
+     */
+    static WorkerPool *_workerPool;
+};
@@ -1,12 +1,84 @@
 /**
  * @file    ZCompression.hpp
  * @brief	Contains classes to perform compression/decompression using zlib
+ *          and other codecs
  */
 #pragma once
 
+#include <stdint.h>
 #include <fstream>
+#include <vector>
 #include "zlib.h"
 
+/**
+ * @class   Codec
+ * @brief   Interface for the codecs used to compress independent blocks of
+ *          data. The available codecs are obtained with Codec::Get()
+ */
+class Codec
+{
+  public:
+    /**
+     * Identifies each codec. These values are stored in disk so
+     * they must not be changed
+     */
+    enum Type {
+        TYPE_NONE = 0, /**< Data is stored as it is */
+        TYPE_ZLIB = 1, /**< zlib deflate, best ratio */
+        TYPE_LZ = 2,   /**< Built-in byte oriented LZ77 codec, much faster to decode */
+        TYPE_COUNT
+    };
+
+    /**
+     * Returns the codec for the given type
+     *
+     * @param type  Type of the codec
+     *
+     * @return Pointer to the codec or NULL if the type is unknown
+     */
+    static const Codec *Get(Type type);
+
+    /**
+     * Returns the codec type from its name ("none", "zlib" or "lz")
+     *
+     * @param name  Name of the codec
+     * @param type  Codec type corresponding to 'name'
+     *
+     * @return true if the name is a known codec, false otherwise
+     */
+    static bool FromName(const char *name, Type &type);
+
+    virtual ~Codec() {}
+    /**
+     * Returns the maximum size of the encoded data for an input of 'size' bytes
+     */
+    virtual size_t getMaxEncodedSize(size_t size) const = 0;
+
+    /**
+     * Encodes 'size' bytes of 'input' into 'output'
+     *
+     * @param input       Data to encode
+     * @param size        Number of bytes in 'input'
+     * @param output      Buffer of at least getMaxEncodedSize(size) bytes
+     * @param outputSize  Number of bytes written to 'output'
+     *
+     * @return true if the data was encoded, false otherwise
+     */
+    virtual bool encode(const uint8_t *input, size_t size, uint8_t *output, size_t &outputSize) const = 0;
+
+    /**
+     * Decodes 'size' bytes of 'input' into 'output'
+     *
+     * @param input       Encoded data
+     * @param size        Number of bytes in 'input'
+     * @param output      Buffer for the decoded data
+     * @param outputSize  Exact size of the decoded data
+     *
+     * @return true if exactly 'outputSize' bytes were decoded, false otherwise
+     */
+    virtual bool decode(const uint8_t *input, size_t size, uint8_t *output, size_t outputSize) const = 0;
+};
+
 /**
  * @class   ZCompression
  * @brief   Compresses and writes the given input to the given output stream
@@ -54,6 +126,28 @@ class ZCompression
      */
     void finish();
 
+    /**
+     * Default size of the blocks used by Compress()
+     */
+    static const uint32_t BlockSize = 256 * 1024;
+
+    /**
+     * Compresses a whole buffer in one go. The buffer is split in blocks
+     * that are compressed independently in parallel, each one with the
+     * checksum of its data. Blocks that do not compress are stored as they are
+     *
+     * @param codec      Codec used for the blocks
+     * @param data       Data to compress
+     * @param size       Number of bytes in 'data'
+     * @param output     Vector where the compressed data is stored, resized to
+     *                   the compressed size
+     * @param blockSize  Size of each block
+     *
+     * @return true if the data was compressed correctly, false otherwise
+     */
+    static bool Compress(Codec::Type codec, const void *data, size_t size, std::vector<uint8_t> &output,
+                         uint32_t blockSize = BlockSize);
+
   private:
     z_stream _strm;      /**< ZLib compression state */
     uint8_t *_outBuffer; /**< Output buffer provided to ZLib */
@@ -107,6 +201,19 @@ class ZDecompression
      */
     void finish();
 
+    /**
+     * Decompresses a whole buffer compressed with ZCompression::Compress in one go.
+     * The blocks are decompressed in parallel and their checksums verified
+     *
+     * @param data        Compressed data
+     * @param size        Number of bytes in 'data'
+     * @param output      Buffer where the decompressed data is written to
+     * @param outputSize  Expected size of the decompressed data
+     *
+     * @return true if exactly 'outputSize' bytes were decompressed, false otherwise
+     */
+    static bool Decompress(const void *data, size_t size, void *output, size_t outputSize);
+
   private:
     z_stream _strm;     /**< ZLib compression state */
     uint8_t *_inBuffer; /**< Input buffer provided to ZLib */
@@ -0,0 +1,252 @@
+/**
+ * @class AllocationTracker
+ * @brief Counts the heap allocations of the engine per subsystem and per frame
+ *
+ *        The hooks run before main() and inside the allocator itself, so the
+ *        counters are plain zero initialized atomics and nothing here may
+ *        allocate
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "AllocationTracker.hpp"
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#if defined(TRACK_ALLOCATIONS) && defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/**
+ * Counters of the frame in progress
+ */
+static std::atomic<uint64_t> _allocations[AllocationTracker::TAG_COUNT];
+static std::atomic<uint64_t> _frees[AllocationTracker::TAG_COUNT];
+static std::atomic<uint64_t> _bytes[AllocationTracker::TAG_COUNT];
+
+static std::atomic<int64_t> _liveBytes;
+static std::atomic<int64_t> _framePeakLiveBytes;
+
+/**
+ * Statistics of the last closed frame, only touched by EndFrame()
+ */
+static AllocationTracker::Stats _frameStats[AllocationTracker::TAG_COUNT];
+static uint64_t _lastFramePeakLiveBytes = 0;
+static uint64_t _budgetAllocations = 0;
+static uint64_t _budgetBytes = 0;
+static uint64_t _framesOverBudget = 0;
+
+static thread_local AllocationTracker::Tag _currentTag = AllocationTracker::TAG_GENERAL;
+
+static const char *_tagNames[AllocationTracker::TAG_COUNT] = {"general", "renderer", "loaders", "console", "scene", "driver"};
+
+#if defined(TRACK_ALLOCATIONS)
+static void _recordAllocation(size_t size)
+{
+    _allocations[_currentTag].fetch_add(1, std::memory_order_relaxed);
+    _bytes[_currentTag].fetch_add(size, std::memory_order_relaxed);
+
+    int64_t live = _liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = _framePeakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && _framePeakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed) == false) {
+    }
+}
+
+static void _recordFree(size_t size)
+{
+    _frees[_currentTag].fetch_add(1, std::memory_order_relaxed);
+    _liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+/* The real allocator, glibc exports it under these names precisely so that
+ * malloc() can be interposed */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *pointer);
+
+void *malloc(size_t size) throw()
+{
+    void *pointer = __libc_malloc(size);
+    if (pointer != NULL) {
+        _recordAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+void *calloc(size_t count, size_t size) throw()
+{
+    void *pointer = __libc_calloc(count, size);
+    if (pointer != NULL) {
+        _recordAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+void *realloc(void *pointer, size_t size) throw()
+{
+    size_t previousSize = pointer != NULL ? malloc_usable_size(pointer) : 0;
+    void *newPointer = __libc_realloc(pointer, size);
+
+    if (pointer != NULL && (newPointer != NULL || size == 0)) {
+        _recordFree(previousSize);
+    }
+    if (newPointer != NULL) {
+        _recordAllocation(malloc_usable_size(newPointer));
+    }
+    return newPointer;
+}
+
+void *memalign(size_t alignment, size_t size) throw()
+{
+    void *pointer = __libc_memalign(alignment, size);
+    if (pointer != NULL) {
+        _recordAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) throw() { return memalign(alignment, size); }
+int posix_memalign(void **pointer, size_t alignment, size_t size) throw()
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+        return 22; /* EINVAL */
+    }
+    *pointer = memalign(alignment, size);
+    return *pointer != NULL ? 0 : 12; /* ENOMEM */
+}
+
+void free(void *pointer) throw()
+{
+    if (pointer != NULL) {
+        _recordFree(malloc_usable_size(pointer));
+    }
+    __libc_free(pointer);
+}
+}
+#else
+/* The size is kept in front of each block, padded to keep the alignment
+ * malloc() guarantees */
+static const size_t _headerSize = 2 * sizeof(void *);
+
+static void *_trackedNew(size_t size)
+{
+    uint8_t *block = (uint8_t *)malloc(size + _headerSize);
+    if (block == NULL) {
+        return NULL;
+    }
+    *(size_t *)block = size;
+    _recordAllocation(size);
+    return block + _headerSize;
+}
+
+static void _trackedDelete(void *pointer)
+{
+    if (pointer == NULL) {
+        return;
+    }
+    uint8_t *block = (uint8_t *)pointer - _headerSize;
+    _recordFree(*(size_t *)block);
+    free(block);
+}
+
+void *operator new(size_t size)
+{
+    void *pointer = _trackedNew(size);
+    if (pointer == NULL) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) throw() { return _trackedNew(size); }
+void *operator new[](size_t size, const std::nothrow_t &) throw() { return _trackedNew(size); }
+void operator delete(void *pointer) throw() { _trackedDelete(pointer); }
+void operator delete[](void *pointer) throw() { _trackedDelete(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) throw() { _trackedDelete(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) throw() { _trackedDelete(pointer); }
+#endif
+#endif
+
+bool AllocationTracker::IsEnabled(void)
+{
+#if defined(TRACK_ALLOCATIONS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationTracker::Tag AllocationTracker::SetCurrentTag(Tag tag)
+{
+    Tag previous = _currentTag;
+    _currentTag = tag;
+    return previous;
+}
+
+AllocationTracker::Tag AllocationTracker::GetCurrentTag(void) { return _currentTag; }
+const char *AllocationTracker::GetTagName(Tag tag) { return tag < TAG_COUNT ? _tagNames[tag] : "unknown"; }
+bool AllocationTracker::EndFrame(void)
+{
+    Stats total = {0, 0, 0, 0};
+
+    for (uint32_t tag = 0; tag < TAG_COUNT; ++tag) {
+        Stats &stats = _frameStats[tag];
+
+        stats.allocations = _allocations[tag].exchange(0, std::memory_order_relaxed);
+        stats.frees = _frees[tag].exchange(0, std::memory_order_relaxed);
+        stats.bytes = _bytes[tag].exchange(0, std::memory_order_relaxed);
+        if (stats.bytes > stats.peakBytes) {
+            stats.peakBytes = stats.bytes;
+        }
+
+        if (tag != TAG_DRIVER) {
+            total.allocations += stats.allocations;
+            total.bytes += stats.bytes;
+        }
+    }
+
+    int64_t peak = _framePeakLiveBytes.exchange(_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _lastFramePeakLiveBytes = peak > 0 ? peak : 0;
+
+    if ((_budgetAllocations != 0 && total.allocations > _budgetAllocations) || (_budgetBytes != 0 && total.bytes > _budgetBytes)) {
+        ++_framesOverBudget;
+        return false;
+    }
+    return true;
+}
+
+const AllocationTracker::Stats &AllocationTracker::GetFrameStats(Tag tag) { return _frameStats[tag]; }
+AllocationTracker::Stats AllocationTracker::GetFrameTotal(void)
+{
+    Stats total = {0, 0, 0, 0};
+
+    for (uint32_t tag = 0; tag < TAG_COUNT; ++tag) {
+        if (tag == TAG_DRIVER) {
+            continue;
+        }
+        total.allocations += _frameStats[tag].allocations;
+        total.frees += _frameStats[tag].frees;
+        total.bytes += _frameStats[tag].bytes;
+        total.peakBytes += _frameStats[tag].peakBytes;
+    }
+    return total;
+}
+
+uint64_t AllocationTracker::GetLiveBytes(void)
+{
+    int64_t live = _liveBytes.load(std::memory_order_relaxed);
+    return live > 0 ? live : 0;
+}
+
+uint64_t AllocationTracker::GetFramePeakLiveBytes(void) { return _lastFramePeakLiveBytes; }
+void AllocationTracker::SetFrameBudget(uint64_t maxAllocations, uint64_t maxBytes)
+{
+    _budgetAllocations = maxAllocations;
+    _budgetBytes = maxBytes;
+}
+
+uint64_t AllocationTracker::GetFramesOverBudget(void) { return _framesOverBudget; }
@@ -6,44 +6,346 @@
  */
 #include "Asset3DLoaders.hpp"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <map>
 #include <string>
 #include <vector>
+#include "AllocationTracker.hpp"
 #include "ImageLoaders.hpp"
 #include "Logging.hpp"
+#include "MappedFile.hpp"
+#include "WorkerPool.hpp"
 
 using namespace Logging;
 using namespace ImageLoaders;
 using namespace std;
 
-bool Asset3DLoaders::LoadOBJ(Asset3D &asset, const string &name)
-{
+/**
+ * Minimum amount of bytes of the geometry file parsed by each
+ * worker. Smaller files are parsed by the calling thread only
+ */
+static const size_t OBJMinChunkSize = 1024 * 1024;
+
+/**
+ * Face as found in the OBJ file, with the 1-based indices
+ * of each of the 3 vertices of the triangle
+ */
+struct OBJFace {
+    uint32_t vertex[3];
+    uint32_t uv[3];
+    uint32_t normal[3];
+};
+
+/**
+ * Material group switch found in the OBJ file. 'face' is the
+ * number of faces parsed in the chunk before the switch
+ */
+struct OBJMaterialSwitch {
+    size_t face;
+    std::string name;
+};
+
+/**
+ * Data parsed from a portion of the geometry file. Each chunk is
+ * parsed independently and then merged in file order
+ */
+struct OBJChunk {
+    const char *begin;
+    const char *end;
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> uvcoords;
-    std::map<std::string, Material>::iterator it;
-    bool ret = true;
-    uint32_t i;
-    uint32_t numFaces = 0;
-    uint8_t *texture = NULL;
-    uint32_t texWidth, texHeight, texBytesPerPixel;
-    std::vector<bool> positionSet;
-    int t = 0;
+    std::vector<OBJFace> faces;
+    std::vector<OBJMaterialSwitch> switches;
+    std::string error;
+};
+
+static inline bool _isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline const char *_skipSpaces(const char *p, const char *end)
+{
+    while (p < end && _isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * Returns the string between 'p' and 'end' without the surrounding whitespace
+ */
+static std::string _parseName(const char *p, const char *end)
+{
+    p = _skipSpaces(p, end);
+    while (end > p && _isSpace(end[-1])) {
+        --end;
+    }
+    return std::string(p, end);
+}
+
+/**
+ * Parses an unsigned decimal integer, advancing 'p' past it
+ *
+ * @return true if at least one digit was found
+ */
+static inline bool _parseUint(const char *&p, const char *end, uint32_t &value)
+{
+    const char *start = p;
+
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    return p != start;
+}
+
+/**
+ * Parses a decimal floating point number with optional sign, fraction
+ * and exponent, advancing 'p' past it. The common case is computed from
+ * an integer mantissa and an exact power of ten, anything beyond that
+ * precision is handed over to strtod
+ *
+ * @return true if a number was found
+ */
+static bool _parseFloat(const char *&p, const char *end, float &value)
+{
+    static const double powersOf10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *start = p;
+    bool negative = false;
+    uint64_t mantissa = 0;
+    int32_t exponent = 0;
+    uint32_t numDigits = 0;
+
+    p = _skipSpaces(p, end);
+    start = p;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++numDigits) {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++numDigits) {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+        }
+    }
+    if (numDigits == 0) {
+        p = start;
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *exp = p + 1;
+        bool negativeExp = false;
+        uint32_t expValue;
+
+        if (exp < end && (*exp == '-' || *exp == '+')) {
+            negativeExp = *exp == '-';
+            ++exp;
+        }
+        if (_parseUint(exp, end, expValue) == true) {
+            exponent += negativeExp ? -(int32_t)expValue : (int32_t)expValue;
+            p = exp;
+        }
+    }
+
+    if (numDigits <= 15 && exponent >= -22 && exponent <= 22) {
+        double result = (double)mantissa;
+
+        result = exponent < 0 ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+        value = (float)(negative ? -result : result);
+        return true;
+    }
+
+    /* Long or extreme numbers, use the C library on a terminated copy */
+    char buffer[64];
+    size_t length = (size_t)(p - start) < sizeof buffer - 1 ? (size_t)(p - start) : sizeof buffer - 1;
+
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    value = (float)strtod(buffer, NULL);
+    return true;
+}
+
+/**
+ * Parses a face vertex in the form v/vt/vn
+ */
+static inline bool _parseFaceVertex(const char *&p, const char *end, uint32_t &vertex, uint32_t &uv, uint32_t &normal)
+{
+    p = _skipSpaces(p, end);
+    if (_parseUint(p, end, vertex) == false || p >= end || *p++ != '/') {
+        return false;
+    }
+    if (_parseUint(p, end, uv) == false || p >= end || *p++ != '/') {
+        return false;
+    }
+    return _parseUint(p, end, normal);
+}
+
+/**
+ * Parses all the lines contained in the chunk. Lines can have any length,
+ * the only requirement is that the chunk starts at the beginning of a line
+ */
+static void _parseOBJChunk(OBJChunk &chunk)
+{
+    const char *p = chunk.begin;
+
+    while (p < chunk.end && chunk.error.empty() == true) {
+        const char *lineEnd = (const char *)memchr(p, '\n', chunk.end - p);
+        if (lineEnd == NULL) {
+            lineEnd = chunk.end;
+        }
+
+        const char *line = _skipSpaces(p, lineEnd);
+        size_t length = lineEnd - line;
+
+        p = lineEnd + 1;
+
+        if (length < 2) {
+            continue;
+        }
+
+        if (line[0] == 'v' && _isSpace(line[1])) {
+            /* vertices */
+            const char *it = line + 2;
+            glm::vec3 vertex;
+            if (_parseFloat(it, lineEnd, vertex.x) == false || _parseFloat(it, lineEnd, vertex.y) == false ||
+                _parseFloat(it, lineEnd, vertex.z) == false) {
+                chunk.error = "ERROR reading v format from OBJ file\n";
+            }
+            chunk.vertices.push_back(vertex);
+        } else if (line[0] == 'v' && line[1] == 'n' && length > 2 && _isSpace(line[2])) {
+            /* Normals */
+            const char *it = line + 3;
+            glm::vec3 normal;
+            if (_parseFloat(it, lineEnd, normal.x) == false || _parseFloat(it, lineEnd, normal.y) == false ||
+                _parseFloat(it, lineEnd, normal.z) == false) {
+                chunk.error = "ERROR reading vn format from OBJ file\n";
+            }
+            chunk.normals.push_back(normal);
+        } else if (line[0] == 'v' && line[1] == 't' && length > 2 && _isSpace(line[2])) {
+            /* Texture coordinates */
+            const char *it = line + 3;
+            glm::vec2 uv;
+            if (_parseFloat(it, lineEnd, uv.x) == false || _parseFloat(it, lineEnd, uv.y) == false) {
+                chunk.error = "ERROR reading vt format from OBJ file\n";
+            }
+            /* Adjust uv.y as OBJ defines (0,0) to be top-left corner while
+             * OpenGL uses (0,0) for bottom left corner. No idea what DirectX
+             * interpretation is. For now just fix it for OpenGL */
+            uv.y = 1.0f - uv.y;
+            chunk.uvcoords.push_back(uv);
+        } else if (line[0] == 'f' && _isSpace(line[1])) {
+            /* Faces */
+            const char *it = line + 2;
+            OBJFace face;
+            for (uint32_t i = 0; i < 3; ++i) {
+                if (_parseFaceVertex(it, lineEnd, face.vertex[i], face.uv[i], face.normal[i]) == false) {
+                    chunk.error = "ERROR OBJ file format is not correct for this loader\n";
+                    break;
+                }
+            }
+            chunk.faces.push_back(face);
+        } else if (length > 7 && strncmp(line, "usemtl", 6) == 0 && _isSpace(line[6])) {
+            /* Material group */
+            OBJMaterialSwitch materialSwitch;
+            materialSwitch.face = chunk.faces.size();
+            materialSwitch.name = _parseName(line + 7, lineEnd);
+            chunk.switches.push_back(materialSwitch);
+        }
+    }
+}
+
+/**
+ * Loads the texture referenced by a map_Kd entry, the image is decoded
+ * straight into the texture data
+ */
+static bool _loadTexture(const std::string &texname, uint32_t maxTextureSize, Texture &texture)
+{
+    uint8_t *data = NULL;
+    uint32_t width, height, bytesPerPixel;
+    ImageAllocator allocate = [&data](uint32_t imageWidth, uint32_t imageHeight, uint32_t imageBytesPerPixel) {
+        data = new uint8_t[(size_t)imageWidth * imageHeight * imageBytesPerPixel];
+        return data;
+    };
+
+    int ret;
+    if (texname.length() > 4 && texname.compare(texname.length() - 4, std::string::npos, ".png") == 0) {
+        ret = decodePNG(texname.c_str(), allocate, maxTextureSize, &width, &height, &bytesPerPixel);
+    } else if (texname.length() > 4 && texname.compare(texname.length() - 4, std::string::npos, ".jpg") == 0) {
+        ret = decodeJPEG(texname.c_str(), allocate, maxTextureSize, &width, &height, &bytesPerPixel);
+    } else {
+        log("ERROR texture format not supported\n");
+        return false;
+    }
+
+    if (ret != 0) {
+        log("ERROR loading texture %s\n", texname.c_str());
+        delete[] data;
+        return false;
+    }
+
+    texture.freeData();
+    texture._texture = data;
+    texture._width = width;
+    texture._height = height;
+    texture._Bpp = bytesPerPixel;
+    return true;
+}
+
+/**
+ * Decodes the textures of the materials in parallel, a file referenced by
+ * several materials is decoded once and then copied
+ */
+static bool _loadTextures(const std::map<std::string, std::string> &textureFiles, uint32_t maxTextureSize,
+                          std::map<std::string, Texture> &textures)
+{
+    std::map<std::string, uint32_t> jobs;
+    std::vector<std::string> files;
+
+    for (std::map<std::string, std::string>::const_iterator it = textureFiles.begin(); it != textureFiles.end(); ++it) {
+        if (jobs.find(it->second) == jobs.end()) {
+            jobs[it->second] = (uint32_t)files.size();
+            files.push_back(it->second);
+        }
+    }
+
+    std::vector<Texture> decoded(files.size());
+    std::vector<uint8_t> loaded(files.size());
+    WorkerPool::GetInstance()->parallelFor((uint32_t)files.size(),
+                                           [&](uint32_t i) { loaded[i] = _loadTexture(files[i], maxTextureSize, decoded[i]); });
+
+    if (std::find(loaded.begin(), loaded.end(), false) != loaded.end()) {
+        return false;
+    }
+
+    for (std::map<std::string, std::string>::const_iterator it = textureFiles.begin(); it != textureFiles.end(); ++it) {
+        textures[it->first] = decoded[jobs[it->second]];
+    }
+    return true;
+}
 
+bool Asset3DLoaders::LoadOBJ(Asset3D &asset, const string &name, uint32_t maxTextureSize)
+{
+    AllocationScope allocationScope(AllocationTracker::TAG_LOADERS);
+    std::map<std::string, Material>::iterator it;
     std::map<std::string, std::vector<uint32_t> > indices;
     std::map<std::string, Material> materials;
     std::map<std::string, Texture> textures;
-
+    std::map<std::string, std::string> textureFiles;
     std::vector<uint32_t> *activeIndices = NULL;
+    MappedFile file;
 
     std::string matFile = name + "/material.mtl";
     std::string geoFile = name + "/geometry.obj";
 
     /* Open the materials file */
-    FILE *file = fopen(matFile.c_str(), "r");
-    if (file == NULL) {
+    if (file.open(matFile) == false) {
         log("ERROR cannot open file %s\n", matFile.c_str());
         return false;
     }
@@ -53,197 +355,199 @@ bool Asset3DLoaders::LoadOBJ(Asset3D &asset, const string &name)
     indices["Default"] = std::vector<uint32_t>();
     materials["Default"] = Material();
 
-    for (;;) {
-        char line[512];
-        int res = fscanf(file, "%[^\r\n]\r\n", line);
-        if (res == EOF) {
-            break;
-        }
+    {
+        const char *p = (const char *)file.getData();
+        const char *end = p + file.getSize();
+        std::string matName;
+        glm::vec3 ambient, diffuse, specular;
+        float shininess = 0.0f;
+        std::string textureFile;
+
+        /* Materials are committed when the next one starts and at the end
+         * of the file, so the order of the components does not matter */
+        for (bool eof = false; eof == false;) {
+            const char *lineEnd = p < end ? (const char *)memchr(p, '\n', end - p) : NULL;
+            if (lineEnd == NULL) {
+                lineEnd = end;
+            }
 
-        if (strncmp(line, "newmtl ", 7) == 0) {
-            std::string matName = line + 7;
-            glm::vec3 ambient, diffuse, specular;
-            float shininess;
+            const char *line = _skipSpaces(p, lineEnd);
+            size_t length = lineEnd - line;
+            const char *it = line + 2;
 
-            /* Read the components */
-            for (;;) {
-                int res = fscanf(file, "%[^\r\n]\r\n", line);
-                if (res == EOF) {
-                    break;
+            p = lineEnd + 1;
+            eof = p > end;
+
+            bool newMaterial = length > 7 && strncmp(line, "newmtl", 6) == 0 && _isSpace(line[6]);
+
+            if ((newMaterial == true || eof == true) && matName.empty() == false) {
+                /* Add the new material */
+                indices[matName] = std::vector<uint32_t>();
+                materials[matName] = Material(ambient, diffuse, specular, 1.0, shininess);
+                if (textureFile.empty() == false) {
+                    textureFiles[matName] = textureFile;
                 }
+                matName.clear();
+            }
 
+            if (newMaterial == true) {
+                matName = _parseName(line + 7, lineEnd);
+                ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+                diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+                specular = glm::vec3(0.0f, 0.0f, 0.0f);
+                shininess = 0.0f;
+                textureFile.clear();
+            } else if (length > 2 && line[0] == 'K' && line[1] == 'a') {
                 /* Ka */
-                if (line[0] == 'K' && line[1] == 'a') {
-                    res = sscanf(line + 2, "%f %f %f", &ambient.r, &ambient.g, &ambient.b);
-                    if (res != 3) {
-                        printf("ERROR reading Ka format from OBJ file\n");
-                    }
-                    continue;
+                if (_parseFloat(it, lineEnd, ambient.r) == false || _parseFloat(it, lineEnd, ambient.g) == false ||
+                    _parseFloat(it, lineEnd, ambient.b) == false) {
+                    log("ERROR reading Ka format from OBJ file\n");
                 }
+            } else if (length > 2 && line[0] == 'K' && line[1] == 'd') {
                 /* Kd */
-                if (line[0] == 'K' && line[1] == 'd') {
-                    res = sscanf(line + 2, "%f %f %f", &diffuse.r, &diffuse.g, &diffuse.b);
-                    if (res != 3) {
-                        printf("ERROR reading Kd format from OBJ file\n");
-                    }
-                    continue;
+                if (_parseFloat(it, lineEnd, diffuse.r) == false || _parseFloat(it, lineEnd, diffuse.g) == false ||
+                    _parseFloat(it, lineEnd, diffuse.b) == false) {
+                    log("ERROR reading Kd format from OBJ file\n");
                 }
+            } else if (length > 2 && line[0] == 'K' && line[1] == 's') {
                 /* Ks */
-                if (line[0] == 'K' && line[1] == 's') {
-                    res = sscanf(line + 2, "%f %f %f", &specular.r, &specular.g, &specular.b);
-                    if (res != 3) {
-                        printf("ERROR reading Ks format from OBJ file\n");
-                    }
-                    continue;
+                if (_parseFloat(it, lineEnd, specular.r) == false || _parseFloat(it, lineEnd, specular.g) == false ||
+                    _parseFloat(it, lineEnd, specular.b) == false) {
+                    log("ERROR reading Ks format from OBJ file\n");
                 }
+            } else if (length > 2 && line[0] == 'N' && line[1] == 's') {
                 /* Ns */
-                if (line[0] == 'N' && line[1] == 's') {
-                    res = sscanf(line + 2, "%f", &shininess);
-                    if (res != 1) {
-                        printf("ERROR reading Ns format from OBJ file\n");
-                    }
-                    continue;
+                if (_parseFloat(it, lineEnd, shininess) == false) {
+                    log("ERROR reading Ns format from OBJ file\n");
                 }
-                /* map_Kd */
-                if (strncmp(line, "map_Kd ", 7) == 0) {
-                    std::string texname = name + std::string("/") + std::string(line + 7);
-
-                    if (strcmp(line + 7, "null") != 0) {
-                        /* Load the texture */
-                        if (texname.compare(texname.length() - 4, std::string::npos, ".png") == 0) {
-                            if (loadPNG(texname.c_str(), &texture, &texWidth, &texHeight, &texBytesPerPixel) != 0) {
-                                printf("ERROR loading PNG texture %s\n", texname.c_str());
-                                ret = false;
-                                goto error_exit;
-                            }
-                        } else if (texname.compare(texname.length() - 4, std::string::npos, ".jpg") == 0) {
-                            if (loadJPEG(texname.c_str(), &texture, &texWidth, &texHeight, &texBytesPerPixel) != 0) {
-                                printf("ERROR loading JPEG texture %s\n", texname.c_str());
-                                ret = false;
-                                goto error_exit;
-                            }
-                        } else {
-                            fprintf(stderr, "ERROR texture format not supported\n");
-                            ret = false;
-                            goto error_exit;
-                        }
-                    } else {
-                        texture = NULL;
-                        texWidth = 0;
-                        texHeight = 0;
-                    }
-                    break;
-                }
-
-            } /* Material components read */
+            } else if (length > 7 && strncmp(line, "map_Kd", 6) == 0 && _isSpace(line[6])) {
+                /* map_Kd, the textures are decoded once all the materials are known */
+                std::string texfile = _parseName(line + 7, lineEnd);
 
-            /* Add the new material */
-            indices[matName] = std::vector<uint32_t>();
-            materials[matName] = Material(ambient, diffuse, specular, 1.0, shininess);
-            textures[matName] = Texture(texture, texWidth, texHeight, texBytesPerPixel);
-
-            free(texture);
+                if (texfile != "null") {
+                    textureFile = name + std::string("/") + texfile;
+                }
+            }
         }
     }
 
-    fclose(file);
+    if (_loadTextures(textureFiles, maxTextureSize, textures) == false) {
+        return false;
+    }
 
     activeIndices = &indices["Default"];
 
     /* Open the geometry file */
-    file = fopen(geoFile.c_str(), "r");
-    if (file == NULL) {
-        printf("ERROR cannot open file %s\n", geoFile.c_str());
+    if (file.open(geoFile) == false) {
+        log("ERROR cannot open file %s\n", geoFile.c_str());
         return false;
     }
 
-    for (;;) {
-        char line[512];
-        int res = fscanf(file, "%[^\r\n]\r\n", line);
-        if (res == EOF) {
-            break;
+    /* Split the file in chunks starting at line boundaries and parse them in parallel */
+    const char *data = (const char *)file.getData();
+    const char *dataEnd = data + file.getSize();
+    WorkerPool *pool = WorkerPool::GetInstance();
+    size_t numChunks = file.getSize() / OBJMinChunkSize;
+
+    if (numChunks > 4 * (pool->getNumWorkers() + 1)) {
+        numChunks = 4 * (pool->getNumWorkers() + 1);
+    }
+    if (numChunks == 0) {
+        numChunks = 1;
+    }
+
+    std::vector<OBJChunk> chunks(numChunks);
+    const char *chunkBegin = data;
+
+    for (size_t i = 0; i < numChunks; ++i) {
+        const char *chunkEnd = i == numChunks - 1 ? dataEnd : data + (file.getSize() / numChunks) * (i + 1);
+
+        if (chunkEnd < chunkBegin) {
+            chunkEnd = chunkBegin;
+        }
+        if (chunkEnd < dataEnd) {
+            chunkEnd = (const char *)memchr(chunkEnd, '\n', dataEnd - chunkEnd);
+            chunkEnd = chunkEnd == NULL ? dataEnd : chunkEnd + 1;
         }
 
-        /* vertices */
-        if (line[0] == 'v' && line[1] == ' ') {
-            glm::vec3 vertex;
-            res = sscanf(line + 2, "%f %f %f", &vertex.x, &vertex.y, &vertex.z);
-            if (res != 3) {
-                printf("ERROR reading v format from OBJ file\n");
-            }
-            vertices.push_back(vertex);
-        } else if (line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
-            /* Normals */
-            glm::vec3 normal;
-            res = sscanf(line + 3, "%f %f %f", &normal.x, &normal.y, &normal.z);
-            if (res != 3) {
-                printf("ERROR reading vn format from OBJ file\n");
-            }
-            normals.push_back(normal);
-        } else if (line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
-            /* Texture coordinates */
-            glm::vec2 uv;
-            res = sscanf(line + 3, "%f %f", &uv.x, &uv.y);
-            if (res != 2) {
-                printf("ERROR reading vt format from OBJ file\n");
-            }
-            /* Adjust uv.y as OBJ defines (0,0) to be top-left corner while
-             * OpenGL uses (0,0) for bottom left corner. No idea what DirectX
-             * interpretation is. For now just fix it for OpenGL */
-            uv.y = 1.0f - uv.y;
-            uvcoords.push_back(uv);
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    pool->parallelFor((uint32_t)numChunks, [&chunks](uint32_t i) { _parseOBJChunk(chunks[i]); });
+
+    /* Merge the raw vertex data of all the chunks */
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvcoords;
+    size_t numVertices = 0, numNormals = 0, numUVCoords = 0;
+
+    for (std::vector<OBJChunk>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+        if (chunk->error.empty() == false) {
+            log("%s", chunk->error.c_str());
+            return false;
         }
+        numVertices += chunk->vertices.size();
+        numNormals += chunk->normals.size();
+        numUVCoords += chunk->uvcoords.size();
     }
 
-    /* Rewind the file */
-    fseek(file, SEEK_SET, 0);
+    vertices.reserve(numVertices);
+    normals.reserve(numNormals);
+    uvcoords.reserve(numUVCoords);
+
+    for (std::vector<OBJChunk>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+        vertices.insert(vertices.end(), chunk->vertices.begin(), chunk->vertices.end());
+        normals.insert(normals.end(), chunk->normals.begin(), chunk->normals.end());
+        uvcoords.insert(uvcoords.end(), chunk->uvcoords.begin(), chunk->uvcoords.end());
+        std::vector<glm::vec3>().swap(chunk->vertices);
+        std::vector<glm::vec3>().swap(chunk->normals);
+        std::vector<glm::vec2>().swap(chunk->uvcoords);
+    }
 
     /* Allocate size for the final data */
     asset._vertexData.resize(vertices.size());
-    positionSet.resize(vertices.size(), false);
-
-    /* Now parse the groups and the faces */
-    for (;;) {
-        char line[512];
-        int res = fscanf(file, "%[^\r\n]\r\n", line);
-        if (res == EOF) {
-            break;
-        }
-
-        /* Material group */
-        if (strncmp(line, "usemtl ", 7) == 0) {
-            std::string materialName = line + 7;
-            if (materials.find(materialName) == materials.end()) {
-                printf("ERROR referenced material %s not found in material list\n", materialName.c_str());
-                break;
+    std::vector<bool> positionSet(vertices.size(), false);
+
+    /* Now go through the groups and the faces in file order */
+    for (std::vector<OBJChunk>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+        std::vector<OBJMaterialSwitch>::iterator materialSwitch = chunk->switches.begin();
+
+        for (size_t face = 0; face <= chunk->faces.size(); ++face) {
+            /* Material group */
+            for (; materialSwitch != chunk->switches.end() && materialSwitch->face == face; ++materialSwitch) {
+                if (materials.find(materialSwitch->name) == materials.end()) {
+                    log("ERROR referenced material %s not found in material list\n", materialSwitch->name.c_str());
+                    activeIndices = &indices["Default"];
+                } else {
+                    activeIndices = &indices[materialSwitch->name];
+                }
             }
 
-            activeIndices = &indices[materialName];
-        }
-
-        /* Faces */
-        if (line[0] == 'f' && line[1] == ' ') {
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-            int matches = sscanf(line + 2, "%d/%d/%d %d/%d/%d %d/%d/%d", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1],
-                                 &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-            if (matches != 9) {
-                printf("ERROR OBJ file format is not correct for this loader %d\n", matches);
-                ret = false;
-                goto error_exit;
+            if (face == chunk->faces.size()) {
+                break;
             }
 
             /* Fill the indices for each triangle */
-            for (i = 0; i < 3; ++i) {
-                uint32_t vertexIdx = vertexIndex[i] - 1;
-                uint32_t normalIdx = normalIndex[i] - 1;
-                uint32_t uvIdx = uvIndex[i] - 1;
+            const OBJFace &objFace = chunk->faces[face];
+
+            for (uint32_t i = 0; i < 3; ++i) {
+                uint32_t vertexIdx = objFace.vertex[i] - 1;
+                uint32_t normalIdx = objFace.normal[i] - 1;
+                uint32_t uvIdx = objFace.uv[i] - 1;
                 uint32_t dataIdx = vertexIdx;
 
+                if (vertexIdx >= vertices.size() || normalIdx >= normals.size() || uvIdx >= uvcoords.size()) {
+                    log("ERROR OBJ file references a vertex out of range\n");
+                    return false;
+                }
+
                 if (positionSet[dataIdx] == true) {
                     if (asset._vertexData[dataIdx].normal != normals[normalIdx] || asset._vertexData[dataIdx].uvcoord != uvcoords[uvIdx]) {
                         dataIdx = asset._vertexData.size();
                         asset._vertexData.resize(asset._vertexData.size() + 1);
-                        positionSet.resize(positionSet.size() + 1, false);
+                        positionSet.push_back(false);
                     }
                 }
 
@@ -259,8 +563,6 @@ bool Asset3DLoaders::LoadOBJ(Asset3D &asset, const string &name)
                  * the data to the global data buffer */
                 activeIndices->push_back(dataIdx);
             }
-
-            numFaces++;
         }
     }
 
@@ -285,7 +587,5 @@ bool Asset3DLoaders::LoadOBJ(Asset3D &asset, const string &name)
 
     printf("Loaded %s with %zu vertices and %zu faces\n", name.c_str(), asset._vertexData.size(), asset._vertexIndices.size() / 3);
 
-error_exit:
-    fclose(file);
-    return ret;
+    return true;
 }
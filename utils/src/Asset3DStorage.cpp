@@ -5,145 +5,510 @@
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #include "Asset3DStorage.hpp"
+#include <string.h>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
+#include "AllocationTracker.hpp"
+#include "GeometryCodec.hpp"
 #include "Logging.hpp"
+#include "MappedFile.hpp"
 #include "ZCompression.hpp"
 
 using namespace std;
 using namespace Logging;
 
-bool Asset3DStorage::Save(const std::string &name, const Asset3D &asset)
+/* The structures are written as they are in memory, make sure there is no
+ * padding that depends on the compiler */
+static_assert(sizeof(Asset3DStorage::FileHeader) == 64, "Unexpected FileHeader size");
+static_assert(sizeof(Asset3DStorage::SectionEntry) == 40, "Unexpected SectionEntry size");
+
+/**
+ * Number of floats stored per material in the materials section
+ */
+static const uint32_t MaterialFloats = 11;
+
+/**
+ * Number of uint32_t before each texture in the textures section: width,
+ * height, Bpp, format and number of mipmap levels
+ */
+static const uint32_t TextureInfoWords = 5;
+
+/**
+ * Encodes and writes a section payload at the next aligned offset of
+ * the file, adding its entry to the directory
+ */
+static bool _writeSection(ofstream &file, std::vector<Asset3DStorage::SectionEntry> &directory, Asset3DStorage::SectionType type,
+                          Codec::Type codec, const void *data, size_t size, uint32_t count, uint32_t elementSize)
 {
-    ofstream file(name, ios::binary | ios::out | ios::trunc);
-    ZCompression comp;
+    static const char padding[Asset3DStorage::SectionAlignment] = {0};
+    Asset3DStorage::SectionEntry entry;
+    std::vector<uint8_t> encoded;
+
+    /* Align the payload */
+    uint64_t offset = (uint64_t)file.tellp();
+    uint64_t alignedOffset = (offset + Asset3DStorage::SectionAlignment - 1) & ~(uint64_t)(Asset3DStorage::SectionAlignment - 1);
+    file.write(padding, alignedOffset - offset);
+
+    /* Geometry is only filtered when compressed, the filters do not
+     * reduce the size by themselves */
+    Asset3DStorage::Filter filter = Asset3DStorage::FILTER_NONE;
+    std::vector<uint8_t> filtered;
+    if (codec != Codec::TYPE_NONE && type == Asset3DStorage::SECTION_VERTEX_DATA) {
+        filter = Asset3DStorage::FILTER_VERTICES;
+        filtered.resize(size);
+        GeometryCodec::EncodeVertices(data, count, elementSize, filtered.data());
+    } else if (codec != Codec::TYPE_NONE && type == Asset3DStorage::SECTION_INDICES) {
+        filter = Asset3DStorage::FILTER_INDICES;
+        filtered.resize(size);
+        GeometryCodec::EncodeIndices(data, count, elementSize, filtered.data());
+    }
 
-    if (file.is_open() == false) {
-        log("ERROR opening file %s\n", name.c_str());
+    if (codec != Codec::TYPE_NONE) {
+        if (ZCompression::Compress(codec, filter != Asset3DStorage::FILTER_NONE ? filtered.data() : data, size, encoded) == false) {
+            return false;
+        }
+
+        /* Vertices with many exact repetitions can compress better without
+         * the filter, keep the smallest */
+        std::vector<uint8_t> unfiltered;
+        if (filter == Asset3DStorage::FILTER_VERTICES && ZCompression::Compress(codec, data, size, unfiltered) == true &&
+            unfiltered.size() < encoded.size()) {
+            filter = Asset3DStorage::FILTER_NONE;
+            encoded.swap(unfiltered);
+        }
+        data = encoded.data();
+    }
+
+    entry.type = type;
+    entry.codec = (uint16_t)codec;
+    entry.filter = (uint16_t)filter;
+    entry.offset = alignedOffset;
+    entry.size = codec == Codec::TYPE_NONE ? size : encoded.size();
+    entry.rawSize = size;
+    entry.count = count;
+    entry.elementSize = elementSize;
+    directory.push_back(entry);
+
+    file.write((const char *)data, entry.size);
+
+    return file.good();
+}
+
+/**
+ * Decodes the payload of a section into 'output', which must have room
+ * for entry.rawSize bytes
+ */
+static bool _readSection(const MappedFile &file, const Asset3DStorage::SectionEntry &entry, void *output)
+{
+    const uint8_t *data = file.getData() + entry.offset;
+    std::vector<uint8_t> filtered;
+    void *decoded = output;
+
+    if (entry.filter != Asset3DStorage::FILTER_NONE) {
+        if (entry.rawSize != (uint64_t)entry.count * entry.elementSize ||
+            (entry.filter == Asset3DStorage::FILTER_VERTICES && (entry.elementSize % sizeof(uint32_t)) != 0) ||
+            (entry.filter == Asset3DStorage::FILTER_INDICES && entry.elementSize != sizeof(uint16_t) &&
+             entry.elementSize != sizeof(uint32_t)) ||
+            entry.filter > Asset3DStorage::FILTER_INDICES) {
+            log("ERROR asset section has a wrong filter\n");
+            return false;
+        }
+        filtered.resize(entry.rawSize);
+        decoded = filtered.data();
+    }
+
+    if (entry.codec == Codec::TYPE_NONE) {
+        if (entry.size != entry.rawSize) {
+            log("ERROR asset section has a wrong size\n");
+            return false;
+        }
+        memcpy(decoded, data, entry.rawSize);
+    } else if (ZDecompression::Decompress(data, entry.size, decoded, entry.rawSize) == false) {
+        /* The stream header identifies the codec of the blocks */
         return false;
     }
 
-    if (comp.init() == false) {
-        log("ERROR initializing compression in Asset3DStorage::Save\n");
-        file.close();
+    if (entry.filter == Asset3DStorage::FILTER_VERTICES) {
+        GeometryCodec::DecodeVertices(filtered.data(), entry.count, entry.elementSize, output);
+    } else if (entry.filter == Asset3DStorage::FILTER_INDICES) {
+        GeometryCodec::DecodeIndices(filtered.data(), entry.count, entry.elementSize, output);
+    }
+
+    return true;
+}
+
+bool Asset3DStorage::Save(const std::string &name, const Asset3D &asset, Codec::Type codec)
+{
+    Codec::Type codecs[SECTION_COUNT];
+
+    for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+        codecs[i] = codec;
+    }
+    return Save(name, asset, codecs);
+}
+
+bool Asset3DStorage::Save(const std::string &name, const Asset3D &asset, const Codec::Type (&codecs)[SECTION_COUNT])
+{
+    std::vector<SectionEntry> directory;
+    FileHeader header;
+    glm::vec3 boundsMin, boundsMax, maxLengthVertex;
+
+    if (asset.hasCPUData() == false) {
+        log("ERROR the data of the asset was released, it cannot be stored in %s\n", name.c_str());
         return false;
     }
 
-    /* Write the vertex data size */
-    uint32_t dataSize = (uint32_t)asset._vertexData.size();
-    comp.write(file, (const char *)&dataSize, sizeof dataSize);
+    ofstream file(name, ios::binary | ios::out | ios::trunc);
+    if (file.is_open() == false) {
+        log("ERROR opening file %s\n", name.c_str());
+        return false;
+    }
+
+    const Asset3D::VertexData *vertexData = asset.getVertexDataPtr();
+    uint32_t numVertices = asset.getNumVertices();
+    uint32_t numIndices = asset.getNumIndices();
 
-    /* Now write the vertex data */
+    /* Precompute the bounds so the loader does not need to loop the vertices */
+    Asset3D::_calculateBounds(vertexData, numVertices, boundsMin, boundsMax, maxLengthVertex);
+
+    memset(&header, 0, sizeof header);
+    header.magic = Magic;
+    header.version = Version;
+    header.primitiveType = (uint16_t)asset.getPrimitiveType();
+    header.numSections = SECTION_COUNT;
+    memcpy(header.boundsMin, &boundsMin[0], sizeof header.boundsMin);
+    memcpy(header.boundsMax, &boundsMax[0], sizeof header.boundsMax);
+    memcpy(header.maxLengthVertex, &maxLengthVertex[0], sizeof header.maxLengthVertex);
+
+    /* Leave room for the header, written once the directory location is known */
+    file.write((const char *)&header, sizeof header);
+
+    /* Vertex data */
+    bool ok;
     if (sizeof(Asset3D::VertexData) == Asset3D::VertexDataPackedSize) {
         /* Everything is packed, we can write a single blob */
-        comp.write(file, (const char *)&asset._vertexData[0], dataSize * sizeof asset._vertexData[0]);
-    } else if (sizeof(Asset3D::VertexData::vertex) + sizeof(Asset3D::VertexData::normal) + sizeof(Asset3D::VertexData::uvcoord) ==
-               Asset3D::VertexDataPackedSize) {
-        /* vertex, normal and uvcoord are correctly packed internally */
-        for (std::vector<Asset3D::VertexData>::const_iterator it = asset._vertexData.begin(); it != asset._vertexData.end(); ++it) {
-            comp.write(file, (const char *)&it->vertex, sizeof it->vertex);
-            comp.write(file, (const char *)&it->normal, sizeof it->normal);
-            comp.write(file, (const char *)&it->uvcoord, sizeof it->uvcoord);
-        }
+        ok = _writeSection(file, directory, SECTION_VERTEX_DATA, codecs[SECTION_VERTEX_DATA], vertexData,
+                           numVertices * sizeof vertexData[0], numVertices, Asset3D::VertexDataPackedSize);
     } else {
-        /* Nothing is correctly packed, need to write each coordinate individually */
-        for (std::vector<Asset3D::VertexData>::const_iterator it = asset._vertexData.begin(); it != asset._vertexData.end(); ++it) {
-            comp.write(file, (const char *)&it->vertex.x, sizeof it->vertex.x);
-            comp.write(file, (const char *)&it->vertex.y, sizeof it->vertex.y);
-            comp.write(file, (const char *)&it->vertex.z, sizeof it->vertex.z);
-            comp.write(file, (const char *)&it->normal.x, sizeof it->normal.x);
-            comp.write(file, (const char *)&it->normal.y, sizeof it->normal.y);
-            comp.write(file, (const char *)&it->normal.z, sizeof it->normal.z);
-            comp.write(file, (const char *)&it->uvcoord.x, sizeof it->uvcoord.x);
-            comp.write(file, (const char *)&it->uvcoord.y, sizeof it->uvcoord.y);
+        /* Nothing is correctly packed, need to copy each coordinate individually */
+        std::vector<float> packed;
+        packed.reserve(numVertices * Asset3D::VertexDataPackedSize / sizeof(float));
+        for (uint32_t i = 0; i < numVertices; ++i) {
+            packed.insert(packed.end(), &vertexData[i].vertex[0], &vertexData[i].vertex[0] + 3);
+            packed.insert(packed.end(), &vertexData[i].normal[0], &vertexData[i].normal[0] + 3);
+            packed.insert(packed.end(), &vertexData[i].uvcoord[0], &vertexData[i].uvcoord[0] + 2);
         }
+        ok = _writeSection(file, directory, SECTION_VERTEX_DATA, codecs[SECTION_VERTEX_DATA], packed.data(),
+                           packed.size() * sizeof packed[0], numVertices, Asset3D::VertexDataPackedSize);
     }
 
-    /* Write the materials data size */
-    dataSize = (uint32_t)asset._materials.size();
-    comp.write(file, (const char *)&dataSize, sizeof dataSize);
+    /* Indices, using 16 bits when they can address all the vertices */
+    if (ok == true) {
+        const void *indices = asset.getIndexDataPtr();
+        uint32_t indexSize = asset.getIndexDataSize();
+
+        if (numVertices <= 0xFFFF) {
+            std::vector<uint16_t> shortIndices(numIndices);
+            for (uint32_t i = 0; i < numIndices; ++i) {
+                uint32_t index = indexSize == sizeof(uint16_t) ? ((const uint16_t *)indices)[i] : ((const uint32_t *)indices)[i];
+                shortIndices[i] = index == Asset3D::PrimitiveRestartIndex ? 0xFFFF : (uint16_t)index;
+            }
+            ok = _writeSection(file, directory, SECTION_INDICES, codecs[SECTION_INDICES], shortIndices.data(),
+                               numIndices * sizeof(uint16_t), numIndices, sizeof(uint16_t));
+        } else {
+            ok = _writeSection(file, directory, SECTION_INDICES, codecs[SECTION_INDICES], indices, numIndices * sizeof(uint32_t),
+                               numIndices, sizeof(uint32_t));
+        }
+    }
 
-    /* Now write the materials data */
-    if (sizeof(Material) == Material::PackedSize) {
-        /* Everything is packed, we can write a single blob */
-        comp.write(file, (const char *)&asset._materials[0], dataSize * sizeof asset._materials[0]);
-    } else if (sizeof(Material::_ambient) + sizeof(Material::_diffuse) + sizeof(Material::_specular) + sizeof(Material::_alpha) +
-                   sizeof(Material::_shininess) ==
-               Material::PackedSize) {
-        /* The individual fields are correctly packed internally */
+    /* Rendering lists */
+    if (ok == true) {
+        ok = _writeSection(file, directory, SECTION_INDICES_OFFSETS, codecs[SECTION_INDICES_OFFSETS], asset._indicesOffsets.data(),
+                           asset._indicesOffsets.size() * sizeof(uint32_t), (uint32_t)asset._indicesOffsets.size(), sizeof(uint32_t));
+    }
+    if (ok == true) {
+        ok = _writeSection(file, directory, SECTION_INDICES_COUNT, codecs[SECTION_INDICES_COUNT], asset._indicesCount.data(),
+                           asset._indicesCount.size() * sizeof(uint32_t), (uint32_t)asset._indicesCount.size(), sizeof(uint32_t));
+    }
+
+    /* Materials */
+    if (ok == true) {
+        std::vector<float> materials;
+        materials.reserve(asset._materials.size() * MaterialFloats);
         for (std::vector<Material>::const_iterator it = asset._materials.begin(); it != asset._materials.end(); ++it) {
-            comp.write(file, (const char *)&it->_ambient, sizeof it->_ambient);
-            comp.write(file, (const char *)&it->_diffuse, sizeof it->_diffuse);
-            comp.write(file, (const char *)&it->_specular, sizeof it->_specular);
-            comp.write(file, (const char *)&it->_alpha, sizeof it->_alpha);
-            comp.write(file, (const char *)&it->_shininess, sizeof it->_shininess);
+            materials.insert(materials.end(), &it->_ambient[0], &it->_ambient[0] + 3);
+            materials.insert(materials.end(), &it->_diffuse[0], &it->_diffuse[0] + 3);
+            materials.insert(materials.end(), &it->_specular[0], &it->_specular[0] + 3);
+            materials.push_back(it->_alpha);
+            materials.push_back(it->_shininess);
         }
-    } else {
-        /* Nothing is correctly packed, need to write each coordinate individually */
-        for (std::vector<Material>::const_iterator it = asset._materials.begin(); it != asset._materials.end(); ++it) {
-            comp.write(file, (const char *)&it->_ambient.x, sizeof it->_ambient.x);
-            comp.write(file, (const char *)&it->_ambient.y, sizeof it->_ambient.y);
-            comp.write(file, (const char *)&it->_ambient.z, sizeof it->_ambient.z);
-            comp.write(file, (const char *)&it->_diffuse.x, sizeof it->_diffuse.x);
-            comp.write(file, (const char *)&it->_diffuse.y, sizeof it->_diffuse.y);
-            comp.write(file, (const char *)&it->_diffuse.z, sizeof it->_diffuse.z);
-            comp.write(file, (const char *)&it->_specular.x, sizeof it->_specular.x);
-            comp.write(file, (const char *)&it->_specular.y, sizeof it->_specular.y);
-            comp.write(file, (const char *)&it->_specular.z, sizeof it->_specular.z);
-            comp.write(file, (const char *)&it->_alpha, sizeof it->_alpha);
-            comp.write(file, (const char *)&it->_shininess, sizeof it->_shininess);
+        ok = _writeSection(file, directory, SECTION_MATERIALS, codecs[SECTION_MATERIALS], materials.data(),
+                           materials.size() * sizeof(float), (uint32_t)asset._materials.size(), MaterialFloats * sizeof(float));
+    }
+
+    /* Textures */
+    if (ok == true) {
+        std::vector<uint8_t> textures;
+        for (std::vector<Texture>::const_iterator it = asset._textures.begin(); it != asset._textures.end(); ++it) {
+            uint32_t info[TextureInfoWords] = {it->_width, it->_height, it->_Bpp, it->_format, it->_levels};
+            size_t size = it->_texture != NULL ? it->getBytes() : 0;
+
+            if (size == 0) {
+                info[0] = info[1] = 0;
+            }
+            textures.insert(textures.end(), (const uint8_t *)info, (const uint8_t *)info + sizeof info);
+            if (size != 0) {
+                textures.insert(textures.end(), it->_texture, it->_texture + size);
+            }
         }
+        ok = _writeSection(file, directory, SECTION_TEXTURES, codecs[SECTION_TEXTURES], textures.data(), textures.size(),
+                           (uint32_t)asset._textures.size(), 0);
     }
 
-    /* Write the textures data size */
-    dataSize = (uint32_t)asset._textures.size();
-    comp.write(file, (const char *)&dataSize, sizeof dataSize);
+    if (ok == false) {
+        log("ERROR writing data to file %s\n", name.c_str());
+        file.close();
+        return false;
+    }
 
-    /* Now write the texture data */
-    for (std::vector<Texture>::const_iterator it = asset._textures.begin(); it != asset._textures.end(); ++it) {
-        comp.write(file, (const char *)&it->_width, sizeof it->_width);
-        comp.write(file, (const char *)&it->_height, sizeof it->_height);
-        comp.write(file, (const char *)&it->_Bpp, sizeof it->_Bpp);
-        comp.write(file, (const char *)it->_texture, it->_width * it->_height * it->_Bpp);
+    /* Write the directory aligned as the sections and then the final header */
+    static const char padding[SectionAlignment] = {0};
+    uint64_t offset = (uint64_t)file.tellp();
+    header.directoryOffset = (offset + SectionAlignment - 1) & ~(uint64_t)(SectionAlignment - 1);
+    file.write(padding, header.directoryOffset - offset);
+    file.write((const char *)directory.data(), directory.size() * sizeof directory[0]);
+    file.seekp(0);
+    file.write((const char *)&header, sizeof header);
+
+    if (file.bad() == true) {
+        log("ERROR writing data to file %s\n", name.c_str());
+        file.close();
+        return false;
     }
 
-    /* Write the indices data size */
-    dataSize = (uint32_t)asset._vertexIndices.size();
-    comp.write(file, (const char *)&dataSize, sizeof dataSize);
+    /* Close the file */
+    file.close();
 
-    /* Now write the indices data */
-    comp.write(file, (const char *)&asset._vertexIndices[0], dataSize * sizeof asset._vertexIndices[0]);
+    return true;
+}
 
-    /* Write the indices offsets data size */
-    dataSize = (uint32_t)asset._indicesOffsets.size();
-    comp.write(file, (const char *)&dataSize, sizeof dataSize);
+bool Asset3DStorage::Load(const std::string &name, Asset3D &asset, bool mapGeometry)
+{
+    AllocationScope allocationScope(AllocationTracker::TAG_LOADERS);
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    const SectionEntry *sections[SECTION_COUNT] = {NULL};
+    FileHeader header;
 
-    /* Now write the indices offsets data */
-    comp.write(file, (const char *)&asset._indicesOffsets[0], dataSize * sizeof asset._indicesOffsets[0]);
+    if (file->open(name) == false) {
+        log("ERROR opening file %s\n", name.c_str());
+        return false;
+    }
 
-    /* Write the indices count data size */
-    dataSize = (uint32_t)asset._indicesCount.size();
-    comp.write(file, (const char *)&dataSize, sizeof dataSize);
+    /* Remembered so the data can be reloaded after releaseCPUData() */
+    asset._sourceName = name;
+    asset._cpuDataReleased = false;
 
-    /* Now write the indices count data */
-    comp.write(file, (const char *)&asset._indicesCount[0], dataSize * sizeof asset._indicesCount[0], true);
+    /* Files without header are version 1 */
+    if (file->getSize() >= sizeof header) {
+        memcpy(&header, file->getData(), sizeof header);
+    }
+    if (file->getSize() < sizeof header || header.magic != Magic) {
+        file->close();
+        return _LoadV1(name, asset);
+    }
 
-    comp.finish();
+    if (header.version > Version) {
+        log("ERROR asset file %s has unsupported version %u\n", name.c_str(), header.version);
+        return false;
+    }
+    if (header.primitiveType > Asset3D::PRIMITIVE_TRIANGLE_STRIP) {
+        log("ERROR asset file %s has unsupported primitive type %u\n", name.c_str(), header.primitiveType);
+        return false;
+    }
+    if (header.directoryOffset > file->getSize() ||
+        header.numSections > (file->getSize() - header.directoryOffset) / sizeof(SectionEntry)) {
+        log("ERROR asset file %s has a corrupted section directory\n", name.c_str());
+        return false;
+    }
 
-    if (file.bad() == true) {
-        log("ERROR writing data to file %s\n", name.c_str());
-        file.close();
+    /* Locate the known sections, ignoring the ones from newer minor revisions */
+    const SectionEntry *directory = (const SectionEntry *)(file->getData() + header.directoryOffset);
+    for (uint32_t i = 0; i < header.numSections; ++i) {
+        if (directory[i].offset > file->getSize() || directory[i].size > file->getSize() - directory[i].offset) {
+            log("ERROR asset file %s has a section out of bounds\n", name.c_str());
+            return false;
+        }
+        if (directory[i].type < SECTION_COUNT) {
+            sections[directory[i].type] = &directory[i];
+        }
+    }
+    for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+        if (sections[i] == NULL) {
+            log("ERROR asset file %s is missing section %u\n", name.c_str(), i);
+            return false;
+        }
+    }
+
+    const SectionEntry &vertexSection = *sections[SECTION_VERTEX_DATA];
+    const SectionEntry &indexSection = *sections[SECTION_INDICES];
+
+    if (vertexSection.rawSize != (uint64_t)vertexSection.count * Asset3D::VertexDataPackedSize ||
+        indexSection.rawSize != (uint64_t)indexSection.count * indexSection.elementSize ||
+        (indexSection.elementSize != sizeof(uint16_t) && indexSection.elementSize != sizeof(uint32_t))) {
+        log("ERROR asset file %s has corrupted geometry sections\n", name.c_str());
         return false;
     }
 
-    /* Close the file */
-    file.close();
+    asset._primitiveType = (Asset3D::PrimitiveType)header.primitiveType;
+    asset._mappedFile.reset();
+    asset._vertexData.clear();
+    asset._vertexIndices.clear();
+
+    /* The geometry is read in place up to rawSize bytes, and only the stored size
+     * was checked against the file. Sections that cannot be mapped go through
+     * _readSection(), which copies the misaligned ones and rejects wrong sizes */
+    if (mapGeometry == true && vertexSection.codec == Codec::TYPE_NONE && indexSection.codec == Codec::TYPE_NONE &&
+        vertexSection.filter == FILTER_NONE && indexSection.filter == FILTER_NONE && vertexSection.size == vertexSection.rawSize &&
+        indexSection.size == indexSection.rawSize && (vertexSection.offset % SectionAlignment) == 0 &&
+        (indexSection.offset % SectionAlignment) == 0 && sizeof(Asset3D::VertexData) == Asset3D::VertexDataPackedSize) {
+        /* Keep the geometry in the file mapping, the payloads are aligned
+         * so they can be accessed in place */
+        asset._mappedFile = file;
+        asset._mappedVertexData = (const Asset3D::VertexData *)(file->getData() + vertexSection.offset);
+        asset._mappedNumVertices = vertexSection.count;
+        asset._mappedIndexData = file->getData() + indexSection.offset;
+        asset._mappedNumIndices = indexSection.count;
+        asset._mappedIndexSize = indexSection.elementSize;
+    } else {
+        /* Vertex data */
+        asset._vertexData.resize(vertexSection.count);
+        if (sizeof(Asset3D::VertexData) == Asset3D::VertexDataPackedSize) {
+            if (_readSection(*file, vertexSection, asset._vertexData.data()) == false) {
+                return false;
+            }
+        } else {
+            std::vector<float> packed(vertexSection.rawSize / sizeof(float));
+            if (_readSection(*file, vertexSection, packed.data()) == false) {
+                return false;
+            }
+            for (uint32_t i = 0; i < vertexSection.count; ++i) {
+                const float *v = &packed[i * Asset3D::VertexDataPackedSize / sizeof(float)];
+                asset._vertexData[i].vertex = glm::vec3(v[0], v[1], v[2]);
+                asset._vertexData[i].normal = glm::vec3(v[3], v[4], v[5]);
+                asset._vertexData[i].uvcoord = glm::vec2(v[6], v[7]);
+            }
+        }
+
+        /* Indices, expanded to 32 bits */
+        asset._vertexIndices.resize(indexSection.count);
+        if (indexSection.elementSize == sizeof(uint32_t)) {
+            if (_readSection(*file, indexSection, asset._vertexIndices.data()) == false) {
+                return false;
+            }
+        } else {
+            std::vector<uint16_t> shortIndices(indexSection.count);
+            if (_readSection(*file, indexSection, shortIndices.data()) == false) {
+                return false;
+            }
+            for (uint32_t i = 0; i < indexSection.count; ++i) {
+                asset._vertexIndices[i] = shortIndices[i] == 0xFFFF ? Asset3D::PrimitiveRestartIndex : shortIndices[i];
+            }
+        }
+    }
+
+    /* Rendering lists */
+    const SectionEntry &offsetsSection = *sections[SECTION_INDICES_OFFSETS];
+    const SectionEntry &countSection = *sections[SECTION_INDICES_COUNT];
+    if (offsetsSection.rawSize != (uint64_t)offsetsSection.count * sizeof(uint32_t) ||
+        countSection.rawSize != (uint64_t)countSection.count * sizeof(uint32_t)) {
+        log("ERROR asset file %s has corrupted rendering lists\n", name.c_str());
+        return false;
+    }
+    asset._indicesOffsets.resize(offsetsSection.count);
+    asset._indicesCount.resize(countSection.count);
+    if (_readSection(*file, offsetsSection, asset._indicesOffsets.data()) == false ||
+        _readSection(*file, countSection, asset._indicesCount.data()) == false) {
+        return false;
+    }
+
+    /* Materials */
+    const SectionEntry &materialsSection = *sections[SECTION_MATERIALS];
+    if (materialsSection.rawSize != (uint64_t)materialsSection.count * MaterialFloats * sizeof(float)) {
+        log("ERROR asset file %s has corrupted materials\n", name.c_str());
+        return false;
+    }
+    std::vector<float> materials(materialsSection.count * MaterialFloats);
+    if (_readSection(*file, materialsSection, materials.data()) == false) {
+        return false;
+    }
+    asset._materials.resize(materialsSection.count);
+    for (uint32_t i = 0; i < materialsSection.count; ++i) {
+        const float *m = &materials[i * MaterialFloats];
+        asset._materials[i]._ambient = glm::vec3(m[0], m[1], m[2]);
+        asset._materials[i]._diffuse = glm::vec3(m[3], m[4], m[5]);
+        asset._materials[i]._specular = glm::vec3(m[6], m[7], m[8]);
+        asset._materials[i]._alpha = m[9];
+        asset._materials[i]._shininess = m[10];
+    }
+
+    /* Textures */
+    const SectionEntry &texturesSection = *sections[SECTION_TEXTURES];
+    std::vector<uint8_t> textures(texturesSection.rawSize);
+    if (_readSection(*file, texturesSection, textures.data()) == false) {
+        return false;
+    }
+    asset._textures.resize(texturesSection.count);
+    size_t position = 0;
+    /* Version 2 files only store the size of the textures */
+    size_t infoSize = (header.version >= 3 ? TextureInfoWords : 3) * sizeof(uint32_t);
+    for (std::vector<Texture>::iterator it = asset._textures.begin(); it != asset._textures.end(); ++it) {
+        uint32_t info[TextureInfoWords] = {0, 0, 0, Texture::FORMAT_RAW, 1};
+
+        if (textures.size() - position < infoSize) {
+            log("ERROR asset file %s has corrupted textures\n", name.c_str());
+            return false;
+        }
+        memcpy(info, &textures[position], infoSize);
+        position += infoSize;
+
+        it->_width = info[0];
+        it->_height = info[1];
+        it->_Bpp = info[2];
+        it->_format = info[3];
+        it->_levels = info[4];
+        it->freeData();
+
+        if (it->_format > Texture::FORMAT_BC3 || it->_levels == 0 || it->_levels > 32 || it->_width > 0xFFFF || it->_height > 0xFFFF) {
+            log("ERROR asset file %s has corrupted textures\n", name.c_str());
+            return false;
+        }
+
+        uint64_t size = it->getBytes();
+        if (textures.size() - position < size) {
+            log("ERROR asset file %s has corrupted textures\n", name.c_str());
+            return false;
+        }
+
+        if (size != 0) {
+            it->_texture = new uint8_t[size];
+            memcpy(it->_texture, &textures[position], size);
+        }
+        position += size;
+    }
+
+    /* Bounds */
+    asset._boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    asset._boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    asset._maxLengthVertex = glm::vec3(header.maxLengthVertex[0], header.maxLengthVertex[1], header.maxLengthVertex[2]);
+    asset._boundsValid = true;
 
     return true;
 }
 
-bool Asset3DStorage::Load(const std::string &name, Asset3D &asset)
+bool Asset3DStorage::_LoadV1(const std::string &name, Asset3D &asset)
 {
     uint32_t dataSize;
     ifstream file(name, ios::binary | ios::in);
@@ -155,11 +520,14 @@ bool Asset3DStorage::Load(const std::string &name, Asset3D &asset)
     }
 
     if (dcomp.init() == false) {
-        log("ERROR initializing decompression in Asset3DStorage::Load\n");
+        log("ERROR initializing decompression in Asset3DStorage::_LoadV1\n");
         file.close();
         return false;
     }
 
+    asset._mappedFile.reset();
+    asset._boundsValid = false;
+
     /* Read the vertex data size */
     dcomp.read(file, (char *)&dataSize, sizeof dataSize);
     asset._vertexData.resize(dataSize);
@@ -235,6 +603,7 @@ bool Asset3DStorage::Load(const std::string &name, Asset3D &asset)
         dcomp.read(file, (char *)&it->_width, sizeof it->_width);
         dcomp.read(file, (char *)&it->_height, sizeof it->_height);
         dcomp.read(file, (char *)&it->_Bpp, sizeof it->_Bpp);
+        it->freeData();
         it->_texture = new uint8_t[it->_width * it->_height * it->_Bpp];
         dcomp.read(file, (char *)it->_texture, it->_width * it->_height * it->_Bpp);
     }
@@ -242,6 +611,7 @@ bool Asset3DStorage::Load(const std::string &name, Asset3D &asset)
     /* Read the indices data size */
     dcomp.read(file, (char *)&dataSize, sizeof dataSize);
     asset._vertexIndices.resize(dataSize);
+    asset._primitiveType = Asset3D::PRIMITIVE_TRIANGLES;
 
     /* Now read the indices data */
     dcomp.read(file, (char *)&asset._vertexIndices[0], dataSize * sizeof asset._vertexIndices[0]);
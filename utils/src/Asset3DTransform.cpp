@@ -5,14 +5,19 @@
  * @author	Roberto Cano (http://www.robertocano.es)
  */
 #include "Asset3DTransform.hpp"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
 #include <glm/gtx/quaternion.hpp>
-#include <map>
 #include "Logging.hpp"
+#include "TextureCodec.hpp"
 
 using namespace Logging;
 
 void Asset3DTransform::Rotate(Asset3D &asset, const glm::vec3 eulerAngles)
 {
+    asset._boundsValid = false;
+
     glm::mat4 rotation = glm::toMat4(glm::quat(eulerAngles));
 
     for (std::vector<Asset3D::VertexData>::iterator it = asset._vertexData.begin(); it != asset._vertexData.end(); ++it) {
@@ -23,17 +28,79 @@ void Asset3DTransform::Rotate(Asset3D &asset, const glm::vec3 eulerAngles)
 
 void Asset3DTransform::Translate(Asset3D &asset, const glm::vec3 offsets)
 {
+    asset._boundsValid = false;
+
     for (std::vector<Asset3D::VertexData>::iterator it = asset._vertexData.begin(); it != asset._vertexData.end(); ++it) {
         it->vertex += offsets;
     }
 }
 
+/**
+ * Appends the triangles described by a triangle strip to the given list. Strips
+ * are split by the restart index and degenerate triangles are discarded
+ *
+ * @param strip  Pointer to the first index of the strip
+ * @param count  Number of indices in the strip
+ * @param out    List where the triangles are appended to
+ */
+static void _stripToTriangles(const uint32_t *strip, uint32_t count, std::vector<uint32_t> &out)
+{
+    uint32_t run = 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (strip[i] == Asset3D::PrimitiveRestartIndex) {
+            run = 0;
+            continue;
+        }
+        if (++run < 3) {
+            continue;
+        }
+
+        uint32_t a = strip[i - 2], b = strip[i - 1], c = strip[i];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+
+        /* Every other triangle in a strip has its winding flipped */
+        if (run % 2) {
+            out.push_back(a);
+            out.push_back(b);
+        } else {
+            out.push_back(b);
+            out.push_back(a);
+        }
+        out.push_back(c);
+    }
+}
+
+/**
+ * Whether the geometry of an asset is in its vectors, the only place where
+ * it can be modified. It is not once mapped from disk or released after being
+ * uploaded, see Asset3D::reloadCPUData()
+ */
+static bool _isGeometryEditable(const Asset3D &asset) { return asset.isGeometryMapped() == false && asset.hasCPUData() == true; }
+
 void Asset3DTransform::Append(Asset3D &to, const Asset3D &from)
 {
-    uint32_t origIndexSize = to._vertexIndices.size();
+    if (_isGeometryEditable(to) == false || _isGeometryEditable(from) == false) {
+        log("ERROR cannot append assets whose geometry is mapped from disk or released\n");
+        return;
+    }
+
+    if (to._vertexIndices.size() != 0 && to._primitiveType != from._primitiveType) {
+        /* Mixed primitives, fall back to triangles for both */
+        Asset3D triangles(from);
+        ConvertToTriangles(to);
+        ConvertToTriangles(triangles);
+        Append(to, triangles);
+        return;
+    }
 
     AppendGeometryOnly(to, from);
 
+    /* The start of the appended indices may be displaced by a restart index */
+    uint32_t origIndexSize = to._vertexIndices.size() - from._vertexIndices.size();
+
     /* The vertex data, materials, textures and indices count can be appended directly,
      * as they are independant of the _vertexData size */
     to._materials.insert(to._materials.end(), from.getMaterials().begin(), from.getMaterials().end());
@@ -51,14 +118,40 @@ void Asset3DTransform::AppendGeometryOnly(Asset3D &to, const Asset3D &from)
 {
     uint32_t origDataSize = to._vertexData.size();
 
+    if (_isGeometryEditable(to) == false || _isGeometryEditable(from) == false) {
+        log("ERROR cannot append assets whose geometry is mapped from disk or released\n");
+        return;
+    }
+
+    to._boundsValid = false;
+
+    if (to._vertexIndices.size() == 0) {
+        to._primitiveType = from._primitiveType;
+    } else if (to._primitiveType != from._primitiveType) {
+        /* Mixed primitives, fall back to triangles for both */
+        Asset3D triangles(from);
+        ConvertToTriangles(to);
+        ConvertToTriangles(triangles);
+        AppendGeometryOnly(to, triangles);
+        return;
+    } else if (to._primitiveType == Asset3D::PRIMITIVE_TRIANGLE_STRIP) {
+        /* Do not join the last strip with the new one */
+        to._vertexIndices.push_back(Asset3D::PrimitiveRestartIndex);
+    }
+
     /* The vertex data, materials, textures and indices count can be appended directly,
      * as they are independant of the _vertexData size */
     to._vertexData.insert(to._vertexData.end(), from.getVertexData().begin(), from.getVertexData().end());
 
     /* Copy the vertices indices. We need to add to the indices the original size of the
      * _vertexData array in the 'to' asset */
+    to._vertexIndices.reserve(to._vertexIndices.size() + from._vertexIndices.size());
     for (std::vector<uint32_t>::const_iterator it = from._vertexIndices.begin(); it != from._vertexIndices.end(); ++it) {
-        to._vertexIndices.push_back(*it + origDataSize);
+        if (*it == Asset3D::PrimitiveRestartIndex) {
+            to._vertexIndices.push_back(*it);
+        } else {
+            to._vertexIndices.push_back(*it + origDataSize);
+        }
     }
 }
 
@@ -87,32 +180,307 @@ void Asset3DTransform::SetUniqueMaterialFromColor(Asset3D &asset, const glm::vec
 
 void Asset3DTransform::RecalculateNormals(Asset3D &asset)
 {
-    /* Loop the asset indices and create a map for each vertex
-     * containing the normals of the faces it touches */
-    std::map<uint32_t, std::vector<glm::vec3> > normalsMap;
+    /* Loop the asset indices and add the normals of the faces
+     * touching each vertex */
+    std::vector<glm::vec3> normals(asset._vertexData.size(), glm::vec3(0.0f));
+    std::vector<uint8_t> touched(asset._vertexData.size(), 0);
+    std::vector<uint32_t> triangles;
+
+    if (asset._primitiveType == Asset3D::PRIMITIVE_TRIANGLE_STRIP) {
+        _stripToTriangles(asset._vertexIndices.data(), asset._vertexIndices.size(), triangles);
+    } else {
+        triangles = asset._vertexIndices;
+    }
 
-    uint32_t *index = &asset._vertexIndices[0];
+    if (triangles.size() == 0) {
+        return;
+    }
 
-    for (uint32_t i = 0; i < asset._vertexIndices.size(); i += 3) {
+    uint32_t *index = &triangles[0];
+
+    for (uint32_t i = 0; i + 2 < triangles.size(); i += 3) {
         /* Calculate the normal for the face */
         glm::vec3 a = asset._vertexData[index[i]].vertex - asset._vertexData[index[i + 1]].vertex;
         glm::vec3 b = asset._vertexData[index[i + 2]].vertex - asset._vertexData[index[i + 1]].vertex;
         glm::vec3 normal = glm::cross(b, a);
 
-        normalsMap[index[i]].push_back(normal);
-        normalsMap[index[i + 1]].push_back(normal);
-        normalsMap[index[i + 2]].push_back(normal);
+        for (uint32_t j = 0; j < 3; ++j) {
+            normals[index[i + j]] += normal;
+            touched[index[i + j]] = 1;
+        }
+    }
+
+    /* Now normalize the sums and set them to the vertices touched */
+    for (uint32_t i = 0; i < normals.size(); ++i) {
+        if (touched[i]) {
+            asset._vertexData[i].normal = glm::normalize(normals[i]);
+        }
+    }
+}
+
+void Asset3DTransform::TriangulateIndices(const Asset3D &asset, std::vector<uint32_t> &indices, std::vector<uint32_t> &offsets,
+                                          std::vector<uint32_t> &counts)
+{
+    if (asset._primitiveType == Asset3D::PRIMITIVE_TRIANGLES) {
+        indices = asset._vertexIndices;
+        offsets = asset._indicesOffsets;
+        counts = asset._indicesCount;
+        return;
+    }
+
+    indices.clear();
+    offsets.clear();
+    counts.clear();
+
+    for (uint32_t i = 0; i < asset._indicesOffsets.size(); ++i) {
+        uint32_t start = indices.size();
+
+        _stripToTriangles(asset._vertexIndices.data() + asset._indicesOffsets[i], asset._indicesCount[i], indices);
+        offsets.push_back(start);
+        counts.push_back(indices.size() - start);
+    }
+
+    /* Geometry without any material ranges is converted as a whole */
+    if (asset._indicesOffsets.size() == 0) {
+        _stripToTriangles(asset._vertexIndices.data(), asset._vertexIndices.size(), indices);
+    }
+}
+
+void Asset3DTransform::ConvertToTriangles(Asset3D &asset)
+{
+    if (asset._primitiveType == Asset3D::PRIMITIVE_TRIANGLES) {
+        return;
+    }
+
+    std::vector<uint32_t> indices, offsets, counts;
+
+    TriangulateIndices(asset, indices, offsets, counts);
+
+    asset._vertexIndices.swap(indices);
+    asset._indicesOffsets.swap(offsets);
+    asset._indicesCount.swap(counts);
+    asset._primitiveType = Asset3D::PRIMITIVE_TRIANGLES;
+}
+
+/**
+ * Size of the vertex cache simulated by _optimizeTriangles
+ */
+static const int32_t VertexCacheSize = 32;
+
+/**
+ * Score of a vertex depending on its position in the simulated cache
+ * and the number of triangles still to be emitted that use it
+ */
+static float _vertexScore(int32_t cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            /* Vertices of the last triangle get a fixed score to avoid
+             * favouring strips over fans */
+            score = 0.75f;
+        } else {
+            score = powf(1.0f - (float)(cachePosition - 3) / (VertexCacheSize - 3), 1.5f);
+        }
+    }
+
+    /* Favour vertices with few triangles left so they leave the cache soon */
+    return score + 2.0f / sqrtf((float)liveTriangles);
+}
+
+/**
+ * Reorders a triangles list in place using the linear-speed vertex cache
+ * optimisation from Tom Forsyth
+ */
+static void _optimizeTriangles(uint32_t *indices, uint32_t count, uint32_t numVertices)
+{
+    uint32_t numTriangles = count / 3;
+    std::vector<uint32_t> liveTriangles(numVertices, 0);
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    std::vector<uint32_t> adjacency(numTriangles * 3);
+
+    /* Triangles using each vertex */
+    for (uint32_t i = 0; i < numTriangles * 3; ++i) {
+        liveTriangles[indices[i]]++;
+    }
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t t = 0; t < numTriangles; ++t) {
+        for (uint32_t k = 0; k < 3; ++k) {
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<int32_t> cachePosition(numVertices, -1);
+    std::vector<float> vertexScores(numVertices);
+    std::vector<float> triangleScores(numTriangles);
+    std::vector<bool> emitted(numTriangles, false);
+
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        vertexScores[v] = _vertexScore(-1, liveTriangles[v]);
+    }
+    for (uint32_t t = 0; t < numTriangles; ++t) {
+        const uint32_t *triangle = &indices[t * 3];
+        triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
     }
 
-    /* Now loop the normals map and calculate the average */
-    for (std::map<uint32_t, std::vector<glm::vec3> >::iterator it = normalsMap.begin(); it != normalsMap.end(); ++it) {
-        glm::vec3 normal(0.0f);
-        for (std::vector<glm::vec3>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
-            normal += *it2;
+    std::vector<uint32_t> output;
+    std::vector<uint32_t> cache, newCache;
+    int64_t best = -1;
+    uint32_t cursor = 0;
+
+    output.reserve(numTriangles * 3);
+    cache.reserve(VertexCacheSize + 3);
+    newCache.reserve(VertexCacheSize + 3);
+
+    for (uint32_t n = 0; n < numTriangles; ++n) {
+        /* Nothing in the cache is useful, continue with the next pending triangle */
+        if (best < 0) {
+            while (emitted[cursor] == true) {
+                ++cursor;
+            }
+            best = cursor;
+        }
+
+        const uint32_t *triangle = &indices[best * 3];
+        emitted[best] = true;
+
+        /* Emit the triangle, moving its vertices to the front of the cache */
+        newCache.clear();
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            uint32_t *first = &adjacency[adjacencyOffsets[v]];
+            uint32_t *last = first + liveTriangles[v];
+
+            output.push_back(v);
+            newCache.push_back(v);
+
+            for (uint32_t *it = first; it != last; ++it) {
+                if (*it == (uint32_t)best) {
+                    *it = *(last - 1);
+                    liveTriangles[v]--;
+                    break;
+                }
+            }
+        }
+        for (std::vector<uint32_t>::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+            if (*it != triangle[0] && *it != triangle[1] && *it != triangle[2]) {
+                newCache.push_back(*it);
+            }
+        }
+
+        /* Update the scores of the vertices in the cache and of the vertices
+         * that were evicted */
+        for (uint32_t i = 0; i < newCache.size(); ++i) {
+            uint32_t v = newCache[i];
+            cachePosition[v] = i < (uint32_t)VertexCacheSize ? (int32_t)i : -1;
+            vertexScores[v] = _vertexScore(cachePosition[v], liveTriangles[v]);
         }
 
-        /* Divide by the number of normals in the average and set it to
-         * the right vertex */
-        asset._vertexData[it->first].normal = glm::normalize(normal);
+        /* The next triangle is the best one among those using cached vertices */
+        float bestScore = -1.0f;
+        best = -1;
+        for (uint32_t i = 0; i < newCache.size(); ++i) {
+            uint32_t v = newCache[i];
+            for (uint32_t j = 0; j < liveTriangles[v]; ++j) {
+                uint32_t t = adjacency[adjacencyOffsets[v] + j];
+                const uint32_t *candidate = &indices[t * 3];
+
+                triangleScores[t] = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (newCache.size() > (size_t)VertexCacheSize) {
+            newCache.resize(VertexCacheSize);
+        }
+        cache.swap(newCache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void Asset3DTransform::OptimizeVertexCache(Asset3D &asset)
+{
+    uint32_t numVertices = (uint32_t)asset._vertexData.size();
+
+    if (asset.isGeometryMapped() == true) {
+        log("ERROR cannot optimize an asset whose geometry is mapped from disk\n");
+        return;
+    }
+
+    /* Weld the vertices that are exactly the same, common in assets
+     * coming from formats with separate indices per attribute */
+    std::vector<uint32_t> sorted(numVertices);
+    std::vector<uint32_t> weld(numVertices);
+    const Asset3D::VertexData *vertices = asset._vertexData.data();
+
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        sorted[v] = v;
+    }
+    std::sort(sorted.begin(), sorted.end(), [vertices](uint32_t a, uint32_t b) {
+        int order = memcmp(&vertices[a], &vertices[b], sizeof vertices[a]);
+        return order < 0 || (order == 0 && a < b);
+    });
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        bool same = i > 0 && memcmp(&vertices[sorted[i]], &vertices[sorted[i - 1]], sizeof vertices[0]) == 0;
+        weld[sorted[i]] = same == true ? weld[sorted[i - 1]] : sorted[i];
+    }
+    for (std::vector<uint32_t>::iterator it = asset._vertexIndices.begin(); it != asset._vertexIndices.end(); ++it) {
+        if (*it != Asset3D::PrimitiveRestartIndex) {
+            *it = weld[*it];
+        }
+    }
+
+    if (asset._primitiveType == Asset3D::PRIMITIVE_TRIANGLES) {
+        for (uint32_t i = 0; i < asset._indicesOffsets.size(); ++i) {
+            _optimizeTriangles(&asset._vertexIndices[asset._indicesOffsets[i]], asset._indicesCount[i], numVertices);
+        }
+    }
+
+    /* Number the vertices in order of first use, dropping the unused ones */
+    std::vector<uint32_t> remap(numVertices, Asset3D::PrimitiveRestartIndex);
+    std::vector<Asset3D::VertexData> vertexData(numVertices);
+    uint32_t next = 0;
+
+    for (std::vector<uint32_t>::iterator it = asset._vertexIndices.begin(); it != asset._vertexIndices.end(); ++it) {
+        if (*it == Asset3D::PrimitiveRestartIndex) {
+            continue;
+        }
+        if (remap[*it] == Asset3D::PrimitiveRestartIndex) {
+            remap[*it] = next++;
+        }
+        *it = remap[*it];
+    }
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        if (remap[v] != Asset3D::PrimitiveRestartIndex) {
+            vertexData[remap[v]] = asset._vertexData[v];
+        }
+    }
+    vertexData.resize(next);
+
+    asset._vertexData.swap(vertexData);
+}
+
+void Asset3DTransform::CompressTextures(Asset3D &asset)
+{
+    for (std::vector<Texture>::iterator it = asset._textures.begin(); it != asset._textures.end(); ++it) {
+        TextureCodec::Compress(*it);
+    }
+}
+
+void Asset3DTransform::GenerateMipmaps(Asset3D &asset)
+{
+    for (std::vector<Texture>::iterator it = asset._textures.begin(); it != asset._textures.end(); ++it) {
+        TextureCodec::GenerateMipmaps(*it);
     }
 }
@@ -0,0 +1,83 @@
+/**
+ * @class FrameArena
+ * @brief Linear allocator for the transient data of a frame
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "FrameArena.hpp"
+
+/* Initial size of the arena, enough for the lists of a typical scene */
+static const size_t _initialSize = 64 * 1024;
+
+FrameArena *FrameArena::_frameArena = NULL;
+
+FrameArena *FrameArena::GetInstance(void)
+{
+    if (_frameArena == NULL) {
+        _frameArena = new FrameArena();
+    }
+    return _frameArena;
+}
+
+void FrameArena::DisposeInstance(void)
+{
+    delete _frameArena;
+    _frameArena = NULL;
+}
+
+FrameArena::FrameArena() : _offset(0), _used(0), _capacity(0) { _grow(_initialSize); }
+FrameArena::~FrameArena()
+{
+    for (std::vector<Block>::iterator it = _blocks.begin(); it != _blocks.end(); ++it) {
+        delete[] it->data;
+    }
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    Block *block = &_blocks.back();
+    uintptr_t address = (uintptr_t)block->data + _offset;
+    size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+
+    if (_offset + padding + size > block->size) {
+        _grow(size + alignment);
+        block = &_blocks.back();
+        address = (uintptr_t)block->data;
+        padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    }
+
+    _offset += padding + size;
+    _used += padding + size;
+    return block->data + (_offset - size);
+}
+
+void FrameArena::reset(void)
+{
+    if (_blocks.size() > 1) {
+        /* The frame did not fit, replace the blocks by one able to hold it all */
+        for (std::vector<Block>::iterator it = _blocks.begin(); it != _blocks.end(); ++it) {
+            delete[] it->data;
+        }
+        size_t size = _capacity;
+
+        _blocks.clear();
+        _capacity = 0;
+        _grow(size);
+    }
+
+    _offset = 0;
+    _used = 0;
+}
+
+void FrameArena::_grow(size_t size)
+{
+    Block block;
+
+    /* Double the capacity at least, so the frame fits in a few steps */
+    block.size = size > _capacity ? size : _capacity;
+    block.data = new uint8_t[block.size];
+
+    _blocks.push_back(block);
+    _capacity += block.size;
+    _offset = 0;
+}
@@ -0,0 +1,269 @@
+/**
+ * @class FrustumCulling
+ * @brief Frustum culling of many objects at once
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "FrustumCulling.hpp"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_LANES 4
+#else
+#define CULLING_LANES 1
+#endif
+
+void CullingBounds::reserve(uint32_t count)
+{
+    uint32_t padded = (count + Lanes - 1) / Lanes * Lanes;
+
+    _spheres.reserve(padded * SPHERE_COUNT);
+    _boxes.reserve(padded * BOX_COUNT);
+    _lastPlane.reserve(padded);
+    _crossing.reserve(padded / Lanes * (Lanes / CULLING_LANES));
+}
+
+void CullingBounds::_resize(uint32_t count)
+{
+    uint32_t padded = (count + Lanes - 1) / Lanes * Lanes;
+    uint32_t previous = (uint32_t)_lastPlane.size();
+
+    if (previous >= padded) {
+        return;
+    }
+    _spheres.resize(padded * SPHERE_COUNT);
+    _boxes.resize(padded * BOX_COUNT);
+    _lastPlane.resize(padded, 0);
+    _crossing.resize(padded / Lanes * (Lanes / CULLING_LANES));
+    for (uint32_t i = previous; i < padded; ++i) {
+        _setCulled(i);
+    }
+}
+
+void CullingBounds::_pad(void)
+{
+    /* Bounds left over by a previous frame with more objects */
+    for (uint32_t i = _size; i < getPaddedSize(); ++i) {
+        _setCulled(i);
+    }
+}
+
+void CullingBounds::_setCulled(uint32_t index)
+{
+    for (uint32_t i = 0; i < SPHERE_COUNT; ++i) {
+        _spheres[_at(index, i, SPHERE_COUNT)] = i == SPHERE_RADIUS ? -FLT_MAX : 0.0f;
+    }
+    for (uint32_t i = 0; i < BOX_COUNT; ++i) {
+        _boxes[_at(index, i, BOX_COUNT)] = 0.0f;
+    }
+}
+
+uint32_t CullingBounds::add(const glm::vec3 &center, float radius, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax)
+{
+    _resize(_size + 1);
+    set(_size, center, radius, aabbMin, aabbMax);
+    return _size++;
+}
+
+uint32_t CullingBounds::addCulled(void)
+{
+    _resize(_size + 1);
+    _setCulled(_size);
+    return _size++;
+}
+
+void CullingBounds::set(uint32_t index, const glm::vec3 &center, float radius, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax)
+{
+    glm::vec3 aabbCenter = (aabbMin + aabbMax) * 0.5f;
+    glm::vec3 extent = (aabbMax - aabbMin) * 0.5f;
+    float *sphere = &_spheres[_at(index, 0, SPHERE_COUNT)];
+    float *box = &_boxes[_at(index, 0, BOX_COUNT)];
+
+    sphere[SPHERE_X * Lanes] = center.x;
+    sphere[SPHERE_Y * Lanes] = center.y;
+    sphere[SPHERE_Z * Lanes] = center.z;
+    sphere[SPHERE_RADIUS * Lanes] = radius;
+    box[BOX_X * Lanes] = aabbCenter.x;
+    box[BOX_Y * Lanes] = aabbCenter.y;
+    box[BOX_Z * Lanes] = aabbCenter.z;
+    box[BOX_EXTENT_X * Lanes] = extent.x;
+    box[BOX_EXTENT_Y * Lanes] = extent.y;
+    box[BOX_EXTENT_Z * Lanes] = extent.z;
+}
+
+void FrustumCulling::CullScalar(const glm::vec4 planes[NumPlanes], CullingBounds &bounds, uint32_t *visible)
+{
+    const uint32_t lanes = CullingBounds::Lanes;
+
+    memset(visible, 0, bounds.getMaskWords() * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < bounds.size(); ++i) {
+        const float *sphere = &bounds._spheres[CullingBounds::_at(i, 0, CullingBounds::SPHERE_COUNT)];
+        uint32_t plane = bounds._lastPlane[i];
+        float radius = sphere[CullingBounds::SPHERE_RADIUS * lanes];
+        bool culled = false, inside = true;
+
+        /* Bounding sphere, starting with the plane that culled it last time */
+        for (uint32_t j = 0; j < NumPlanes && culled == false; ++j, plane = plane + 1 < NumPlanes ? plane + 1 : 0) {
+            const glm::vec4 &p = planes[plane];
+            float distance = p.x * sphere[CullingBounds::SPHERE_X * lanes] + p.y * sphere[CullingBounds::SPHERE_Y * lanes] +
+                             p.z * sphere[CullingBounds::SPHERE_Z * lanes] + p.w;
+
+            if (distance < -radius) {
+                bounds._lastPlane[i] = plane;
+                culled = true;
+            }
+            inside = inside && distance >= radius;
+        }
+
+        /* The AABB of the spheres crossing a plane, using the distance of its
+         * vertex furthest along the plane normal */
+        if (culled == false && inside == false) {
+            const float *box = &bounds._boxes[CullingBounds::_at(i, 0, CullingBounds::BOX_COUNT)];
+
+            for (uint32_t j = 0; j < NumPlanes && culled == false; ++j) {
+                const glm::vec4 &p = planes[j];
+                float distance = p.x * box[CullingBounds::BOX_X * lanes] + p.y * box[CullingBounds::BOX_Y * lanes] +
+                                 p.z * box[CullingBounds::BOX_Z * lanes] + p.w + fabsf(p.x) * box[CullingBounds::BOX_EXTENT_X * lanes] +
+                                 fabsf(p.y) * box[CullingBounds::BOX_EXTENT_Y * lanes] + fabsf(p.z) * box[CullingBounds::BOX_EXTENT_Z * lanes];
+
+                culled = distance < 0.0f;
+            }
+        }
+
+        if (culled == false) {
+            visible[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+#if CULLING_LANES > 1
+
+#if CULLING_LANES == 8
+typedef __m256 Lane;
+
+static inline Lane _load(const float *p) { return _mm256_loadu_ps(p); }
+static inline Lane _set(float value) { return _mm256_set1_ps(value); }
+static inline Lane _add(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+static inline Lane _mul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+static inline Lane _less(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline Lane _greaterEqual(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline Lane _and(Lane a, Lane b) { return _mm256_and_ps(a, b); }
+static inline Lane _or(Lane a, Lane b) { return _mm256_or_ps(a, b); }
+static inline Lane _ones(void) { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+static inline uint32_t _mask(Lane a) { return (uint32_t)_mm256_movemask_ps(a); }
+#else
+typedef __m128 Lane;
+
+static inline Lane _load(const float *p) { return _mm_loadu_ps(p); }
+static inline Lane _set(float value) { return _mm_set1_ps(value); }
+static inline Lane _add(Lane a, Lane b) { return _mm_add_ps(a, b); }
+static inline Lane _mul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+static inline Lane _less(Lane a, Lane b) { return _mm_cmplt_ps(a, b); }
+static inline Lane _greaterEqual(Lane a, Lane b) { return _mm_cmpge_ps(a, b); }
+static inline Lane _and(Lane a, Lane b) { return _mm_and_ps(a, b); }
+static inline Lane _or(Lane a, Lane b) { return _mm_or_ps(a, b); }
+static inline Lane _ones(void) { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+static inline uint32_t _mask(Lane a) { return (uint32_t)_mm_movemask_ps(a); }
+#endif
+
+/**
+ * Distance from the points to a plane, with the same order of operations
+ * than the scalar kernel so both give the same results
+ */
+static inline Lane _distance(const Lane plane[4], Lane x, Lane y, Lane z)
+{
+    return _add(_add(_add(_mul(plane[0], x), _mul(plane[1], y)), _mul(plane[2], z)), plane[3]);
+}
+
+void FrustumCulling::Cull(const glm::vec4 planes[NumPlanes], CullingBounds &bounds, uint32_t *visible)
+{
+    const uint32_t allLanes = (1u << CULLING_LANES) - 1;
+    const uint32_t lanes = CullingBounds::Lanes;
+    Lane plane[NumPlanes][4], absNormal[NumPlanes][3];
+    Lane zero = _set(0.0f), ones = _ones();
+    uint32_t numCrossing = 0;
+
+    memset(visible, 0, bounds.getMaskWords() * sizeof(uint32_t));
+    if (bounds.size() == 0) {
+        return;
+    }
+
+    bounds._pad();
+    for (uint32_t i = 0; i < NumPlanes; ++i) {
+        for (uint32_t j = 0; j < 4; ++j) {
+            plane[i][j] = _set(planes[i][j]);
+        }
+        for (uint32_t j = 0; j < 3; ++j) {
+            absNormal[i][j] = _set(fabsf(planes[i][j]));
+        }
+    }
+
+    for (uint32_t first = 0; first < bounds.getPaddedSize(); first += CULLING_LANES) {
+        const float *sphere = &bounds._spheres[CullingBounds::_at(first, 0, CullingBounds::SPHERE_COUNT)];
+        Lane x = _load(sphere + CullingBounds::SPHERE_X * lanes);
+        Lane y = _load(sphere + CullingBounds::SPHERE_Y * lanes);
+        Lane z = _load(sphere + CullingBounds::SPHERE_Z * lanes);
+        Lane radius = _load(sphere + CullingBounds::SPHERE_RADIUS * lanes);
+        Lane minusRadius = _mul(radius, _set(-1.0f));
+        Lane culled = zero, inside = ones;
+
+        /* Bounding spheres against all the planes, without branches as the
+         * lanes of an iteration are rarely culled by the same plane */
+        for (uint32_t p = 0; p < NumPlanes; ++p) {
+            Lane distance = _distance(plane[p], x, y, z);
+
+            culled = _or(culled, _less(distance, minusRadius));
+            inside = _and(inside, _greaterEqual(distance, radius));
+        }
+        uint32_t remaining = allLanes & ~_mask(culled);
+        uint32_t crossing = remaining & ~_mask(inside);
+
+        /* The AABBs are tested afterwards, so this loop only reads the spheres */
+        bounds._crossing[numCrossing].first = first;
+        bounds._crossing[numCrossing].lanes = crossing;
+        numCrossing += crossing != 0;
+
+        visible[first / 32] |= remaining << (first % 32);
+    }
+
+    /* AABBs of the visible spheres crossing a plane, only their groups are read */
+    for (uint32_t i = 0; i < numCrossing; ++i) {
+        uint32_t first = bounds._crossing[i].first;
+        const float *box = &bounds._boxes[CullingBounds::_at(first, 0, CullingBounds::BOX_COUNT)];
+        Lane centerX = _load(box + CullingBounds::BOX_X * lanes);
+        Lane centerY = _load(box + CullingBounds::BOX_Y * lanes);
+        Lane centerZ = _load(box + CullingBounds::BOX_Z * lanes);
+        Lane extentX = _load(box + CullingBounds::BOX_EXTENT_X * lanes);
+        Lane extentY = _load(box + CullingBounds::BOX_EXTENT_Y * lanes);
+        Lane extentZ = _load(box + CullingBounds::BOX_EXTENT_Z * lanes);
+        uint32_t culled = 0;
+
+        for (uint32_t p = 0; p < NumPlanes; ++p) {
+            Lane distance = _add(_add(_add(_distance(plane[p], centerX, centerY, centerZ), _mul(absNormal[p][0], extentX)),
+                                      _mul(absNormal[p][1], extentY)),
+                                 _mul(absNormal[p][2], extentZ));
+
+            culled |= _mask(_less(distance, zero));
+        }
+
+        visible[first / 32] &= ~((culled & bounds._crossing[i].lanes) << (first % 32));
+    }
+}
+
+#else
+
+void FrustumCulling::Cull(const glm::vec4 planes[NumPlanes], CullingBounds &bounds, uint32_t *visible)
+{
+    CullScalar(planes, bounds, visible);
+}
+
+#endif
+
+uint32_t FrustumCulling::GetLanes(void) { return CULLING_LANES; }
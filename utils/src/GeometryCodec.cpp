@@ -0,0 +1,190 @@
+/**
+ * @class GeometryCodec
+ * @brief Reversible filters for vertex and index streams that make them
+ *        much easier to compress by a generic codec afterwards
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "GeometryCodec.hpp"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMETRY_CODEC_SSE2
+#endif
+
+template <typename T>
+static inline T _zigzag(T delta)
+{
+    return (T)((delta << 1) ^ (T)(0 - (delta >> (sizeof(T) * 8 - 1))));
+}
+
+template <typename T>
+static inline T _unzigzag(T value)
+{
+    return (T)((value >> 1) ^ (T)(0 - (value & 1)));
+}
+
+/**
+ * Delta codes each component against the previous element and splits
+ * the result in byte planes, one group of planes per component
+ */
+template <typename T>
+static void _encode(const T *elements, uint32_t count, uint32_t components, uint8_t *output)
+{
+    for (uint32_t c = 0; c < components; ++c) {
+        uint8_t *planes = output + (size_t)c * sizeof(T) * count;
+        T previous = 0;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            T value = elements[(size_t)i * components + c];
+            T encoded = _zigzag<T>((T)(value - previous));
+
+            for (uint32_t b = 0; b < sizeof(T); ++b) {
+                planes[(size_t)b * count + i] = (uint8_t)(encoded >> (b * 8));
+            }
+            previous = value;
+        }
+    }
+}
+
+/**
+ * Decodes the elements from 'first' onwards, continuing from 'previous'
+ */
+template <typename T>
+static void _decodeScalar(const uint8_t *planes, uint32_t first, uint32_t count, uint32_t components, T previous, T *elements)
+{
+    for (uint32_t i = first; i < count; ++i) {
+        T encoded = 0;
+
+        for (uint32_t b = 0; b < sizeof(T); ++b) {
+            encoded |= (T)planes[(size_t)b * count + i] << (b * 8);
+        }
+        previous = (T)(previous + _unzigzag<T>(encoded));
+        *elements = previous;
+        elements += components;
+    }
+}
+
+#if defined(GEOMETRY_CODEC_SSE2)
+static inline __m128i _load32(const uint8_t *p)
+{
+    int32_t value;
+    memcpy(&value, p, sizeof value);
+    return _mm_cvtsi32_si128(value);
+}
+
+static inline __m128i _load64(const uint8_t *p)
+{
+    return _mm_loadl_epi64((const __m128i *)p);
+}
+
+/**
+ * Decodes one 32-bit component, four elements at a time
+ */
+static void _decode32(const uint8_t *planes, uint32_t count, uint32_t components, uint32_t *elements)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i previous = zero;
+    uint32_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        /* Gather the 4 bytes of 4 elements from each plane */
+        __m128i low = _mm_unpacklo_epi8(_load32(planes + i), _load32(planes + count + i));
+        __m128i high = _mm_unpacklo_epi8(_load32(planes + 2 * count + i), _load32(planes + 3 * count + i));
+        __m128i values = _mm_unpacklo_epi16(low, high);
+
+        /* Undo the zig-zag coding and accumulate the deltas */
+        values = _mm_xor_si128(_mm_srli_epi32(values, 1), _mm_sub_epi32(zero, _mm_and_si128(values, one)));
+        values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+        values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+        values = _mm_add_epi32(values, previous);
+        previous = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+
+        if (components == 1) {
+            _mm_storeu_si128((__m128i *)(elements + i), values);
+        } else {
+            uint32_t decoded[4];
+            _mm_storeu_si128((__m128i *)decoded, values);
+            elements[(size_t)i * components] = decoded[0];
+            elements[(size_t)(i + 1) * components] = decoded[1];
+            elements[(size_t)(i + 2) * components] = decoded[2];
+            elements[(size_t)(i + 3) * components] = decoded[3];
+        }
+    }
+
+    _decodeScalar<uint32_t>(planes, i, count, components, (uint32_t)_mm_cvtsi128_si32(previous), elements + (size_t)i * components);
+}
+
+/**
+ * Decodes 16-bit indices, eight elements at a time
+ */
+static void _decode16(const uint8_t *planes, uint32_t count, uint16_t *elements)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i previous = zero;
+    uint32_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i values = _mm_unpacklo_epi8(_load64(planes + i), _load64(planes + count + i));
+
+        values = _mm_xor_si128(_mm_srli_epi16(values, 1), _mm_sub_epi16(zero, _mm_and_si128(values, one)));
+        values = _mm_add_epi16(values, _mm_slli_si128(values, 2));
+        values = _mm_add_epi16(values, _mm_slli_si128(values, 4));
+        values = _mm_add_epi16(values, _mm_slli_si128(values, 8));
+        values = _mm_add_epi16(values, previous);
+        previous = _mm_set1_epi16((short)_mm_extract_epi16(values, 7));
+
+        _mm_storeu_si128((__m128i *)(elements + i), values);
+    }
+
+    _decodeScalar<uint16_t>(planes, i, count, 1, (uint16_t)_mm_extract_epi16(previous, 0), elements + i);
+}
+#endif
+
+void GeometryCodec::EncodeVertices(const void *vertices, uint32_t count, uint32_t stride, uint8_t *output)
+{
+    _encode<uint32_t>((const uint32_t *)vertices, count, stride / sizeof(uint32_t), output);
+}
+
+void GeometryCodec::DecodeVertices(const uint8_t *input, uint32_t count, uint32_t stride, void *vertices)
+{
+    uint32_t components = stride / sizeof(uint32_t);
+
+    for (uint32_t c = 0; c < components; ++c) {
+        const uint8_t *planes = input + (size_t)c * sizeof(uint32_t) * count;
+#if defined(GEOMETRY_CODEC_SSE2)
+        _decode32(planes, count, components, (uint32_t *)vertices + c);
+#else
+        _decodeScalar<uint32_t>(planes, 0, count, components, 0, (uint32_t *)vertices + c);
+#endif
+    }
+}
+
+void GeometryCodec::EncodeIndices(const void *indices, uint32_t count, uint32_t indexSize, uint8_t *output)
+{
+    if (indexSize == sizeof(uint16_t)) {
+        _encode<uint16_t>((const uint16_t *)indices, count, 1, output);
+    } else {
+        _encode<uint32_t>((const uint32_t *)indices, count, 1, output);
+    }
+}
+
+void GeometryCodec::DecodeIndices(const uint8_t *input, uint32_t count, uint32_t indexSize, void *indices)
+{
+#if defined(GEOMETRY_CODEC_SSE2)
+    if (indexSize == sizeof(uint16_t)) {
+        _decode16(input, count, (uint16_t *)indices);
+    } else {
+        _decode32(input, count, 1, (uint32_t *)indices);
+    }
+#else
+    if (indexSize == sizeof(uint16_t)) {
+        _decodeScalar<uint16_t>(input, 0, count, 1, 0, (uint16_t *)indices);
+    } else {
+        _decodeScalar<uint32_t>(input, 0, count, 1, 0, (uint32_t *)indices);
+    }
+#endif
+}
@@ -3,9 +3,12 @@
 #include <jerror.h>
 #include <jpeglib.h>
 #include <png.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
+#include "MappedFile.hpp"
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -47,173 +50,259 @@ static void jpeg_mem_src(j_decompress_ptr cinfo, void *buffer, long nbytes)
 }
 #endif
 
-int ImageLoaders::loadJPEG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel)
+/**
+ * Smallest power of two reduction that fits the image in maxDimension
+ */
+static uint32_t _reduction(uint32_t width, uint32_t height, uint32_t maxDimension, uint32_t maxReduction)
 {
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    int rowStride;
+    uint32_t reduction = 1;
 
-    FILE *file = fopen(filename, "rb");
-    if (file == NULL) {
-        fprintf(stderr, "ERROR opening JPEG file %s\n", filename);
-        return -1;
+    if (maxDimension > 0) {
+        while (reduction < maxReduction &&
+               ((width + reduction - 1) / reduction > maxDimension || (height + reduction - 1) / reduction > maxDimension)) {
+            reduction *= 2;
+        }
     }
+    return reduction;
+}
+
+/**
+ * libjpeg error manager that returns to the decoder instead of exiting
+ */
+struct JPEGErrorManager {
+    struct jpeg_error_mgr manager;
+    jmp_buf jump;
+};
 
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+static void _jpegErrorExit(j_common_ptr cinfo)
+{
+    JPEGErrorManager *error = (JPEGErrorManager *)cinfo->err;
+    char message[JMSG_LENGTH_MAX];
 
-    if (size == -1) {
-        fclose(file);
+    (*cinfo->err->format_message)(cinfo, message);
+    fprintf(stderr, "ERROR decoding JPEG: %s\n", message);
+    longjmp(error->jump, 1);
+}
+
+int ImageLoaders::decodeJPEG(const char *filename, const ImageAllocator &allocate, uint32_t maxDimension, uint32_t *width, uint32_t *height,
+                             uint32_t *bytesPerPixel)
+{
+    struct jpeg_decompress_struct cinfo;
+    JPEGErrorManager error;
+    MappedFile file;
+
+    if (file.open(filename) == false || file.getSize() == 0) {
+        fprintf(stderr, "ERROR opening JPEG file %s\n", filename);
         return -1;
     }
-    char *jpeg = (char *)malloc(size);
-    size_t count = fread(jpeg, sizeof(char), size, file);
-    if (count != size) {
-        free(jpeg);
-        fclose(file);
+
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = _jpegErrorExit;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&cinfo);
         return -1;
     }
 
-    cinfo.err = jpeg_std_error(&jerr);
     jpeg_create_decompress(&cinfo);
-
-    jpeg_mem_src(&cinfo, (unsigned char *)jpeg, size);
+    jpeg_mem_src(&cinfo, (unsigned char *)file.getData(), (unsigned long)file.getSize());
     jpeg_read_header(&cinfo, TRUE);
+
+    /* Grayscale images are expanded, and big images are reduced by the
+     * IDCT itself, which then only computes the coefficients needed */
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = _reduction(cinfo.image_width, cinfo.image_height, maxDimension, 8);
     jpeg_start_decompress(&cinfo);
 
     *width = cinfo.output_width;
     *height = cinfo.output_height;
-    *bytesPerPixel = cinfo.out_color_components;
-
-    *image = (uint8_t *)malloc((*width) * (*height) * (*bytesPerPixel));
+    *bytesPerPixel = cinfo.output_components;
 
-    rowStride = cinfo.output_width * cinfo.output_components;
-
-    JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, rowStride, 1);
+    uint8_t *image = allocate(*width, *height, *bytesPerPixel);
+    if (image == NULL) {
+        jpeg_destroy_decompress(&cinfo);
+        return -1;
+    }
 
+    /* The scanlines are decoded straight into the destination */
+    size_t rowStride = (size_t)cinfo.output_width * cinfo.output_components;
     while (cinfo.output_scanline < cinfo.output_height) {
-        (void)jpeg_read_scanlines(&cinfo, buffer, 1);
-        memcpy(&(*image)[(cinfo.output_scanline - 1) * rowStride], buffer[0], rowStride);
+        JSAMPROW rows[4];
+        for (uint32_t i = 0; i < 4; ++i) {
+            uint32_t y = cinfo.output_scanline + i < cinfo.output_height ? cinfo.output_scanline + i : cinfo.output_height - 1;
+            rows[i] = image + y * rowStride;
+        }
+        (void)jpeg_read_scanlines(&cinfo, rows, 4);
     }
 
     (void)jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
-
-    free(jpeg);
-    fclose(file);
-
     return 0;
 }
 
-int ImageLoaders::loadPNG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel)
+/**
+ * Reads the PNG stream from the mapped file
+ */
+struct PNGSource {
+    const uint8_t *data; /**< Start of the file */
+    size_t size;         /**< Size of the file */
+    size_t offset;       /**< Bytes already read */
+};
+
+static void _pngRead(png_structp png, png_bytep data, png_size_t length)
 {
-    uint32_t y;
-    uint32_t ret = 0;
-    // png_byte color_type;
-    // png_byte bit_depth;
-    png_structp png_ptr;
-    png_infop info_ptr;
-    // int number_of_passes;
-    png_bytep *row_pointers;
-    uint32_t row_size_bytes;
-
-    char header[8];  // 8 is the maximum size that can be checked
-
-    /* open file and test for it being a png */
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        fprintf(stderr, "ERROR opening PNG file %s\n", filename);
-        return -1;
-    }
+    PNGSource *source = (PNGSource *)png_get_io_ptr(png);
 
-    if (fread(header, sizeof *header, sizeof header, fp) != sizeof header) {
-        fprintf(stderr, "ERROR reading PNG header from %s\n", filename);
-        return -1;
+    if (length > source->size - source->offset) {
+        png_error(png, "unexpected end of file");
     }
+    memcpy(data, source->data + source->offset, length);
+    source->offset += length;
+}
 
-    if (png_sig_cmp((png_bytep)header, 0, sizeof header)) {
-        fprintf(stderr, "ERROR file %s is not recognized as a PNG file", filename);
-        return -1;
+/**
+ * Keeps one of every 'reduction' texels of a row
+ */
+static void _decimateRow(const uint8_t *row, uint32_t width, uint32_t bytesPerPixel, uint32_t reduction, uint8_t *destination)
+{
+    for (uint32_t x = 0; x < width; x += reduction) {
+        memcpy(destination, row + (size_t)x * bytesPerPixel, bytesPerPixel);
+        destination += bytesPerPixel;
     }
+}
 
-    /* initialize stuff */
-    png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+int ImageLoaders::decodePNG(const char *filename, const ImageAllocator &allocate, uint32_t maxDimension, uint32_t *width, uint32_t *height,
+                            uint32_t *bytesPerPixel)
+{
+    const size_t signatureSize = 8;
+    std::vector<uint8_t> scratch;
+    MappedFile file;
 
-    if (png_ptr == NULL) {
-        fprintf(stderr, "ERROR png_create_read_struct failed for %s\n", filename);
+    if (file.open(filename) == false) {
+        fprintf(stderr, "ERROR opening PNG file %s\n", filename);
         return -1;
     }
 
-    info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == NULL) {
-        fprintf(stderr, "ERROR png_create_info_struct failed for %s\n", filename);
+    if (file.getSize() < signatureSize || png_sig_cmp((png_bytep)file.getData(), 0, signatureSize)) {
+        fprintf(stderr, "ERROR file %s is not recognized as a PNG file\n", filename);
         return -1;
     }
 
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        fprintf(stderr, "ERROR during init_io for %s\n", filename);
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png != NULL ? png_create_info_struct(png) : NULL;
+    if (info == NULL) {
+        fprintf(stderr, "ERROR creating the PNG decoder for %s\n", filename);
+        png_destroy_read_struct(&png, NULL, NULL);
         return -1;
     }
 
-    png_init_io(png_ptr, fp);
-    png_set_sig_bytes(png_ptr, 8);
-
-    png_read_info(png_ptr, info_ptr);
-
-    *width = png_get_image_width(png_ptr, info_ptr);
-    *height = png_get_image_height(png_ptr, info_ptr);
-    // color_type = png_get_color_type(png_ptr, info_ptr);
-    *bytesPerPixel = png_get_bit_depth(png_ptr, info_ptr) / 8;
-
-    // number_of_passes = png_set_interlace_handling(png_ptr);
-    png_read_update_info(png_ptr, info_ptr);
-
-    /* read file */
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        fprintf(stderr, "ERROR during read_image for %s\n", filename);
+    if (setjmp(png_jmpbuf(png))) {
+        fprintf(stderr, "ERROR decoding PNG file %s\n", filename);
+        png_destroy_read_struct(&png, &info, NULL);
         return -1;
     }
 
-    row_size_bytes = png_get_rowbytes(png_ptr, info_ptr);
-    *image = (uint8_t *)malloc(row_size_bytes * (*height));
-    if ((*image) == NULL) {
-        fprintf(stderr, "ERROR allocating memory for final image for %s\n", filename);
-        return -1;
+    PNGSource source = {file.getData(), file.getSize(), signatureSize};
+    png_set_read_fn(png, &source, _pngRead);
+    png_set_sig_bytes(png, signatureSize);
+    png_read_info(png, info);
+
+    /* Everything is converted to 8-bit RGB or RGBA */
+    png_byte colorType = png_get_color_type(png, info);
+    if (colorType == PNG_COLOR_TYPE_PALETTE || png_get_bit_depth(png, info) < 8 || png_get_valid(png, info, PNG_INFO_tRNS)) {
+        png_set_expand(png);
+    }
+    if (png_get_bit_depth(png, info) == 16) {
+        png_set_strip_16(png);
+    }
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        png_set_gray_to_rgb(png);
     }
+    int passes = png_set_interlace_handling(png);
+    png_read_update_info(png, info);
 
-    row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * (*height));
-    if (row_pointers == NULL) {
-        fprintf(stderr, "ERROR allocating memory for final image for %s\n", filename);
-        free(*image);
-        *image = NULL;
+    uint32_t sourceWidth = png_get_image_width(png, info);
+    uint32_t sourceHeight = png_get_image_height(png, info);
+    uint32_t reduction = _reduction(sourceWidth, sourceHeight, maxDimension, 0x80000000);
+    size_t rowBytes = png_get_rowbytes(png, info);
+
+    *width = (sourceWidth + reduction - 1) / reduction;
+    *height = (sourceHeight + reduction - 1) / reduction;
+    *bytesPerPixel = png_get_channels(png, info);
+
+    uint8_t *image = allocate(*width, *height, *bytesPerPixel);
+    if (image == NULL) {
+        png_destroy_read_struct(&png, &info, NULL);
         return -1;
     }
 
-    memset(row_pointers, 0, sizeof(png_bytep) * (*height));
-
-    for (y = 0; y < (*height); y++) {
-        row_pointers[y] = (png_byte *)malloc(row_size_bytes);
-        if (row_pointers[y] == NULL) {
-            fprintf(stderr, "ERROR allocating memory for the row number %d for %s\n", y, filename);
-            ret = -1;
-            goto error;
+    size_t stride = (size_t)*width * *bytesPerPixel;
+    if (reduction == 1) {
+        /* The rows are decoded straight into the destination, each pass of an
+         * interlaced image refines them */
+        for (int pass = 0; pass < passes; ++pass) {
+            for (uint32_t y = 0; y < sourceHeight; ++y) {
+                png_read_row(png, image + y * stride, NULL);
+            }
+        }
+    } else if (passes == 1) {
+        /* Every row has to be inflated, but only the ones kept are copied */
+        scratch.resize(rowBytes);
+        for (uint32_t y = 0; y < sourceHeight; ++y) {
+            png_read_row(png, scratch.data(), NULL);
+            if (y % reduction == 0) {
+                _decimateRow(scratch.data(), sourceWidth, *bytesPerPixel, reduction, image + (y / reduction) * stride);
+            }
+        }
+    } else {
+        /* Interlaced images are only complete after the last pass */
+        scratch.resize(rowBytes * sourceHeight);
+        for (int pass = 0; pass < passes; ++pass) {
+            for (uint32_t y = 0; y < sourceHeight; ++y) {
+                png_read_row(png, scratch.data() + y * rowBytes, NULL);
+            }
+        }
+        for (uint32_t y = 0; y < *height; ++y) {
+            _decimateRow(scratch.data() + (size_t)y * reduction * rowBytes, sourceWidth, *bytesPerPixel, reduction, image + y * stride);
         }
     }
 
-    png_read_image(png_ptr, row_pointers);
-
-    fclose(fp);
-
-    /* Now copy the data to the final location */
-    for (y = 0; y < (*height); y++) {
-        memcpy(&(*image)[row_size_bytes * y], row_pointers[y], row_size_bytes);
-    }
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+    return 0;
+}
 
-error:
-    for (y = 0; y < (*height); y++) {
-        free(row_pointers[y]);
+/**
+ * Decodes an image into a buffer allocated with malloc(), which is freed
+ * if the decoding fails
+ */
+static int _load(int (*decode)(const char *, const ImageLoaders::ImageAllocator &, uint32_t, uint32_t *, uint32_t *, uint32_t *),
+                 const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel, uint32_t maxDimension)
+{
+    uint8_t *buffer = NULL;
+    int ret = decode(filename,
+                     [&buffer](uint32_t imageWidth, uint32_t imageHeight, uint32_t imageBytesPerPixel) {
+                         buffer = (uint8_t *)malloc((size_t)imageWidth * imageHeight * imageBytesPerPixel);
+                         return buffer;
+                     },
+                     maxDimension, width, height, bytesPerPixel);
+
+    if (ret != 0) {
+        free(buffer);
+        buffer = NULL;
     }
-    free(row_pointers);
+    *image = buffer;
     return ret;
 }
+
+int ImageLoaders::loadJPEG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel,
+                           uint32_t maxDimension)
+{
+    return _load(decodeJPEG, filename, image, width, height, bytesPerPixel, maxDimension);
+}
+
+int ImageLoaders::loadPNG(const char *filename, uint8_t **image, uint32_t *width, uint32_t *height, uint32_t *bytesPerPixel,
+                          uint32_t maxDimension)
+{
+    return _load(decodePNG, filename, image, width, height, bytesPerPixel, maxDimension);
+}
@@ -46,19 +46,20 @@ void Logging::log(const char *msg, const Asset3D &asset)
 
     printf("[Asset3D] %s\n", msg);
 
-    printf("  [Vertices] %lu\n", asset.getVertexData().size());
-    i = 0;
-    for (std::vector<Asset3D::VertexData>::const_iterator it = asset.getVertexData().begin(); it != asset.getVertexData().end();
-         ++it, ++i) {
-        printf("    [%05d] vertex: [%f, %f, %f]\n", i, it->vertex.x, it->vertex.y, it->vertex.z);
-        printf("            normal: [%f, %f, %f]\n", it->normal.x, it->normal.y, it->normal.z);
-        printf("            uvcoord:[%f, %f]\n", it->uvcoord.x, it->uvcoord.y);
+    /* The geometry can be mapped from disk, with 16-bit indices, or released */
+    const Asset3D::VertexData *vertices = asset.getVertexDataPtr();
+    printf("  [Vertices] %u%s\n", asset.getNumVertices(), vertices == NULL ? " (released)" : "");
+    for (i = 0; vertices != NULL && i < asset.getNumVertices(); ++i) {
+        printf("    [%05d] vertex: [%f, %f, %f]\n", i, vertices[i].vertex.x, vertices[i].vertex.y, vertices[i].vertex.z);
+        printf("            normal: [%f, %f, %f]\n", vertices[i].normal.x, vertices[i].normal.y, vertices[i].normal.z);
+        printf("            uvcoord:[%f, %f]\n", vertices[i].uvcoord.x, vertices[i].uvcoord.y);
     }
 
-    printf("  [Indices] %lu\n", asset.getIndexData().size());
-    i = 0;
-    for (std::vector<uint32_t>::const_iterator it = asset.getIndexData().begin(); it != asset.getIndexData().end(); ++it, ++i) {
-        printf("    [%05d] index: %d\n", i, *it);
+    const void *indices = asset.getIndexDataPtr();
+    printf("  [Indices] %u%s\n", asset.getNumIndices(), indices == NULL ? " (released)" : "");
+    for (i = 0; indices != NULL && i < asset.getNumIndices(); ++i) {
+        uint32_t index = asset.getIndexDataSize() == sizeof(uint16_t) ? ((const uint16_t *)indices)[i] : ((const uint32_t *)indices)[i];
+        printf("    [%05d] index: %u\n", i, index);
     }
 
     printf("  [Materials] %lu\n", asset.getMaterials().size());
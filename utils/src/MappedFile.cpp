@@ -0,0 +1,147 @@
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a file
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "MappedFile.hpp"
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "Logging.hpp"
+
+using namespace Logging;
+
+#if defined(_WIN32) || defined(_WIN64)
+MappedFile::MappedFile() : _data(NULL), _size(0), _isOpen(false), _file(INVALID_HANDLE_VALUE), _mapping(NULL) {}
+#else
+MappedFile::MappedFile() : _data(NULL), _size(0), _isOpen(false) {}
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+#if defined(_WIN32) || defined(_WIN64)
+bool MappedFile::open(const std::string &name)
+{
+    LARGE_INTEGER size;
+
+    close();
+
+    _file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (_file == INVALID_HANDLE_VALUE) {
+        log("ERROR opening file %s\n", name.c_str());
+        return false;
+    }
+
+    if (GetFileSizeEx(_file, &size) == 0) {
+        log("ERROR retrieving size of file %s\n", name.c_str());
+        close();
+        return false;
+    }
+
+    _size = (size_t)size.QuadPart;
+    _isOpen = true;
+
+    /* Empty files cannot be mapped */
+    if (_size == 0) {
+        return true;
+    }
+
+    _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (_mapping == NULL) {
+        log("ERROR creating mapping for file %s\n", name.c_str());
+        close();
+        return false;
+    }
+
+    _data = (const uint8_t *)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (_data == NULL) {
+        log("ERROR mapping file %s\n", name.c_str());
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data != NULL) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping != NULL) {
+        CloseHandle(_mapping);
+    }
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+    }
+
+    _data = NULL;
+    _size = 0;
+    _isOpen = false;
+    _file = INVALID_HANDLE_VALUE;
+    _mapping = NULL;
+}
+#else
+bool MappedFile::open(const std::string &name)
+{
+    struct stat info;
+
+    close();
+
+    int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd == -1) {
+        log("ERROR opening file %s\n", name.c_str());
+        return false;
+    }
+
+    if (fstat(fd, &info) == -1) {
+        log("ERROR retrieving size of file %s\n", name.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    _size = (size_t)info.st_size;
+    _isOpen = true;
+
+    /* Empty files cannot be mapped */
+    if (_size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void *data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    /* The mapping keeps its own reference to the file */
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        log("ERROR mapping file %s\n", name.c_str());
+        _size = 0;
+        _isOpen = false;
+        return false;
+    }
+
+    /* Files are mostly parsed front to back */
+    madvise(data, _size, MADV_SEQUENTIAL);
+
+    _data = (const uint8_t *)data;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data != NULL) {
+        munmap((void *)_data, _size);
+    }
+
+    _data = NULL;
+    _size = 0;
+    _isOpen = false;
+}
+#endif
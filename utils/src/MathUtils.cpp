@@ -4,9 +4,23 @@
  * @author Roberto Cano
  */
 #include "MathUtils.hpp"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtx/compatibility.hpp>
 #include "Logging.hpp"
+#include "WorkerPool.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PERLIN_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PERLIN_LANES 4
+#else
+#define PERLIN_LANES 1
+#endif
 
 using namespace Logging;
 
@@ -33,25 +47,29 @@ float MathUtils::restrictAngle(float angle)
 /**
  * Perlin noise implementation
  */
-double MathUtils::Perlin::Noise(double x, double y, double z) { return _getPerlin()->_noise(x, y, z); }
+double MathUtils::Perlin::Noise(double x, double y, double z) { return _getPerlin().noise(x, y, z); }
 double MathUtils::Perlin::Octave(double x, double y, double z, uint8_t octaves, double persistence)
 {
-    return _getPerlin()->_octave(x, y, z, octaves, persistence);
+    return _getPerlin().octave(x, y, z, octaves, persistence);
 }
 
-MathUtils::Perlin *MathUtils::Perlin::_getPerlin()
+void MathUtils::Perlin::OctaveGrid(float *values, uint32_t rows, uint32_t columns, const glm::vec3 &origin, const glm::vec3 &rowStep,
+                                   const glm::vec3 &columnStep, uint8_t octaves, float persistence)
 {
-    static MathUtils::Perlin *_perlin = NULL;
+    _getPerlin().octaveGrid(values, rows, columns, origin, rowStep, columnStep, octaves, persistence);
+}
 
-    if (_perlin == NULL) {
-        _perlin = new MathUtils::Perlin();
-    }
-    return _perlin;
+uint32_t MathUtils::Perlin::GetLanes(void) { return PERLIN_LANES; }
+const MathUtils::Perlin &MathUtils::Perlin::_getPerlin()
+{
+    static const MathUtils::Perlin perlin;
+
+    return perlin;
 }
 
-MathUtils::Perlin::Perlin()
+MathUtils::Perlin::Perlin(uint32_t seed)
 {
-    uint8_t perlinPerms[] = {
+    static const uint8_t perlinPerms[] = {
         151, 160, 137, 91,  90,  15,  131, 13,  201, 95,  96,  53,  194, 233, 7,   225, 140, 36,  103, 30,  69,  142, 8,   99,  37,  240,
         21,  10,  23,  190, 6,   148, 247, 120, 234, 75,  0,   26,  197, 62,  94,  252, 219, 203, 117, 35,  11,  32,  57,  177, 33,  88,
         237, 149, 56,  87,  174, 20,  125, 136, 171, 168, 68,  175, 74,  165, 71,  134, 139, 48,  27,  166, 77,  146, 158, 231, 83,  111,
@@ -63,33 +81,47 @@ MathUtils::Perlin::Perlin()
         81,  51,  145, 235, 249, 14,  239, 107, 49,  192, 214, 31,  181, 199, 106, 157, 184, 84,  204, 176, 115, 121, 50,  45,  127, 4,
         150, 254, 138, 236, 205, 93,  222, 114, 67,  29,  24,  72,  243, 141, 128, 195, 78,  66,  215, 61,  156, 180};
 
-    _perms = new uint8_t[2 * sizeof perlinPerms / sizeof *perlinPerms];
+    for (int32_t i = 0; i < 256; ++i) {
+        _perms[i] = perlinPerms[i];
+    }
 
-    for (int i = 0; i < sizeof perlinPerms / sizeof *perlinPerms; ++i) {
-        _perms[i] = _perms[i + 256] = perlinPerms[i];
+    /* Fisher-Yates shuffle driven by a xorshift generator */
+    uint32_t state = seed;
+    for (int32_t i = 255; i > 0 && seed != 0; --i) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        std::swap(_perms[i], _perms[state % (i + 1)]);
+    }
+
+    for (int32_t i = 0; i < 256; ++i) {
+        _perms[i + 256] = _perms[i];
     }
 }
 
-double MathUtils::Perlin::_noise(double x, double y, double z)
+double MathUtils::Perlin::noise(double x, double y, double z) const
 {
-    int32_t xi = (int32_t)x & 255;
-    int32_t yi = (int32_t)y & 255;
-    int32_t zi = (int32_t)z & 255;
+    double fx = floor(x);
+    double fy = floor(y);
+    double fz = floor(z);
+    int32_t xi = (int32_t)fx & 255;
+    int32_t yi = (int32_t)fy & 255;
+    int32_t zi = (int32_t)fz & 255;
 
-    x -= xi;
-    y -= yi;
-    z -= zi;
+    x -= fx;
+    y -= fy;
+    z -= fz;
 
     double u = _fade(x);
     double v = _fade(y);
     double w = _fade(z);
 
-    uint8_t px0 = _perms[xi] + yi;
-    uint8_t px1 = _perms[xi + 1] + yi;
-    uint8_t px0y0 = _perms[px0] + zi;
-    uint8_t px0y1 = _perms[px0 + 1] + zi;
-    uint8_t px1y0 = _perms[px1] + zi;
-    uint8_t px1y1 = _perms[px1 + 1] + zi;
+    int32_t px0 = (_perms[xi] + yi) & 255;
+    int32_t px1 = (_perms[xi + 1] + yi) & 255;
+    int32_t px0y0 = (_perms[px0] + zi) & 255;
+    int32_t px0y1 = (_perms[px0 + 1] + zi) & 255;
+    int32_t px1y0 = (_perms[px1] + zi) & 255;
+    int32_t px1y1 = (_perms[px1 + 1] + zi) & 255;
 
     return (glm::lerp(
                 glm::lerp(glm::lerp(_grad(_perms[px0y0], x, y, z), _grad(_perms[px0y0 + 1], x, y, z - 1.0), w),
@@ -101,7 +133,7 @@ double MathUtils::Perlin::_noise(double x, double y, double z)
            2.0;
 }
 
-double MathUtils::Perlin::_octave(double x, double y, double z, uint8_t octaves, double persistence)
+double MathUtils::Perlin::octave(double x, double y, double z, uint8_t octaves, double persistence) const
 {
     double frequency = 1.0;
     double amplitude = 1.0;
@@ -110,7 +142,7 @@ double MathUtils::Perlin::_octave(double x, double y, double z, uint8_t octaves,
     double v = 0.0;
 
     for (int i = 0; i < octaves; ++i) {
-        v += amplitude * _noise(x * frequency, y * frequency, z * frequency);
+        v += amplitude * noise(x * frequency, y * frequency, z * frequency);
 
         maxValue += amplitude;
 
@@ -121,7 +153,7 @@ double MathUtils::Perlin::_octave(double x, double y, double z, uint8_t octaves,
     return v / maxValue;
 }
 
-double MathUtils::Perlin::_grad(uint8_t hash, double x, double y, double z)
+double MathUtils::Perlin::_grad(int32_t hash, double x, double y, double z)
 {
     // clang-format off
     switch (hash & 0xF) {
@@ -147,3 +179,250 @@ double MathUtils::Perlin::_grad(uint8_t hash, double x, double y, double z)
 }
 
 double MathUtils::Perlin::_fade(double v) { return v * v * v * (v * (v * 6 - 15) + 10); }
+
+/**
+ * Hashes of the 8 corners of the cell of a coordinate, see Perlin::noise()
+ */
+static inline void _hashCorners(const int32_t *perms, int32_t xi, int32_t yi, int32_t zi, int32_t *hashes, uint32_t stride)
+{
+    int32_t px0 = (perms[xi] + yi) & 255;
+    int32_t px1 = (perms[xi + 1] + yi) & 255;
+    int32_t corners[4] = {(perms[px0] + zi) & 255, (perms[px0 + 1] + zi) & 255, (perms[px1] + zi) & 255, (perms[px1 + 1] + zi) & 255};
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        hashes[(2 * i) * stride] = perms[corners[i]];
+        hashes[(2 * i + 1) * stride] = perms[corners[i] + 1];
+    }
+}
+
+#if PERLIN_LANES == 8
+typedef __m256 Lane;
+typedef __m256i LaneInt;
+
+static inline Lane _set(float value) { return _mm256_set1_ps(value); }
+static inline Lane _ramp(void) { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+static inline Lane _add(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+static inline Lane _sub(Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+static inline Lane _mul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+static inline Lane _floor(Lane a) { return _mm256_floor_ps(a); }
+static inline Lane _select(LaneInt mask, Lane a, Lane b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+static inline Lane _xor(Lane a, LaneInt b) { return _mm256_xor_ps(a, _mm256_castsi256_ps(b)); }
+static inline void _store(float *p, Lane a) { _mm256_storeu_ps(p, a); }
+static inline LaneInt _toInt(Lane a) { return _mm256_cvttps_epi32(a); }
+static inline LaneInt _iset(int32_t value) { return _mm256_set1_epi32(value); }
+static inline LaneInt _iadd(LaneInt a, LaneInt b) { return _mm256_add_epi32(a, b); }
+static inline LaneInt _iand(LaneInt a, LaneInt b) { return _mm256_and_si256(a, b); }
+static inline LaneInt _ior(LaneInt a, LaneInt b) { return _mm256_or_si256(a, b); }
+static inline LaneInt _iless(LaneInt a, LaneInt b) { return _mm256_cmpgt_epi32(b, a); }
+static inline LaneInt _iequal(LaneInt a, LaneInt b) { return _mm256_cmpeq_epi32(a, b); }
+template <int bits>
+static inline LaneInt _ishift(LaneInt a)
+{
+    return _mm256_slli_epi32(a, bits);
+}
+static inline void _hashes(const int32_t *perms, LaneInt xi, LaneInt yi, LaneInt zi, LaneInt hashes[8])
+{
+    LaneInt mask = _iset(255), one = _iset(1);
+    LaneInt px0 = _iand(_iadd(_mm256_i32gather_epi32(perms, xi, 4), yi), mask);
+    LaneInt px1 = _iand(_iadd(_mm256_i32gather_epi32(perms, _iadd(xi, one), 4), yi), mask);
+    LaneInt corners[4] = {_iand(_iadd(_mm256_i32gather_epi32(perms, px0, 4), zi), mask),
+                          _iand(_iadd(_mm256_i32gather_epi32(perms, _iadd(px0, one), 4), zi), mask),
+                          _iand(_iadd(_mm256_i32gather_epi32(perms, px1, 4), zi), mask),
+                          _iand(_iadd(_mm256_i32gather_epi32(perms, _iadd(px1, one), 4), zi), mask)};
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        hashes[2 * i] = _mm256_i32gather_epi32(perms, corners[i], 4);
+        hashes[2 * i + 1] = _mm256_i32gather_epi32(perms, _iadd(corners[i], one), 4);
+    }
+}
+#elif PERLIN_LANES == 4
+typedef __m128 Lane;
+typedef __m128i LaneInt;
+
+static inline Lane _set(float value) { return _mm_set1_ps(value); }
+static inline Lane _ramp(void) { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+static inline Lane _add(Lane a, Lane b) { return _mm_add_ps(a, b); }
+static inline Lane _sub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+static inline Lane _mul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+static inline Lane _floor(Lane a)
+{
+    /* Truncation rounds the negative values up, those are moved one down */
+    Lane truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.0f)));
+}
+static inline Lane _select(LaneInt mask, Lane a, Lane b)
+{
+    Lane m = _mm_castsi128_ps(mask);
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline Lane _xor(Lane a, LaneInt b) { return _mm_xor_ps(a, _mm_castsi128_ps(b)); }
+static inline void _store(float *p, Lane a) { _mm_storeu_ps(p, a); }
+static inline LaneInt _toInt(Lane a) { return _mm_cvttps_epi32(a); }
+static inline LaneInt _iset(int32_t value) { return _mm_set1_epi32(value); }
+static inline LaneInt _iadd(LaneInt a, LaneInt b) { return _mm_add_epi32(a, b); }
+static inline LaneInt _iand(LaneInt a, LaneInt b) { return _mm_and_si128(a, b); }
+static inline LaneInt _ior(LaneInt a, LaneInt b) { return _mm_or_si128(a, b); }
+static inline LaneInt _iless(LaneInt a, LaneInt b) { return _mm_cmplt_epi32(a, b); }
+static inline LaneInt _iequal(LaneInt a, LaneInt b) { return _mm_cmpeq_epi32(a, b); }
+template <int bits>
+static inline LaneInt _ishift(LaneInt a)
+{
+    return _mm_slli_epi32(a, bits);
+}
+static inline void _hashes(const int32_t *perms, LaneInt xi, LaneInt yi, LaneInt zi, LaneInt hashes[8])
+{
+    /* SSE2 has no gather, the hashes of each lane are calculated apart */
+    int32_t x[4], y[4], z[4], h[8 * 4];
+
+    _mm_storeu_si128((__m128i *)x, xi);
+    _mm_storeu_si128((__m128i *)y, yi);
+    _mm_storeu_si128((__m128i *)z, zi);
+    for (uint32_t i = 0; i < 4; ++i) {
+        _hashCorners(perms, x[i], y[i], z[i], h + i, 4);
+    }
+    for (uint32_t i = 0; i < 8; ++i) {
+        hashes[i] = _mm_loadu_si128((const __m128i *)(h + 4 * i));
+    }
+}
+#else
+typedef float Lane;
+typedef int32_t LaneInt;
+
+static inline Lane _set(float value) { return value; }
+static inline Lane _ramp(void) { return 0.0f; }
+static inline Lane _add(Lane a, Lane b) { return a + b; }
+static inline Lane _sub(Lane a, Lane b) { return a - b; }
+static inline Lane _mul(Lane a, Lane b) { return a * b; }
+static inline Lane _floor(Lane a) { return floorf(a); }
+static inline Lane _select(LaneInt mask, Lane a, Lane b) { return mask != 0 ? a : b; }
+static inline Lane _xor(Lane a, LaneInt b)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &a, sizeof bits);
+    bits ^= (uint32_t)b;
+    memcpy(&a, &bits, sizeof bits);
+    return a;
+}
+static inline void _store(float *p, Lane a) { *p = a; }
+static inline LaneInt _toInt(Lane a) { return (int32_t)a; }
+static inline LaneInt _iset(int32_t value) { return value; }
+static inline LaneInt _iadd(LaneInt a, LaneInt b) { return a + b; }
+static inline LaneInt _iand(LaneInt a, LaneInt b) { return a & b; }
+static inline LaneInt _ior(LaneInt a, LaneInt b) { return a | b; }
+static inline LaneInt _iless(LaneInt a, LaneInt b) { return a < b ? -1 : 0; }
+static inline LaneInt _iequal(LaneInt a, LaneInt b) { return a == b ? -1 : 0; }
+template <int bits>
+static inline LaneInt _ishift(LaneInt a)
+{
+    return (int32_t)((uint32_t)a << bits);
+}
+static inline void _hashes(const int32_t *perms, LaneInt xi, LaneInt yi, LaneInt zi, LaneInt hashes[8])
+{
+    _hashCorners(perms, xi, yi, zi, hashes, 1);
+}
+#endif
+
+static inline Lane _lerp(Lane t, Lane a, Lane b) { return _add(a, _mul(t, _sub(b, a))); }
+static inline Lane _fade(Lane t)
+{
+    return _mul(_mul(_mul(t, t), t), _add(_mul(t, _sub(_mul(t, _set(6.0f)), _set(15.0f))), _set(10.0f)));
+}
+
+/**
+ * Same gradients than Perlin::_grad() without branches: the lower 4 bits of
+ * the hash choose two of the coordinates, and the two lowest bits their signs
+ */
+static inline Lane _grad(LaneInt hash, Lane x, Lane y, Lane z)
+{
+    LaneInt h = _iand(hash, _iset(15));
+    Lane u = _select(_iless(h, _iset(8)), x, y);
+    Lane v = _select(_iless(h, _iset(4)), y, _select(_ior(_iequal(h, _iset(12)), _iequal(h, _iset(14))), x, z));
+
+    return _add(_xor(u, _ishift<31>(_iand(h, _iset(1)))), _xor(v, _ishift<30>(_iand(h, _iset(2)))));
+}
+
+/**
+ * Perlin::noise() of PERLIN_LANES coordinates
+ */
+static inline Lane _noise(const int32_t *perms, Lane x, Lane y, Lane z)
+{
+    Lane fx = _floor(x), fy = _floor(y), fz = _floor(z);
+    LaneInt mask = _iset(255);
+    LaneInt xi = _iand(_toInt(fx), mask);
+    LaneInt yi = _iand(_toInt(fy), mask);
+    LaneInt zi = _iand(_toInt(fz), mask);
+
+    x = _sub(x, fx);
+    y = _sub(y, fy);
+    z = _sub(z, fz);
+
+    Lane u = _fade(x), v = _fade(y), w = _fade(z);
+    Lane x1 = _sub(x, _set(1.0f)), y1 = _sub(y, _set(1.0f)), z1 = _sub(z, _set(1.0f));
+
+    LaneInt h[8];
+
+    _hashes(perms, xi, yi, zi, h);
+
+    Lane x0Value = _lerp(v, _lerp(w, _grad(h[0], x, y, z), _grad(h[1], x, y, z1)), _lerp(w, _grad(h[2], x, y1, z), _grad(h[3], x, y1, z1)));
+    Lane x1Value =
+        _lerp(v, _lerp(w, _grad(h[4], x1, y, z), _grad(h[5], x1, y, z1)), _lerp(w, _grad(h[6], x1, y1, z), _grad(h[7], x1, y1, z1)));
+
+    return _mul(_add(_lerp(u, x0Value, x1Value), _set(1.0f)), _set(0.5f));
+}
+
+void MathUtils::Perlin::octaveGrid(float *values, uint32_t rows, uint32_t columns, const glm::vec3 &origin, const glm::vec3 &rowStep,
+                                   const glm::vec3 &columnStep, uint8_t octaves, float persistence) const
+{
+    /* Small grids are not worth waking up the workers */
+    if ((uint64_t)rows * columns < ParallelThreshold) {
+        for (uint32_t row = 0; row < rows; ++row) {
+            _octaveRow(values + (size_t)row * columns, columns, origin + rowStep * (float)row, columnStep, octaves, persistence);
+        }
+        return;
+    }
+
+    WorkerPool::GetInstance()->parallelFor(rows, [&](uint32_t row) {
+        _octaveRow(values + (size_t)row * columns, columns, origin + rowStep * (float)row, columnStep, octaves, persistence);
+    });
+}
+
+void MathUtils::Perlin::_octaveRow(float *values, uint32_t columns, const glm::vec3 &origin, const glm::vec3 &columnStep, uint8_t octaves,
+                                   float persistence) const
+{
+    float maxValue = 0.0f;
+    float amplitude = 1.0f;
+
+    for (uint32_t i = 0; i < octaves; ++i) {
+        maxValue += amplitude;
+        amplitude *= persistence;
+    }
+
+    for (uint32_t first = 0; first < columns; first += PERLIN_LANES) {
+        Lane column = _add(_set((float)first), _ramp());
+        Lane x = _add(_set(origin.x), _mul(column, _set(columnStep.x)));
+        Lane y = _add(_set(origin.y), _mul(column, _set(columnStep.y)));
+        Lane z = _add(_set(origin.z), _mul(column, _set(columnStep.z)));
+        Lane sum = _set(0.0f);
+        float frequency = 1.0f;
+
+        amplitude = 1.0f;
+        for (uint32_t i = 0; i < octaves; ++i) {
+            Lane f = _set(frequency);
+
+            sum = _add(sum, _mul(_set(amplitude), _noise(_perms, _mul(x, f), _mul(y, f), _mul(z, f))));
+            amplitude *= persistence;
+            frequency *= 2.0f;
+        }
+        sum = _mul(sum, _set(1.0f / maxValue));
+
+        if (first + PERLIN_LANES <= columns) {
+            _store(values + first, sum);
+        } else {
+            float last[PERLIN_LANES];
+
+            _store(last, sum);
+            memcpy(values + first, last, (columns - first) * sizeof(float));
+        }
+    }
+}
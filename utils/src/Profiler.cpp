@@ -0,0 +1,170 @@
+/**
+ * @class Profiler
+ * @brief Hierarchical CPU/GPU frame profiler
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "Profiler.hpp"
+#include <stdio.h>
+#include <chrono>
+#include "Logging.hpp"
+
+using namespace Logging;
+
+Profiler *Profiler::_profiler = NULL;
+std::atomic<bool> Profiler::_enabled(false);
+
+/* Track and nesting level of the markers of each thread */
+static thread_local uint32_t _threadIndex = 0;
+static thread_local uint32_t _depth = 0;
+
+static double _clockMicroseconds(void)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Writes a marker name as a JSON string
+ */
+static void _writeJSONString(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (; *string != '\0'; ++string) {
+        if (*string == '"' || *string == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*string, file);
+    }
+    fputc('"', file);
+}
+
+Profiler *Profiler::GetInstance(void)
+{
+    if (_profiler == NULL) {
+        _profiler = new Profiler();
+    }
+    return _profiler;
+}
+
+void Profiler::DisposeInstance(void)
+{
+    _enabled = false;
+    delete _profiler;
+    _profiler = NULL;
+}
+
+Profiler::Profiler() : _numEvents(0), _frame(0), _lastGPUFrame(0), _numThreads(0), _origin(_clockMicroseconds()) {}
+void Profiler::setEnabled(bool enable)
+{
+    if (enable) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_events.empty()) {
+            _events.resize(RingSize);
+        }
+    }
+    _enabled = enable;
+}
+
+double Profiler::now(void) const { return _clockMicroseconds() - _origin; }
+double Profiler::beginCPU(void)
+{
+    ++_depth;
+    return now();
+}
+
+void Profiler::endCPU(const char *name, double start)
+{
+    Event event;
+
+    if (_threadIndex == 0) {
+        _threadIndex = ++_numThreads;
+    }
+
+    event.name = name;
+    event.frame = getFrame();
+    event.start = start;
+    event.duration = now() - start;
+    event.thread = _threadIndex;
+    event.depth = --_depth;
+
+    _record(event);
+}
+
+void Profiler::addGPUEvent(const char *name, uint64_t frame, double start, double duration)
+{
+    Event event;
+
+    event.name = name;
+    event.frame = frame;
+    event.start = start;
+    event.duration = duration;
+    event.thread = GPUThread;
+    event.depth = 0;
+
+    _record(event);
+}
+
+void Profiler::_record(const Event &event)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_events.empty()) {
+        return;
+    }
+    _events[_numEvents++ % RingSize] = event;
+
+    if (event.thread == GPUThread && event.frame > _lastGPUFrame) {
+        _lastGPUFrame = event.frame;
+    }
+}
+
+size_t Profiler::getFrameEvents(uint64_t frame, bool gpu, Event *events, size_t maxEvents)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t first = _numEvents > RingSize ? _numEvents - RingSize : 0;
+    size_t count = 0;
+
+    for (uint64_t i = first; i < _numEvents && count < maxEvents; ++i) {
+        const Event &event = _events[i % RingSize];
+
+        if (event.frame == frame && (event.thread == GPUThread) == gpu) {
+            events[count++] = event;
+        }
+    }
+    return count;
+}
+
+bool Profiler::exportChromeTrace(const std::string &filename)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t first = _numEvents > RingSize ? _numEvents - RingSize : 0;
+
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == NULL) {
+        log("ERROR opening trace file %s\n", filename.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", GPUThread);
+    for (uint32_t thread = 1; thread <= _numThreads; ++thread) {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CPU %u\"}}", thread, thread);
+    }
+
+    for (uint64_t i = first; i < _numEvents; ++i) {
+        const Event &event = _events[i % RingSize];
+
+        fprintf(file, ",\n{\"name\":");
+        _writeJSONString(file, event.name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                event.thread == GPUThread ? "gpu" : "cpu", event.thread, event.start, event.duration, (unsigned long long)event.frame);
+    }
+    fprintf(file, "\n]}\n");
+
+    bool written = ferror(file) == 0;
+    if (fclose(file) != 0 || written == false) {
+        log("ERROR writing trace file %s\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+/**
+ * @class RenderStats
+ * @brief Counts the draw calls and the state changes submitted to the GPU
+ *        per frame
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "RenderStats.hpp"
+
+uint64_t RenderStats::_current[RenderStats::COUNTER_COUNT];
+uint64_t RenderStats::_frame[RenderStats::COUNTER_COUNT];
+
+static const char *_counterNames[RenderStats::COUNTER_COUNT] = {"drawCalls", "shaderBinds", "textureBinds", "vertexArrayBinds",
+                                                                "framebufferBinds"};
+
+void RenderStats::EndFrame(void)
+{
+    for (uint32_t counter = 0; counter < COUNTER_COUNT; ++counter) {
+        _frame[counter] = _current[counter];
+        _current[counter] = 0;
+    }
+}
+
+uint64_t RenderStats::GetStateChanges(void)
+{
+    uint64_t changes = 0;
+
+    for (uint32_t counter = DRAW_CALLS + 1; counter < COUNTER_COUNT; ++counter) {
+        changes += _frame[counter];
+    }
+    return changes;
+}
+
+const char *RenderStats::GetCounterName(Counter counter) { return counter < COUNTER_COUNT ? _counterNames[counter] : "unknown"; }
@@ -0,0 +1,624 @@
+/**
+ * @class TextureCodec
+ * @brief Offline block compression of textures for the GPU
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "TextureCodec.hpp"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+#include "WorkerPool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURECODEC_SSE2
+#endif
+
+/**
+ * Size in bytes of the BC1 color block, also the second half of a BC3 block
+ */
+static const uint32_t ColorBlockSize = 8;
+
+static inline uint32_t _clamp(int32_t value, int32_t high) { return (uint32_t)(value < 0 ? 0 : (value > high ? high : value)); }
+
+static inline uint16_t _pack565(const float color[3])
+{
+    uint32_t r = _clamp((int32_t)(color[0] * 31.0f / 255.0f + 0.5f), 31);
+    uint32_t g = _clamp((int32_t)(color[1] * 63.0f / 255.0f + 0.5f), 63);
+    uint32_t b = _clamp((int32_t)(color[2] * 31.0f / 255.0f + 0.5f), 31);
+
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void _unpack565(uint16_t color, int32_t rgb[3])
+{
+    uint32_t r = (color >> 11) & 31;
+    uint32_t g = (color >> 5) & 63;
+    uint32_t b = color & 31;
+
+    rgb[0] = (int32_t)((r << 3) | (r >> 2));
+    rgb[1] = (int32_t)((g << 2) | (g >> 4));
+    rgb[2] = (int32_t)((b << 3) | (b >> 2));
+}
+
+/**
+ * Builds the 4 colors of a block in 4-color mode
+ */
+static void _palette(uint16_t color0, uint16_t color1, int32_t palette[4][3])
+{
+    _unpack565(color0, palette[0]);
+    _unpack565(color1, palette[1]);
+    for (uint32_t c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+/**
+ * Selects the closest palette entry for each texel
+ *
+ * @return Squared error of the selection
+ */
+static uint32_t _selectIndices(const uint8_t block[16][4], uint16_t color0, uint16_t color1, uint32_t *indices)
+{
+    int32_t palette[4][3];
+    uint32_t error = 0;
+
+    _palette(color0, color1, palette);
+
+    *indices = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t best = 0;
+        uint32_t bestDistance = 0xFFFFFFFF;
+
+        for (uint32_t p = 0; p < 4; ++p) {
+            int32_t dr = (int32_t)block[i][0] - palette[p][0];
+            int32_t dg = (int32_t)block[i][1] - palette[p][1];
+            int32_t db = (int32_t)block[i][2] - palette[p][2];
+            uint32_t distance = (uint32_t)(dr * dr + dg * dg + db * db);
+
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = p;
+            }
+        }
+        *indices |= best << (2 * i);
+        error += bestDistance;
+    }
+
+    return error;
+}
+
+/**
+ * Solves the endpoints that best reproduce the texels with the given indices
+ *
+ * @return false if the indices do not allow to solve them
+ */
+static bool _refineEndpoints(const uint8_t block[16][4], uint32_t indices, float endpoint0[3], float endpoint1[3])
+{
+    /* Weight of the first endpoint for each index */
+    static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[3] = {0.0f, 0.0f, 0.0f};
+    float bx[3] = {0.0f, 0.0f, 0.0f};
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        float a = weights[(indices >> (2 * i)) & 3];
+        float b = 1.0f - a;
+
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (uint32_t c = 0; c < 3; ++c) {
+            ax[c] += a * block[i][c];
+            bx[c] += b * block[i][c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) {
+        return false;
+    }
+
+    for (uint32_t c = 0; c < 3; ++c) {
+        endpoint0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        endpoint1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+/**
+ * Writes the color endpoints and indices, making sure the block is
+ * decoded in 4-color mode
+ */
+static void _writeColorBlock(uint16_t color0, uint16_t color1, uint32_t indices, uint8_t *output)
+{
+    if (color0 < color1) {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+        /* Swaps 0 <-> 1 and 2 <-> 3 */
+        indices ^= 0x55555555;
+    } else if (color0 == color1) {
+        indices = 0;
+    }
+
+    output[0] = (uint8_t)color0;
+    output[1] = (uint8_t)(color0 >> 8);
+    output[2] = (uint8_t)color1;
+    output[3] = (uint8_t)(color1 >> 8);
+    output[4] = (uint8_t)indices;
+    output[5] = (uint8_t)(indices >> 8);
+    output[6] = (uint8_t)(indices >> 16);
+    output[7] = (uint8_t)(indices >> 24);
+}
+
+static void _encodeColorBlock(const uint8_t block[16][4], uint8_t *output)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        for (uint32_t c = 0; c < 3; ++c) {
+            mean[c] += block[i][c] / 16.0f;
+        }
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+        float r = block[i][0] - mean[0];
+        float g = block[i][1] - mean[1];
+        float b = block[i][2] - mean[2];
+
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    /* Principal axis of the colors by power iteration */
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (uint32_t iteration = 0; iteration < 4; ++iteration) {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float length = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+
+        if (length < 1e-6f) {
+            break;
+        }
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    /* The texels at both ends of the axis are the first endpoints */
+    uint32_t minimum = 0, maximum = 0;
+    float minimumDot = 1e30f, maximumDot = -1e30f;
+    for (uint32_t i = 0; i < 16; ++i) {
+        float dot = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+
+        if (dot < minimumDot) {
+            minimumDot = dot;
+            minimum = i;
+        }
+        if (dot > maximumDot) {
+            maximumDot = dot;
+            maximum = i;
+        }
+    }
+
+    float endpoint0[3], endpoint1[3];
+    for (uint32_t c = 0; c < 3; ++c) {
+        endpoint0[c] = block[maximum][c];
+        endpoint1[c] = block[minimum][c];
+    }
+
+    uint16_t color0 = _pack565(endpoint0);
+    uint16_t color1 = _pack565(endpoint1);
+    uint32_t indices;
+    uint32_t error = _selectIndices(block, color0, color1, &indices);
+
+    /* Keep refining the endpoints while it reduces the error */
+    for (uint32_t iteration = 0; iteration < 2 && error > 0; ++iteration) {
+        if (_refineEndpoints(block, indices, endpoint0, endpoint1) == false) {
+            break;
+        }
+
+        uint16_t refined0 = _pack565(endpoint0);
+        uint16_t refined1 = _pack565(endpoint1);
+        uint32_t refinedIndices;
+        uint32_t refinedError = _selectIndices(block, refined0, refined1, &refinedIndices);
+
+        if (refinedError >= error) {
+            break;
+        }
+        color0 = refined0;
+        color1 = refined1;
+        indices = refinedIndices;
+        error = refinedError;
+    }
+
+    _writeColorBlock(color0, color1, indices, output);
+}
+
+static void _encodeAlphaBlock(const uint8_t block[16][4], uint8_t *output)
+{
+    uint32_t alpha0 = 0, alpha1 = 255;
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        alpha0 = block[i][3] > alpha0 ? block[i][3] : alpha0;
+        alpha1 = block[i][3] < alpha1 ? block[i][3] : alpha1;
+    }
+
+    /* 8 values mode, index 0 and 1 are the endpoints and 2 to 7 the
+     * interpolated values from alpha0 towards alpha1 */
+    uint64_t indices = 0;
+    if (alpha0 > alpha1) {
+        uint32_t palette[8] = {alpha0, alpha1};
+        for (uint32_t p = 1; p < 7; ++p) {
+            palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+        }
+
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t best = 0;
+            int32_t bestDistance = 256;
+
+            for (uint32_t p = 0; p < 8; ++p) {
+                int32_t distance = abs((int32_t)block[i][3] - (int32_t)palette[p]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    output[0] = (uint8_t)alpha0;
+    output[1] = (uint8_t)alpha1;
+    for (uint32_t i = 0; i < 6; ++i) {
+        output[2 + i] = (uint8_t)(indices >> (8 * i));
+    }
+}
+
+/**
+ * Reads a 4x4 block, repeating the last row and column at the borders
+ */
+static void _readBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t Bpp, uint32_t x, uint32_t y, uint8_t block[16][4])
+{
+    for (uint32_t j = 0; j < 4; ++j) {
+        uint32_t row = y + j < height ? y + j : height - 1;
+
+        for (uint32_t i = 0; i < 4; ++i) {
+            uint32_t column = x + i < width ? x + i : width - 1;
+            const uint8_t *texel = pixels + ((size_t)row * width + column) * Bpp;
+
+            block[j * 4 + i][0] = texel[0];
+            block[j * 4 + i][1] = texel[1];
+            block[j * 4 + i][2] = texel[2];
+            block[j * 4 + i][3] = Bpp == 4 ? texel[3] : 255;
+        }
+    }
+}
+
+void TextureCodec::Encode(Texture::Format format, const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t Bpp, uint8_t *output)
+{
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    size_t blockSize = format == Texture::FORMAT_BC3 ? 16 : ColorBlockSize;
+
+    WorkerPool::GetInstance()->parallelFor(blocksHigh, [&](uint32_t by) {
+        uint8_t block[16][4];
+        uint8_t *destination = output + (size_t)by * blocksWide * blockSize;
+
+        for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+            _readBlock(pixels, width, height, Bpp, bx * 4, by * 4, block);
+            if (format == Texture::FORMAT_BC3) {
+                _encodeAlphaBlock(block, destination);
+                destination += 8;
+            }
+            _encodeColorBlock(block, destination);
+            destination += ColorBlockSize;
+        }
+    });
+}
+
+void TextureCodec::Decode(Texture::Format format, const uint8_t *input, uint32_t width, uint32_t height, uint8_t *pixels)
+{
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+
+    for (uint32_t by = 0; by < blocksHigh; ++by) {
+        for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+            uint32_t alphas[8];
+            uint64_t alphaIndices = 0;
+
+            if (format == Texture::FORMAT_BC3) {
+                alphas[0] = input[0];
+                alphas[1] = input[1];
+                for (uint32_t p = 1; p < 7; ++p) {
+                    alphas[p + 1] = alphas[0] > alphas[1] ? ((7 - p) * alphas[0] + p * alphas[1]) / 7 : 0;
+                }
+                if (alphas[0] <= alphas[1]) {
+                    /* 6 values mode */
+                    for (uint32_t p = 1; p < 5; ++p) {
+                        alphas[p + 1] = ((5 - p) * alphas[0] + p * alphas[1]) / 5;
+                    }
+                    alphas[6] = 0;
+                    alphas[7] = 255;
+                }
+                for (uint32_t i = 0; i < 6; ++i) {
+                    alphaIndices |= (uint64_t)input[2 + i] << (8 * i);
+                }
+                input += 8;
+            }
+
+            uint16_t color0 = (uint16_t)(input[0] | (input[1] << 8));
+            uint16_t color1 = (uint16_t)(input[2] | (input[3] << 8));
+            uint32_t indices = input[4] | (input[5] << 8) | (input[6] << 16) | ((uint32_t)input[7] << 24);
+            int32_t palette[4][3];
+            bool transparent = false;
+
+            _palette(color0, color1, palette);
+            if (format == Texture::FORMAT_BC1 && color0 <= color1) {
+                /* 3-color mode, the last entry is transparent black */
+                for (uint32_t c = 0; c < 3; ++c) {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+                transparent = true;
+            }
+            input += ColorBlockSize;
+
+            for (uint32_t j = 0; j < 4 && by * 4 + j < height; ++j) {
+                for (uint32_t i = 0; i < 4 && bx * 4 + i < width; ++i) {
+                    uint32_t texel = j * 4 + i;
+                    uint32_t index = (indices >> (2 * texel)) & 3;
+                    uint8_t *destination = pixels + ((size_t)(by * 4 + j) * width + bx * 4 + i) * 4;
+
+                    destination[0] = (uint8_t)palette[index][0];
+                    destination[1] = (uint8_t)palette[index][1];
+                    destination[2] = (uint8_t)palette[index][2];
+                    if (format == Texture::FORMAT_BC3) {
+                        destination[3] = (uint8_t)alphas[(alphaIndices >> (3 * texel)) & 7];
+                    } else {
+                        destination[3] = transparent == true && index == 3 ? 0 : 255;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Conversion tables between 8-bit sRGB and linear intensity. Linear values
+ * are quantized in LinearSteps steps, fine enough to tell apart the
+ * darkest sRGB values
+ */
+struct GammaTables {
+    static const uint32_t LinearSteps = 16384;
+
+    float toLinear[256];
+    uint8_t toSRGB[LinearSteps];
+
+    GammaTables()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            float value = i / 255.0f;
+            toLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+        }
+        for (uint32_t i = 0; i < LinearSteps; ++i) {
+            float value = i / (float)(LinearSteps - 1);
+            value = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+            toSRGB[i] = (uint8_t)_clamp((int32_t)(value * 255.0f + 0.5f), 255);
+        }
+    }
+};
+
+static const GammaTables &_gammaTables(void)
+{
+    static const GammaTables tables;
+    return tables;
+}
+
+/**
+ * Converts a row of texels into 4 linear floats per texel, the alpha
+ * is not gamma encoded and is 1 for RGB textures
+ */
+static void _linearizeRow(const GammaTables &tables, const uint8_t *row, uint32_t width, uint32_t Bpp, float *linear)
+{
+    for (uint32_t x = 0; x < width; ++x, row += Bpp, linear += 4) {
+        linear[0] = tables.toLinear[row[0]];
+        linear[1] = tables.toLinear[row[1]];
+        linear[2] = tables.toLinear[row[2]];
+        linear[3] = Bpp == 4 ? row[3] / 255.0f : 1.0f;
+    }
+}
+
+void TextureCodec::Downsample(const uint8_t *source, uint32_t width, uint32_t height, uint32_t Bpp, uint8_t *destination)
+{
+    uint32_t destinationWidth = Texture::GetLevelSize(width, 1);
+    uint32_t destinationHeight = Texture::GetLevelSize(height, 1);
+
+    if (Bpp != 3 && Bpp != 4) {
+        /* Not color, average the bytes as they are */
+        for (uint32_t y = 0; y < destinationHeight; ++y) {
+            const uint8_t *row0 = source + (size_t)(2 * y < height ? 2 * y : height - 1) * width * Bpp;
+            const uint8_t *row1 = source + (size_t)(2 * y + 1 < height ? 2 * y + 1 : height - 1) * width * Bpp;
+
+            for (uint32_t x = 0; x < destinationWidth; ++x) {
+                uint32_t x0 = (2 * x < width ? 2 * x : width - 1) * Bpp;
+                uint32_t x1 = (2 * x + 1 < width ? 2 * x + 1 : width - 1) * Bpp;
+
+                for (uint32_t c = 0; c < Bpp; ++c) {
+                    *destination++ = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+        return;
+    }
+
+    /* The texels are averaged in linear space, averaging the sRGB values
+     * directly darkens the smaller levels. The scale takes the sum of 4
+     * texels to an index into the sRGB table, or to the 8-bit alpha */
+    const GammaTables &tables = _gammaTables();
+    const float colorScale = (GammaTables::LinearSteps - 1) / 4.0f;
+    const float alphaScale = 255.0f / 4.0f;
+
+    WorkerPool::GetInstance()->parallelFor(destinationHeight, [&](uint32_t y) {
+        std::vector<float> rows((size_t)width * 8);
+        float *row0 = rows.data();
+        float *row1 = row0 + (size_t)width * 4;
+        uint8_t *output = destination + (size_t)y * destinationWidth * Bpp;
+
+        _linearizeRow(tables, source + (size_t)(2 * y < height ? 2 * y : height - 1) * width * Bpp, width, Bpp, row0);
+        _linearizeRow(tables, source + (size_t)(2 * y + 1 < height ? 2 * y + 1 : height - 1) * width * Bpp, width, Bpp, row1);
+
+#ifdef TEXTURECODEC_SSE2
+        const __m128 scale = _mm_setr_ps(colorScale, colorScale, colorScale, alphaScale);
+#endif
+        for (uint32_t x = 0; x < destinationWidth; ++x, output += Bpp) {
+            uint32_t x0 = (2 * x < width ? 2 * x : width - 1) * 4;
+            uint32_t x1 = (2 * x + 1 < width ? 2 * x + 1 : width - 1) * 4;
+            int32_t indices[4];
+
+#ifdef TEXTURECODEC_SSE2
+            /* One texel per register, the 4 channels are filtered at once */
+            __m128 top = _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+            __m128 bottom = _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1));
+            _mm_storeu_si128((__m128i *)indices, _mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(top, bottom), scale)));
+#else
+            for (uint32_t c = 0; c < 4; ++c) {
+                float sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                indices[c] = (int32_t)(sum * (c < 3 ? colorScale : alphaScale) + 0.5f);
+            }
+#endif
+            output[0] = tables.toSRGB[indices[0]];
+            output[1] = tables.toSRGB[indices[1]];
+            output[2] = tables.toSRGB[indices[2]];
+            if (Bpp == 4) {
+                output[3] = (uint8_t)indices[3];
+            }
+        }
+    });
+}
+
+/**
+ * Builds the mip chain of an uncompressed image, level 0 included
+ *
+ * @param texture  Texture with the level 0
+ * @param levels   Number of levels to build
+ * @param chain    Buffer of Texture::getLevelOffset(levels) bytes for the chain
+ */
+static void _buildMipChain(const Texture &texture, uint32_t levels, uint8_t *chain)
+{
+    memcpy(chain, texture._texture, texture.getLevelBytes(0));
+
+    /* Each level is reduced from the previous one */
+    for (uint32_t level = 1; level < levels; ++level) {
+        const uint8_t *previous = chain + texture.getLevelOffset(level - 1);
+
+        TextureCodec::Downsample(previous, Texture::GetLevelSize(texture._width, level - 1),
+                                 Texture::GetLevelSize(texture._height, level - 1), texture._Bpp, chain + texture.getLevelOffset(level));
+    }
+}
+
+/**
+ * Number of levels of a full mip chain, down to 1x1
+ */
+static uint32_t _fullMipLevels(const Texture &texture)
+{
+    uint32_t levels = 1;
+    while ((texture._width >> levels) > 0 || (texture._height >> levels) > 0) {
+        ++levels;
+    }
+    return levels;
+}
+
+bool TextureCodec::GenerateMipmaps(Texture &texture)
+{
+    if (texture.isCompressed() == true || texture._texture == NULL || texture._levels > 1) {
+        return false;
+    }
+
+    Texture mipmapped = texture;
+    mipmapped._levels = _fullMipLevels(texture);
+    mipmapped._texture = new uint8_t[mipmapped.getBytes()];
+    _buildMipChain(texture, mipmapped._levels, mipmapped._texture);
+
+    texture = std::move(mipmapped);
+    return true;
+}
+
+bool TextureCodec::Compress(Texture &texture)
+{
+    if (texture.isCompressed() == true || texture._texture == NULL || (texture._Bpp != 3 && texture._Bpp != 4)) {
+        return false;
+    }
+
+    /* Only the textures with some transparency pay for the alpha block */
+    Texture::Format format = Texture::FORMAT_BC1;
+    if (texture._Bpp == 4) {
+        for (size_t i = 3; i < (size_t)texture._width * texture._height * 4; i += 4) {
+            if (texture._texture[i] != 255) {
+                format = Texture::FORMAT_BC3;
+                break;
+            }
+        }
+    }
+
+    /* A chain stored in the texture is kept, otherwise the full one is built */
+    const uint8_t *chain = texture._texture;
+    uint32_t levels = texture._levels;
+    std::vector<uint8_t> built;
+    if (levels == 1) {
+        levels = _fullMipLevels(texture);
+        built.resize(texture.getLevelOffset(levels));
+        _buildMipChain(texture, levels, built.data());
+        chain = built.data();
+    }
+
+    Texture compressed;
+    compressed._width = texture._width;
+    compressed._height = texture._height;
+    compressed._Bpp = texture._Bpp;
+    compressed._format = format;
+    compressed._levels = levels;
+    compressed._texture = new uint8_t[compressed.getBytes()];
+
+    for (uint32_t level = 0; level < levels; ++level) {
+        Encode(format, chain + texture.getLevelOffset(level), Texture::GetLevelSize(texture._width, level),
+               Texture::GetLevelSize(texture._height, level), texture._Bpp, compressed._texture + compressed.getLevelOffset(level));
+    }
+
+    texture = std::move(compressed);
+    return true;
+}
+
+void TextureCodec::Decompress(Texture &texture)
+{
+    if (texture.isCompressed() == false) {
+        return;
+    }
+
+    Texture decompressed;
+    decompressed._width = texture._width;
+    decompressed._height = texture._height;
+    decompressed._Bpp = 4;
+    decompressed._levels = texture._levels;
+    decompressed._texture = new uint8_t[decompressed.getBytes()];
+
+    for (uint32_t level = 0; level < texture._levels; ++level) {
+        uint32_t width = Texture::GetLevelSize(texture._width, level);
+        uint32_t height = Texture::GetLevelSize(texture._height, level);
+
+        Decode((Texture::Format)texture._format, texture._texture + texture.getLevelOffset(level), width, height,
+               decompressed._texture + decompressed.getLevelOffset(level));
+    }
+
+    texture = std::move(decompressed);
+}
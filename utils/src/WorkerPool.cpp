@@ -0,0 +1,134 @@
+/**
+ * @class WorkerPool
+ * @brief Pool of worker threads shared by the engine
+ *
+ * @author	Roberto Cano (http://www.robertocano.es)
+ */
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <memory>
+
+WorkerPool *WorkerPool::_workerPool = NULL;
+
+WorkerPool *WorkerPool::GetInstance(void)
+{
+    if (_workerPool == NULL) {
+        uint32_t numThreads = std::thread::hardware_concurrency();
+
+        _workerPool = new WorkerPool(numThreads > 1 ? numThreads - 1 : 0);
+    }
+    return _workerPool;
+}
+
+void WorkerPool::DisposeInstance(void)
+{
+    delete _workerPool;
+    _workerPool = NULL;
+}
+
+WorkerPool::WorkerPool(uint32_t numWorkers) : _stop(false)
+{
+    for (uint32_t i = 0; i < numWorkers; ++i) {
+        _workers.push_back(std::thread(&WorkerPool::_run, this));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+
+    for (std::vector<std::thread>::iterator it = _workers.begin(); it != _workers.end(); ++it) {
+        it->join();
+    }
+}
+
+void WorkerPool::submit(const std::function<void()> &task)
+{
+    /* Without workers the task is run in place */
+    if (_workers.size() == 0) {
+        task();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _tasks.push_back(task);
+    }
+    _condition.notify_one();
+}
+
+void WorkerPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &func)
+{
+    /* State shared with the helper tasks. Helpers that start after all the
+     * indices have been taken find nothing to do, so they can outlive
+     * this call safely */
+    struct State {
+        std::atomic<uint32_t> next;
+        std::atomic<uint32_t> done;
+        uint32_t count;
+        std::function<void(uint32_t)> func;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+
+    state->next = 0;
+    state->done = 0;
+    state->count = count;
+    state->func = func;
+
+    std::function<void()> work = [state]() {
+        for (;;) {
+            uint32_t index = state->next++;
+            if (index >= state->count) {
+                return;
+            }
+
+            state->func(index);
+
+            if (++state->done == state->count) {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    uint32_t numHelpers = count > 1 ? count - 1 : 0;
+    if (numHelpers > _workers.size()) {
+        numHelpers = (uint32_t)_workers.size();
+    }
+    for (uint32_t i = 0; i < numHelpers; ++i) {
+        submit(work);
+    }
+
+    /* The caller takes indices too and then waits for the ones in flight */
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (state->done < state->count) {
+        state->finished.wait(lock);
+    }
+}
+
+void WorkerPool::_run()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_stop == false && _tasks.empty() == true) {
+                _condition.wait(lock);
+            }
+            if (_tasks.empty() == true) {
+                return;
+            }
+            task = _tasks.front();
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -1,5 +1,329 @@
 #include "ZCompression.hpp"
+#include <string.h>
+#include <atomic>
 #include "Logging.hpp"
+#include "WorkerPool.hpp"
+
+/**
+ * Header of the data generated by ZCompression::Compress, followed by
+ * one BlockEntry per block and then the blocks data
+ */
+struct BlockStreamHeader {
+    uint32_t codec;     /**< Codec::Type used for the blocks */
+    uint32_t blockSize; /**< Size of the uncompressed blocks, except the last one */
+    uint64_t size;      /**< Total uncompressed size */
+};
+
+/**
+ * Description of each compressed block
+ */
+struct BlockEntry {
+    uint32_t size;     /**< Compressed size, equal to the uncompressed size if stored as it is */
+    uint32_t checksum; /**< CRC-32 of the uncompressed data */
+};
+
+/**
+ * Codec that stores the data as it is
+ */
+class NoneCodec : public Codec
+{
+  public:
+    size_t getMaxEncodedSize(size_t size) const { return size; }
+    bool encode(const uint8_t *input, size_t size, uint8_t *output, size_t &outputSize) const
+    {
+        memcpy(output, input, size);
+        outputSize = size;
+        return true;
+    }
+    bool decode(const uint8_t *input, size_t size, uint8_t *output, size_t outputSize) const
+    {
+        if (size != outputSize) {
+            return false;
+        }
+        memcpy(output, input, size);
+        return true;
+    }
+};
+
+/**
+ * zlib deflate codec
+ */
+class ZlibCodec : public Codec
+{
+  public:
+    size_t getMaxEncodedSize(size_t size) const { return compressBound((uLong)size); }
+    bool encode(const uint8_t *input, size_t size, uint8_t *output, size_t &outputSize) const
+    {
+        uLongf destSize = (uLongf)getMaxEncodedSize(size);
+
+        if (compress2(output, &destSize, input, (uLong)size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            return false;
+        }
+        outputSize = destSize;
+        return true;
+    }
+    bool decode(const uint8_t *input, size_t size, uint8_t *output, size_t outputSize) const
+    {
+        uLongf destSize = (uLongf)outputSize;
+
+        return uncompress(output, &destSize, input, (uLong)size) == Z_OK && destSize == outputSize;
+    }
+};
+
+/**
+ * Byte oriented LZ77 codec in the spirit of LZ4. The data is a list of
+ * sequences, each one made of:
+ *
+ *     * Token: high nibble is the literals length, low nibble the match length minus 4.
+ *       A nibble of 15 means the length continues in the following bytes, adding
+ *       each byte until one is lower than 255
+ *     * Literals
+ *     * Match offset, 2 bytes little endian, and the match length continuation
+ *
+ * The last sequence only has literals. Matches are searched with a single
+ * entry hash table, trading ratio for speed
+ */
+class LZCodec : public Codec
+{
+  public:
+    static const uint32_t MinMatch = 4;
+    static const uint32_t MaxOffset = 65535;
+    static const uint32_t HashBits = 14;
+    /* The last bytes are always literals, so the decoder never reads a match
+     * past the end of the data */
+    static const uint32_t LastLiterals = 5;
+    static const uint32_t MinLength = 12;
+    /* Short literal runs are copied with a fixed size copy */
+    static const uint32_t WildCopy = 16;
+
+    size_t getMaxEncodedSize(size_t size) const { return size + size / 255 + 16; }
+    bool encode(const uint8_t *input, size_t size, uint8_t *output, size_t &outputSize) const
+    {
+        std::vector<uint32_t> table(1 << HashBits, 0);
+        uint8_t *op = output;
+        uint8_t *opEnd = output + getMaxEncodedSize(size);
+        size_t anchor = 0;
+        size_t ip = 0;
+
+        if (size >= MinLength) {
+            size_t limit = size - MinLength;
+            size_t matchLimit = size - LastLiterals;
+            uint32_t misses = 0;
+
+            while (ip < limit) {
+                uint32_t sequence = _read32(input + ip);
+                uint32_t hash = (sequence * 2654435761U) >> (32 - HashBits);
+                size_t candidate = table[hash];
+
+                table[hash] = (uint32_t)ip;
+
+                if (candidate >= ip || ip - candidate > MaxOffset || _read32(input + candidate) != sequence) {
+                    /* Move faster through data that does not compress */
+                    ip += 1 + (misses++ >> 6);
+                    continue;
+                }
+                misses = 0;
+
+                size_t length = MinMatch;
+                while (ip + length < matchLimit && input[candidate + length] == input[ip + length]) {
+                    ++length;
+                }
+
+                if (_writeSequence(op, opEnd, input + anchor, ip - anchor, (uint32_t)(ip - candidate), length) == false) {
+                    return false;
+                }
+
+                ip += length;
+                anchor = ip;
+            }
+        }
+
+        /* Remaining literals */
+        if (_writeSequence(op, opEnd, input + anchor, size - anchor, 0, 0) == false) {
+            return false;
+        }
+
+        outputSize = op - output;
+        return true;
+    }
+    bool decode(const uint8_t *input, size_t size, uint8_t *output, size_t outputSize) const
+    {
+        const uint8_t *ip = input;
+        const uint8_t *ipEnd = input + size;
+        uint8_t *op = output;
+        uint8_t *opEnd = output + outputSize;
+
+        while (ip < ipEnd) {
+            uint8_t token = *ip++;
+            size_t length = token >> 4;
+
+            /* Literals */
+            if (length == 15 && _readLength(ip, ipEnd, length) == false) {
+                return false;
+            }
+            if (length > (size_t)(ipEnd - ip) || length > (size_t)(opEnd - op)) {
+                return false;
+            }
+            if (length <= WildCopy && ipEnd - ip >= WildCopy && opEnd - op >= WildCopy) {
+                /* Short literals, copy a fixed amount that the compiler can inline */
+                memcpy(op, ip, WildCopy);
+            } else {
+                memcpy(op, ip, length);
+            }
+            ip += length;
+            op += length;
+
+            /* The last sequence has no match */
+            if (ip == ipEnd) {
+                break;
+            }
+
+            /* Match */
+            if (ipEnd - ip < 2) {
+                return false;
+            }
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+
+            length = token & 0x0F;
+            if (length == 15 && _readLength(ip, ipEnd, length) == false) {
+                return false;
+            }
+            length += MinMatch;
+
+            if (offset == 0 || offset > (size_t)(op - output) || length > (size_t)(opEnd - op)) {
+                return false;
+            }
+
+            const uint8_t *match = op - offset;
+            if (offset >= 8 && (size_t)(opEnd - op) >= length + 8) {
+                /* Copy in 8 bytes steps, the bytes written past the end of
+                 * the match are overwritten by the next sequence */
+                uint8_t *end = op + length;
+                do {
+                    memcpy(op, match, 8);
+                    op += 8;
+                    match += 8;
+                } while (op < end);
+                op = end;
+            } else if (offset >= length) {
+                memcpy(op, match, length);
+                op += length;
+            } else {
+                /* Overlapping match, repeats the last 'offset' bytes */
+                for (size_t i = 0; i < length; ++i) {
+                    *op++ = *match++;
+                }
+            }
+        }
+
+        return op == opEnd;
+    }
+
+  private:
+    static inline uint32_t _read32(const uint8_t *p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof value);
+        return value;
+    }
+
+    static inline bool _readLength(const uint8_t *&ip, const uint8_t *ipEnd, size_t &length)
+    {
+        uint8_t byte;
+        do {
+            if (ip >= ipEnd) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    static inline bool _writeLength(uint8_t *&op, uint8_t *opEnd, size_t length)
+    {
+        for (; length >= 255; length -= 255) {
+            if (op >= opEnd) {
+                return false;
+            }
+            *op++ = 255;
+        }
+        if (op >= opEnd) {
+            return false;
+        }
+        *op++ = (uint8_t)length;
+        return true;
+    }
+
+    /**
+     * Writes a sequence. A 'matchLength' of 0 writes the final literals only sequence
+     */
+    static bool _writeSequence(uint8_t *&op, uint8_t *opEnd, const uint8_t *literals, size_t numLiterals, uint32_t offset,
+                               size_t matchLength)
+    {
+        size_t matchCode = matchLength != 0 ? matchLength - MinMatch : 0;
+        uint8_t *token = op++;
+
+        if (op > opEnd) {
+            return false;
+        }
+
+        *token = (uint8_t)(((numLiterals >= 15 ? 15 : numLiterals) << 4) | (matchCode >= 15 ? 15 : matchCode));
+        if (numLiterals >= 15 && _writeLength(op, opEnd, numLiterals - 15) == false) {
+            return false;
+        }
+        if (numLiterals > (size_t)(opEnd - op)) {
+            return false;
+        }
+        memcpy(op, literals, numLiterals);
+        op += numLiterals;
+
+        if (matchLength == 0) {
+            return true;
+        }
+
+        if (opEnd - op < 2) {
+            return false;
+        }
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+
+        return matchCode < 15 || _writeLength(op, opEnd, matchCode - 15);
+    }
+};
+
+const Codec *Codec::Get(Type type)
+{
+    static const NoneCodec noneCodec;
+    static const ZlibCodec zlibCodec;
+    static const LZCodec lzCodec;
+
+    switch (type) {
+        case TYPE_NONE:
+            return &noneCodec;
+        case TYPE_ZLIB:
+            return &zlibCodec;
+        case TYPE_LZ:
+            return &lzCodec;
+        default:
+            return NULL;
+    }
+}
+
+bool Codec::FromName(const char *name, Type &type)
+{
+    static const char *names[TYPE_COUNT] = {"none", "zlib", "lz"};
+
+    for (uint32_t i = 0; i < TYPE_COUNT; ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            type = (Type)i;
+            return true;
+        }
+    }
+    return false;
+}
+
 
 ZCompression::ZCompression()
 {
@@ -130,3 +454,123 @@ bool ZDecompression::read(std::ifstream &file, void *data, uint32_t &size)
 }
 
 void ZDecompression::finish() { (void)inflateEnd(&_strm); }
+
+bool ZCompression::Compress(Codec::Type codecType, const void *data, size_t size, std::vector<uint8_t> &output, uint32_t blockSize)
+{
+    const Codec *codec = Codec::Get(codecType);
+    if (codec == NULL || blockSize == 0) {
+        Logging::log("ERROR unknown codec %u\n", codecType);
+        return false;
+    }
+
+    uint32_t numBlocks = (uint32_t)((size + blockSize - 1) / blockSize);
+    std::vector<std::vector<uint8_t> > blocks(numBlocks);
+    std::vector<BlockEntry> entries(numBlocks);
+
+    /* Compress each block independently */
+    WorkerPool::GetInstance()->parallelFor(numBlocks, [&](uint32_t i) {
+        const uint8_t *block = (const uint8_t *)data + (size_t)i * blockSize;
+        size_t rawSize = i == numBlocks - 1 ? size - (size_t)i * blockSize : blockSize;
+        size_t encodedSize = 0;
+
+        blocks[i].resize(codec->getMaxEncodedSize(rawSize));
+        entries[i].checksum = (uint32_t)crc32(0, block, (uInt)rawSize);
+
+        /* Keep the raw data when the codec does not help */
+        if (codec->encode(block, rawSize, blocks[i].data(), encodedSize) == false || encodedSize >= rawSize) {
+            blocks[i].assign(block, block + rawSize);
+            encodedSize = rawSize;
+        }
+        blocks[i].resize(encodedSize);
+        entries[i].size = (uint32_t)encodedSize;
+    });
+
+    BlockStreamHeader header;
+    header.codec = codecType;
+    header.blockSize = blockSize;
+    header.size = size;
+
+    size_t totalSize = sizeof header + numBlocks * sizeof(BlockEntry);
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+        totalSize += blocks[i].size();
+    }
+
+    output.resize(totalSize);
+    uint8_t *out = output.data();
+
+    memcpy(out, &header, sizeof header);
+    out += sizeof header;
+    memcpy(out, entries.data(), numBlocks * sizeof(BlockEntry));
+    out += numBlocks * sizeof(BlockEntry);
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+        memcpy(out, blocks[i].data(), blocks[i].size());
+        out += blocks[i].size();
+    }
+
+    return true;
+}
+
+bool ZDecompression::Decompress(const void *data, size_t size, void *output, size_t outputSize)
+{
+    const uint8_t *in = (const uint8_t *)data;
+    BlockStreamHeader header;
+
+    if (size < sizeof header) {
+        Logging::log("ERROR decompressing data, stream is too short\n");
+        return false;
+    }
+    memcpy(&header, in, sizeof header);
+
+    const Codec *codec = Codec::Get((Codec::Type)header.codec);
+    if (codec == NULL || header.size != outputSize || header.blockSize == 0) {
+        Logging::log("ERROR decompressing data, wrong stream header\n");
+        return false;
+    }
+
+    uint32_t numBlocks = (uint32_t)((outputSize + header.blockSize - 1) / header.blockSize);
+    if ((size - sizeof header) / sizeof(BlockEntry) < numBlocks) {
+        Logging::log("ERROR decompressing data, stream is too short\n");
+        return false;
+    }
+
+    /* Locate each block */
+    std::vector<BlockEntry> entries(numBlocks);
+    std::vector<size_t> offsets(numBlocks);
+    size_t offset = sizeof header + numBlocks * sizeof(BlockEntry);
+
+    memcpy(entries.data(), in + sizeof header, numBlocks * sizeof(BlockEntry));
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+        offsets[i] = offset;
+        offset += entries[i].size;
+    }
+    if (offset > size) {
+        Logging::log("ERROR decompressing data, stream is too short\n");
+        return false;
+    }
+
+    /* Decompress and verify each block independently */
+    std::atomic<bool> ok(true);
+    WorkerPool::GetInstance()->parallelFor(numBlocks, [&](uint32_t i) {
+        uint8_t *block = (uint8_t *)output + (size_t)i * header.blockSize;
+        size_t rawSize = i == numBlocks - 1 ? outputSize - (size_t)i * header.blockSize : header.blockSize;
+        bool decoded;
+
+        if (entries[i].size == rawSize) {
+            memcpy(block, in + offsets[i], rawSize);
+            decoded = true;
+        } else {
+            decoded = codec->decode(in + offsets[i], entries[i].size, block, rawSize);
+        }
+
+        if (decoded == false || (uint32_t)crc32(0, block, (uInt)rawSize) != entries[i].checksum) {
+            ok = false;
+        }
+    });
+
+    if (ok == false) {
+        Logging::log("ERROR decompressing data, corrupted block\n");
+        return false;
+    }
+
+    return true;
+}